@@ -42,7 +42,8 @@ G_DEFINE_BOXED_TYPE (EggCounterArena, egg_counter_arena, egg_counter_arena_ref,
 #define MAX_COUNTERS       2000
 #define NAME_FORMAT        "/EggCounters-%u"
 #define MAGIC              0x71167125
-#define COUNTER_MAX_SHM    (1024 * 1024 * 4)
+#define COUNTER_MAX_SHM    (1024 * 1024 * 16)
+#define MAX_HISTOGRAMS     32
 #define COUNTERS_PER_GROUP 8
 #define DATA_CELL_SIZE     64
 #define CELLS_PER_INFO     (sizeof(CounterInfo) / DATA_CELL_SIZE)
@@ -50,6 +51,9 @@ G_DEFINE_BOXED_TYPE (EggCounterArena, egg_counter_arena, egg_counter_arena_ref,
 #define CELLS_PER_GROUP(ncpu)                             \
   (((sizeof (CounterInfo) * COUNTERS_PER_GROUP) +         \
     (sizeof(EggCounterValue) * (ncpu))) / DATA_CELL_SIZE)
+#define CELLS_PER_HISTOGRAM(ncpu)                         \
+  ((sizeof (HistogramInfo) +                              \
+    (sizeof (EggHistogramValue) * (ncpu))) / DATA_CELL_SIZE)
 #define EGG_MEMORY_BARRIER __sync_synchronize()
 
 typedef struct
@@ -69,6 +73,19 @@ G_STATIC_ASSERT (CELLS_PER_GROUP(4) == 20);
 G_STATIC_ASSERT (CELLS_PER_GROUP(8) == 24);
 G_STATIC_ASSERT (CELLS_PER_GROUP(16) == 32);
 
+typedef struct
+{
+  gchar   category[20];    /* Histogram category name. */
+  gchar   name[32];        /* Histogram name. */
+  gchar   description[72]; /* Histogram description */
+  guint32 n_buckets;       /* Number of buckets per CPU */
+} HistogramInfo __attribute__((aligned (DATA_CELL_SIZE)));
+
+G_STATIC_ASSERT (sizeof (HistogramInfo) == 128);
+G_STATIC_ASSERT (sizeof (EggHistogramValue) == 768);
+G_STATIC_ASSERT (CELLS_PER_HISTOGRAM(1) == 14);
+G_STATIC_ASSERT (CELLS_PER_HISTOGRAM(4) == 50);
+
 typedef struct
 {
   gint64 values[8];
@@ -83,7 +100,9 @@ typedef struct
   guint32 ncpu;          /* Number of CPUs registered with */
   guint32 first_offset;  /* Offset to first counter info in cells */
   guint32 n_counters;    /* Number of CounterInfos */
-  gchar   padding [108];
+  guint32 histogram_offset; /* Offset to first histogram info in cells */
+  guint32 n_histograms;  /* Number of HistogramInfos */
+  gchar   padding [100];
 } ShmHeader __attribute__((aligned (DATA_CELL_SIZE)));
 
 G_STATIC_ASSERT (sizeof(ShmHeader) == (DATA_CELL_SIZE * CELLS_PER_HEADER));
@@ -100,6 +119,9 @@ struct _EggCounterArena
   GPid      pid;
   guint     n_counters;
   GList    *counters;
+  gsize     histogram_offset;
+  guint     n_histograms;
+  GList    *histograms;
 };
 
 G_LOCK_DEFINE_STATIC (reglock);
@@ -160,6 +182,7 @@ _egg_counter_arena_init_local (EggCounterArena *arena)
   gpointer mem;
   unsigned pid;
   gsize size;
+  gsize counters_size;
   gint page_size;
   gint fd;
   gchar name [32];
@@ -170,7 +193,8 @@ _egg_counter_arena_init_local (EggCounterArena *arena)
   if (page_size < 4096)
     {
       page_size = 4096;
-      size = page_size * 4;
+      counters_size = page_size * 4;
+      size = counters_size + (CELLS_PER_HISTOGRAM (g_get_num_processors ()) * DATA_CELL_SIZE * MAX_HISTOGRAMS);
       goto use_malloc;
     }
 
@@ -180,8 +204,12 @@ _egg_counter_arena_init_local (EggCounterArena *arena)
    * We have some very tricky work ahead of us to add unlimited numbers
    * of counters at runtime. We basically need to avoid placing counters
    * that could overlap a page.
+   *
+   * Histograms are placed after the counters. They are much larger (a row
+   * of buckets per CPU), so we reserve room for a fixed number of them.
    */
-  size = page_size * 4;
+  counters_size = page_size * 4;
+  size = counters_size + (CELLS_PER_HISTOGRAM (g_get_num_processors ()) * DATA_CELL_SIZE * MAX_HISTOGRAMS);
 
   arena->ref_count = 1;
   arena->is_local_arena = TRUE;
@@ -218,11 +246,13 @@ _egg_counter_arena_init_local (EggCounterArena *arena)
   arena->cells = mem;
   arena->n_cells = (size / DATA_CELL_SIZE);
   arena->data_length = size;
+  arena->histogram_offset = counters_size / DATA_CELL_SIZE;
 
   header = mem;
   header->magic = MAGIC;
   header->ncpu = g_get_num_processors ();
   header->first_offset = CELLS_PER_HEADER;
+  header->histogram_offset = arena->histogram_offset;
 
   EGG_MEMORY_BARRIER;
 
@@ -254,10 +284,14 @@ use_malloc:
       abort ();
     }
 
+  memset (arena->cells, 0, size << 1);
+  arena->histogram_offset = counters_size / DATA_CELL_SIZE;
+
   header = (void *)arena->cells;
   header->magic = MAGIC;
   header->ncpu = g_get_num_processors ();
   header->first_offset = CELLS_PER_HEADER;
+  header->histogram_offset = arena->histogram_offset;
 
   EGG_MEMORY_BARRIER;
 
@@ -274,6 +308,7 @@ _egg_counter_arena_init_remote (EggCounterArena *arena,
   void *mem = NULL;
   guint ncpu;
   guint n_counters;
+  guint n_histograms;
   int i;
   int fd = -1;
 
@@ -355,6 +390,39 @@ _egg_counter_arena_init_remote (EggCounterArena *arena,
       arena->counters = g_list_prepend (arena->counters, counter);
     }
 
+  /*
+   * Histograms are laid out back to back after the counters, each being an
+   * info block followed by a row of buckets per CPU of the remote process.
+   */
+  n_histograms = MIN (header.n_histograms, MAX_HISTOGRAMS);
+
+  for (i = 0; i < n_histograms; i++)
+    {
+      HistogramInfo *info;
+      EggHistogram *histogram;
+      gsize start_cell;
+
+      start_cell = header.histogram_offset + ((gsize)CELLS_PER_HISTOGRAM (header.ncpu) * i);
+
+      if (header.histogram_offset == 0 ||
+          start_cell + CELLS_PER_HISTOGRAM (header.ncpu) > arena->n_cells)
+        goto failure;
+
+      info = (HistogramInfo *)&arena->cells[start_cell];
+
+      if (info->n_buckets != EGG_HISTOGRAM_N_BUCKETS)
+        continue;
+
+      histogram = g_new0 (EggHistogram, 1);
+      histogram->category = g_strndup (info->category, sizeof info->category);
+      histogram->name = g_strndup (info->name, sizeof info->name);
+      histogram->description = g_strndup (info->description, sizeof info->description);
+      histogram->values = (EggHistogramValue *)&arena->cells[start_cell + CELLS_PER_INFO];
+      histogram->n_values = header.ncpu;
+
+      arena->histograms = g_list_prepend (arena->histograms, histogram);
+    }
+
   close (fd);
 
   return TRUE;
@@ -395,6 +463,7 @@ _egg_counter_arena_destroy (EggCounterArena *arena)
     g_free (arena->cells);
 
   g_clear_pointer (&arena->counters, g_list_free);
+  g_clear_pointer (&arena->histograms, g_list_free);
 
   arena->cells = NULL;
 
@@ -493,10 +562,33 @@ egg_counter_arena_register (EggCounterArena *arena,
    * Get the starting cell for this group. Cells roughly map to cachelines.
    */
   group_start_cell = CELLS_PER_HEADER + (CELLS_PER_GROUP (ncpu) * group);
-  info = &((CounterInfo *)&arena->cells [group_start_cell])[position];
 
   g_assert (position < COUNTERS_PER_GROUP);
-  g_assert (group_start_cell < arena->n_cells);
+
+  /*
+   * If we have run out of room, keep the counter working for this process
+   * but do not publish it to the shared memory zone.
+   */
+  if (group_start_cell + CELLS_PER_GROUP (ncpu) > arena->histogram_offset)
+    {
+      static gboolean warned;
+
+      if (!warned)
+        {
+          g_warning ("Out of space for counters, %s.%s will not be visible to external processes.",
+                     counter->category, counter->name);
+          warned = TRUE;
+        }
+
+      counter->values = g_new0 (EggCounterValue, ncpu);
+      arena->counters = g_list_append (arena->counters, counter);
+
+      G_UNLOCK (reglock);
+
+      return;
+    }
+
+  info = &((CounterInfo *)&arena->cells [group_start_cell])[position];
 
   /*
    * Store information about the counter in the SHM area. Also, update
@@ -529,6 +621,206 @@ egg_counter_arena_register (EggCounterArena *arena,
   G_UNLOCK (reglock);
 }
 
+/**
+ * egg_counter_arena_foreach_histogram:
+ * @arena: An #EggCounterArena
+ * @func: (scope call): A callback to execute
+ * @user_data: user data for @func
+ *
+ * Calls @func for every histogram found in @arena.
+ */
+void
+egg_counter_arena_foreach_histogram (EggCounterArena         *arena,
+                                     EggHistogramForeachFunc  func,
+                                     gpointer                 user_data)
+{
+  GList *iter;
+
+  g_return_if_fail (arena != NULL);
+  g_return_if_fail (func != NULL);
+
+  for (iter = arena->histograms; iter; iter = iter->next)
+    func (iter->data, user_data);
+}
+
+void
+egg_counter_arena_register_histogram (EggCounterArena *arena,
+                                      EggHistogram    *histogram)
+{
+  HistogramInfo *info;
+  gsize start_cell;
+  guint ncpu;
+
+  g_return_if_fail (arena != NULL);
+  g_return_if_fail (histogram != NULL);
+
+  if (!arena->is_local_arena)
+    {
+      g_warning ("Cannot add histograms to a remote arena.");
+      return;
+    }
+
+  ncpu = g_get_num_processors ();
+
+  G_LOCK (reglock);
+
+  histogram->n_values = ncpu;
+
+  if (arena->n_histograms >= MAX_HISTOGRAMS)
+    {
+      g_warning ("Out of space for histograms, %s.%s will not be visible to external processes.",
+                 histogram->category, histogram->name);
+      histogram->values = g_new0 (EggHistogramValue, ncpu);
+      arena->histograms = g_list_append (arena->histograms, histogram);
+      G_UNLOCK (reglock);
+      return;
+    }
+
+  start_cell = arena->histogram_offset + (CELLS_PER_HISTOGRAM (ncpu) * arena->n_histograms);
+
+  g_assert (start_cell + CELLS_PER_HISTOGRAM (ncpu) <= arena->n_cells);
+
+  info = (HistogramInfo *)&arena->cells [start_cell];
+  info->n_buckets = EGG_HISTOGRAM_N_BUCKETS;
+  g_snprintf (info->category, sizeof info->category, "%s", histogram->category);
+  g_snprintf (info->description, sizeof info->description, "%s", histogram->description);
+  g_snprintf (info->name, sizeof info->name, "%s", histogram->name);
+  histogram->values = (EggHistogramValue *)&arena->cells [start_cell + CELLS_PER_INFO];
+
+  arena->histograms = g_list_append (arena->histograms, histogram);
+  arena->n_histograms++;
+
+  EGG_MEMORY_BARRIER;
+  ((ShmHeader *)&arena->cells[0])->n_histograms++;
+
+  G_UNLOCK (reglock);
+}
+
+/**
+ * egg_histogram_get_buckets:
+ * @histogram: An #EggHistogram
+ * @buckets: (array fixed-size=96) (out caller-allocates): a location
+ *   for %EGG_HISTOGRAM_N_BUCKETS values
+ *
+ * Sums the per-CPU buckets of @histogram into @buckets.
+ */
+void
+egg_histogram_get_buckets (EggHistogram *histogram,
+                           gint64       *buckets)
+{
+  guint i;
+  guint j;
+
+  g_return_if_fail (histogram != NULL);
+  g_return_if_fail (buckets != NULL);
+
+  memset (buckets, 0, sizeof (gint64) * EGG_HISTOGRAM_N_BUCKETS);
+
+  EGG_MEMORY_BARRIER;
+
+  for (i = 0; i < histogram->n_values; i++)
+    for (j = 0; j < EGG_HISTOGRAM_N_BUCKETS; j++)
+      buckets [j] += histogram->values [i].buckets [j];
+}
+
+gint64
+egg_histogram_get_count (EggHistogram *histogram)
+{
+  gint64 buckets [EGG_HISTOGRAM_N_BUCKETS];
+  gint64 count = 0;
+  guint i;
+
+  g_return_val_if_fail (histogram != NULL, 0);
+
+  egg_histogram_get_buckets (histogram, buckets);
+
+  for (i = 0; i < EGG_HISTOGRAM_N_BUCKETS; i++)
+    count += buckets [i];
+
+  return count;
+}
+
+/**
+ * egg_histogram_bucket_upper_bound:
+ * @bucket: the index of a bucket
+ *
+ * Gets the smallest value that is larger than every value that is placed
+ * into @bucket.
+ */
+gint64
+egg_histogram_bucket_upper_bound (guint bucket)
+{
+  guint octave;
+  guint sub;
+
+  g_return_val_if_fail (bucket < EGG_HISTOGRAM_N_BUCKETS, 0);
+
+  if (bucket < 8)
+    return bucket + 1;
+
+  octave = 3 + ((bucket - 8) >> 2);
+  sub = (bucket - 8) & 3;
+
+  return (gint64)(5 + sub) << (octave - 2);
+}
+
+/**
+ * egg_histogram_get_percentile:
+ * @histogram: An #EggHistogram
+ * @percentile: the percentile, between 0 and 100
+ *
+ * Estimates the value below which @percentile percent of the recorded
+ * values fall. The upper bound of the matching bucket is returned, so the
+ * result may overestimate by up to 25%.
+ *
+ * Returns: the estimated value, or 0 if nothing has been recorded.
+ */
+gint64
+egg_histogram_get_percentile (EggHistogram *histogram,
+                              gdouble       percentile)
+{
+  gint64 buckets [EGG_HISTOGRAM_N_BUCKETS];
+  gint64 count = 0;
+  gint64 target;
+  gint64 seen = 0;
+  guint i;
+
+  g_return_val_if_fail (histogram != NULL, 0);
+
+  egg_histogram_get_buckets (histogram, buckets);
+
+  for (i = 0; i < EGG_HISTOGRAM_N_BUCKETS; i++)
+    count += buckets [i];
+
+  if (count == 0)
+    return 0;
+
+  target = (gint64)((CLAMP (percentile, 0.0, 100.0) / 100.0) * count);
+  target = MAX (target, 1);
+
+  for (i = 0; i < EGG_HISTOGRAM_N_BUCKETS; i++)
+    {
+      seen += buckets [i];
+      if (seen >= target)
+        return egg_histogram_bucket_upper_bound (i);
+    }
+
+  return egg_histogram_bucket_upper_bound (EGG_HISTOGRAM_N_BUCKETS - 1);
+}
+
+void
+egg_histogram_reset (EggHistogram *histogram)
+{
+  guint i;
+
+  g_return_if_fail (histogram != NULL);
+
+  for (i = 0; i < histogram->n_values; i++)
+    memset ((gpointer)histogram->values [i].buckets, 0, sizeof histogram->values [i].buckets);
+
+  EGG_MEMORY_BARRIER;
+}
+
 #ifdef __linux__
 static void *
 _egg_counter_find_getcpu_in_vdso (void)
@@ -80,6 +80,26 @@
  * You cannot remove a counter once it has been registered.
  *
  *
+ * Histograms
+ * ==========
+ *
+ * When a distribution matters more than a total, such as the latency of an
+ * operation, use an EggHistogram. They live in the same shared memory zone
+ * as counters and are updated the same way, using a row of buckets per CPU.
+ *
+ *   EGG_DEFINE_HISTOGRAM (Symbol, "Category", "Name", "Description")
+ *
+ * Record a value, typically a duration in microseconds, with
+ * EGG_HISTOGRAM_RECORD, or time the rest of the current scope with
+ * EGG_HISTOGRAM_SCOPE.
+ *
+ *   EGG_HISTOGRAM_SCOPE (Symbol);
+ *
+ * Buckets are log-linear: values below 8 get their own bucket, after which
+ * every power of two is split into 4 buckets. That gives a resolution of
+ * 25% or better up to 2^25 (about 33 seconds when recording microseconds).
+ *
+ *
  * Accessing Counters Remotely
  * ===========================
  *
@@ -284,6 +304,159 @@ void             egg_counter_arena_foreach      (EggCounterArena       *arena,
 void             egg_counter_reset              (EggCounter            *counter);
 gint64           egg_counter_get                (EggCounter            *counter);
 
+/**
+ * EGG_DEFINE_HISTOGRAM:
+ * @Identifier: The symbol name of the histogram
+ * @Category: A string category for the histogram.
+ * @Name: A string name for the histogram.
+ * @Description: A string description for the histogram.
+ *
+ * |[<!-- language="C" -->
+ * EGG_DEFINE_HISTOGRAM (my_latency, "My", "Latency", "Time to do the thing in usec");
+ * ]|
+ */
+#define EGG_DEFINE_HISTOGRAM(Identifier, Category, Name, Description)                           \
+ static EggHistogram Identifier##_hist = { NULL, 0, Category, Name, Description };              \
+ static void Identifier##_hist_init (void) __attribute__((constructor));                        \
+ static void                                                                                    \
+ Identifier##_hist_init (void)                                                                  \
+ {                                                                                              \
+   egg_counter_arena_register_histogram (egg_counter_arena_get_default(), &Identifier##_hist); \
+ }
+
+/**
+ * EGG_HISTOGRAM_RECORD:
+ * @Identifier: The identifier of the histogram.
+ * @Value: The value to record.
+ *
+ * Adds @Value to the histogram identified by @Identifier.
+ */
+#define EGG_HISTOGRAM_RECORD(Identifier, Value) \
+  egg_histogram_record (&Identifier##_hist, (Value))
+
+/**
+ * EGG_HISTOGRAM_SCOPE:
+ * @Identifier: The identifier of the histogram.
+ *
+ * Records the number of microseconds until the end of the enclosing scope
+ * into the histogram identified by @Identifier.
+ */
+#define EGG_HISTOGRAM_SCOPE(Identifier)                                              \
+  EggHistogramScope G_PASTE (_egg_histogram_scope_, __LINE__)                        \
+    __attribute__((cleanup (egg_histogram_scope_end))) G_GNUC_UNUSED =               \
+    { &Identifier##_hist, g_get_monotonic_time () }
+
+#define EGG_HISTOGRAM_N_BUCKETS 96
+
+typedef struct _EggHistogram      EggHistogram;
+typedef struct _EggHistogramValue EggHistogramValue;
+
+struct _EggHistogram
+{
+  /*< Private >*/
+  EggHistogramValue *values;
+  guint              n_values;
+  const gchar       *category;
+  const gchar       *name;
+  const gchar       *description;
+};
+
+struct _EggHistogramValue
+{
+  volatile gint64 buckets [EGG_HISTOGRAM_N_BUCKETS];
+} __attribute__ ((aligned(64)));
+
+typedef struct
+{
+  EggHistogram *histogram;
+  gint64        begin;
+} EggHistogramScope;
+
+/**
+ * EggHistogramForeachFunc:
+ * @histogram: the histogram.
+ * @user_data: data supplied to egg_counter_arena_foreach_histogram().
+ *
+ * Function prototype for callbacks provided to
+ * egg_counter_arena_foreach_histogram().
+ */
+typedef void (*EggHistogramForeachFunc) (EggHistogram *histogram,
+                                         gpointer      user_data);
+
+void             egg_counter_arena_register_histogram (EggCounterArena         *arena,
+                                                       EggHistogram            *histogram);
+void             egg_counter_arena_foreach_histogram  (EggCounterArena         *arena,
+                                                       EggHistogramForeachFunc  func,
+                                                       gpointer                 user_data);
+void             egg_histogram_get_buckets            (EggHistogram            *histogram,
+                                                       gint64                  *buckets);
+gint64           egg_histogram_get_count              (EggHistogram            *histogram);
+gint64           egg_histogram_get_percentile         (EggHistogram            *histogram,
+                                                       gdouble                  percentile);
+gint64           egg_histogram_bucket_upper_bound     (guint                    bucket);
+void             egg_histogram_reset                  (EggHistogram            *histogram);
+
+static inline guint
+egg_histogram_get_bucket (gint64 value)
+{
+  guint octave;
+  guint bucket;
+
+  if (value < 8)
+    return value < 0 ? 0 : (guint)value;
+
+  octave = 63 - __builtin_clzll ((guint64)value);
+  bucket = 8 + ((octave - 3) << 2) + (((guint64)value >> (octave - 2)) & 3);
+
+  return MIN (bucket, EGG_HISTOGRAM_N_BUCKETS - 1);
+}
+
+/**
+ * egg_histogram_record:
+ * @histogram: An #EggHistogram.
+ * @value: the value to record.
+ *
+ * Adds @value to @histogram. Like counters, this does not synchronize with
+ * other threads and may very rarely lose a value.
+ */
+static inline void
+egg_histogram_record (EggHistogram *histogram,
+                      gint64        value)
+{
+  guint bucket = egg_histogram_get_bucket (value);
+
+#ifdef EGG_COUNTER_REQUIRES_ATOMIC
+  __sync_add_and_fetch ((gint64 *)&histogram->values[0].buckets[bucket], 1);
+#else
+  histogram->values[egg_get_current_cpu()].buckets[bucket]++;
+#endif
+}
+
+static inline void
+egg_histogram_scope_end (EggHistogramScope *scope)
+{
+  egg_histogram_record (scope->histogram, g_get_monotonic_time () - scope->begin);
+}
+
+/**
+ * egg_counter_add:
+ * @counter: An #EggCounter registered with egg_counter_arena_register().
+ * @count: the amount to add to the counter.
+ *
+ * Like EGG_COUNTER_ADD() but for counters that are registered at runtime,
+ * such as one counter per plugin type, rather than with EGG_DEFINE_COUNTER().
+ */
+static inline void
+egg_counter_add (EggCounter *counter,
+                 gint64      count)
+{
+#ifdef EGG_COUNTER_REQUIRES_ATOMIC
+  __sync_add_and_fetch ((gint64 *)&counter->values[0], count);
+#else
+  counter->values[egg_get_current_cpu()].value += count;
+#endif
+}
+
 G_END_DECLS
 
 #endif /* EGG_COUNTER_H */
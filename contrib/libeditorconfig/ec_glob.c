@@ -46,20 +46,25 @@ static const UT_icd ut_int_pair_icd = {sizeof(int_pair),NULL,NULL,NULL};
 #define STRING_CAT(p, string, end)  do {    \
     size_t string_len = strlen(string); \
     if (p + string_len >= end) \
-        return -1; \
+        goto overflow; \
     strcat(p, string); \
     p += string_len; \
 } while(0)
 
 #define PATTERN_MAX  300
+
+struct ec_glob_re
+{
+    pcre *      re;
+    UT_array *  nums;     /* number ranges */
+};
+
 /*
- * Whether the string matches the given glob pattern
+ * Compile the glob pattern so that it can be matched against many strings
  */
 EDITORCONFIG_LOCAL
-int ec_glob(const char *pattern, const char *string)
+ec_glob_re *ec_glob_compile(const char *pattern)
 {
-    size_t                    i;
-    int_pair *                p;
     char *                    c;
     char                      pcre_str[2 * PATTERN_MAX] = "^";
     char *                    p_pcre;
@@ -70,15 +75,13 @@ int ec_glob(const char *pattern, const char *string)
     int                       erroffset;
     pcre *                    re;
     int                       rc;
-    int *                     pcre_result;
-    size_t                    pcre_result_len;
     char                      l_pattern[2 * PATTERN_MAX];
     _Bool                     are_brace_paired;
     UT_array *                nums;     /* number ranges */
-    int                       ret = 0;
+    ec_glob_re *              ret;
 
-    if (pattern == NULL || string == NULL || (strlen (pattern) > PATTERN_MAX))
-      return -1;
+    if (pattern == NULL || (strlen (pattern) > PATTERN_MAX))
+      return NULL;
 
     strcpy(l_pattern, pattern);
     p_pcre = pcre_str + 1;
@@ -108,7 +111,7 @@ int ec_glob(const char *pattern, const char *string)
     re = pcre_compile("^\\{[\\+\\-]?\\d+\\.\\.[\\+\\-]?\\d+\\}$", 0,
             &error_msg, &erroffset, NULL);
     if (!re)        /* failed to compile */
-        return -1;
+        return NULL;
 
     utarray_new(nums, &ut_int_pair_icd);
 
@@ -315,11 +318,50 @@ int ec_glob(const char *pattern, const char *string)
     re = pcre_compile(pcre_str, 0, &error_msg, &erroffset, NULL);
 
     if (!re)        /* failed to compile */
-        return -1;
+    {
+        utarray_free(nums);
+        return NULL;
+    }
+
+    ret = (ec_glob_re *) malloc(sizeof(ec_glob_re));
+    if (!ret)
+    {
+        pcre_free(re);
+        utarray_free(nums);
+        return NULL;
+    }
+
+    ret->re = re;
+    ret->nums = nums;
+
+    return ret;
+
+overflow:
+    pcre_free(re); /* ^\\d+\\.\\.\\d+$ */
+    utarray_free(nums);
+
+    return NULL;
+}
 
-    pcre_result_len = 3 * (utarray_len(nums) + 1);
+/*
+ * Whether the string matches the compiled glob pattern
+ */
+EDITORCONFIG_LOCAL
+int ec_glob_match(const ec_glob_re *glob, const char *string)
+{
+    size_t                    i;
+    int_pair *                p;
+    int                       rc;
+    int *                     pcre_result;
+    size_t                    pcre_result_len;
+    int                       ret = 0;
+
+    if (glob == NULL || string == NULL)
+      return -1;
+
+    pcre_result_len = 3 * (utarray_len(glob->nums) + 1);
     pcre_result = (int *) calloc(pcre_result_len, sizeof(int_pair));
-    rc = pcre_exec(re, NULL, string, (int) strlen(string), 0, 0,
+    rc = pcre_exec(glob->re, NULL, string, (int) strlen(string), 0, 0,
             pcre_result, pcre_result_len);
 
     if (rc < 0)     /* failed to match */
@@ -329,16 +371,14 @@ int ec_glob(const char *pattern, const char *string)
         else
             ret = rc;
 
-        pcre_free(re);
         free(pcre_result);
-        utarray_free(nums);
 
         return ret;
     }
 
     /* Whether the numbers are in the desired range? */
-    for(p = (int_pair *) utarray_front(nums), i = 1; p;
-            ++ i, p = (int_pair *) utarray_next(nums, p))
+    for(p = (int_pair *) utarray_front(glob->nums), i = 1; p;
+            ++ i, p = (int_pair *) utarray_next(glob->nums, p))
     {
         const char * substring_start = string + pcre_result[2 * i];
         size_t  substring_length = pcre_result[2 * i + 1] - pcre_result[2 * i];
@@ -360,9 +400,39 @@ int ec_glob(const char *pattern, const char *string)
     if (p != NULL)      /* numbers not matched */
         ret = EC_GLOB_NOMATCH;
 
-    pcre_free(re);
     free(pcre_result);
-    utarray_free(nums);
+
+    return ret;
+}
+
+EDITORCONFIG_LOCAL
+void ec_glob_free(ec_glob_re *glob)
+{
+    if (glob == NULL)
+        return;
+
+    pcre_free(glob->re);
+    utarray_free(glob->nums);
+    free(glob);
+}
+
+/*
+ * Whether the string matches the given glob pattern
+ */
+EDITORCONFIG_LOCAL
+int ec_glob(const char *pattern, const char *string)
+{
+    ec_glob_re *              glob;
+    int                       ret;
+
+    if (pattern == NULL || string == NULL)
+      return -1;
+
+    if (!(glob = ec_glob_compile(pattern)))
+      return -1;
+
+    ret = ec_glob_match(glob, string);
+    ec_glob_free(glob);
 
     return ret;
 }
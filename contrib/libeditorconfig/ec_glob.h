@@ -34,8 +34,16 @@
 #ifdef __cplusplus
 extern "C" {
 #endif
+typedef struct ec_glob_re ec_glob_re;
+
 EDITORCONFIG_LOCAL
 int ec_glob(const char * pattern, const char * string);
+EDITORCONFIG_LOCAL
+ec_glob_re * ec_glob_compile(const char * pattern);
+EDITORCONFIG_LOCAL
+int ec_glob_match(const ec_glob_re * glob, const char * string);
+EDITORCONFIG_LOCAL
+void ec_glob_free(ec_glob_re * glob);
 #ifdef __cplusplus
 }
 #endif
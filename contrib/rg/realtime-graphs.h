@@ -26,9 +26,13 @@ G_BEGIN_DECLS
 #include "rg-column.h"
 #include "rg-cpu-graph.h"
 #include "rg-cpu-table.h"
+#include "rg-disk-table.h"
 #include "rg-graph.h"
 #include "rg-line-renderer.h"
+#include "rg-memory-table.h"
+#include "rg-process-table.h"
 #include "rg-renderer.h"
+#include "rg-sampled-table.h"
 #include "rg-table.h"
 
 G_END_DECLS
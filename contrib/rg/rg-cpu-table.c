@@ -45,16 +45,14 @@ typedef struct
 
 struct _RgCpuTable
 {
-  RgTable  parent_instance;
+  RgSampledTable  parent_instance;
 
-  GArray  *cpu_info;
-  guint    n_cpu;
-
-  guint    poll_source;
-  guint    poll_interval_msec;
+  /* Only used from the sampler thread once sampling has started */
+  GArray         *cpu_info;
+  guint           n_cpu;
 };
 
-G_DEFINE_TYPE (RgCpuTable, rg_cpu_table, RG_TYPE_TABLE)
+G_DEFINE_TYPE (RgCpuTable, rg_cpu_table, RG_TYPE_SAMPLED_TABLE)
 
 #ifdef __linux__
 static void
@@ -221,48 +219,29 @@ rg_cpu_table_poll (RgCpuTable *self)
 #endif
 
 static gboolean
-rg_cpu_table_poll_cb (gpointer user_data)
+rg_cpu_table_sample (RgSampledTable *sampled,
+                     gint64          timestamp,
+                     gdouble        *values)
 {
-  RgCpuTable *self = user_data;
-  RgTableIter iter;
+  RgCpuTable *self = (RgCpuTable *)sampled;
   guint i;
 
   rg_cpu_table_poll (self);
 
-  rg_table_push (RG_TABLE (self), &iter, g_get_monotonic_time ());
-
   for (i = 0; i < self->cpu_info->len; i++)
-    {
-      CpuInfo *cpu_info;
+    values [i] = g_array_index (self->cpu_info, CpuInfo, i).total;
 
-      cpu_info = &g_array_index (self->cpu_info, CpuInfo, i);
-      rg_table_iter_set (&iter, i, cpu_info->total, -1);
-    }
-
-  return G_SOURCE_CONTINUE;
+  return TRUE;
 }
 
 static void
 rg_cpu_table_constructed (GObject *object)
 {
   RgCpuTable *self = (RgCpuTable *)object;
-  gint64 timespan;
-  guint max_samples;
   guint i;
 
   G_OBJECT_CLASS (rg_cpu_table_parent_class)->constructed (object);
 
-  max_samples = rg_table_get_max_samples (RG_TABLE (self));
-  timespan = rg_table_get_timespan (RG_TABLE (self));
-
-  self->poll_interval_msec = (gdouble)timespan / (gdouble)(max_samples - 1) / 1000L;
-
-  if (self->poll_interval_msec == 0)
-    {
-      g_critical ("Implausible timespan/max_samples combination for graph.");
-      self->poll_interval_msec = 1000;
-    }
-
   self->n_cpu = g_get_num_processors ();
 
   for (i = 0; i < self->n_cpu; i++)
@@ -283,7 +262,7 @@ rg_cpu_table_constructed (GObject *object)
 
   rg_cpu_table_poll (self);
 
-  self->poll_source = g_timeout_add (self->poll_interval_msec, rg_cpu_table_poll_cb, self);
+  rg_sampled_table_start (RG_SAMPLED_TABLE (self));
 }
 
 static void
@@ -291,12 +270,6 @@ rg_cpu_table_finalize (GObject *object)
 {
   RgCpuTable *self = (RgCpuTable *)object;
 
-  if (self->poll_source != 0)
-    {
-      g_source_remove (self->poll_source);
-      self->poll_source = 0;
-    }
-
   g_clear_pointer (&self->cpu_info, g_array_unref);
 
   G_OBJECT_CLASS (rg_cpu_table_parent_class)->finalize (object);
@@ -306,9 +279,12 @@ static void
 rg_cpu_table_class_init (RgCpuTableClass *klass)
 {
   GObjectClass *object_class = G_OBJECT_CLASS (klass);
+  RgSampledTableClass *sampled_table_class = RG_SAMPLED_TABLE_CLASS (klass);
 
   object_class->constructed = rg_cpu_table_constructed;
   object_class->finalize = rg_cpu_table_finalize;
+
+  sampled_table_class->sample = rg_cpu_table_sample;
 }
 
 static void
@@ -19,13 +19,13 @@
 #ifndef RG_CPU_TABLE_H
 #define RG_CPU_TABLE_H
 
-#include "rg-table.h"
+#include "rg-sampled-table.h"
 
 G_BEGIN_DECLS
 
 #define RG_TYPE_CPU_TABLE (rg_cpu_table_get_type())
 
-G_DECLARE_FINAL_TYPE (RgCpuTable, rg_cpu_table, RG, CPU_TABLE, RgTable)
+G_DECLARE_FINAL_TYPE (RgCpuTable, rg_cpu_table, RG, CPU_TABLE, RgSampledTable)
 
 RgTable *rg_cpu_table_new (void);
 
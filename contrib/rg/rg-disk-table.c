@@ -0,0 +1,153 @@
+/* rg-disk-table.c
+ *
+ * Copyright (C) 2016 Christian Hergert <christian@hergert.me>
+ *
+ * This file is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This file is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <glib/gi18n.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "rg-disk-table.h"
+
+/*
+ * Graphs how busy the busiest block device is, as the percentage of time
+ * it spent doing I/O since the previous sample. Using the busiest device
+ * rather than a sum keeps the values between 0 and 100 and means that
+ * partitions do not count twice.
+ *
+ * Device statistics are only read from /proc/diskstats, so elsewhere the
+ * table is never sampled and is not shown in the sysmon panel.
+ */
+
+struct _RgDiskTable
+{
+  RgSampledTable  parent_instance;
+
+  /* Only used from the sampler thread once sampling has started */
+  GHashTable     *last_io_msec;
+  gint64          last_timestamp;
+};
+
+G_DEFINE_TYPE (RgDiskTable, rg_disk_table, RG_TYPE_SAMPLED_TABLE)
+
+#ifdef __linux__
+static gboolean
+rg_disk_table_sample (RgSampledTable *sampled,
+                      gint64          timestamp,
+                      gdouble        *values)
+{
+  RgDiskTable *self = (RgDiskTable *)sampled;
+  g_autofree gchar *buf = NULL;
+  gdouble elapsed_msec;
+  gdouble busiest = 0.0;
+  gboolean ret;
+  gchar *line;
+  gchar *save = NULL;
+
+  if (!g_file_get_contents ("/proc/diskstats", &buf, NULL, NULL))
+    return FALSE;
+
+  elapsed_msec = (timestamp - self->last_timestamp) / 1000.0;
+
+  for (line = strtok_r (buf, "\n", &save); line != NULL; line = strtok_r (NULL, "\n", &save))
+    {
+      gchar name[64];
+      gpointer last;
+      gulong io_msec;
+
+      if (sscanf (line, " %*u %*u %63s %*u %*u %*u %*u %*u %*u %*u %*u %*u %lu", name, &io_msec) != 2)
+        continue;
+
+      if (g_str_has_prefix (name, "loop") || g_str_has_prefix (name, "ram"))
+        continue;
+
+      if (g_hash_table_lookup_extended (self->last_io_msec, name, NULL, &last) && elapsed_msec > 0)
+        {
+          gulong delta = io_msec - GPOINTER_TO_SIZE (last);
+
+          busiest = MAX (busiest, MIN (100.0, delta / elapsed_msec * 100.0));
+        }
+
+      g_hash_table_insert (self->last_io_msec, g_strdup (name), GSIZE_TO_POINTER (io_msec));
+    }
+
+  /* The first sample only primes the counters */
+  ret = (self->last_timestamp != 0);
+
+  self->last_timestamp = timestamp;
+  values [0] = busiest;
+
+  return ret;
+}
+#endif
+
+static void
+rg_disk_table_constructed (GObject *object)
+{
+  RgDiskTable *self = (RgDiskTable *)object;
+  RgColumn *column;
+
+  G_OBJECT_CLASS (rg_disk_table_parent_class)->constructed (object);
+
+  column = rg_column_new (_("Disk"), G_TYPE_DOUBLE);
+  rg_table_add_column (RG_TABLE (self), column);
+  g_object_unref (column);
+
+#ifdef __linux__
+  rg_sampled_table_start (RG_SAMPLED_TABLE (self));
+#endif
+}
+
+static void
+rg_disk_table_finalize (GObject *object)
+{
+  RgDiskTable *self = (RgDiskTable *)object;
+
+  g_clear_pointer (&self->last_io_msec, g_hash_table_unref);
+
+  G_OBJECT_CLASS (rg_disk_table_parent_class)->finalize (object);
+}
+
+static void
+rg_disk_table_class_init (RgDiskTableClass *klass)
+{
+  GObjectClass *object_class = G_OBJECT_CLASS (klass);
+  RgSampledTableClass *sampled_table_class = RG_SAMPLED_TABLE_CLASS (klass);
+
+  object_class->constructed = rg_disk_table_constructed;
+  object_class->finalize = rg_disk_table_finalize;
+
+#ifdef __linux__
+  sampled_table_class->sample = rg_disk_table_sample;
+#endif
+}
+
+static void
+rg_disk_table_init (RgDiskTable *self)
+{
+  self->last_io_msec = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+
+  g_object_set (self,
+                "value-min", 0.0,
+                "value-max", 100.0,
+                NULL);
+}
+
+RgTable *
+rg_disk_table_new (void)
+{
+  return g_object_new (RG_TYPE_DISK_TABLE, NULL);
+}
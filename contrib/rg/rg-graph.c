@@ -121,13 +121,17 @@ rg_graph_tick_cb (GtkWidget     *widget,
 
   g_assert (RG_IS_GRAPH (self));
 
-  if ((priv->surface == NULL) || (priv->table == NULL) || !gtk_widget_get_visible (widget))
+  /* Stop ticking while we are not on screen, drawing will restart it */
+  if ((priv->surface == NULL) || (priv->table == NULL) || !gtk_widget_get_mapped (widget))
     goto remove_handler;
 
   timespan = rg_table_get_timespan (priv->table);
   if (timespan == 0)
     goto remove_handler;
 
+  /* Bring in the samples collected since the last frame */
+  rg_table_update (priv->table);
+
   gtk_widget_get_allocation (widget, &alloc);
 
   frame_time = gdk_frame_clock_get_frame_time (frame_clock);
@@ -135,7 +139,8 @@ rg_graph_tick_cb (GtkWidget     *widget,
 
   x_offset = -((frame_time - end_time) / (gdouble)timespan);
 
-  if (x_offset != priv->x_offset)
+  /* Only redraw when the graph moved by at least a pixel */
+  if (priv->surface_dirty || (gint)(x_offset * alloc.width) != (gint)(priv->x_offset * alloc.width))
     {
       priv->x_offset = x_offset;
       gtk_widget_queue_draw (widget);
@@ -182,6 +187,8 @@ rg_graph_ensure_surface (RgGraph *self)
   if (priv->table == NULL)
     return;
 
+  rg_table_update (priv->table);
+
   if (priv->surface_dirty)
     {
       priv->surface_dirty = FALSE;
@@ -0,0 +1,139 @@
+/* rg-memory-table.c
+ *
+ * Copyright (C) 2016 Christian Hergert <christian@hergert.me>
+ *
+ * This file is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This file is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <glib/gi18n.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "rg-memory-table.h"
+
+struct _RgMemoryTable
+{
+  RgSampledTable parent_instance;
+};
+
+G_DEFINE_TYPE (RgMemoryTable, rg_memory_table, RG_TYPE_SAMPLED_TABLE)
+
+enum {
+  COLUMN_MEMORY,
+  COLUMN_SWAP,
+};
+
+#ifdef __linux__
+static gboolean
+rg_memory_table_sample (RgSampledTable *sampled,
+                        gint64          timestamp,
+                        gdouble        *values)
+{
+  g_autofree gchar *buf = NULL;
+  gulong mem_total = 0;
+  gulong mem_available = 0;
+  gulong swap_total = 0;
+  gulong swap_free = 0;
+  gchar *line;
+  gchar *save = NULL;
+
+  if (!g_file_get_contents ("/proc/meminfo", &buf, NULL, NULL))
+    return FALSE;
+
+  for (line = strtok_r (buf, "\n", &save); line != NULL; line = strtok_r (NULL, "\n", &save))
+    {
+      if (sscanf (line, "MemTotal: %lu", &mem_total) == 1 ||
+          sscanf (line, "MemAvailable: %lu", &mem_available) == 1 ||
+          sscanf (line, "SwapTotal: %lu", &swap_total) == 1)
+        continue;
+
+      sscanf (line, "SwapFree: %lu", &swap_free);
+    }
+
+  if (mem_total == 0)
+    return FALSE;
+
+  values [COLUMN_MEMORY] = (mem_total - MIN (mem_available, mem_total)) / (gdouble)mem_total * 100.0;
+  values [COLUMN_SWAP] = swap_total ? (swap_total - MIN (swap_free, swap_total)) / (gdouble)swap_total * 100.0 : 0.0;
+
+  return TRUE;
+}
+#else
+static gboolean
+rg_memory_table_sample (RgSampledTable *sampled,
+                        gint64          timestamp,
+                        gdouble        *values)
+{
+  glong total_pages;
+  glong available_pages;
+
+  /* Swap usage is not available through sysconf(), so only memory is graphed */
+  total_pages = sysconf (_SC_PHYS_PAGES);
+  available_pages = sysconf (_SC_AVPHYS_PAGES);
+
+  if (total_pages <= 0 || available_pages < 0)
+    return FALSE;
+
+  values [COLUMN_MEMORY] = (total_pages - MIN (available_pages, total_pages)) / (gdouble)total_pages * 100.0;
+  values [COLUMN_SWAP] = 0.0;
+
+  return TRUE;
+}
+#endif
+
+static void
+rg_memory_table_constructed (GObject *object)
+{
+  RgMemoryTable *self = (RgMemoryTable *)object;
+  RgColumn *column;
+
+  G_OBJECT_CLASS (rg_memory_table_parent_class)->constructed (object);
+
+  column = rg_column_new (_("Memory"), G_TYPE_DOUBLE);
+  rg_table_add_column (RG_TABLE (self), column);
+  g_object_unref (column);
+
+  column = rg_column_new (_("Swap"), G_TYPE_DOUBLE);
+  rg_table_add_column (RG_TABLE (self), column);
+  g_object_unref (column);
+
+  rg_sampled_table_start (RG_SAMPLED_TABLE (self));
+}
+
+static void
+rg_memory_table_class_init (RgMemoryTableClass *klass)
+{
+  GObjectClass *object_class = G_OBJECT_CLASS (klass);
+  RgSampledTableClass *sampled_table_class = RG_SAMPLED_TABLE_CLASS (klass);
+
+  object_class->constructed = rg_memory_table_constructed;
+
+  sampled_table_class->sample = rg_memory_table_sample;
+}
+
+static void
+rg_memory_table_init (RgMemoryTable *self)
+{
+  g_object_set (self,
+                "value-min", 0.0,
+                "value-max", 100.0,
+                NULL);
+}
+
+RgTable *
+rg_memory_table_new (void)
+{
+  return g_object_new (RG_TYPE_MEMORY_TABLE, NULL);
+}
@@ -0,0 +1,34 @@
+/* rg-memory-table.h
+ *
+ * Copyright (C) 2016 Christian Hergert <christian@hergert.me>
+ *
+ * This file is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This file is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef RG_MEMORY_TABLE_H
+#define RG_MEMORY_TABLE_H
+
+#include "rg-sampled-table.h"
+
+G_BEGIN_DECLS
+
+#define RG_TYPE_MEMORY_TABLE (rg_memory_table_get_type())
+
+G_DECLARE_FINAL_TYPE (RgMemoryTable, rg_memory_table, RG, MEMORY_TABLE, RgSampledTable)
+
+RgTable *rg_memory_table_new (void);
+
+G_END_DECLS
+
+#endif /* RG_MEMORY_TABLE_H */
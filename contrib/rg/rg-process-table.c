@@ -0,0 +1,306 @@
+/* rg-process-table.c
+ *
+ * Copyright (C) 2016 Christian Hergert <christian@hergert.me>
+ *
+ * This file is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This file is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <glib/gi18n.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/time.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include "rg-process-table.h"
+
+/*
+ * Graphs the processor usage of this process and, separately, of all of
+ * its descendants, such as build and runtime subprocesses. Values are a
+ * percentage of the whole machine so they can share the 0 to 100 scale
+ * with the other graphs.
+ */
+
+struct _RgProcessTable
+{
+  RgSampledTable  parent_instance;
+
+  /* Only used from the sampler thread once sampling has started */
+  GHashTable     *last_ticks;
+  gint64          last_timestamp;
+  gdouble         ticks_per_sec;
+  guint           n_cpu;
+
+  /* Only used when sampling with getrusage() */
+  gint64          last_self_usec;
+  gint64          last_children_usec;
+};
+
+typedef struct
+{
+  GPid   pid;
+  GPid   ppid;
+  gulong ticks;
+} ProcessInfo;
+
+G_DEFINE_TYPE (RgProcessTable, rg_process_table, RG_TYPE_SAMPLED_TABLE)
+
+enum {
+  COLUMN_SELF,
+  COLUMN_CHILDREN,
+};
+
+#ifdef __linux__
+static gboolean
+read_process_info (const gchar *pid_str,
+                   ProcessInfo *info)
+{
+  g_autofree gchar *path = NULL;
+  g_autofree gchar *buf = NULL;
+  gulong utime;
+  gulong stime;
+  gchar *end;
+
+  path = g_build_filename ("/proc", pid_str, "stat", NULL);
+
+  if (!g_file_get_contents (path, &buf, NULL, NULL))
+    return FALSE;
+
+  /* The command name may contain spaces and parentheses */
+  if (NULL == (end = strrchr (buf, ')')))
+    return FALSE;
+
+  if (sscanf (end + 1, " %*c %d %*d %*d %*d %*d %*u %*u %*u %*u %*u %lu %lu",
+              &info->ppid, &utime, &stime) != 3)
+    return FALSE;
+
+  info->pid = atoi (pid_str);
+  info->ticks = utime + stime;
+
+  return TRUE;
+}
+
+static gboolean
+is_descendant (GHashTable *parents,
+               GPid        pid,
+               GPid        ancestor)
+{
+  guint depth;
+
+  /* Bound the walk in case a pid was reused while we were reading */
+  for (depth = 0; depth < 64 && pid > 1; depth++)
+    {
+      pid = GPOINTER_TO_INT (g_hash_table_lookup (parents, GINT_TO_POINTER (pid)));
+
+      if (pid == ancestor)
+        return TRUE;
+    }
+
+  return FALSE;
+}
+
+static gboolean
+rg_process_table_sample (RgSampledTable *sampled,
+                         gint64          timestamp,
+                         gdouble        *values)
+{
+  RgProcessTable *self = (RgProcessTable *)sampled;
+  g_autoptr(GHashTable) parents = NULL;
+  g_autoptr(GHashTable) ticks = NULL;
+  g_autoptr(GArray) infos = NULL;
+  const gchar *name;
+  gdouble elapsed_ticks;
+  gulong self_ticks = 0;
+  gulong children_ticks = 0;
+  gboolean ret;
+  GPid self_pid;
+  GDir *dir;
+  guint i;
+
+  if (NULL == (dir = g_dir_open ("/proc", 0, NULL)))
+    return FALSE;
+
+  self_pid = getpid ();
+  parents = g_hash_table_new (NULL, NULL);
+  ticks = g_hash_table_new (NULL, NULL);
+  infos = g_array_new (FALSE, FALSE, sizeof (ProcessInfo));
+
+  while ((name = g_dir_read_name (dir)))
+    {
+      ProcessInfo info;
+
+      if (!g_ascii_isdigit (*name) || !read_process_info (name, &info))
+        continue;
+
+      g_hash_table_insert (parents, GINT_TO_POINTER (info.pid), GINT_TO_POINTER (info.ppid));
+      g_array_append_val (infos, info);
+    }
+
+  g_dir_close (dir);
+
+  for (i = 0; i < infos->len; i++)
+    {
+      const ProcessInfo *info = &g_array_index (infos, ProcessInfo, i);
+      gpointer last = NULL;
+      gulong delta;
+
+      if (info->pid != self_pid && !is_descendant (parents, info->pid, self_pid))
+        continue;
+
+      /* Processes we have not seen yet were started since the last sample */
+      g_hash_table_lookup_extended (self->last_ticks, GINT_TO_POINTER (info->pid), NULL, &last);
+      delta = info->ticks - MIN (info->ticks, GPOINTER_TO_SIZE (last));
+
+      if (info->pid == self_pid)
+        self_ticks = delta;
+      else
+        children_ticks += delta;
+
+      g_hash_table_insert (ticks, GINT_TO_POINTER (info->pid), GSIZE_TO_POINTER (info->ticks));
+    }
+
+  /* Only remember the processes that are still alive */
+  g_hash_table_unref (self->last_ticks);
+  self->last_ticks = g_steal_pointer (&ticks);
+
+  elapsed_ticks = (timestamp - self->last_timestamp) / (gdouble)G_USEC_PER_SEC * self->ticks_per_sec * self->n_cpu;
+
+  /* The first sample only primes the counters */
+  ret = (self->last_timestamp != 0 && elapsed_ticks > 0);
+
+  self->last_timestamp = timestamp;
+
+  if (ret)
+    {
+      values [COLUMN_SELF] = MIN (100.0, self_ticks / elapsed_ticks * 100.0);
+      values [COLUMN_CHILDREN] = MIN (100.0, children_ticks / elapsed_ticks * 100.0);
+    }
+
+  return ret;
+}
+#else
+static gint64
+timeval_to_usec (const struct timeval *tv)
+{
+  return (gint64)tv->tv_sec * G_USEC_PER_SEC + tv->tv_usec;
+}
+
+/*
+ * Without /proc we fall back to getrusage(). The children figure then only
+ * includes subprocesses once they have exited and been reaped, so it shows
+ * up after the fact rather than while they are running.
+ */
+static gboolean
+rg_process_table_sample (RgSampledTable *sampled,
+                         gint64          timestamp,
+                         gdouble        *values)
+{
+  RgProcessTable *self = (RgProcessTable *)sampled;
+  struct rusage self_usage;
+  struct rusage children_usage;
+  gint64 self_usec;
+  gint64 children_usec;
+  gdouble elapsed_usec;
+  gboolean ret;
+
+  if (getrusage (RUSAGE_SELF, &self_usage) != 0 ||
+      getrusage (RUSAGE_CHILDREN, &children_usage) != 0)
+    return FALSE;
+
+  self_usec = timeval_to_usec (&self_usage.ru_utime) + timeval_to_usec (&self_usage.ru_stime);
+  children_usec = timeval_to_usec (&children_usage.ru_utime) + timeval_to_usec (&children_usage.ru_stime);
+
+  elapsed_usec = (gdouble)(timestamp - self->last_timestamp) * self->n_cpu;
+
+  /* The first sample only primes the counters */
+  ret = (self->last_timestamp != 0 && elapsed_usec > 0);
+
+  if (ret)
+    {
+      values [COLUMN_SELF] = MIN (100.0, (self_usec - MIN (self_usec, self->last_self_usec)) / elapsed_usec * 100.0);
+      values [COLUMN_CHILDREN] = MIN (100.0, (children_usec - MIN (children_usec, self->last_children_usec)) / elapsed_usec * 100.0);
+    }
+
+  self->last_timestamp = timestamp;
+  self->last_self_usec = self_usec;
+  self->last_children_usec = children_usec;
+
+  return ret;
+}
+#endif
+
+static void
+rg_process_table_constructed (GObject *object)
+{
+  RgProcessTable *self = (RgProcessTable *)object;
+  RgColumn *column;
+
+  G_OBJECT_CLASS (rg_process_table_parent_class)->constructed (object);
+
+  column = rg_column_new (_("Builder"), G_TYPE_DOUBLE);
+  rg_table_add_column (RG_TABLE (self), column);
+  g_object_unref (column);
+
+  column = rg_column_new (_("Subprocesses"), G_TYPE_DOUBLE);
+  rg_table_add_column (RG_TABLE (self), column);
+  g_object_unref (column);
+
+  rg_sampled_table_start (RG_SAMPLED_TABLE (self));
+}
+
+static void
+rg_process_table_finalize (GObject *object)
+{
+  RgProcessTable *self = (RgProcessTable *)object;
+
+  g_clear_pointer (&self->last_ticks, g_hash_table_unref);
+
+  G_OBJECT_CLASS (rg_process_table_parent_class)->finalize (object);
+}
+
+static void
+rg_process_table_class_init (RgProcessTableClass *klass)
+{
+  GObjectClass *object_class = G_OBJECT_CLASS (klass);
+  RgSampledTableClass *sampled_table_class = RG_SAMPLED_TABLE_CLASS (klass);
+
+  object_class->constructed = rg_process_table_constructed;
+  object_class->finalize = rg_process_table_finalize;
+
+  sampled_table_class->sample = rg_process_table_sample;
+}
+
+static void
+rg_process_table_init (RgProcessTable *self)
+{
+  self->last_ticks = g_hash_table_new (NULL, NULL);
+  self->n_cpu = g_get_num_processors ();
+  self->ticks_per_sec = sysconf (_SC_CLK_TCK);
+
+  if (self->ticks_per_sec <= 0)
+    self->ticks_per_sec = 100;
+
+  g_object_set (self,
+                "value-min", 0.0,
+                "value-max", 100.0,
+                NULL);
+}
+
+RgTable *
+rg_process_table_new (void)
+{
+  return g_object_new (RG_TYPE_PROCESS_TABLE, NULL);
+}
@@ -0,0 +1,40 @@
+/* rg-sample-ring-private.h
+ *
+ * Copyright (C) 2016 Christian Hergert <christian@hergert.me>
+ *
+ * This file is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This file is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef RG_SAMPLE_RING_PRIVATE_H
+#define RG_SAMPLE_RING_PRIVATE_H
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+typedef struct _RgSampleRing RgSampleRing;
+
+RgSampleRing *_rg_sample_ring_new  (guint          n_values,
+                                    guint          n_samples);
+void          _rg_sample_ring_free (RgSampleRing  *ring);
+void          _rg_sample_ring_push (RgSampleRing  *ring,
+                                    gint64         timestamp,
+                                    const gdouble *values);
+gboolean      _rg_sample_ring_pop  (RgSampleRing  *ring,
+                                    gint64        *timestamp,
+                                    gdouble       *values);
+
+G_END_DECLS
+
+#endif /* RG_SAMPLE_RING_PRIVATE_H */
@@ -0,0 +1,174 @@
+/* rg-sample-ring.c
+ *
+ * Copyright (C) 2016 Christian Hergert <christian@hergert.me>
+ *
+ * This file is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This file is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+
+#include "rg-sample-ring-private.h"
+
+/*
+ * A ring of samples written by a single producer (the sampler thread) and
+ * read by a single consumer (the main thread), without locks.
+ *
+ * The producer never waits for the consumer. When the consumer falls
+ * behind, which is expected while the graphs are not visible, the oldest
+ * samples are overwritten. Each slot carries a sequence number that is
+ * odd while the slot is being written, so the consumer can detect a slot
+ * that was overwritten while it was being copied and skip it.
+ */
+
+#define RG_MEMORY_BARRIER __sync_synchronize()
+
+typedef struct
+{
+  volatile guint sequence;
+  gint64         timestamp;
+  gdouble        values[];
+} RgSampleSlot;
+
+struct _RgSampleRing
+{
+  /* Number of samples ever written, only modified by the producer */
+  volatile guint  head;
+
+  /* Number of samples consumed, only used by the consumer */
+  guint           tail;
+
+  guint           n_values;
+  guint           n_samples;
+  gsize           slot_size;
+  guint8         *slots;
+};
+
+static inline RgSampleSlot *
+get_slot (RgSampleRing *ring,
+          guint         position)
+{
+  return (RgSampleSlot *)(gpointer)&ring->slots [(position % ring->n_samples) * ring->slot_size];
+}
+
+RgSampleRing *
+_rg_sample_ring_new (guint n_values,
+                     guint n_samples)
+{
+  RgSampleRing *ring;
+
+  g_return_val_if_fail (n_samples > 0, NULL);
+
+  ring = g_slice_new0 (RgSampleRing);
+  ring->n_values = n_values;
+  ring->n_samples = n_samples;
+  ring->slot_size = sizeof (RgSampleSlot) + (sizeof (gdouble) * n_values);
+  ring->slots = g_malloc0 (ring->slot_size * n_samples);
+
+  return ring;
+}
+
+void
+_rg_sample_ring_free (RgSampleRing *ring)
+{
+  if (ring != NULL)
+    {
+      g_free (ring->slots);
+      g_slice_free (RgSampleRing, ring);
+    }
+}
+
+/*
+ * Must only be called from the producer thread.
+ */
+void
+_rg_sample_ring_push (RgSampleRing  *ring,
+                      gint64         timestamp,
+                      const gdouble *values)
+{
+  RgSampleSlot *slot;
+  guint head;
+
+  g_return_if_fail (ring != NULL);
+
+  head = ring->head;
+  slot = get_slot (ring, head);
+
+  g_atomic_int_set (&slot->sequence, (head * 2) + 1);
+
+  /* The odd sequence must be visible before any of the new contents */
+  RG_MEMORY_BARRIER;
+
+  slot->timestamp = timestamp;
+  memcpy (slot->values, values, sizeof (gdouble) * ring->n_values);
+
+  /* And the contents must be complete before the even sequence */
+  RG_MEMORY_BARRIER;
+
+  g_atomic_int_set (&slot->sequence, (head * 2) + 2);
+
+  g_atomic_int_set (&ring->head, head + 1);
+}
+
+/*
+ * Must only be called from the consumer thread. Copies the oldest sample
+ * that has not been consumed yet into @timestamp and @values.
+ */
+gboolean
+_rg_sample_ring_pop (RgSampleRing *ring,
+                     gint64       *timestamp,
+                     gdouble      *values)
+{
+  g_return_val_if_fail (ring != NULL, FALSE);
+  g_return_val_if_fail (timestamp != NULL, FALSE);
+
+  for (;;)
+    {
+      RgSampleSlot *slot;
+      guint head;
+      guint sequence;
+
+      head = g_atomic_int_get (&ring->head);
+
+      if (ring->tail == head)
+        return FALSE;
+
+      /* Skip the samples that have already been overwritten */
+      if (head - ring->tail > ring->n_samples)
+        ring->tail = head - ring->n_samples;
+
+      slot = get_slot (ring, ring->tail);
+
+      sequence = g_atomic_int_get (&slot->sequence);
+
+      if (sequence == (ring->tail * 2) + 2)
+        {
+          RG_MEMORY_BARRIER;
+
+          *timestamp = slot->timestamp;
+          memcpy (values, slot->values, sizeof (gdouble) * ring->n_values);
+
+          /* Finish reading the contents before checking the sequence again */
+          RG_MEMORY_BARRIER;
+
+          if (g_atomic_int_get (&slot->sequence) == sequence)
+            {
+              ring->tail++;
+              return TRUE;
+            }
+        }
+
+      /* The producer lapped us while copying, try the next one */
+      ring->tail++;
+    }
+}
@@ -0,0 +1,170 @@
+/* rg-sampled-table.c
+ *
+ * Copyright (C) 2016 Christian Hergert <christian@hergert.me>
+ *
+ * This file is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This file is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "rg-sample-ring-private.h"
+#include "rg-sampled-table.h"
+#include "rg-sampler-private.h"
+
+/*
+ * RgSampledTable is the base class for tables whose values are collected
+ * from the sampler thread. Samples are written into a lock-free ring and
+ * only copied into the table when a graph showing it asks for an update
+ * from its frame clock.
+ */
+
+typedef struct
+{
+  RgSampleRing *ring;
+
+  /* Only used from the sampler thread */
+  gdouble      *sample_values;
+
+  /* Only used from the main thread */
+  gdouble      *update_values;
+
+  guint         n_values;
+  guint         sampler_id;
+} RgSampledTablePrivate;
+
+G_DEFINE_ABSTRACT_TYPE_WITH_PRIVATE (RgSampledTable, rg_sampled_table, RG_TYPE_TABLE)
+
+static void
+rg_sampled_table_sample (gint64   timestamp,
+                         gpointer user_data)
+{
+  RgSampledTable *self = user_data;
+  RgSampledTablePrivate *priv = rg_sampled_table_get_instance_private (self);
+
+  if (RG_SAMPLED_TABLE_GET_CLASS (self)->sample (self, timestamp, priv->sample_values))
+    _rg_sample_ring_push (priv->ring, timestamp, priv->sample_values);
+}
+
+static void
+rg_sampled_table_update (RgTable *table)
+{
+  RgSampledTable *self = (RgSampledTable *)table;
+  RgSampledTablePrivate *priv = rg_sampled_table_get_instance_private (self);
+  gint64 timestamp;
+
+  g_assert (RG_IS_SAMPLED_TABLE (self));
+
+  if (priv->ring == NULL)
+    return;
+
+  while (_rg_sample_ring_pop (priv->ring, &timestamp, priv->update_values))
+    {
+      RgTableIter iter;
+      guint i;
+
+      rg_table_push (table, &iter, timestamp);
+
+      for (i = 0; i < priv->n_values; i++)
+        rg_table_iter_set (&iter, i, priv->update_values [i], -1);
+    }
+}
+
+/**
+ * rg_sampled_table_start:
+ * @self: An #RgSampledTable
+ *
+ * Starts sampling from the sampler thread. This should be called by
+ * subclasses once all of their columns have been added, and the state
+ * used by their sample function must only be touched from the sampler
+ * thread afterwards.
+ */
+void
+rg_sampled_table_start (RgSampledTable *self)
+{
+  RgSampledTablePrivate *priv = rg_sampled_table_get_instance_private (self);
+  guint interval_msec;
+  guint max_samples;
+  gint64 timespan;
+
+  g_return_if_fail (RG_IS_SAMPLED_TABLE (self));
+  g_return_if_fail (RG_SAMPLED_TABLE_GET_CLASS (self)->sample != NULL);
+  g_return_if_fail (priv->sampler_id == 0);
+
+  max_samples = rg_table_get_max_samples (RG_TABLE (self));
+  timespan = rg_table_get_timespan (RG_TABLE (self));
+
+  interval_msec = (gdouble)timespan / (gdouble)MAX (1, max_samples - 1) / 1000L;
+
+  if (interval_msec == 0)
+    {
+      g_critical ("Implausible timespan/max_samples combination for graph.");
+      interval_msec = 1000;
+    }
+
+  priv->n_values = rg_table_get_n_columns (RG_TABLE (self));
+  priv->sample_values = g_new0 (gdouble, priv->n_values);
+  priv->update_values = g_new0 (gdouble, priv->n_values);
+
+  /* Keep enough samples to fill the graph after it was hidden */
+  priv->ring = _rg_sample_ring_new (priv->n_values, max_samples);
+
+  priv->sampler_id = _rg_sampler_add (interval_msec, rg_sampled_table_sample, self);
+}
+
+static void
+rg_sampled_table_dispose (GObject *object)
+{
+  RgSampledTable *self = (RgSampledTable *)object;
+  RgSampledTablePrivate *priv = rg_sampled_table_get_instance_private (self);
+
+  /*
+   * This must happen before subclasses free the state used by their
+   * sample function in finalize, and blocks while a sample is running.
+   */
+  if (priv->sampler_id != 0)
+    {
+      _rg_sampler_remove (priv->sampler_id);
+      priv->sampler_id = 0;
+    }
+
+  G_OBJECT_CLASS (rg_sampled_table_parent_class)->dispose (object);
+}
+
+static void
+rg_sampled_table_finalize (GObject *object)
+{
+  RgSampledTable *self = (RgSampledTable *)object;
+  RgSampledTablePrivate *priv = rg_sampled_table_get_instance_private (self);
+
+  g_clear_pointer (&priv->ring, _rg_sample_ring_free);
+  g_clear_pointer (&priv->sample_values, g_free);
+  g_clear_pointer (&priv->update_values, g_free);
+
+  G_OBJECT_CLASS (rg_sampled_table_parent_class)->finalize (object);
+}
+
+static void
+rg_sampled_table_class_init (RgSampledTableClass *klass)
+{
+  GObjectClass *object_class = G_OBJECT_CLASS (klass);
+  RgTableClass *table_class = RG_TABLE_CLASS (klass);
+
+  object_class->dispose = rg_sampled_table_dispose;
+  object_class->finalize = rg_sampled_table_finalize;
+
+  table_class->update = rg_sampled_table_update;
+}
+
+static void
+rg_sampled_table_init (RgSampledTable *self)
+{
+}
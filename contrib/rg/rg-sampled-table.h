@@ -0,0 +1,47 @@
+/* rg-sampled-table.h
+ *
+ * Copyright (C) 2016 Christian Hergert <christian@hergert.me>
+ *
+ * This file is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This file is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef RG_SAMPLED_TABLE_H
+#define RG_SAMPLED_TABLE_H
+
+#include "rg-table.h"
+
+G_BEGIN_DECLS
+
+#define RG_TYPE_SAMPLED_TABLE (rg_sampled_table_get_type())
+
+G_DECLARE_DERIVABLE_TYPE (RgSampledTable, rg_sampled_table, RG, SAMPLED_TABLE, RgTable)
+
+struct _RgSampledTableClass
+{
+  RgTableClass parent;
+
+  /*
+   * Called from the sampler thread, @values has one element per column.
+   * Returns FALSE if no sample should be recorded.
+   */
+  gboolean (*sample) (RgSampledTable *self,
+                      gint64          timestamp,
+                      gdouble        *values);
+};
+
+void rg_sampled_table_start (RgSampledTable *self);
+
+G_END_DECLS
+
+#endif /* RG_SAMPLED_TABLE_H */
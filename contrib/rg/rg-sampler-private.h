@@ -0,0 +1,36 @@
+/* rg-sampler-private.h
+ *
+ * Copyright (C) 2016 Christian Hergert <christian@hergert.me>
+ *
+ * This file is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This file is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef RG_SAMPLER_PRIVATE_H
+#define RG_SAMPLER_PRIVATE_H
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+typedef void (*RgSamplerFunc) (gint64   timestamp,
+                               gpointer user_data);
+
+guint _rg_sampler_add    (guint          interval_msec,
+                          RgSamplerFunc  func,
+                          gpointer       user_data);
+void  _rg_sampler_remove (guint          id);
+
+G_END_DECLS
+
+#endif /* RG_SAMPLER_PRIVATE_H */
@@ -0,0 +1,172 @@
+/* rg-sampler.c
+ *
+ * Copyright (C) 2016 Christian Hergert <christian@hergert.me>
+ *
+ * This file is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This file is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "rg-sampler-private.h"
+
+/*
+ * All of the tables share a single sampler thread so that reading from
+ * /proc is never delayed by a busy main loop. Registered functions are
+ * called on that thread at their interval with the sampler lock held,
+ * which means that once _rg_sampler_remove() returns the function is
+ * guaranteed to not be running nor to be called again.
+ */
+
+typedef struct
+{
+  guint         id;
+  gint64        interval;
+  gint64        deadline;
+  RgSamplerFunc func;
+  gpointer      user_data;
+} RgSamplerSource;
+
+static GMutex   sampler_mutex;
+static GCond    sampler_cond;
+static GArray  *sampler_sources;
+static GThread *sampler_thread;
+static guint    sampler_last_id;
+
+static gpointer
+rg_sampler_worker (gpointer data)
+{
+  g_mutex_lock (&sampler_mutex);
+
+  for (;;)
+    {
+      gint64 deadline = G_MAXINT64;
+      gint64 now;
+      guint i;
+
+      for (i = 0; i < sampler_sources->len; i++)
+        {
+          RgSamplerSource *source = &g_array_index (sampler_sources, RgSamplerSource, i);
+
+          deadline = MIN (deadline, source->deadline);
+        }
+
+      if (deadline == G_MAXINT64)
+        {
+          g_cond_wait (&sampler_cond, &sampler_mutex);
+          continue;
+        }
+
+      now = g_get_monotonic_time ();
+
+      if (now < deadline)
+        {
+          g_cond_wait_until (&sampler_cond, &sampler_mutex, deadline);
+          continue;
+        }
+
+      /* Sources may not be added or removed while we hold the lock */
+      for (i = 0; i < sampler_sources->len; i++)
+        {
+          RgSamplerSource *source = &g_array_index (sampler_sources, RgSamplerSource, i);
+
+          if (source->deadline > now)
+            continue;
+
+          source->func (now, source->user_data);
+
+          /* Keep a steady cadence, unless we fell behind by a whole interval */
+          source->deadline += source->interval;
+          if (source->deadline <= now)
+            source->deadline = now + source->interval;
+        }
+    }
+
+  g_mutex_unlock (&sampler_mutex);
+
+  return NULL;
+}
+
+/**
+ * _rg_sampler_add:
+ * @interval_msec: the interval between samples, in milliseconds.
+ * @func: the function to call from the sampler thread.
+ * @user_data: closure data for @func.
+ *
+ * Registers @func to be called from the sampler thread every
+ * @interval_msec, starting immediately.
+ *
+ * Returns: an identifier for _rg_sampler_remove().
+ */
+guint
+_rg_sampler_add (guint         interval_msec,
+                 RgSamplerFunc func,
+                 gpointer      user_data)
+{
+  RgSamplerSource source = { 0 };
+  guint ret;
+
+  g_return_val_if_fail (interval_msec > 0, 0);
+  g_return_val_if_fail (func != NULL, 0);
+
+  g_mutex_lock (&sampler_mutex);
+
+  if (sampler_thread == NULL)
+    {
+      sampler_sources = g_array_new (FALSE, FALSE, sizeof (RgSamplerSource));
+      sampler_thread = g_thread_new ("rg-sampler", rg_sampler_worker, NULL);
+    }
+
+  source.id = ret = ++sampler_last_id;
+  source.interval = (gint64)interval_msec * 1000L;
+  source.deadline = g_get_monotonic_time ();
+  source.func = func;
+  source.user_data = user_data;
+
+  g_array_append_val (sampler_sources, source);
+
+  g_cond_signal (&sampler_cond);
+  g_mutex_unlock (&sampler_mutex);
+
+  return ret;
+}
+
+/**
+ * _rg_sampler_remove:
+ * @id: an identifier returned from _rg_sampler_add().
+ *
+ * Stops calling the function registered as @id. If the function is
+ * currently running on the sampler thread, this blocks until it returns.
+ */
+void
+_rg_sampler_remove (guint id)
+{
+  guint i;
+
+  g_return_if_fail (id != 0);
+
+  g_mutex_lock (&sampler_mutex);
+
+  if (sampler_sources != NULL)
+    {
+      for (i = 0; i < sampler_sources->len; i++)
+        {
+          if (g_array_index (sampler_sources, RgSamplerSource, i).id == id)
+            {
+              g_array_remove_index_fast (sampler_sources, i);
+              break;
+            }
+        }
+    }
+
+  g_cond_signal (&sampler_cond);
+  g_mutex_unlock (&sampler_mutex);
+}
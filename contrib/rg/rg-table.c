@@ -137,6 +137,33 @@ rg_table_add_column (RgTable  *self,
   return priv->columns->len - 1;
 }
 
+guint
+rg_table_get_n_columns (RgTable *self)
+{
+  RgTablePrivate *priv = rg_table_get_instance_private (self);
+
+  g_return_val_if_fail (RG_IS_TABLE (self), 0);
+
+  return priv->columns->len;
+}
+
+/**
+ * rg_table_update:
+ * @self: Table to update
+ *
+ * Gives the table a chance to bring in samples that were collected in
+ * the background. Graphs call this from their frame clock before
+ * rendering, so tables that are not visible are not updated.
+ */
+void
+rg_table_update (RgTable *self)
+{
+  g_return_if_fail (RG_IS_TABLE (self));
+
+  if (RG_TABLE_GET_CLASS (self)->update)
+    RG_TABLE_GET_CLASS (self)->update (self);
+}
+
 guint
 rg_table_get_max_samples (RgTable *self)
 {
@@ -32,6 +32,8 @@ G_DECLARE_DERIVABLE_TYPE (RgTable, rg_table, RG, TABLE, GObject)
 struct _RgTableClass
 {
   GObjectClass parent;
+
+  void (*update) (RgTable *self);
 };
 
 typedef struct
@@ -42,6 +44,8 @@ typedef struct
 RgTable   *rg_table_new                (void);
 guint      rg_table_add_column         (RgTable     *self,
                                         RgColumn    *column);
+guint      rg_table_get_n_columns      (RgTable     *self);
+void       rg_table_update             (RgTable     *self);
 GTimeSpan  rg_table_get_timespan       (RgTable     *self);
 void       rg_table_set_timespan       (RgTable     *self,
                                         GTimeSpan    timespan);
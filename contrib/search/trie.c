@@ -43,11 +43,25 @@
  * To insert a key and value pair into the #Trie use trie_insert().
  * To remove a key from the #Trie use trie_remove().
  * To traverse all children of the #Trie from a given key use trie_traverse().
+ *
+ * Nodes are allocated from an arena owned by the #Trie, so freeing the trie
+ * releases them all at once. When all of the keys are known up front, use
+ * trie_insert_sorted() to build the tree breadth-first, which places the
+ * children of each node next to each other in memory.
+ *
+ * A #Trie can be written to an image with trie_serialize() and loaded again
+ * with trie_new_from_bytes(). Loading does not rebuild the tree, so an image
+ * from a #GMappedFile is used directly from the page cache. Tries loaded
+ * from an image are read-only and their values are integers.
  */
 
 typedef struct _TrieNode      TrieNode;
 typedef struct _TrieNodeChunk TrieNodeChunk;
 
+#define TRIE_ARENA_NODES   1024
+#define TRIE_IMAGE_MAGIC   0x54524945
+#define TRIE_IMAGE_VERSION 1
+
 /**
  * Try to optimize for 64 bit vs 32 bit pointers. We are assuming that the
  * 32 bit also has a 32 byte cacheline. This is very likely not the case
@@ -104,24 +118,77 @@ struct _TrieNode
 };
 #pragma pack(pop)
 
+/**
+ * TrieImageHeader:
+ * @magic: %TRIE_IMAGE_MAGIC, which also detects byte order mismatches.
+ * @version: %TRIE_IMAGE_VERSION.
+ * @n_nodes: The number of nodes in the image.
+ * @reserved: Unused, must be zero.
+ *
+ * The header of a serialized #Trie. It is followed by @n_nodes
+ * #TrieImageNode and then @n_nodes bytes containing the key leading to
+ * each node.
+ */
+typedef struct
+{
+   guint32 magic;
+   guint32 version;
+   guint32 n_nodes;
+   guint32 reserved;
+} TrieImageHeader;
+
+/**
+ * TrieImageNode:
+ * @value: The value of the node, or 0.
+ * @first_child: The index of the first child.
+ * @n_children: The number of children.
+ *
+ * Nodes are numbered breadth-first starting with the root, so the children
+ * of a node are contiguous and sorted by key.
+ */
+typedef struct
+{
+   guint32 value;
+   guint32 first_child;
+   guint32 n_children;
+} TrieImageNode;
+
 /**
  * Trie:
  * @value_destroy: A #GDestroyNotify to free data pointers.
  * @root: The root TrieNode.
+ * @blocks: The arena blocks that nodes and chunks are allocated from.
+ * @block_pos: The next unused slot of the current block.
+ * @block_end: The end of the current block.
+ * @free_list: Slots that have been released, linked through their first
+ *    pointer.
+ * @image: The image the trie was loaded from, or %NULL.
+ * @image_nodes: The nodes within @image.
+ * @image_keys: The keys within @image.
  */
 struct _Trie
 {
-   GDestroyNotify  value_destroy;
-   TrieNode       *root;
+   GDestroyNotify       value_destroy;
+   TrieNode            *root;
+   GPtrArray           *blocks;
+   guint8              *block_pos;
+   guint8              *block_end;
+   gpointer             free_list;
+   GBytes              *image;
+   const TrieImageNode *image_nodes;
+   const guint8        *image_keys;
 };
 
+G_DEFINE_QUARK(trie-error-quark, trie_error)
+
 /**
  * trie_malloc0:
  * @trie: A #Trie
  * @size: Number of bytes to allocate.
  *
- * Wrapper function to allocate a memory chunk. This gives us somewhere to
- * perform the abstraction if we want to use mmap()'d I/O at some point.
+ * Allocates a node or chunk from the arena of @trie. Nodes and chunks are
+ * the same size, so released slots are reused from a single free list.
+ * Slots are aligned to their size so that they do not straddle cachelines.
  * The memory will be zero'd before being returned.
  *
  * Returns: A pointer to the allocation.
@@ -130,7 +197,31 @@ static gpointer
 trie_malloc0 (Trie  *trie,
               gsize  size)
 {
-   return g_malloc0(size);
+   gpointer ret;
+
+   g_assert(size <= TRIE_NODE_SIZE);
+
+   if (trie->free_list) {
+      ret = trie->free_list;
+      trie->free_list = *(gpointer *)ret;
+   } else {
+      if (trie->block_pos == trie->block_end) {
+         guint8 *block;
+
+         block = g_malloc((TRIE_ARENA_NODES + 1) * TRIE_NODE_SIZE);
+         g_ptr_array_add(trie->blocks, block);
+
+         trie->block_pos = (guint8 *)(((gsize)block + TRIE_NODE_SIZE - 1) & ~(gsize)(TRIE_NODE_SIZE - 1));
+         trie->block_end = trie->block_pos + (TRIE_ARENA_NODES * TRIE_NODE_SIZE);
+      }
+
+      ret = trie->block_pos;
+      trie->block_pos += TRIE_NODE_SIZE;
+   }
+
+   memset(ret, 0, TRIE_NODE_SIZE);
+
+   return ret;
 }
 
 /**
@@ -138,13 +229,15 @@ trie_malloc0 (Trie  *trie,
  * @trie: A #Trie.
  * @data: The data to free.
  *
- * Frees a portion of memory allocated by @trie.
+ * Returns a portion of memory allocated by @trie to its free list. The
+ * memory itself is released when @trie is destroyed.
  */
 static void
 trie_free (Trie     *trie,
            gpointer  data)
 {
-   g_free(data);
+   *(gpointer *)data = trie->free_list;
+   trie->free_list = data;
 }
 
 /**
@@ -156,7 +249,7 @@ trie_free (Trie     *trie,
  * embedded in it that may contain only 4 pointers instead of the full 6 do
  * to the overhead of the TrieNode itself.
  *
- * Returns: A newly allocated TrieNode that should be freed with g_free().
+ * Returns: A newly allocated TrieNode that should be freed with trie_free().
  */
 TrieNode *
 trie_node_new (Trie     *trie,
@@ -471,6 +564,122 @@ trie_destroy_node (Trie           *trie,
    trie_free(trie, node);
 }
 
+/**
+ * trie_destroy_values:
+ * @node: A #TrieNode.
+ * @value_destroy: A #GDestroyNotify.
+ *
+ * Calls @value_destroy for the values of @node and all of its children
+ * without unlinking anything. This is used when the whole tree is being
+ * destroyed.
+ */
+static void
+trie_destroy_values (TrieNode       *node,
+                     GDestroyNotify  value_destroy)
+{
+   TrieNodeChunk *iter;
+   guint i;
+
+   for (iter = &node->chunk; iter; iter = iter->next) {
+      for (i = 0; i < iter->count; i++) {
+         trie_destroy_values(iter->children[i], value_destroy);
+      }
+   }
+
+   if (node->value) {
+      value_destroy(node->value);
+   }
+}
+
+/**
+ * trie_image_find_node:
+ * @trie: A #Trie loaded from an image.
+ * @id: The index of a node.
+ * @key: The key to find in this node.
+ * @child: A location for the index of the child.
+ *
+ * Searches the children of node @id for @key.
+ *
+ * Returns: %TRUE if the child was found and @child was set.
+ */
+static gboolean
+trie_image_find_node (Trie    *trie,
+                      guint32  id,
+                      guint8   key,
+                      guint32 *child)
+{
+   const TrieImageNode *node = &trie->image_nodes[id];
+   const guint8 *found;
+
+   found = memchr(&trie->image_keys[node->first_child], key, node->n_children);
+
+   if (found) {
+      *child = found - trie->image_keys;
+      return TRUE;
+   }
+
+   return FALSE;
+}
+
+/**
+ * trie_image_traverse_node:
+ * @trie: A #Trie loaded from an image.
+ * @id: The index of a node.
+ * @str: The prefix for this node.
+ * @order: %G_PRE_ORDER or %G_POST_ORDER.
+ * @flags: The flags for which nodes to callback.
+ * @max_depth: the maximum depth to process.
+ * @func: The func to execute for each matching node.
+ * @user_data: User data for @func.
+ *
+ * Like trie_traverse_node_pre_order() and trie_traverse_node_post_order()
+ * but for tries loaded from an image.
+ *
+ * Returns: %TRUE if traversal was cancelled; otherwise %FALSE.
+ */
+static gboolean
+trie_image_traverse_node (Trie             *trie,
+                          guint32           id,
+                          GString          *str,
+                          GTraverseType     order,
+                          GTraverseFlags    flags,
+                          gint              max_depth,
+                          TrieTraverseFunc  func,
+                          gpointer          user_data)
+{
+   const TrieImageNode *node = &trie->image_nodes[id];
+   gboolean matches;
+   guint32 i;
+
+   if (!max_depth) {
+      return FALSE;
+   }
+
+   matches = ((!node->value && (flags & G_TRAVERSE_NON_LEAVES)) ||
+              (node->value && (flags & G_TRAVERSE_LEAVES)));
+
+   if (matches && order == G_PRE_ORDER) {
+      if (func(trie, str->str, GUINT_TO_POINTER(node->value), user_data)) {
+         return TRUE;
+      }
+   }
+
+   for (i = 0; i < node->n_children; i++) {
+      g_string_append_c(str, trie->image_keys[node->first_child + i]);
+      if (trie_image_traverse_node(trie, node->first_child + i, str, order,
+                                   flags, max_depth - 1, func, user_data)) {
+         return TRUE;
+      }
+      g_string_truncate(str, str->len - 1);
+   }
+
+   if (matches && order == G_POST_ORDER) {
+      return func(trie, str->str, GUINT_TO_POINTER(node->value), user_data);
+   }
+
+   return FALSE;
+}
+
 /**
  * trie_new:
  * @value_destroy: A #GDestroyNotify, or %NULL.
@@ -495,6 +704,7 @@ trie_new (GDestroyNotify value_destroy)
 #endif
 
    trie = g_new0(Trie, 1);
+   trie->blocks = g_ptr_array_new_with_free_func(g_free);
    trie->root = trie_node_new(trie, NULL);
    trie->value_destroy = value_destroy;
 
@@ -517,6 +727,7 @@ trie_insert (Trie        *trie,
    TrieNode *node;
 
    g_return_if_fail(trie);
+   g_return_if_fail(!trie->image);
    g_return_if_fail(key);
    g_return_if_fail(value);
 
@@ -555,6 +766,16 @@ trie_lookup (Trie        *trie,
    g_return_val_if_fail(trie, NULL);
    g_return_val_if_fail(key, NULL);
 
+   if (trie->image) {
+      guint32 id = 0;
+
+      while (*key && trie_image_find_node(trie, id, *key, &id)) {
+         key++;
+      }
+
+      return *key ? NULL : GUINT_TO_POINTER(trie->image_nodes[id].value);
+   }
+
    node = trie->root;
 
    while (*key && node) {
@@ -582,6 +803,7 @@ trie_remove (Trie        *trie,
    TrieNode *node;
 
    g_return_val_if_fail(trie, FALSE);
+   g_return_val_if_fail(!trie->image, FALSE);
    g_return_val_if_fail(key, FALSE);
 
    node = trie->root;
@@ -769,9 +991,33 @@ trie_traverse (Trie             *trie,
    g_return_if_fail(trie);
    g_return_if_fail(func);
 
-   node = trie->root;
    key = key ? key : "";
 
+   if (trie->image) {
+      guint32 id = 0;
+
+      if (order != G_PRE_ORDER && order != G_POST_ORDER) {
+         g_warning(_("Traversal order %u is not supported on Trie."), order);
+         return;
+      }
+
+      str = g_string_new(key);
+
+      while (*key && trie_image_find_node(trie, id, *key, &id)) {
+         key++;
+      }
+
+      if (!*key) {
+         trie_image_traverse_node(trie, id, str, order, flags,
+                                  max_depth, func, user_data);
+      }
+
+      g_string_free(str, TRUE);
+
+      return;
+   }
+
+   node = trie->root;
    str = g_string_new(key);
 
    while (*key && node) {
@@ -804,9 +1050,311 @@ void
 trie_destroy (Trie *trie)
 {
    if (trie) {
-      trie_destroy_node(trie, trie->root, trie->value_destroy);
+      /*
+       * The nodes are released along with the arena, so we only need to walk
+       * the tree if there are values to destroy.
+       */
+      if (trie->root && trie->value_destroy) {
+         trie_destroy_values(trie->root, trie->value_destroy);
+      }
       trie->root = NULL;
       trie->value_destroy = NULL;
+      g_clear_pointer(&trie->blocks, g_ptr_array_unref);
+      g_clear_pointer(&trie->image, g_bytes_unref);
       g_free(trie);
    }
 }
+
+typedef struct
+{
+   TrieNode *node;
+   guint     begin;
+   guint     end;
+   guint     depth;
+} TrieBuildRange;
+
+/**
+ * trie_insert_sorted:
+ * @trie: An empty #Trie.
+ * @keys: (array length=n_keys): The keys to insert, sorted with strcmp().
+ * @values: (array length=n_keys): The values for @keys.
+ * @n_keys: The number of keys.
+ *
+ * Inserts many keys at once. The tree is built breadth-first so that the
+ * children of each node are allocated next to each other, which gives
+ * better cache locality when searching than inserting one key at a time.
+ *
+ * If @trie is not empty or @keys is not sorted, the keys are inserted one
+ * at a time instead.
+ */
+void
+trie_insert_sorted (Trie                *trie,
+                    const gchar * const *keys,
+                    gpointer            *values,
+                    guint                n_keys)
+{
+   TrieBuildRange range;
+   GArray *queue;
+   guint head = 0;
+   guint i;
+
+   g_return_if_fail(trie);
+   g_return_if_fail(!trie->image);
+   g_return_if_fail(keys || !n_keys);
+   g_return_if_fail(values || !n_keys);
+
+   for (i = 1; i < n_keys; i++) {
+      if (strcmp(keys[i - 1], keys[i]) > 0) {
+         break;
+      }
+   }
+
+   if (i < n_keys || trie->root->value || trie->root->chunk.count) {
+      for (i = 0; i < n_keys; i++) {
+         trie_insert(trie, keys[i], values[i]);
+      }
+      return;
+   }
+
+   queue = g_array_new(FALSE, FALSE, sizeof(TrieBuildRange));
+
+   range.node = trie->root;
+   range.begin = 0;
+   range.end = n_keys;
+   range.depth = 0;
+   g_array_append_val(queue, range);
+
+   /*
+    * Every key within a range shares the first depth bytes. Keys ending at
+    * this depth sort first and belong to the node itself, and the rest are
+    * split into a child range per distinct byte.
+    */
+   while (head < queue->len) {
+      TrieNodeChunk *last;
+      TrieNode *node;
+      guint depth;
+      guint end;
+
+      range = g_array_index(queue, TrieBuildRange, head++);
+      node = range.node;
+      depth = range.depth;
+      end = range.end;
+
+      for (i = range.begin; i < end && !keys[i][depth]; i++) {
+         g_return_if_fail(values[i]);
+         if (node->value && trie->value_destroy) {
+            trie->value_destroy(node->value);
+         }
+         node->value = values[i];
+      }
+
+      for (last = &node->chunk; last->next; last = last->next) { }
+
+      while (i < end) {
+         TrieBuildRange child;
+         guint8 key = keys[i][depth];
+         guint j;
+
+         for (j = i + 1; j < end && (guint8)keys[j][depth] == key; j++) { }
+
+         child.node = trie_node_new(trie, node);
+         child.begin = i;
+         child.end = j;
+         child.depth = depth + 1;
+
+         trie_append_to_node(trie, node, last, key, child.node);
+         if (last->next) {
+            last = last->next;
+         }
+
+         g_array_append_val(queue, child);
+
+         i = j;
+      }
+   }
+
+   g_array_unref(queue);
+}
+
+typedef struct
+{
+   guint8    key;
+   TrieNode *child;
+} TrieChild;
+
+static gint
+trie_child_compare (gconstpointer a,
+                    gconstpointer b)
+{
+   return (gint)((const TrieChild *)a)->key - (gint)((const TrieChild *)b)->key;
+}
+
+/**
+ * trie_serialize:
+ * @trie: A #Trie.
+ * @func: (scope call) (nullable): A function to convert values to integers.
+ * @user_data: User data for @func.
+ *
+ * Writes @trie to an image that can be loaded with trie_new_from_bytes().
+ *
+ * Values are stored as 32-bit integers, which @func must produce. If @func
+ * is %NULL, the values must already be integers stored with
+ * GUINT_TO_POINTER(). A value of zero is treated as no value.
+ *
+ * The image uses the byte order of the host.
+ *
+ * Returns: (transfer full): A #GBytes containing the image.
+ */
+GBytes *
+trie_serialize (Trie              *trie,
+                TrieSerializeFunc  func,
+                gpointer           user_data)
+{
+   TrieImageHeader header = { 0 };
+   GPtrArray *nodes;
+   GByteArray *image;
+   GByteArray *keys;
+   GArray *children;
+   guint8 zero = 0;
+   guint i;
+
+   g_return_val_if_fail(trie, NULL);
+   g_return_val_if_fail(!trie->image, NULL);
+
+   nodes = g_ptr_array_new();
+   keys = g_byte_array_new();
+   children = g_array_new(FALSE, FALSE, sizeof(TrieChild));
+   image = g_byte_array_new();
+
+   g_byte_array_append(image, (guint8 *)&header, sizeof header);
+
+   g_ptr_array_add(nodes, trie->root);
+   g_byte_array_append(keys, &zero, 1);
+
+   /*
+    * Number the nodes breadth-first. Since the children of a node are
+    * queued together, they receive consecutive indexes.
+    */
+   for (i = 0; i < nodes->len; i++) {
+      TrieNode *node = g_ptr_array_index(nodes, i);
+      TrieImageNode inode = { 0 };
+      TrieNodeChunk *iter;
+      guint j;
+
+      /* Chunks are in most recently used order, so sort by key */
+      g_array_set_size(children, 0);
+
+      for (iter = &node->chunk; iter; iter = iter->next) {
+         for (j = 0; j < iter->count; j++) {
+            TrieChild child = { iter->keys[j], iter->children[j] };
+
+            g_array_append_val(children, child);
+         }
+      }
+
+      g_array_sort(children, trie_child_compare);
+
+      if (node->value) {
+         inode.value = func ? func(node->value, user_data) : GPOINTER_TO_UINT(node->value);
+      }
+      inode.first_child = nodes->len;
+      inode.n_children = children->len;
+
+      for (j = 0; j < children->len; j++) {
+         TrieChild *child = &g_array_index(children, TrieChild, j);
+
+         g_ptr_array_add(nodes, child->child);
+         g_byte_array_append(keys, &child->key, 1);
+      }
+
+      g_byte_array_append(image, (guint8 *)&inode, sizeof inode);
+   }
+
+   g_byte_array_append(image, keys->data, keys->len);
+
+   header.magic = TRIE_IMAGE_MAGIC;
+   header.version = TRIE_IMAGE_VERSION;
+   header.n_nodes = nodes->len;
+   memcpy(image->data, &header, sizeof header);
+
+   g_array_unref(children);
+   g_ptr_array_unref(nodes);
+   g_byte_array_unref(keys);
+
+   return g_byte_array_free_to_bytes(image);
+}
+
+/**
+ * trie_new_from_bytes:
+ * @bytes: A #GBytes containing an image created with trie_serialize().
+ * @error: A location for a #GError, or %NULL.
+ *
+ * Creates a read-only #Trie backed by @bytes. The image is validated but
+ * not copied, so using the contents of a #GMappedFile avoids both reading
+ * and rebuilding the tree.
+ *
+ * The values of the trie are the integers produced when serializing, and
+ * can be retrieved with GPOINTER_TO_UINT().
+ *
+ * Returns: (transfer full): A #Trie, or %NULL if @bytes is not a valid
+ *   image for this host.
+ */
+Trie *
+trie_new_from_bytes (GBytes  *bytes,
+                     GError **error)
+{
+   const TrieImageHeader *header;
+   const TrieImageNode *nodes;
+   const guint8 *data;
+   Trie *trie;
+   gsize len;
+   guint32 i;
+
+   g_return_val_if_fail(bytes, NULL);
+
+   data = g_bytes_get_data(bytes, &len);
+
+   /* Our own images are always aligned, but be safe with foreign memory */
+   if (((gsize)data & (G_ALIGNOF(TrieImageNode) - 1)) != 0) {
+      g_autoptr(GBytes) copy = g_bytes_new(data, len);
+      return trie_new_from_bytes(copy, error);
+   }
+
+   header = (const TrieImageHeader *)data;
+
+   if (len < sizeof *header ||
+       header->magic != TRIE_IMAGE_MAGIC ||
+       header->version != TRIE_IMAGE_VERSION ||
+       header->n_nodes == 0 ||
+       header->n_nodes > (G_MAXSIZE - sizeof *header) / (sizeof(TrieImageNode) + 1) ||
+       len != sizeof *header + (header->n_nodes * (sizeof(TrieImageNode) + 1))) {
+      g_set_error(error, TRIE_ERROR, TRIE_ERROR_INVALID,
+                  _("The trie image is invalid or was created on an incompatible system."));
+      return NULL;
+   }
+
+   nodes = (const TrieImageNode *)(data + sizeof *header);
+
+   /*
+    * Children always have a higher index than their parent, which guarantees
+    * that lookups and traversals terminate.
+    */
+   for (i = 0; i < header->n_nodes; i++) {
+      if (nodes[i].n_children > 256 ||
+          (nodes[i].n_children &&
+           (nodes[i].first_child <= i ||
+            nodes[i].first_child > header->n_nodes ||
+            nodes[i].n_children > header->n_nodes - nodes[i].first_child))) {
+         g_set_error(error, TRIE_ERROR, TRIE_ERROR_INVALID,
+                     _("The trie image is corrupted."));
+         return NULL;
+      }
+   }
+
+   trie = g_new0(Trie, 1);
+   trie->image = g_bytes_ref(bytes);
+   trie->image_nodes = nodes;
+   trie->image_keys = (const guint8 *)(nodes + header->n_nodes);
+
+   return trie;
+}
@@ -23,29 +23,49 @@
 
 G_BEGIN_DECLS
 
+#define TRIE_ERROR (trie_error_quark())
+
 typedef struct _Trie Trie;
 
+typedef enum
+{
+  TRIE_ERROR_INVALID,
+} TrieError;
+
 typedef gboolean (*TrieTraverseFunc) (Trie        *trie,
                                       const gchar *key,
                                       gpointer     value,
                                       gpointer     user_data);
 
-void      trie_destroy  (Trie             *trie);
-void      trie_insert   (Trie             *trie,
-                         const gchar      *key,
-                         gpointer          value);
-gpointer  trie_lookup   (Trie             *trie,
-                         const gchar      *key);
-Trie     *trie_new      (GDestroyNotify    value_destroy);
-gboolean  trie_remove   (Trie             *trie,
-                         const gchar      *key);
-void      trie_traverse (Trie             *trie,
-                         const gchar      *key,
-                         GTraverseType     order,
-                         GTraverseFlags    flags,
-                         gint              max_depth,
-                         TrieTraverseFunc  func,
-                         gpointer          user_data);
+typedef guint32 (*TrieSerializeFunc) (gpointer     value,
+                                      gpointer     user_data);
+
+GQuark    trie_error_quark    (void);
+void      trie_destroy        (Trie                *trie);
+void      trie_insert         (Trie                *trie,
+                               const gchar         *key,
+                               gpointer             value);
+void      trie_insert_sorted  (Trie                *trie,
+                               const gchar * const *keys,
+                               gpointer            *values,
+                               guint                n_keys);
+gpointer  trie_lookup         (Trie                *trie,
+                               const gchar         *key);
+Trie     *trie_new            (GDestroyNotify       value_destroy);
+Trie     *trie_new_from_bytes (GBytes              *bytes,
+                               GError             **error);
+gboolean  trie_remove         (Trie                *trie,
+                               const gchar         *key);
+GBytes   *trie_serialize      (Trie                *trie,
+                               TrieSerializeFunc    func,
+                               gpointer             user_data);
+void      trie_traverse       (Trie                *trie,
+                               const gchar         *key,
+                               GTraverseType        order,
+                               GTraverseFlags       flags,
+                               gint                 max_depth,
+                               TrieTraverseFunc     func,
+                               gpointer             user_data);
 
 G_END_DECLS
 
@@ -667,9 +667,22 @@ ide_editor_view_actions_goto_line (GSimpleAction *action,
   gtk_widget_activate (GTK_WIDGET (self->goto_line_button));
 }
 
+static void
+ide_editor_view_actions_disable_large_file_mode (GSimpleAction *action,
+                                                 GVariant      *param,
+                                                 gpointer       user_data)
+{
+  IdeEditorView *self = user_data;
+
+  g_assert (IDE_IS_EDITOR_VIEW (self));
+
+  ide_buffer_set_large_file (self->document, FALSE);
+}
+
 static GActionEntry IdeEditorViewActions[] = {
   { "auto-indent", NULL, NULL, "false", ide_editor_view_actions_auto_indent },
   { "close", ide_editor_view_actions_close },
+  { "disable-large-file-mode", ide_editor_view_actions_disable_large_file_mode },
   { "find-other-file", ide_editor_view_actions_find_other_file },
   { "goto-line", ide_editor_view_actions_goto_line },
   { "highlight-current-line", NULL, NULL, "false", ide_editor_view_actions_highlight_current_line },
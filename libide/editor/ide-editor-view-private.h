@@ -47,6 +47,8 @@ struct _IdeEditorView
   IdeEditorFrame       *frame1;
   IdeEditorFrame       *frame2;
   IdeEditorFrame       *last_focused_frame;
+  GtkRevealer          *large_file_revealer;
+  GBinding             *load_progress_binding;
   GtkButton            *modified_cancel_button;
   GtkRevealer          *modified_revealer;
   GtkPaned             *paned;
@@ -29,7 +29,10 @@
 #include "ide-editor-view.h"
 #include "ide-editor-view-addin-private.h"
 #include "ide-editor-view-private.h"
+#include "ide-gtk.h"
+#include "ide-internal.h"
 #include "ide-macros.h"
+#include "ide-progress.h"
 
 G_DEFINE_TYPE (IdeEditorView, ide_editor_view, IDE_TYPE_LAYOUT_VIEW)
 
@@ -331,6 +334,49 @@ ide_editor_view__buffer_cursor_moved (IdeEditorView     *self,
   gtk_widget_set_visible (GTK_WIDGET (self->range_label), TRUE);
 }
 
+static void
+ide_editor_view__buffer_loaded (IdeEditorView *self,
+                                IdeBuffer     *buffer)
+{
+  g_assert (IDE_IS_EDITOR_VIEW (self));
+  g_assert (IDE_IS_BUFFER (buffer));
+
+  if (gtk_widget_get_visible (GTK_WIDGET (self->progress_bar)))
+    ide_widget_hide_with_fade (GTK_WIDGET (self->progress_bar));
+
+  if (self->load_progress_binding != NULL)
+    g_binding_unbind (self->load_progress_binding);
+}
+
+/*
+ * Large files can take a while to be inserted into the buffer, so show the
+ * progress while the contents arrive. Large file mode may be enabled after
+ * the view was created, so this is also called when it changes.
+ */
+static void
+ide_editor_view__buffer_notify_large_file (IdeEditorView *self,
+                                           GParamSpec    *pspec,
+                                           IdeBuffer     *buffer)
+{
+  IdeProgress *progress;
+
+  g_assert (IDE_IS_EDITOR_VIEW (self));
+  g_assert (IDE_IS_BUFFER (buffer));
+
+  if (self->load_progress_binding != NULL ||
+      !ide_buffer_get_large_file (buffer) ||
+      !(progress = _ide_buffer_get_load_progress (buffer)))
+    return;
+
+  gtk_progress_bar_set_fraction (self->progress_bar, 0.0);
+  self->load_progress_binding =
+    g_object_bind_property (progress, "fraction", self->progress_bar, "fraction",
+                            G_BINDING_SYNC_CREATE);
+  g_object_add_weak_pointer (G_OBJECT (self->load_progress_binding),
+                             (gpointer *)&self->load_progress_binding);
+  gtk_widget_show (GTK_WIDGET (self->progress_bar));
+}
+
 static void
 ide_editor_view_set_document (IdeEditorView *self,
                               IdeBuffer     *document)
@@ -393,6 +439,24 @@ ide_editor_view_set_document (IdeEditorView *self,
                               self->warning_button, "visible",
                               G_BINDING_SYNC_CREATE);
 
+      g_object_bind_property (document, "large-file",
+                              self->large_file_revealer, "reveal-child",
+                              G_BINDING_SYNC_CREATE);
+
+      g_signal_connect_object (document,
+                               "notify::large-file",
+                               G_CALLBACK (ide_editor_view__buffer_notify_large_file),
+                               self,
+                               G_CONNECT_SWAPPED);
+
+      g_signal_connect_object (document,
+                               "loaded",
+                               G_CALLBACK (ide_editor_view__buffer_loaded),
+                               self,
+                               G_CONNECT_SWAPPED);
+
+      ide_editor_view__buffer_notify_large_file (self, NULL, document);
+
       ide_editor_view__buffer_notify_language (self, NULL, document);
       ide_editor_view__buffer_notify_title (self, NULL, IDE_BUFFER (document));
 
@@ -815,6 +879,9 @@ ide_editor_view_destroy (GtkWidget *widget)
 
   ide_editor_view_unload_addins (self);
 
+  if (self->load_progress_binding != NULL)
+    g_binding_unbind (self->load_progress_binding);
+
   GTK_WIDGET_CLASS (ide_editor_view_parent_class)->destroy (widget);
 
   g_clear_object (&self->document);
@@ -920,6 +987,7 @@ ide_editor_view_class_init (IdeEditorViewClass *klass)
   gtk_widget_class_bind_template_child (widget_class, IdeEditorView, frame1);
   gtk_widget_class_bind_template_child (widget_class, IdeEditorView, goto_line_button);
   gtk_widget_class_bind_template_child (widget_class, IdeEditorView, goto_line_popover);
+  gtk_widget_class_bind_template_child (widget_class, IdeEditorView, large_file_revealer);
   gtk_widget_class_bind_template_child (widget_class, IdeEditorView, line_label);
   gtk_widget_class_bind_template_child (widget_class, IdeEditorView, modified_cancel_button);
   gtk_widget_class_bind_template_child (widget_class, IdeEditorView, modified_revealer);
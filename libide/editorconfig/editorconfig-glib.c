@@ -17,8 +17,55 @@
  */
 
 #include <editorconfig/editorconfig.h>
+#include <stdlib.h>
+#include <string.h>
 
+#include "ec_glob.h"
 #include "editorconfig-glib.h"
+#include "ini.h"
+
+/*
+ * The EditorconfigCache below keeps every .editorconfig we have seen parsed
+ * in memory, keyed by the directory containing it. Files are read with the
+ * ini parser of libeditorconfig and section globs are compiled once with
+ * ec_glob_compile(), so matching follows editorconfig_parse() exactly.
+ * Directories without an .editorconfig are cached too so that we do not
+ * stat() them again. Entries are dropped by the file monitors installed
+ * with editorconfig_cache_watch().
+ */
+
+typedef struct
+{
+  ec_glob_re *glob;
+  GPtrArray  *names;
+  GPtrArray  *values;
+} EditorconfigSection;
+
+typedef struct
+{
+  volatile gint  ref_count;
+  GPtrArray     *sections;
+  guint          root : 1;
+  guint          failed : 1;
+} EditorconfigFile;
+
+typedef struct
+{
+  EditorconfigFile *file;
+  const gchar      *prefix;
+  gchar            *section;
+} EditorconfigLoad;
+
+struct _EditorconfigCache
+{
+  volatile gint  ref_count;
+  GMutex         mutex;
+  gchar         *workdir;
+  GHashTable    *files;
+  GHashTable    *watched;
+  GPtrArray     *monitors;
+  guint          generation;
+};
 
 static void
 _g_value_free (gpointer data)
@@ -29,6 +76,40 @@ _g_value_free (gpointer data)
   g_free (value);
 }
 
+static GValue *
+_g_value_new_for_key (const gchar *key,
+                      const gchar *valuestr)
+{
+  GValue *value = g_new0 (GValue, 1);
+
+  if ((g_strcmp0 (key, "indent_size") == 0) && (g_strcmp0 (valuestr, "tab") == 0))
+    {
+      /* Without a tab_width, indent by whatever the tab width is */
+      g_value_init (value, G_TYPE_INT);
+      g_value_set_int (value, -1);
+    }
+  else if ((g_strcmp0 (key, "tab_width") == 0) ||
+           (g_strcmp0 (key, "max_line_length") == 0) ||
+           (g_strcmp0 (key, "indent_size") == 0))
+    {
+      g_value_init (value, G_TYPE_INT);
+      g_value_set_int (value, g_ascii_strtoll (valuestr, NULL, 10));
+    }
+  else if ((g_strcmp0 (key, "insert_final_newline") == 0) ||
+           (g_strcmp0 (key, "trim_trailing_whitespace") == 0))
+    {
+      g_value_init (value, G_TYPE_BOOLEAN);
+      g_value_set_boolean (value, g_str_equal (valuestr, "true"));
+    }
+  else
+    {
+      g_value_init (value, G_TYPE_STRING);
+      g_value_set_string (value, valuestr);
+    }
+
+  return value;
+}
+
 GHashTable *
 editorconfig_glib_read (GFile         *file,
                         GCancellable  *cancellable,
@@ -81,39 +162,554 @@ editorconfig_glib_read (GFile         *file,
 
   for (i = 0; i < count; i++)
     {
-      GValue *value;
       const gchar *key = NULL;
       const gchar *valuestr = NULL;
 
-      value = g_new0 (GValue, 1);
-
       editorconfig_handle_get_name_value (handle, i, &key, &valuestr);
 
-      if ((g_strcmp0 (key, "tab_width") == 0) ||
-          (g_strcmp0 (key, "max_line_length") == 0) ||
-          (g_strcmp0 (key, "indent_size") == 0))
+      g_hash_table_replace (ret, g_strdup (key), _g_value_new_for_key (key, valuestr));
+    }
+
+cleanup:
+  editorconfig_handle_destroy (handle);
+  g_free (filename);
+
+  return ret;
+}
+
+static void
+editorconfig_section_free (gpointer data)
+{
+  EditorconfigSection *section = data;
+
+  g_clear_pointer (&section->glob, ec_glob_free);
+  g_clear_pointer (&section->names, g_ptr_array_unref);
+  g_clear_pointer (&section->values, g_ptr_array_unref);
+  g_slice_free (EditorconfigSection, section);
+}
+
+static EditorconfigFile *
+editorconfig_file_ref (EditorconfigFile *file)
+{
+  g_assert (file != NULL);
+  g_assert (file->ref_count > 0);
+
+  g_atomic_int_inc (&file->ref_count);
+
+  return file;
+}
+
+static void
+editorconfig_file_unref (EditorconfigFile *file)
+{
+  g_assert (file != NULL);
+  g_assert (file->ref_count > 0);
+
+  if (g_atomic_int_dec_and_test (&file->ref_count))
+    {
+      g_clear_pointer (&file->sections, g_ptr_array_unref);
+      g_slice_free (EditorconfigFile, file);
+    }
+}
+
+static void
+editorconfig_file_add_section (EditorconfigFile *file,
+                               const gchar      *prefix,
+                               const gchar      *name)
+{
+  EditorconfigSection *section;
+  g_autofree gchar *pattern = NULL;
+  ec_glob_re *glob;
+
+  g_assert (file != NULL);
+  g_assert (prefix != NULL);
+  g_assert (name != NULL);
+
+  /* Same prefixing rules as the ini_handler() of libeditorconfig */
+  if (strchr (name, '/') == NULL)
+    pattern = g_strconcat (prefix, "**/", name, NULL);
+  else if (*name != '/')
+    pattern = g_strconcat (prefix, "/", name, NULL);
+  else
+    pattern = g_strconcat (prefix, name, NULL);
+
+  /* Keep a placeholder for sections that fail to compile, they never match */
+  if (!(glob = ec_glob_compile (pattern)))
+    {
+      g_ptr_array_add (file->sections, NULL);
+      return;
+    }
+
+  section = g_slice_new0 (EditorconfigSection);
+  section->glob = glob;
+  section->names = g_ptr_array_new_with_free_func (g_free);
+  section->values = g_ptr_array_new_with_free_func (g_free);
+
+  g_ptr_array_add (file->sections, section);
+}
+
+static void
+editorconfig_file_add_value (EditorconfigFile *file,
+                             const gchar      *name,
+                             const gchar      *value)
+{
+  EditorconfigSection *section;
+  gchar *name_lwr;
+
+  g_assert (file != NULL);
+  g_assert (file->sections->len > 0);
+
+  section = g_ptr_array_index (file->sections, file->sections->len - 1);
+
+  if (section == NULL)
+    return;
+
+  /* Property names are case insensitive, so are some of the values */
+  name_lwr = g_ascii_strdown (name, -1);
+
+  g_ptr_array_add (section->names, name_lwr);
+
+  if (g_str_equal (name_lwr, "end_of_line") ||
+      g_str_equal (name_lwr, "indent_style") ||
+      g_str_equal (name_lwr, "indent_size") ||
+      g_str_equal (name_lwr, "insert_final_newline") ||
+      g_str_equal (name_lwr, "trim_trailing_whitespace") ||
+      g_str_equal (name_lwr, "charset"))
+    g_ptr_array_add (section->values, g_ascii_strdown (value, -1));
+  else
+    g_ptr_array_add (section->values, g_strdup (value));
+}
+
+static int
+editorconfig_file_load_handler (void       *user_data,
+                                const char *section,
+                                const char *name,
+                                const char *value)
+{
+  EditorconfigLoad *load = user_data;
+
+  if (*section == '\0')
+    {
+      if (g_ascii_strcasecmp (name, "root") == 0 &&
+          g_ascii_strcasecmp (value, "true") == 0)
+        load->file->root = TRUE;
+      return 1;
+    }
+
+  /* ini_parse() only tells us the section of each value */
+  if (g_strcmp0 (section, load->section) != 0)
+    {
+      g_free (load->section);
+      load->section = g_strdup (section);
+      editorconfig_file_add_section (load->file, load->prefix, section);
+    }
+
+  editorconfig_file_add_value (load->file, name, value);
+
+  return 1;
+}
+
+/*
+ * Loads and compiles the .editorconfig found in @dir. A missing or
+ * unreadable file results in an empty file, just as libeditorconfig
+ * ignores I/O errors.
+ */
+static EditorconfigFile *
+editorconfig_file_load (const gchar *dir)
+{
+  g_autofree gchar *path = NULL;
+  EditorconfigLoad load = { 0 };
+  EditorconfigFile *file;
+  gint err;
+
+  g_assert (dir != NULL);
+
+  file = g_slice_new0 (EditorconfigFile);
+  file->ref_count = 1;
+  file->sections = g_ptr_array_new_with_free_func (editorconfig_section_free);
+
+  path = g_build_filename (dir, ".editorconfig", NULL);
+
+  load.file = file;
+  /* libeditorconfig uses the directory without a trailing slash */
+  load.prefix = g_str_equal (dir, "/") ? "" : dir;
+
+  err = ini_parse (path, editorconfig_file_load_handler, &load);
+
+  /* -1 is an I/O error, such as the file not existing */
+  if (err > 0)
+    file->failed = TRUE;
+
+  g_free (load.section);
+
+  return file;
+}
+
+/*
+ * Returns the directories that may contain an .editorconfig affecting
+ * @filename, closest first.
+ */
+static GPtrArray *
+get_directories (const gchar *filename)
+{
+  GPtrArray *dirs;
+  gchar *dir;
+
+  g_assert (filename != NULL);
+
+  dirs = g_ptr_array_new_with_free_func (g_free);
+  dir = g_path_get_dirname (filename);
+
+  for (;;)
+    {
+      g_ptr_array_add (dirs, dir);
+
+      if (g_str_equal (dir, "/") || g_str_equal (dir, "."))
+        break;
+
+      dir = g_path_get_dirname (dir);
+    }
+
+  return dirs;
+}
+
+/**
+ * editorconfig_cache_new:
+ * @workdir: (nullable): the working directory of the project
+ *
+ * Creates a new cache. Only directories within @workdir are monitored for
+ * newly created .editorconfig files, outside of it only existing files are
+ * monitored.
+ */
+EditorconfigCache *
+editorconfig_cache_new (GFile *workdir)
+{
+  EditorconfigCache *self;
+
+  g_return_val_if_fail (!workdir || G_IS_FILE (workdir), NULL);
+
+  self = g_slice_new0 (EditorconfigCache);
+  self->ref_count = 1;
+  g_mutex_init (&self->mutex);
+  self->workdir = workdir ? g_file_get_path (workdir) : NULL;
+  self->files = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+                                       (GDestroyNotify)editorconfig_file_unref);
+  self->watched = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+  self->monitors = g_ptr_array_new_with_free_func (g_object_unref);
+
+  return self;
+}
+
+EditorconfigCache *
+editorconfig_cache_ref (EditorconfigCache *self)
+{
+  g_return_val_if_fail (self != NULL, NULL);
+  g_return_val_if_fail (self->ref_count > 0, NULL);
+
+  g_atomic_int_inc (&self->ref_count);
+
+  return self;
+}
+
+void
+editorconfig_cache_unref (EditorconfigCache *self)
+{
+  g_return_if_fail (self != NULL);
+  g_return_if_fail (self->ref_count > 0);
+
+  if (g_atomic_int_dec_and_test (&self->ref_count))
+    {
+      guint i;
+
+      for (i = 0; i < self->monitors->len; i++)
         {
-          g_value_init (value, G_TYPE_INT);
-          g_value_set_int (value, g_ascii_strtoll (valuestr, NULL, 10));
+          GFileMonitor *monitor = g_ptr_array_index (self->monitors, i);
+
+          g_signal_handlers_disconnect_by_data (monitor, self);
+          g_file_monitor_cancel (monitor);
         }
-      else if ((g_strcmp0 (key, "insert_final_newline") == 0) ||
-               (g_strcmp0 (key, "trim_trailing_whitespace") == 0))
+
+      g_clear_pointer (&self->monitors, g_ptr_array_unref);
+      g_clear_pointer (&self->watched, g_hash_table_unref);
+      g_clear_pointer (&self->files, g_hash_table_unref);
+      g_clear_pointer (&self->workdir, g_free);
+      g_mutex_clear (&self->mutex);
+      g_slice_free (EditorconfigCache, self);
+    }
+}
+
+static void
+editorconfig_cache_monitor_changed (EditorconfigCache *self,
+                                    GFile             *file,
+                                    GFile             *other_file,
+                                    GFileMonitorEvent  event,
+                                    GFileMonitor      *monitor)
+{
+  g_autoptr(GFile) parent = NULL;
+  g_autofree gchar *dir = NULL;
+
+  g_assert (self != NULL);
+  g_assert (G_IS_FILE (file));
+  g_assert (G_IS_FILE_MONITOR (monitor));
+
+  if (event == G_FILE_MONITOR_EVENT_ATTRIBUTE_CHANGED)
+    return;
+
+  if (!(parent = g_file_get_parent (file)) || !(dir = g_file_get_path (parent)))
+    return;
+
+  g_mutex_lock (&self->mutex);
+  g_hash_table_remove (self->files, dir);
+  self->generation++;
+  g_mutex_unlock (&self->mutex);
+}
+
+static gboolean
+editorconfig_cache_is_in_workdir (EditorconfigCache *self,
+                                  const gchar       *dir)
+{
+  gsize len;
+
+  if (self->workdir == NULL || !g_str_has_prefix (dir, self->workdir))
+    return FALSE;
+
+  len = strlen (self->workdir);
+
+  return dir [len] == '\0' || dir [len] == G_DIR_SEPARATOR;
+}
+
+static gboolean
+editorconfig_cache_is_root (EditorconfigCache *self,
+                            const gchar       *dir)
+{
+  EditorconfigFile *file;
+  gboolean ret;
+
+  g_mutex_lock (&self->mutex);
+  file = g_hash_table_lookup (self->files, dir);
+  ret = (file != NULL && file->root);
+  g_mutex_unlock (&self->mutex);
+
+  return ret;
+}
+
+/**
+ * editorconfig_cache_watch:
+ *
+ * Installs file monitors for the .editorconfig files that may affect @file
+ * so that the cached copies are dropped when they change.
+ *
+ * Within the working directory, every directory is watched so that new
+ * .editorconfig files are noticed. Above it, only .editorconfig files that
+ * already exist are watched, to avoid monitoring directories such as $HOME.
+ * A file created there is picked up the next time the project is loaded.
+ *
+ * This must be called from the main thread, the monitors dispatch to the
+ * thread-default main context of the caller.
+ */
+void
+editorconfig_cache_watch (EditorconfigCache *self,
+                          GFile             *file)
+{
+  g_autoptr(GPtrArray) dirs = NULL;
+  g_autofree gchar *filename = NULL;
+  guint i;
+
+  g_return_if_fail (self != NULL);
+  g_return_if_fail (G_IS_FILE (file));
+
+  if (!(filename = g_file_get_path (file)))
+    return;
+
+  dirs = get_directories (filename);
+
+  for (i = 0; i < dirs->len; i++)
+    {
+      const gchar *dir = g_ptr_array_index (dirs, i);
+
+      if (!g_hash_table_contains (self->watched, dir))
         {
-          g_value_init (value, G_TYPE_BOOLEAN);
-          g_value_set_boolean (value, g_str_equal (valuestr, "true"));
+          g_autoptr(GFile) config = NULL;
+          g_autofree gchar *path = NULL;
+          GFileMonitor *monitor;
+
+          g_hash_table_add (self->watched, g_strdup (dir));
+
+          path = g_build_filename (dir, ".editorconfig", NULL);
+
+          if (!editorconfig_cache_is_in_workdir (self, dir) &&
+              !g_file_test (path, G_FILE_TEST_IS_REGULAR))
+            continue;
+
+          config = g_file_new_for_path (path);
+
+          if (!(monitor = g_file_monitor_file (config, G_FILE_MONITOR_NONE, NULL, NULL)))
+            continue;
+
+          g_signal_connect_swapped (monitor,
+                                    "changed",
+                                    G_CALLBACK (editorconfig_cache_monitor_changed),
+                                    self);
+
+          g_ptr_array_add (self->monitors, monitor);
         }
-      else
+
+      /* Nothing above a root .editorconfig can affect @file */
+      if (editorconfig_cache_is_root (self, dir))
+        break;
+    }
+}
+
+static EditorconfigFile *
+editorconfig_cache_lookup (EditorconfigCache *self,
+                           const gchar       *dir)
+{
+  EditorconfigFile *file;
+  guint generation;
+
+  g_assert (self != NULL);
+  g_assert (dir != NULL);
+
+  g_mutex_lock (&self->mutex);
+  if ((file = g_hash_table_lookup (self->files, dir)))
+    editorconfig_file_ref (file);
+  generation = self->generation;
+  g_mutex_unlock (&self->mutex);
+
+  if (file != NULL)
+    return file;
+
+  file = editorconfig_file_load (dir);
+
+  /* Don't cache the result if a monitor fired while we were loading */
+  g_mutex_lock (&self->mutex);
+  if (generation == self->generation && !g_hash_table_contains (self->files, dir))
+    g_hash_table_insert (self->files, g_strdup (dir), editorconfig_file_ref (file));
+  g_mutex_unlock (&self->mutex);
+
+  return file;
+}
+
+/*
+ * Applies the same post-processing as editorconfig_parse() does for
+ * version 0.9 and newer of the specification.
+ */
+static void
+editorconfig_apply_defaults (GHashTable *values)
+{
+  const gchar *indent_style = g_hash_table_lookup (values, "indent_style");
+  const gchar *indent_size = g_hash_table_lookup (values, "indent_size");
+  const gchar *tab_width = g_hash_table_lookup (values, "tab_width");
+
+  if (indent_style != NULL && indent_size == NULL && g_str_equal (indent_style, "tab"))
+    {
+      indent_size = "tab";
+      g_hash_table_insert (values, (gchar *)"indent_size", (gchar *)indent_size);
+    }
+
+  if (indent_size != NULL && tab_width != NULL && g_str_equal (indent_size, "tab"))
+    {
+      indent_size = tab_width;
+      g_hash_table_insert (values, (gchar *)"indent_size", (gchar *)indent_size);
+    }
+
+  if (indent_size != NULL && tab_width == NULL && !g_str_equal (indent_size, "tab"))
+    g_hash_table_insert (values, (gchar *)"tab_width", (gchar *)indent_size);
+}
+
+/**
+ * editorconfig_cache_read:
+ *
+ * Like editorconfig_glib_read(), but resolves the settings using the parsed
+ * .editorconfig files in @self, only loading the ones not yet cached.
+ *
+ * This is safe to call from a thread.
+ */
+GHashTable *
+editorconfig_cache_read (EditorconfigCache  *self,
+                         GFile              *file,
+                         GCancellable       *cancellable,
+                         GError            **error)
+{
+  g_autoptr(GPtrArray) dirs = NULL;
+  g_autoptr(GPtrArray) files = NULL;
+  g_autoptr(GHashTable) values = NULL;
+  g_autofree gchar *filename = NULL;
+  GHashTableIter iter;
+  GHashTable *ret;
+  gpointer k, v;
+  guint i;
+
+  g_return_val_if_fail (self != NULL, NULL);
+  g_return_val_if_fail (G_IS_FILE (file), NULL);
+
+  if (!(filename = g_file_get_path (file)))
+    {
+      g_set_error (error,
+                   G_IO_ERROR,
+                   G_IO_ERROR_NOT_SUPPORTED,
+                   "only local files are currently supported");
+      return NULL;
+    }
+
+  files = g_ptr_array_new_with_free_func ((GDestroyNotify)editorconfig_file_unref);
+  dirs = get_directories (filename);
+
+  /* Walk up until we find a root .editorconfig */
+  for (i = 0; i < dirs->len; i++)
+    {
+      EditorconfigFile *ecfile;
+
+      if (g_cancellable_set_error_if_cancelled (cancellable, error))
+        return NULL;
+
+      ecfile = editorconfig_cache_lookup (self, g_ptr_array_index (dirs, i));
+      g_ptr_array_add (files, ecfile);
+
+      if (ecfile->root)
+        break;
+    }
+
+  values = g_hash_table_new (g_str_hash, g_str_equal);
+
+  /* Apply from the top-most file down, closer files take precedence */
+  for (i = files->len; i > 0; i--)
+    {
+      EditorconfigFile *ecfile = g_ptr_array_index (files, i - 1);
+      guint j;
+
+      if (ecfile->failed)
         {
-          g_value_init (value, G_TYPE_STRING);
-          g_value_set_string (value, valuestr);
+          g_set_error (error,
+                       G_IO_ERROR,
+                       G_IO_ERROR_FAILED,
+                       "Failed to parse editorconfig.");
+          return NULL;
         }
 
-      g_hash_table_replace (ret, g_strdup (key), value);
+      for (j = 0; j < ecfile->sections->len; j++)
+        {
+          EditorconfigSection *section = g_ptr_array_index (ecfile->sections, j);
+          guint n;
+
+          if (section == NULL || ec_glob_match (section->glob, filename) != 0)
+            continue;
+
+          for (n = 0; n < section->names->len; n++)
+            g_hash_table_insert (values,
+                                 g_ptr_array_index (section->names, n),
+                                 g_ptr_array_index (section->values, n));
+        }
     }
 
-cleanup:
-  editorconfig_handle_destroy (handle);
-  g_free (filename);
+  editorconfig_apply_defaults (values);
+
+  ret = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, _g_value_free);
+
+  g_hash_table_iter_init (&iter, values);
+
+  while (g_hash_table_iter_next (&iter, &k, &v))
+    g_hash_table_insert (ret, g_strdup (k), _g_value_new_for_key (k, v));
 
   return ret;
 }
@@ -13,8 +13,21 @@
 
 #include <gio/gio.h>
 
-GHashTable *editorconfig_glib_read (GFile         *file,
-                                    GCancellable  *cancellable,
-                                    GError       **error);
+typedef struct _EditorconfigCache EditorconfigCache;
+
+GHashTable        *editorconfig_glib_read   (GFile              *file,
+                                             GCancellable       *cancellable,
+                                             GError            **error);
+EditorconfigCache *editorconfig_cache_new   (GFile              *workdir);
+EditorconfigCache *editorconfig_cache_ref   (EditorconfigCache  *self);
+void               editorconfig_cache_unref (EditorconfigCache  *self);
+void               editorconfig_cache_watch (EditorconfigCache  *self,
+                                             GFile              *file);
+GHashTable        *editorconfig_cache_read  (EditorconfigCache  *self,
+                                             GFile              *file,
+                                             GCancellable       *cancellable,
+                                             GError            **error);
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC (EditorconfigCache, editorconfig_cache_unref)
 
 #endif /* EDITORCONFIG_GLIB_H */
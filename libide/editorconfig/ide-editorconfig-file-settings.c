@@ -19,14 +19,22 @@
 #include <editorconfig-glib.h>
 #include <glib/gi18n.h>
 
+#include "ide-context.h"
 #include "ide-editorconfig-file-settings.h"
 #include "ide-file.h"
+#include "ide-vcs.h"
 
 struct _IdeEditorconfigFileSettings
 {
   IdeFileSettings parent_instance;
 };
 
+typedef struct
+{
+  GFile             *file;
+  EditorconfigCache *cache;
+} InitState;
+
 static void async_initable_iface_init (GAsyncInitableIface *iface);
 
 G_DEFINE_TYPE_EXTENDED (IdeEditorconfigFileSettings,
@@ -46,13 +54,54 @@ ide_editorconfig_file_settings_init (IdeEditorconfigFileSettings *self)
 {
 }
 
+static void
+init_state_free (gpointer data)
+{
+  InitState *state = data;
+
+  g_clear_object (&state->file);
+  g_clear_pointer (&state->cache, editorconfig_cache_unref);
+  g_slice_free (InitState, state);
+}
+
+/*
+ * The parsed .editorconfig files are shared by every file in the context
+ * so that resolving settings rarely needs to touch the disk.
+ */
+static EditorconfigCache *
+get_editorconfig_cache (IdeContext *context)
+{
+  EditorconfigCache *cache;
+
+  g_assert (IDE_IS_CONTEXT (context));
+
+  cache = g_object_get_data (G_OBJECT (context), "EDITORCONFIG_CACHE");
+
+  if (cache == NULL)
+    {
+      GFile *workdir = NULL;
+      IdeVcs *vcs;
+
+      if ((vcs = ide_context_get_vcs (context)))
+        workdir = ide_vcs_get_working_directory (vcs);
+
+      cache = editorconfig_cache_new (workdir);
+      g_object_set_data_full (G_OBJECT (context),
+                              "EDITORCONFIG_CACHE",
+                              cache,
+                              (GDestroyNotify)editorconfig_cache_unref);
+    }
+
+  return cache;
+}
+
 static void
 ide_editorconfig_file_settings_init_worker (GTask        *task,
                                             gpointer      source_object,
                                             gpointer      task_data,
                                             GCancellable *cancellable)
 {
-  GFile *file = task_data;
+  InitState *state = task_data;
   GHashTableIter iter;
   GHashTable *ht;
   gpointer k, v;
@@ -60,10 +109,11 @@ ide_editorconfig_file_settings_init_worker (GTask        *task,
 
   g_assert (G_IS_TASK (task));
   g_assert (IDE_IS_EDITORCONFIG_FILE_SETTINGS (source_object));
-  g_assert (G_IS_FILE (file));
+  g_assert (state != NULL);
+  g_assert (G_IS_FILE (state->file));
   g_assert (!cancellable || G_IS_CANCELLABLE (cancellable));
 
-  ht = editorconfig_glib_read (file, cancellable, &error);
+  ht = editorconfig_cache_read (state->cache, state->file, cancellable, &error);
 
   if (!ht)
     {
@@ -133,6 +183,8 @@ ide_editorconfig_file_settings_init_async (GAsyncInitable      *initable,
 {
   IdeEditorconfigFileSettings *self = (IdeEditorconfigFileSettings *)initable;
   g_autoptr(GTask) task = NULL;
+  IdeContext *context;
+  InitState *state;
   IdeFile *file;
   GFile *gfile = NULL;
 
@@ -154,7 +206,16 @@ ide_editorconfig_file_settings_init_async (GAsyncInitable      *initable,
       return;
     }
 
-  g_task_set_task_data (task, g_object_ref (gfile), g_object_unref);
+  context = ide_object_get_context (IDE_OBJECT (self));
+
+  state = g_slice_new0 (InitState);
+  state->file = g_object_ref (gfile);
+  state->cache = editorconfig_cache_ref (get_editorconfig_cache (context));
+
+  /* Monitors must be created from the main thread */
+  editorconfig_cache_watch (state->cache, gfile);
+
+  g_task_set_task_data (task, state, init_state_free);
   g_task_run_in_thread (task, ide_editorconfig_file_settings_init_worker);
 }
 
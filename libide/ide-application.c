@@ -365,6 +365,7 @@ ide_application_startup (GApplication *application)
     }
 
   _ide_battery_monitor_init ();
+  _ide_stall_monitor_init ();
 
   G_APPLICATION_CLASS (ide_application_parent_class)->startup (application);
 
@@ -83,3 +83,213 @@ ide_async_helper_run (gpointer             source_object,
          ide_async_helper_cb,
          g_object_ref (task));
 }
+
+typedef struct
+{
+  IdeAsyncGraphStep *steps;
+  GArray            *timeline;
+  guint64            all;
+  guint64            started;
+  guint64            completed;
+  guint              n_steps;
+  guint              failed : 1;
+} GraphState;
+
+typedef struct
+{
+  GTask *task;
+  guint  index;
+} GraphStepClosure;
+
+static void ide_async_helper_graph_advance (GTask *task);
+
+static void
+graph_state_free (gpointer data)
+{
+  GraphState *state = data;
+
+  g_clear_pointer (&state->timeline, g_array_unref);
+  g_free (state->steps);
+  g_slice_free (GraphState, state);
+}
+
+static void
+ide_async_helper_graph_step_cb (GObject      *object,
+                                GAsyncResult *result,
+                                gpointer      user_data)
+{
+  GraphStepClosure *closure = user_data;
+  g_autoptr(GTask) task = closure->task;
+  guint index = closure->index;
+  GraphState *state;
+  GError *error = NULL;
+
+  g_return_if_fail (G_IS_TASK (task));
+  g_return_if_fail (G_IS_TASK (result));
+
+  g_slice_free (GraphStepClosure, closure);
+
+  state = g_task_get_task_data (task);
+
+  if (state->timeline != NULL)
+    g_array_index (state->timeline, IdeAsyncStepTiming, index).end_time = g_get_monotonic_time ();
+
+  if (!g_task_propagate_boolean (G_TASK (result), &error))
+    {
+      /* Only the first failure is reported, the rest are dropped */
+      if (!state->failed)
+        {
+          state->failed = TRUE;
+          g_task_return_error (task, error);
+        }
+      else
+        g_clear_error (&error);
+
+      return;
+    }
+
+  state->completed |= IDE_ASYNC_STEP_REQUIRES (index);
+
+  if (!state->failed)
+    ide_async_helper_graph_advance (task);
+}
+
+static void
+ide_async_helper_graph_advance (GTask *task)
+{
+  GraphState *state;
+  guint i;
+
+  g_assert (G_IS_TASK (task));
+
+  state = g_task_get_task_data (task);
+
+  g_assert (state != NULL);
+  g_assert (!state->failed);
+
+  /*
+   * Start every step whose requirements have been met. The started mask is
+   * updated before calling into the step so that we are safe against the
+   * step completing (and re-entering) before it returns.
+   */
+  for (i = 0; i < state->n_steps; i++)
+    {
+      const IdeAsyncGraphStep *step = &state->steps [i];
+      guint64 bit = IDE_ASYNC_STEP_REQUIRES (i);
+      GraphStepClosure *closure;
+
+      if ((state->started & bit) != 0)
+        continue;
+
+      if ((state->completed & step->requires) != step->requires)
+        continue;
+
+      state->started |= bit;
+
+      if (state->timeline != NULL)
+        g_array_index (state->timeline, IdeAsyncStepTiming, i).begin_time = g_get_monotonic_time ();
+
+      closure = g_slice_new0 (GraphStepClosure);
+      closure->task = g_object_ref (task);
+      closure->index = i;
+
+      step->func (g_task_get_source_object (task),
+                  g_task_get_cancellable (task),
+                  ide_async_helper_graph_step_cb,
+                  closure);
+
+      if (state->failed)
+        return;
+    }
+
+  if (state->completed == state->all)
+    {
+      g_task_return_boolean (task, TRUE);
+      return;
+    }
+
+  /*
+   * If nothing is in flight and we could not start anything, the remaining
+   * steps can never be satisfied.
+   */
+  if ((state->started & ~state->completed) == 0)
+    {
+      state->failed = TRUE;
+      g_task_return_new_error (task,
+                               G_IO_ERROR,
+                               G_IO_ERROR_FAILED,
+                               "Unsatisfiable dependencies in async step graph");
+    }
+}
+
+/**
+ * ide_async_helper_run_graph:
+ * @source_object: the source object for the steps
+ * @steps: (array length=n_steps): the steps to run
+ * @n_steps: the number of steps, at most %IDE_ASYNC_GRAPH_MAX_STEPS
+ * @timeline: (nullable) (element-type IdeAsyncStepTiming): an array to
+ *   receive the timing of each step, or %NULL.
+ * @cancellable: (nullable): a #GCancellable
+ * @callback: the callback to execute upon completion
+ * @user_data: user data for @callback
+ *
+ * Like ide_async_helper_run(), but rather than running the steps one after
+ * another, each step is started as soon as the steps it requires have
+ * completed. Independent steps are therefore run concurrently.
+ *
+ * If @timeline is provided, it is resized to @n_steps and each element is
+ * filled with the name of the step and the monotonic time at which the step
+ * began and completed.
+ *
+ * Use g_task_propagate_boolean() to complete the operation from @callback.
+ */
+void
+ide_async_helper_run_graph (gpointer                 source_object,
+                            const IdeAsyncGraphStep *steps,
+                            guint                    n_steps,
+                            GArray                  *timeline,
+                            GCancellable            *cancellable,
+                            GAsyncReadyCallback      callback,
+                            gpointer                 user_data)
+{
+  g_autoptr(GTask) task = NULL;
+  GraphState *state;
+  guint i;
+
+  g_return_if_fail (steps != NULL || n_steps == 0);
+  g_return_if_fail (n_steps <= IDE_ASYNC_GRAPH_MAX_STEPS);
+  g_return_if_fail (timeline == NULL ||
+                    g_array_get_element_size (timeline) == sizeof (IdeAsyncStepTiming));
+
+  task = g_task_new (source_object, cancellable, callback, user_data);
+
+  if (n_steps == 0)
+    {
+      g_task_return_boolean (task, TRUE);
+      return;
+    }
+
+  state = g_slice_new0 (GraphState);
+  state->steps = g_memdup (steps, sizeof *steps * n_steps);
+  state->n_steps = n_steps;
+  state->all = (n_steps == 64) ? G_MAXUINT64 : (IDE_ASYNC_STEP_REQUIRES (n_steps) - 1);
+
+  if (timeline != NULL)
+    {
+      state->timeline = g_array_ref (timeline);
+      g_array_set_size (timeline, n_steps);
+
+      for (i = 0; i < n_steps; i++)
+        {
+          IdeAsyncStepTiming *timing = &g_array_index (timeline, IdeAsyncStepTiming, i);
+
+          timing->name = steps [i].name;
+          timing->begin_time = 0;
+          timing->end_time = 0;
+        }
+    }
+
+  g_task_set_task_data (task, state, graph_state_free);
+
+  ide_async_helper_graph_advance (task);
+}
@@ -28,12 +28,46 @@ typedef void (*IdeAsyncStep) (gpointer             source_object,
                               GAsyncReadyCallback  callback,
                               gpointer             user_data);
 
-void ide_async_helper_run (gpointer             source_object,
-                           GCancellable        *cancellable,
-                           GAsyncReadyCallback  callback,
-                           gpointer             user_data,
-                           IdeAsyncStep         step1,
-                           ...);
+/*
+ * IdeAsyncGraphStep describes a single step to be run by
+ * ide_async_helper_run_graph(). @requires is a bitmask of the indexes of the
+ * steps (within the same array) that must complete before this step may be
+ * started. Use IDE_ASYNC_STEP_REQUIRES() to build the mask.
+ */
+typedef struct
+{
+  const gchar  *name;
+  IdeAsyncStep  func;
+  guint64       requires;
+} IdeAsyncGraphStep;
+
+/*
+ * IdeAsyncStepTiming contains the monotonic time at which a step was
+ * started and completed. Both are zero if the step was never run.
+ */
+typedef struct
+{
+  const gchar *name;
+  gint64       begin_time;
+  gint64       end_time;
+} IdeAsyncStepTiming;
+
+#define IDE_ASYNC_STEP_REQUIRES(n) (G_GUINT64_CONSTANT(1) << (n))
+#define IDE_ASYNC_GRAPH_MAX_STEPS  64
+
+void ide_async_helper_run       (gpointer                 source_object,
+                                 GCancellable            *cancellable,
+                                 GAsyncReadyCallback      callback,
+                                 gpointer                 user_data,
+                                 IdeAsyncStep             step1,
+                                 ...);
+void ide_async_helper_run_graph (gpointer                 source_object,
+                                 const IdeAsyncGraphStep *steps,
+                                 guint                    n_steps,
+                                 GArray                  *timeline,
+                                 GCancellable            *cancellable,
+                                 GAsyncReadyCallback      callback,
+                                 gpointer                 user_data);
 
 G_END_DECLS
 
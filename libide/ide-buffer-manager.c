@@ -35,13 +35,16 @@
 #include "ide-file-settings.h"
 #include "ide-global.h"
 #include "ide-internal.h"
+#include "ide-posix.h"
 #include "ide-progress.h"
 #include "ide-source-location.h"
 #include "ide-unsaved-files.h"
 #include "ide-vcs.h"
 
 #define AUTO_SAVE_TIMEOUT_DEFAULT    60
-#define MAX_FILE_SIZE_BYTES_DEFAULT  (1024UL * 1024UL * 10UL)
+#define MAX_FILE_SIZE_BYTES_MIN      (1024UL * 1024UL * 10UL)
+#define MAX_FILE_SIZE_BYTES_MAX      (1024UL * 1024UL * 512UL)
+#define LARGE_FILE_SIZE_BYTES        (1024UL * 1024UL * 5UL)
 
 struct _IdeBufferManager
 {
@@ -121,6 +124,21 @@ static void unregister_auto_save (IdeBufferManager *self,
 static GParamSpec *properties [LAST_PROP];
 static guint signals [LAST_SIGNAL];
 
+/*
+ * GtkTextBuffer needs several times the size of the file once it has been
+ * split into lines and segments, so the default limit is proportional to the
+ * physical memory of the machine rather than a fixed value.
+ */
+static gsize
+get_default_max_file_size (void)
+{
+  guint64 memory;
+
+  memory = ide_get_system_memory () / 8;
+
+  return CLAMP (memory, MAX_FILE_SIZE_BYTES_MIN, MAX_FILE_SIZE_BYTES_MAX);
+}
+
 static void
 save_state_free (gpointer data)
 {
@@ -330,6 +348,21 @@ ide_buffer_manager_buffer_changed (IdeBufferManager *self,
     }
 }
 
+static void
+ide_buffer_manager_buffer_notify_large_file (IdeBufferManager *self,
+                                             GParamSpec       *pspec,
+                                             IdeBuffer        *buffer)
+{
+  g_assert (IDE_IS_BUFFER_MANAGER (self));
+  g_assert (IDE_IS_BUFFER (buffer));
+
+  /* Word completion scans the whole buffer, so skip it for large files */
+  if (ide_buffer_get_large_file (buffer))
+    gtk_source_completion_words_unregister (self->word_completion, GTK_TEXT_BUFFER (buffer));
+  else
+    gtk_source_completion_words_register (self->word_completion, GTK_TEXT_BUFFER (buffer));
+}
+
 static void
 ide_buffer_manager_add_buffer (IdeBufferManager *self,
                                IdeBuffer        *buffer)
@@ -344,7 +377,8 @@ ide_buffer_manager_add_buffer (IdeBufferManager *self,
   if (self->auto_save)
     register_auto_save (self, buffer);
 
-  gtk_source_completion_words_register (self->word_completion, GTK_TEXT_BUFFER (buffer));
+  if (!ide_buffer_get_large_file (buffer))
+    gtk_source_completion_words_register (self->word_completion, GTK_TEXT_BUFFER (buffer));
 
   g_signal_connect_object (buffer,
                            "changed",
@@ -352,6 +386,12 @@ ide_buffer_manager_add_buffer (IdeBufferManager *self,
                            self,
                            (G_CONNECT_SWAPPED | G_CONNECT_AFTER));
 
+  g_signal_connect_object (buffer,
+                           "notify::large-file",
+                           G_CALLBACK (ide_buffer_manager_buffer_notify_large_file),
+                           self,
+                           G_CONNECT_SWAPPED);
+
   EGG_COUNTER_INC (registered);
 
   g_list_model_items_changed (G_LIST_MODEL (self), self->buffers->len - 1, 0, 1);
@@ -403,6 +443,9 @@ ide_buffer_manager_remove_buffer (IdeBufferManager *self,
   g_signal_handlers_disconnect_by_func (buffer,
                                         G_CALLBACK (ide_buffer_manager_buffer_changed),
                                         self);
+  g_signal_handlers_disconnect_by_func (buffer,
+                                        G_CALLBACK (ide_buffer_manager_buffer_notify_large_file),
+                                        self);
 
   g_object_unref (buffer);
 
@@ -610,6 +653,7 @@ ide_buffer_manager__load_file_query_info_cb (GObject      *object,
                                G_IO_ERROR,
                                G_IO_ERROR_INVALID_DATA,
                                _("File too large to be opened."));
+      _ide_buffer_set_loading (state->buffer, FALSE);
       IDE_EXIT;
     }
 
@@ -630,6 +674,19 @@ ide_buffer_manager__load_file_query_info_cb (GObject      *object,
       _ide_buffer_set_mtime (state->buffer, &tv);
     }
 
+  /*
+   * Very large files are loaded without the features that need to process
+   * the whole buffer. GtkSourceFileLoader inserts the contents in chunks as
+   * they are read, so the editor can show the progress as it goes.
+   */
+  if (state->is_new && size > LARGE_FILE_SIZE_BYTES)
+    {
+      IDE_TRACE_MSG ("Loading %s in large file mode", ide_file_get_path (state->file));
+      ide_buffer_set_large_file (state->buffer, TRUE);
+    }
+
+  _ide_buffer_set_load_progress (state->buffer, state->progress);
+
   g_signal_emit (self, signals [LOAD_BUFFER], 0, state->buffer, !state->is_new);
 
   gtk_source_file_loader_load_async (state->loader,
@@ -1456,7 +1513,7 @@ ide_buffer_manager_init (IdeBufferManager *self)
   self->auto_save = TRUE;
   self->auto_save_timeout = AUTO_SAVE_TIMEOUT_DEFAULT;
   self->buffers = g_ptr_array_new ();
-  self->max_file_size = MAX_FILE_SIZE_BYTES_DEFAULT;
+  self->max_file_size = get_default_max_file_size ();
   self->timeouts = g_hash_table_new (g_direct_hash, g_direct_equal);
   self->word_completion = gtk_source_completion_words_new (_("Words"), NULL);
   self->settings = g_settings_new ("org.gnome.builder.editor");
@@ -29,6 +29,7 @@
 #include "ide-context.h"
 #include "ide-debug.h"
 #include "ide-diagnostic.h"
+#include "ide-diagnostic-provider.h"
 #include "ide-diagnostician.h"
 #include "ide-diagnostics.h"
 #include "ide-extension-adapter.h"
@@ -38,6 +39,7 @@
 #include "ide-highlighter.h"
 #include "ide-highlight-engine.h"
 #include "ide-internal.h"
+#include "ide-progress.h"
 #include "ide-source-iter.h"
 #include "ide-source-location.h"
 #include "ide-source-range.h"
@@ -63,6 +65,7 @@ typedef struct
 {
   IdeContext             *context;
   IdeDiagnostics         *diagnostics;
+  GHashTable             *diagnostics_by_provider;
   GHashTable             *diagnostics_line_cache;
   IdeFile                *file;
   GBytes                 *content;
@@ -76,6 +79,11 @@ typedef struct
 
   GFileMonitor           *file_monitor;
 
+  IdeProgress            *load_progress;
+
+  /* Cancelled to drop the results of the diagnose in flight */
+  GCancellable           *diagnose_cancellable;
+
   gulong                  change_monitor_changed_handler;
 
   guint                   diagnose_timeout;
@@ -92,6 +100,7 @@ typedef struct
   guint                   diagnostics_dirty : 1;
   guint                   highlight_diagnostics : 1;
   guint                   in_diagnose : 1;
+  guint                   large_file : 1;
   guint                   loading : 1;
   guint                   mtime_set : 1;
   guint                   read_only : 1;
@@ -110,6 +119,7 @@ enum {
   PROP_FILE,
   PROP_HAS_DIAGNOSTICS,
   PROP_HIGHLIGHT_DIAGNOSTICS,
+  PROP_LARGE_FILE,
   PROP_READ_ONLY,
   PROP_STYLE_SCHEME_NAME,
   PROP_TITLE,
@@ -499,6 +509,63 @@ ide_buffer_set_diagnostics (IdeBuffer      *self,
     }
 }
 
+static void
+ide_buffer_publish_provider_diagnostics (IdeBuffer *self)
+{
+  IdeBufferPrivate *priv = ide_buffer_get_instance_private (self);
+  g_autoptr(IdeDiagnostics) diagnostics = NULL;
+  GHashTableIter iter;
+  gpointer value;
+
+  g_assert (IDE_IS_BUFFER (self));
+
+  diagnostics = ide_diagnostics_new (NULL);
+
+  g_hash_table_iter_init (&iter, priv->diagnostics_by_provider);
+  while (g_hash_table_iter_next (&iter, NULL, &value))
+    ide_diagnostics_merge (diagnostics, value);
+
+  ide_buffer_set_diagnostics (self, diagnostics);
+}
+
+static void
+ide_buffer__diagnostician_provider_diagnostics_cb (IdeBuffer             *self,
+                                                   IdeDiagnosticProvider *provider,
+                                                   IdeDiagnostics        *diagnostics,
+                                                   IdeDiagnostician      *diagnostician)
+{
+  IdeBufferPrivate *priv = ide_buffer_get_instance_private (self);
+
+  g_assert (IDE_IS_BUFFER (self));
+  g_assert (IDE_IS_DIAGNOSTIC_PROVIDER (provider));
+  g_assert (IDE_IS_DIAGNOSTICIAN (diagnostician));
+
+  /*
+   * A request may complete after the buffer has been disposed, or after
+   * diagnostics were disabled for a large file.
+   */
+  if (priv->diagnostics_by_provider == NULL || priv->large_file)
+    return;
+
+  /*
+   * Each provider replaces only its own previous results, so fast providers
+   * show up immediately while slower ones are still running.
+   */
+  if (diagnostics == NULL || ide_diagnostics_get_size (diagnostics) == 0)
+    {
+      if (!g_hash_table_remove (priv->diagnostics_by_provider, provider))
+        return;
+    }
+  else
+    {
+      g_hash_table_insert (priv->diagnostics_by_provider,
+                           g_object_ref (provider),
+                           ide_diagnostics_ref (diagnostics));
+    }
+
+  ide_buffer_publish_provider_diagnostics (self);
+}
+
 static void
 ide_buffer__file_load_settings_cb (GObject      *object,
                                    GAsyncResult *result,
@@ -537,15 +604,22 @@ ide_buffer__diagnostician_diagnose_cb (GObject      *object,
   g_assert (IDE_IS_DIAGNOSTICIAN (diagnostician));
   g_assert (IDE_IS_BUFFER (self));
 
+  diagnostics = ide_diagnostician_diagnose_finish (diagnostician, result, &error);
+
+  /* Whoever cancelled the request has already reset our state */
+  if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+    return;
+
   priv->in_diagnose = FALSE;
   g_object_notify_by_pspec (G_OBJECT (self), properties [PROP_BUSY]);
 
-  diagnostics = ide_diagnostician_diagnose_finish (diagnostician, result, &error);
-
   if (error)
     g_message ("%s", error->message);
 
-  ide_buffer_set_diagnostics (self, diagnostics);
+  /*
+   * The diagnostics have already been published per-provider from
+   * ide_buffer__diagnostician_provider_diagnostics_cb() as they arrived.
+   */
 
   if (priv->diagnostics_dirty)
     ide_buffer_queue_diagnose (self);
@@ -573,10 +647,13 @@ ide_buffer__diagnose_timeout_cb (gpointer user_data)
       priv->in_diagnose = TRUE;
       g_object_notify_by_pspec (G_OBJECT (self), properties [PROP_BUSY]);
 
+      g_clear_object (&priv->diagnose_cancellable);
+      priv->diagnose_cancellable = g_cancellable_new ();
+
       ide_buffer_sync_to_unsaved_files (self);
       ide_diagnostician_diagnose_async (priv->diagnostician,
                                         priv->file,
-                                        NULL,
+                                        priv->diagnose_cancellable,
                                         ide_buffer__diagnostician_diagnose_cb,
                                         g_object_ref (self));
     }
@@ -605,6 +682,10 @@ ide_buffer_queue_diagnose (IdeBuffer *self)
 
   priv->diagnostics_dirty = TRUE;
 
+  /* Diagnostics are deferred until the user opts in for large files */
+  if (priv->large_file)
+    return;
+
   if (priv->diagnose_timeout != 0)
     {
       g_source_remove (priv->diagnose_timeout);
@@ -646,7 +727,7 @@ ide_buffer_reload_change_monitor (IdeBuffer *self)
       g_clear_object (&priv->change_monitor);
     }
 
-  if (priv->context && priv->file)
+  if (priv->context && priv->file && !priv->large_file)
     {
       IdeVcs *vcs;
 
@@ -916,6 +997,7 @@ ide_buffer__file_notify_language (IdeBuffer  *self,
                                   GParamSpec *pspec,
                                   IdeFile    *file)
 {
+  IdeBufferPrivate *priv = ide_buffer_get_instance_private (self);
   GtkSourceLanguage *language;
 
   g_assert (IDE_IS_BUFFER (self));
@@ -926,8 +1008,11 @@ ide_buffer__file_notify_language (IdeBuffer  *self,
    *        This should be refactored as part of the move to libpeas.
    */
 
-  language = ide_file_get_language (file);
-  gtk_source_buffer_set_language (GTK_SOURCE_BUFFER (self), language);
+  if (!priv->large_file)
+    {
+      language = ide_file_get_language (file);
+      gtk_source_buffer_set_language (GTK_SOURCE_BUFFER (self), language);
+    }
 
   ide_file_load_settings_async (file,
                                 NULL,
@@ -956,6 +1041,13 @@ ide_buffer_notify_language (IdeBuffer  *self,
     ide_extension_adapter_set_value (priv->symbol_resolver_adapter, lang_id);
 
   ide_diagnostician_set_language (priv->diagnostician, language);
+
+  /* Results from the previous language's providers no longer apply */
+  if (g_hash_table_size (priv->diagnostics_by_provider) > 0)
+    {
+      g_hash_table_remove_all (priv->diagnostics_by_provider);
+      ide_buffer_publish_provider_diagnostics (self);
+    }
 }
 
 static void
@@ -1097,6 +1189,12 @@ ide_buffer_constructed (GObject *object)
                                       "context", priv->context,
                                       NULL);
 
+  g_signal_connect_object (priv->diagnostician,
+                           "provider-diagnostics",
+                           G_CALLBACK (ide_buffer__diagnostician_provider_diagnostics_cb),
+                           self,
+                           G_CONNECT_SWAPPED);
+
   g_signal_connect (self,
                     "notify::language",
                     G_CALLBACK (ide_buffer_notify_language),
@@ -1141,12 +1239,19 @@ ide_buffer_dispose (GObject *object)
       priv->diagnose_timeout = 0;
     }
 
+  if (priv->diagnose_cancellable != NULL)
+    {
+      g_cancellable_cancel (priv->diagnose_cancellable);
+      g_clear_object (&priv->diagnose_cancellable);
+    }
+
   if (priv->change_monitor)
     {
       ide_clear_signal_handler (priv->change_monitor, &priv->change_monitor_changed_handler);
       g_clear_object (&priv->change_monitor);
     }
 
+  g_clear_pointer (&priv->diagnostics_by_provider, g_hash_table_unref);
   g_clear_pointer (&priv->diagnostics_line_cache, g_hash_table_unref);
   g_clear_pointer (&priv->diagnostics, ide_diagnostics_unref);
   g_clear_pointer (&priv->content, g_bytes_unref);
@@ -1154,6 +1259,7 @@ ide_buffer_dispose (GObject *object)
   g_clear_object (&priv->diagnostician);
   g_clear_object (&priv->file);
   g_clear_object (&priv->highlight_engine);
+  g_clear_object (&priv->load_progress);
   g_clear_object (&priv->symbol_resolver_adapter);
 
   if (priv->context != NULL)
@@ -1226,6 +1332,10 @@ ide_buffer_get_property (GObject    *object,
       g_value_set_boolean (value, ide_buffer_get_highlight_diagnostics (self));
       break;
 
+    case PROP_LARGE_FILE:
+      g_value_set_boolean (value, ide_buffer_get_large_file (self));
+      break;
+
     case PROP_READ_ONLY:
       g_value_set_boolean (value, ide_buffer_get_read_only (self));
       break;
@@ -1265,6 +1375,10 @@ ide_buffer_set_property (GObject      *object,
       ide_buffer_set_highlight_diagnostics (self, g_value_get_boolean (value));
       break;
 
+    case PROP_LARGE_FILE:
+      ide_buffer_set_large_file (self, g_value_get_boolean (value));
+      break;
+
     case PROP_STYLE_SCHEME_NAME:
       ide_buffer_set_style_scheme_name (self, g_value_get_string (value));
       break;
@@ -1335,6 +1449,13 @@ ide_buffer_class_init (IdeBufferClass *klass)
                           TRUE,
                           (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
+  properties [PROP_LARGE_FILE] =
+    g_param_spec_boolean ("large-file",
+                          "Large File",
+                          "If the expensive buffer features are disabled due to the file size.",
+                          FALSE,
+                          (G_PARAM_READWRITE | G_PARAM_EXPLICIT_NOTIFY | G_PARAM_STATIC_STRINGS));
+
   properties [PROP_READ_ONLY] =
     g_param_spec_boolean ("read-only",
                           "Read Only",
@@ -1443,6 +1564,9 @@ ide_buffer_init (IdeBuffer *self)
                                    G_CONNECT_SWAPPED);
 
   priv->diagnostics_line_cache = g_hash_table_new (g_direct_hash, g_direct_equal);
+  priv->diagnostics_by_provider = g_hash_table_new_full (NULL, NULL,
+                                                         g_object_unref,
+                                                         (GDestroyNotify)ide_diagnostics_unref);
 
   EGG_COUNTER_INC (instances);
 
@@ -2030,12 +2154,14 @@ _ide_buffer_set_loading (IdeBuffer *self,
           GtkSourceLanguage *language;
           GtkSourceLanguage *current;
 
+          g_clear_object (&priv->load_progress);
+
           /*
            * It is possible our source language has changed since the buffer loaded (as loading
            * contents provides us the opportunity to inspect file contents and get a more
            * accurate content-type).
            */
-          language = ide_file_get_language (priv->file);
+          language = priv->large_file ? NULL : ide_file_get_language (priv->file);
           current = gtk_source_buffer_get_language (GTK_SOURCE_BUFFER (self));
           if (current != language)
             gtk_source_buffer_set_language (GTK_SOURCE_BUFFER (self), language);
@@ -2050,6 +2176,116 @@ _ide_buffer_set_loading (IdeBuffer *self,
     }
 }
 
+/**
+ * ide_buffer_get_large_file:
+ * @self: A #IdeBuffer.
+ *
+ * Gets the #IdeBuffer:large-file property.
+ *
+ * Returns: %TRUE if @self is in large file mode.
+ */
+gboolean
+ide_buffer_get_large_file (IdeBuffer *self)
+{
+  IdeBufferPrivate *priv = ide_buffer_get_instance_private (self);
+
+  g_return_val_if_fail (IDE_IS_BUFFER (self), FALSE);
+
+  return priv->large_file;
+}
+
+/**
+ * ide_buffer_set_large_file:
+ * @self: A #IdeBuffer.
+ * @large_file: If large file mode should be used.
+ *
+ * Sets the #IdeBuffer:large-file property.
+ *
+ * The #IdeBufferManager enables large file mode when loading files above a
+ * size threshold. While enabled, syntax and semantic highlighting, the
+ * change monitor, and diagnostics are disabled so that very large files can
+ * be opened without processing the whole buffer. Setting this to %FALSE
+ * lets the user opt back in to those features.
+ */
+void
+ide_buffer_set_large_file (IdeBuffer *self,
+                           gboolean   large_file)
+{
+  IdeBufferPrivate *priv = ide_buffer_get_instance_private (self);
+  GtkSourceLanguage *language = NULL;
+
+  g_return_if_fail (IDE_IS_BUFFER (self));
+
+  large_file = !!large_file;
+
+  if (priv->large_file == large_file)
+    return;
+
+  priv->large_file = large_file;
+
+  /* The highlighters are chosen based on the language */
+  if (!large_file && !priv->loading && priv->file != NULL)
+    language = ide_file_get_language (priv->file);
+
+  if (large_file || !priv->loading)
+    gtk_source_buffer_set_language (GTK_SOURCE_BUFFER (self), language);
+
+  if (large_file)
+    {
+      if (priv->diagnose_timeout != 0)
+        {
+          g_source_remove (priv->diagnose_timeout);
+          priv->diagnose_timeout = 0;
+        }
+
+      /* Drop the request in flight so its results are never published */
+      if (priv->diagnose_cancellable != NULL)
+        {
+          g_cancellable_cancel (priv->diagnose_cancellable);
+          g_clear_object (&priv->diagnose_cancellable);
+        }
+
+      if (priv->in_diagnose)
+        {
+          priv->in_diagnose = FALSE;
+          g_object_notify_by_pspec (G_OBJECT (self), properties [PROP_BUSY]);
+        }
+
+      g_hash_table_remove_all (priv->diagnostics_by_provider);
+      ide_buffer_set_diagnostics (self, NULL);
+      ide_buffer_clear_diagnostics (self);
+    }
+
+  ide_buffer_reload_change_monitor (self);
+
+  if (!large_file && priv->highlight_diagnostics)
+    ide_buffer_queue_diagnose (self);
+
+  g_object_notify_by_pspec (G_OBJECT (self), properties [PROP_LARGE_FILE]);
+}
+
+IdeProgress *
+_ide_buffer_get_load_progress (IdeBuffer *self)
+{
+  IdeBufferPrivate *priv = ide_buffer_get_instance_private (self);
+
+  g_return_val_if_fail (IDE_IS_BUFFER (self), NULL);
+
+  return priv->load_progress;
+}
+
+void
+_ide_buffer_set_load_progress (IdeBuffer   *self,
+                               IdeProgress *progress)
+{
+  IdeBufferPrivate *priv = ide_buffer_get_instance_private (self);
+
+  g_return_if_fail (IDE_IS_BUFFER (self));
+  g_return_if_fail (!progress || IDE_IS_PROGRESS (progress));
+
+  g_set_object (&priv->load_progress, progress);
+}
+
 /**
  * ide_buffer_get_read_only:
  * @self: A #IdeBuffer.
@@ -63,12 +63,15 @@ IdeBufferLineFlags  ide_buffer_get_line_flags                (IdeBuffer
                                                               guint                 line);
 gboolean            ide_buffer_get_read_only                 (IdeBuffer            *self);
 gboolean            ide_buffer_get_highlight_diagnostics     (IdeBuffer            *self);
+gboolean            ide_buffer_get_large_file                (IdeBuffer            *self);
 const gchar        *ide_buffer_get_style_scheme_name         (IdeBuffer            *self);
 const gchar        *ide_buffer_get_title                     (IdeBuffer            *self);
 void                ide_buffer_set_file                      (IdeBuffer            *self,
                                                               IdeFile              *file);
 void                ide_buffer_set_highlight_diagnostics     (IdeBuffer            *self,
                                                               gboolean              highlight_diagnostics);
+void                ide_buffer_set_large_file                (IdeBuffer            *self,
+                                                              gboolean              large_file);
 void                ide_buffer_set_style_scheme_name         (IdeBuffer            *self,
                                                               const gchar          *style_scheme_name);
 void                ide_buffer_trim_trailing_whitespace      (IdeBuffer            *self);
@@ -20,8 +20,10 @@
 
 #include <glib/gi18n.h>
 #include <libpeas/peas.h>
+#include <stdio.h>
 
 #include "ide-async-helper.h"
+#include "ide-back-forward-item.h"
 #include "ide-back-forward-list.h"
 #include "ide-back-forward-list-private.h"
 #include "ide-buffer-manager.h"
@@ -31,6 +33,7 @@
 #include "ide-context.h"
 #include "ide-debug.h"
 #include "ide-device-manager.h"
+#include "ide-file.h"
 #include "ide-global.h"
 #include "ide-internal.h"
 #include "ide-project.h"
@@ -45,12 +48,14 @@
 #include "ide-source-snippets-manager.h"
 #include "ide-unsaved-file.h"
 #include "ide-unsaved-files.h"
+#include "ide-uri.h"
 #include "ide-vcs.h"
 #include "ide-recent-projects.h"
 
 #include "doap/ide-doap.h"
 
-#define RESTORE_FILES_MAX_FILES 20
+#define RESTORE_FILES_MAX_FILES    20
+#define RESTORE_FILES_MAX_PARALLEL 4
 
 struct _IdeContext
 {
@@ -82,6 +87,13 @@ struct _IdeContext
   GMutex                    unload_mutex;
   gint                      hold_count;
   GTask                    *delayed_unload_task;
+
+  /*
+   * Per-step timings from ide_context_init_async(), which may be dumped
+   * by setting IDE_INIT_TIMELINE in the environment.
+   */
+  GArray                   *init_timeline;
+  gint64                    init_begin_time;
 };
 
 static void async_initable_init (GAsyncInitableIface *);
@@ -535,6 +547,7 @@ ide_context_finalize (GObject *object)
   IDE_ENTRY;
 
   g_clear_pointer (&self->services, g_hash_table_unref);
+  g_clear_pointer (&self->init_timeline, g_array_unref);
   g_clear_pointer (&self->root_build_dir, g_free);
   g_clear_pointer (&self->recent_projects_path, g_free);
 
@@ -1478,6 +1491,137 @@ ide_context_init_loaded (gpointer             source_object,
   g_task_return_boolean (task, TRUE);
 }
 
+/*
+ * The steps to initialize the context. Each step may only start once the
+ * steps it requires have completed; everything else is run concurrently.
+ */
+enum {
+  INIT_BUILD_SYSTEM,
+  INIT_VCS,
+  INIT_SERVICES,
+  INIT_PROJECT_NAME,
+  INIT_BACK_FORWARD_LIST,
+  INIT_SNIPPETS,
+  INIT_SCRIPTS,
+  INIT_UNSAVED_FILES,
+  INIT_ADD_RECENT,
+  INIT_SEARCH_ENGINE,
+  INIT_CONFIGURATION_MANAGER,
+  INIT_LOADED,
+  INIT_LAST
+};
+
+#define REQUIRES(n) IDE_ASYNC_STEP_REQUIRES(INIT_##n)
+
+static const IdeAsyncGraphStep init_steps [INIT_LAST] = {
+  /* The build system may override the project file, which the rest use */
+  [INIT_BUILD_SYSTEM] = { "build-system", ide_context_init_build_system, 0 },
+  [INIT_VCS] = { "vcs", ide_context_init_vcs, REQUIRES (BUILD_SYSTEM) },
+  [INIT_SERVICES] = { "services", ide_context_init_services,
+                      REQUIRES (BUILD_SYSTEM) | REQUIRES (VCS) },
+  [INIT_PROJECT_NAME] = { "project-name", ide_context_init_project_name, REQUIRES (BUILD_SYSTEM) },
+  /* The back-forward list and drafts are stored by project name */
+  [INIT_BACK_FORWARD_LIST] = { "back-forward-list", ide_context_init_back_forward_list,
+                               REQUIRES (PROJECT_NAME) },
+  [INIT_SNIPPETS] = { "snippets", ide_context_init_snippets, 0 },
+  [INIT_SCRIPTS] = { "scripts", ide_context_init_scripts, 0 },
+  [INIT_UNSAVED_FILES] = { "unsaved-files", ide_context_init_unsaved_files, REQUIRES (PROJECT_NAME) },
+  [INIT_ADD_RECENT] = { "add-recent", ide_context_init_add_recent, REQUIRES (PROJECT_NAME) },
+  [INIT_SEARCH_ENGINE] = { "search-engine", ide_context_init_search_engine, REQUIRES (SERVICES) },
+  [INIT_CONFIGURATION_MANAGER] = { "configuration-manager", ide_context_init_configuration_manager,
+                                   REQUIRES (BUILD_SYSTEM) | REQUIRES (VCS) },
+  [INIT_LOADED] = { "loaded", ide_context_init_loaded,
+                    IDE_ASYNC_STEP_REQUIRES (INIT_LOADED) - 1 },
+};
+
+#undef REQUIRES
+
+/*
+ * Writes the time spent in each step of initializing the context to @stream.
+ * Times are in milliseconds, relative to the start of initialization.
+ */
+static void
+ide_context_dump_init_timeline (IdeContext *self,
+                                FILE       *stream)
+{
+  gint64 end_time = self->init_begin_time;
+  guint i;
+
+  g_return_if_fail (IDE_IS_CONTEXT (self));
+  g_return_if_fail (stream != NULL);
+
+  if (self->init_timeline == NULL)
+    return;
+
+  fprintf (stream, "%-24s %10s %10s %10s\n", "STEP", "BEGIN", "END", "DURATION");
+
+  for (i = 0; i < self->init_timeline->len; i++)
+    {
+      const IdeAsyncStepTiming *timing = &g_array_index (self->init_timeline, IdeAsyncStepTiming, i);
+
+      if (timing->begin_time == 0)
+        {
+          fprintf (stream, "%-24s %10s %10s %10s\n", timing->name, "-", "-", "-");
+          continue;
+        }
+
+      fprintf (stream, "%-24s %10.3lf %10.3lf %10.3lf\n",
+               timing->name,
+               (timing->begin_time - self->init_begin_time) / 1000.0,
+               (timing->end_time - self->init_begin_time) / 1000.0,
+               (timing->end_time - timing->begin_time) / 1000.0);
+
+      end_time = MAX (end_time, timing->end_time);
+    }
+
+  fprintf (stream, "%-24s %10s %10.3lf %10.3lf\n",
+           "total", "",
+           (end_time - self->init_begin_time) / 1000.0,
+           (end_time - self->init_begin_time) / 1000.0);
+}
+
+static void
+ide_context_init_cb (GObject      *object,
+                     GAsyncResult *result,
+                     gpointer      user_data)
+{
+  IdeContext *self = (IdeContext *)object;
+  g_autoptr(GTask) task = user_data;
+  const gchar *timeline_path;
+  GError *error = NULL;
+
+  g_assert (IDE_IS_CONTEXT (self));
+  g_assert (G_IS_TASK (result));
+  g_assert (G_IS_TASK (task));
+
+  /*
+   * Allow tracking project load time (such as from CI) by setting
+   * IDE_INIT_TIMELINE to a file name, or "-" for stderr.
+   */
+  if ((timeline_path = g_getenv ("IDE_INIT_TIMELINE")) != NULL)
+    {
+      if (g_strcmp0 (timeline_path, "-") == 0)
+        ide_context_dump_init_timeline (self, stderr);
+      else
+        {
+          FILE *stream;
+
+          if ((stream = fopen (timeline_path, "a")) != NULL)
+            {
+              ide_context_dump_init_timeline (self, stream);
+              fclose (stream);
+            }
+          else
+            g_warning ("Failed to open \"%s\" for writing", timeline_path);
+        }
+    }
+
+  if (!g_task_propagate_boolean (G_TASK (result), &error))
+    g_task_return_error (task, error);
+  else
+    g_task_return_boolean (task, TRUE);
+}
+
 static void
 ide_context_init_async (GAsyncInitable      *initable,
                         int                  io_priority,
@@ -1486,27 +1630,24 @@ ide_context_init_async (GAsyncInitable      *initable,
                         gpointer             user_data)
 {
   IdeContext *context = (IdeContext *)initable;
+  GTask *task;
 
   g_return_if_fail (G_IS_ASYNC_INITABLE (context));
   g_return_if_fail (!cancellable || G_IS_CANCELLABLE (cancellable));
 
-  ide_async_helper_run (context,
-                        cancellable,
-                        callback,
-                        user_data,
-                        ide_context_init_build_system,
-                        ide_context_init_vcs,
-                        ide_context_init_services,
-                        ide_context_init_project_name,
-                        ide_context_init_back_forward_list,
-                        ide_context_init_snippets,
-                        ide_context_init_scripts,
-                        ide_context_init_unsaved_files,
-                        ide_context_init_add_recent,
-                        ide_context_init_search_engine,
-                        ide_context_init_configuration_manager,
-                        ide_context_init_loaded,
-                        NULL);
+  task = g_task_new (context, cancellable, callback, user_data);
+
+  g_clear_pointer (&context->init_timeline, g_array_unref);
+  context->init_timeline = g_array_new (FALSE, TRUE, sizeof (IdeAsyncStepTiming));
+  context->init_begin_time = g_get_monotonic_time ();
+
+  ide_async_helper_run_graph (context,
+                              init_steps,
+                              G_N_ELEMENTS (init_steps),
+                              context->init_timeline,
+                              cancellable,
+                              ide_context_init_cb,
+                              task);
 }
 
 static gboolean
@@ -1866,7 +2007,30 @@ ide_context_unload_finish (IdeContext    *self,
   IDE_RETURN (ret);
 }
 
-static gboolean restore_in_idle (gpointer user_data);
+/*
+ * Restoring drafts loads up to RESTORE_FILES_MAX_PARALLEL buffers at a time,
+ * starting with the files most recently visited in the back-forward list
+ * since those are the ones the user was most likely looking at.
+ */
+typedef struct
+{
+  GPtrArray *files;
+  IdeBuffer *first_buffer;
+  guint      next;
+  guint      active;
+} RestoreState;
+
+static void ide_context_restore_next (GTask *task);
+
+static void
+restore_state_free (gpointer data)
+{
+  RestoreState *state = data;
+
+  g_clear_pointer (&state->files, g_ptr_array_unref);
+  g_clear_object (&state->first_buffer);
+  g_slice_free (RestoreState, state);
+}
 
 static void
 ide_context_restore__load_file_cb (GObject      *object,
@@ -1874,60 +2038,195 @@ ide_context_restore__load_file_cb (GObject      *object,
                                    gpointer      user_data)
 {
   IdeBufferManager *buffer_manager = (IdeBufferManager *)object;
+  g_autoptr(IdeBuffer) buffer = NULL;
   g_autoptr(GTask) task = user_data;
   g_autoptr(GError) error = NULL;
+  RestoreState *state;
 
   g_assert (IDE_IS_BUFFER_MANAGER (buffer_manager));
   g_assert (G_IS_TASK (task));
 
-  if (!ide_buffer_manager_load_file_finish (buffer_manager, result, &error))
+  state = g_task_get_task_data (task);
+  state->active--;
+
+  if (!(buffer = ide_buffer_manager_load_file_finish (buffer_manager, result, &error)))
     {
       g_warning ("%s", error->message);
       /* TODO: add error into grouped error */
     }
+  else if (state->first_buffer == NULL &&
+           ide_file_equal (ide_buffer_get_file (buffer), g_ptr_array_index (state->files, 0)))
+    {
+      state->first_buffer = g_object_ref (buffer);
+    }
 
-  g_idle_add (restore_in_idle, g_object_ref (task));
+  ide_context_restore_next (task);
 }
 
-static gboolean
-restore_in_idle (gpointer user_data)
+static void
+ide_context_restore_next (GTask *task)
 {
-  g_autoptr(IdeFile) ifile = NULL;
-  g_autoptr(GTask) task = user_data;
-  IdeUnsavedFile *uf;
+  RestoreState *state;
   IdeContext *self;
-  GPtrArray *ar;
-  GFile *file;
 
   g_assert (G_IS_TASK (task));
 
   self = g_task_get_source_object (task);
-  ar = g_task_get_task_data (task);
+  state = g_task_get_task_data (task);
 
-  if (ar == NULL || ar->len == 0)
+  while (state->active < RESTORE_FILES_MAX_PARALLEL && state->next < state->files->len)
+    {
+      IdeFile *file = g_ptr_array_index (state->files, state->next++);
+
+      state->active++;
+
+      ide_buffer_manager_load_file_async (self->buffer_manager,
+                                          file,
+                                          FALSE,
+                                          NULL,
+                                          g_task_get_cancellable (task),
+                                          ide_context_restore__load_file_cb,
+                                          g_object_ref (task));
+    }
+
+  if (state->active == 0 && state->next == state->files->len)
     {
       self->restoring = FALSE;
+
+      /* Bring the most recently visited file to the front */
+      if (state->first_buffer != NULL)
+        ide_buffer_manager_set_focus_buffer (self->buffer_manager, state->first_buffer);
+
       g_task_return_boolean (task, TRUE);
-      return G_SOURCE_REMOVE;
     }
+}
+
+static void
+collect_back_forward_item (gpointer data,
+                           gpointer user_data)
+{
+  GPtrArray *items = user_data;
+
+  g_ptr_array_add (items, data);
+}
+
+/*
+ * Returns the back-forward items ordered by how recently they were visited:
+ * the current item, then the backward history (newest first) and lastly the
+ * forward history (nearest first).
+ */
+static GPtrArray *
+get_back_forward_items_by_recency (IdeBackForwardList *list)
+{
+  g_autoptr(GPtrArray) items = NULL;
+  IdeBackForwardItem *current;
+  GPtrArray *ret;
+  guint pos = 0;
+  guint i;
+
+  g_assert (IDE_IS_BACK_FORWARD_LIST (list));
+
+  /* Visits forward (furthest first), then current, then backward (newest first) */
+  items = g_ptr_array_new ();
+  _ide_back_forward_list_foreach (list, collect_back_forward_item, items);
+
+  ret = g_ptr_array_sized_new (items->len);
 
-  g_assert (ar != NULL);
-  g_assert (ar->len > 0);
+  if ((current = ide_back_forward_list_get_current_item (list)))
+    {
+      for (pos = 0; pos < items->len; pos++)
+        if (g_ptr_array_index (items, pos) == (gpointer)current)
+          break;
+      g_assert (pos < items->len);
+
+      g_ptr_array_add (ret, current);
 
-  uf = g_ptr_array_index (ar, ar->len - 1);
-  file = ide_unsaved_file_get_file (uf);
-  ifile = ide_project_get_project_file (self->project, file);
-  g_ptr_array_remove_index (ar, ar->len - 1);
+      for (i = pos + 1; i < items->len; i++)
+        g_ptr_array_add (ret, g_ptr_array_index (items, i));
+    }
 
-  ide_buffer_manager_load_file_async (self->buffer_manager,
-                                      ifile,
-                                      FALSE,
-                                      NULL,
-                                      g_task_get_cancellable (task),
-                                      ide_context_restore__load_file_cb,
-                                      g_object_ref (task));
+  for (i = pos; i > 0; i--)
+    g_ptr_array_add (ret, g_ptr_array_index (items, i - 1));
 
-  return G_SOURCE_REMOVE;
+  return ret;
+}
+
+static gint
+compare_by_rank (gconstpointer a,
+                 gconstpointer b,
+                 gpointer      user_data)
+{
+  GHashTable *ranks = user_data;
+  guint rank_a = GPOINTER_TO_UINT (g_hash_table_lookup (ranks, *(IdeFile **)a));
+  guint rank_b = GPOINTER_TO_UINT (g_hash_table_lookup (ranks, *(IdeFile **)b));
+
+  return (rank_a < rank_b) ? -1 : (rank_a > rank_b);
+}
+
+static GPtrArray *
+ide_context_get_restore_files (IdeContext *self,
+                               GPtrArray  *unsaved_files)
+{
+  g_autoptr(GHashTable) ranks = NULL;
+  g_autoptr(GPtrArray) items = NULL;
+  g_autofree guint *visited = NULL;
+  GPtrArray *files;
+  guint i;
+  guint j;
+
+  g_assert (IDE_IS_CONTEXT (self));
+  g_assert (unsaved_files != NULL);
+
+  files = g_ptr_array_new_with_free_func (g_object_unref);
+
+  /* The unsaved files are ordered oldest first */
+  for (i = unsaved_files->len; i > 0; i--)
+    {
+      IdeUnsavedFile *uf = g_ptr_array_index (unsaved_files, i - 1);
+      GFile *file = ide_unsaved_file_get_file (uf);
+
+      g_ptr_array_add (files, ide_project_get_project_file (self->project, file));
+    }
+
+  visited = g_new (guint, files->len);
+  for (i = 0; i < files->len; i++)
+    visited [i] = G_MAXUINT;
+
+  items = get_back_forward_items_by_recency (self->back_forward_list);
+
+  for (i = 0; i < items->len; i++)
+    {
+      IdeBackForwardItem *item = g_ptr_array_index (items, i);
+      IdeUri *uri;
+
+      if (!(uri = ide_back_forward_item_get_uri (item)))
+        continue;
+
+      for (j = 0; j < files->len; j++)
+        {
+          IdeFile *file = g_ptr_array_index (files, j);
+
+          if (visited [j] == G_MAXUINT && ide_uri_is_file (uri, ide_file_get_file (file)))
+            visited [j] = i;
+        }
+    }
+
+  /*
+   * Files that were never visited go after those that were, keeping their
+   * relative order. Folding the index into the rank keeps every rank unique
+   * since g_ptr_array_sort_with_data() is not a stable sort.
+   */
+  ranks = g_hash_table_new (NULL, NULL);
+  for (i = 0; i < files->len; i++)
+    {
+      guint rank = (visited [i] == G_MAXUINT) ? (items->len + i) : visited [i];
+
+      g_hash_table_insert (ranks, g_ptr_array_index (files, i), GUINT_TO_POINTER (rank));
+    }
+
+  g_ptr_array_sort_with_data (files, compare_by_rank, ranks);
+
+  return files;
 }
 
 void
@@ -1938,6 +2237,7 @@ ide_context_restore_async (IdeContext          *self,
 {
   g_autoptr(GTask) task = NULL;
   g_autoptr(GPtrArray) ar = NULL;
+  RestoreState *state;
 
   g_return_if_fail (IDE_IS_CONTEXT (self));
   g_return_if_fail (!cancellable || G_IS_CANCELLABLE (cancellable));
@@ -1978,9 +2278,12 @@ ide_context_restore_async (IdeContext          *self,
 
   self->restoring = TRUE;
 
-  g_task_set_task_data (task, g_ptr_array_ref (ar), (GDestroyNotify)g_ptr_array_unref);
+  state = g_slice_new0 (RestoreState);
+  state->files = ide_context_get_restore_files (self, ar);
+
+  g_task_set_task_data (task, state, restore_state_free);
 
-  g_idle_add (restore_in_idle, g_object_ref (task));
+  ide_context_restore_next (task);
 }
 
 gboolean
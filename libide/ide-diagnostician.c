@@ -20,6 +20,8 @@
 
 #include <glib/gi18n.h>
 
+#include "egg-counter.h"
+
 #include "ide-diagnostic-provider.h"
 #include "ide-diagnostician.h"
 #include "ide-diagnostics.h"
@@ -27,12 +29,20 @@
 #include "ide-file.h"
 #include "ide-internal.h"
 
+EGG_DEFINE_HISTOGRAM (diagnose_latency,
+                      "Diagnostician",
+                      "Diagnose Latency",
+                      "Time to diagnose a file with all providers in usec")
+
 struct _IdeDiagnostician
 {
   IdeObject               parent_instance;
 
   GtkSourceLanguage      *language;
   IdeExtensionSetAdapter *extensions;
+
+  /* Incremented for every diagnose request so stale results are not published */
+  guint                   sequence;
 };
 
 typedef struct
@@ -49,10 +59,18 @@ typedef struct
    * Owned by diagnose state.
    */
   IdeDiagnostics *diagnostics;
+  gint64          begin_time;
+  guint           sequence;
   guint           total;
   guint           active;
 } DiagnoseState;
 
+typedef struct
+{
+  EggCounter calls;
+  EggCounter latency;
+} ProviderCounters;
+
 G_DEFINE_TYPE (IdeDiagnostician, ide_diagnostician, IDE_TYPE_OBJECT)
 
 enum {
@@ -61,7 +79,49 @@ enum {
   LAST_PROP
 };
 
+enum {
+  PROVIDER_DIAGNOSTICS,
+  LAST_SIGNAL
+};
+
 static GParamSpec *properties [LAST_PROP];
+static guint signals [LAST_SIGNAL];
+
+/*
+ * Counters are registered lazily, one pair per provider implementation, so
+ * that slow providers can be spotted with ide-list-counters. Registered
+ * counters can never be removed, so they are kept for the process lifetime.
+ */
+static ProviderCounters *
+get_provider_counters (GType provider_type)
+{
+  static GHashTable *counters;
+  ProviderCounters *ret;
+
+  if (counters == NULL)
+    counters = g_hash_table_new (NULL, NULL);
+
+  ret = g_hash_table_lookup (counters, GSIZE_TO_POINTER (provider_type));
+
+  if (ret == NULL)
+    {
+      ret = g_new0 (ProviderCounters, 1);
+
+      ret->calls.category = "DiagnosticCalls";
+      ret->calls.name = g_type_name (provider_type);
+      ret->calls.description = "Number of diagnose requests completed by the provider";
+      egg_counter_arena_register (egg_counter_arena_get_default (), &ret->calls);
+
+      ret->latency.category = "DiagnosticLatency";
+      ret->latency.name = g_type_name (provider_type);
+      ret->latency.description = "Total time spent in the provider, in microseconds";
+      egg_counter_arena_register (egg_counter_arena_get_default (), &ret->latency);
+
+      g_hash_table_insert (counters, GSIZE_TO_POINTER (provider_type), ret);
+    }
+
+  return ret;
+}
 
 static void
 diagnose_state_free (gpointer data)
@@ -81,20 +141,35 @@ diagnose_cb (GObject      *object,
              gpointer      user_data)
 {
   IdeDiagnosticProvider *provider = (IdeDiagnosticProvider *)object;
+  IdeDiagnostician *self;
   IdeDiagnostics *ret;
   g_autoptr(GTask) task = user_data;
   g_autoptr(GError) error = NULL;
+  ProviderCounters *counters;
   DiagnoseState *state;
 
   g_return_if_fail (IDE_IS_DIAGNOSTIC_PROVIDER (provider));
   g_return_if_fail (G_IS_TASK (task));
 
+  self = g_task_get_source_object (task);
   state = g_task_get_task_data (task);
 
   state->active--;
 
   ret = ide_diagnostic_provider_diagnose_finish (provider, result, &error);
 
+  counters = get_provider_counters (G_OBJECT_TYPE (provider));
+  egg_counter_add (&counters->calls, 1);
+  egg_counter_add (&counters->latency, g_get_monotonic_time () - state->begin_time);
+
+  /*
+   * Publish this provider's results right away, rather than waiting on the
+   * slowest provider, unless a newer request has been made in the mean time
+   * or the request was cancelled.
+   */
+  if (state->sequence == self->sequence && !g_cancellable_is_cancelled (state->cancellable))
+    g_signal_emit (self, signals [PROVIDER_DIAGNOSTICS], 0, provider, ret);
+
   if (!ret)
     goto maybe_complete;
 
@@ -105,9 +180,12 @@ maybe_complete:
   if (state->total == 1 && error)
     g_task_return_error (task, g_error_copy (error));
   else if (!state->active)
-    g_task_return_pointer (task,
-                           ide_diagnostics_ref (state->diagnostics),
-                           (GDestroyNotify)ide_diagnostics_unref);
+    {
+      EGG_HISTOGRAM_RECORD (diagnose_latency, g_get_monotonic_time () - state->begin_time);
+      g_task_return_pointer (task,
+                             ide_diagnostics_ref (state->diagnostics),
+                             (GDestroyNotify)ide_diagnostics_unref);
+    }
 }
 
 static void
@@ -149,6 +227,8 @@ ide_diagnostician_diagnose_async (IdeDiagnostician    *self,
 
   task = g_task_new (self, cancellable, callback, user_data);
 
+  self->sequence++;
+
   count = ide_extension_set_adapter_get_n_extensions (self->extensions);
 
   if (count == 0)
@@ -165,6 +245,8 @@ ide_diagnostician_diagnose_async (IdeDiagnostician    *self,
   state->task = task;
   state->active = count;
   state->total = count;
+  state->sequence = self->sequence;
+  state->begin_time = g_get_monotonic_time ();
   state->diagnostics = ide_diagnostics_new (NULL);
 
   g_task_set_task_data (task, state, diagnose_state_free);
@@ -273,6 +355,32 @@ ide_diagnostician_class_init (IdeDiagnosticianClass *klass)
                          (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
   g_object_class_install_properties (object_class, LAST_PROP, properties);
+
+  /**
+   * IdeDiagnostician::provider-diagnostics:
+   * @self: An #IdeDiagnostician
+   * @provider: The #IdeDiagnosticProvider that completed
+   * @diagnostics: (nullable): The diagnostics from @provider, or %NULL
+   *
+   * This signal is emitted as each provider completes a request made with
+   * ide_diagnostician_diagnose_async(), before the request itself completes.
+   * The @diagnostics replace any previously emitted for @provider, which
+   * allows consumers to display results from fast providers without waiting
+   * for slower ones.
+   *
+   * Results from a request that has been superseded by a newer one are not
+   * emitted.
+   */
+  signals [PROVIDER_DIAGNOSTICS] =
+    g_signal_new ("provider-diagnostics",
+                  G_TYPE_FROM_CLASS (klass),
+                  G_SIGNAL_RUN_LAST,
+                  0,
+                  NULL, NULL, NULL,
+                  G_TYPE_NONE,
+                  2,
+                  IDE_TYPE_DIAGNOSTIC_PROVIDER,
+                  IDE_TYPE_DIAGNOSTICS);
 }
 
 static void
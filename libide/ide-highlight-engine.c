@@ -21,6 +21,7 @@
 #include <glib/gi18n.h>
 #include <string.h>
 
+#include "egg-counter.h"
 #include "egg-signal-group.h"
 
 #include "ide-debug.h"
@@ -32,6 +33,11 @@
 #define HIGHLIGHT_QUANTA_USEC      5000
 #define PRIVATE_TAG_PREFIX        "gb-private-tag"
 
+EGG_DEFINE_HISTOGRAM (tick_latency,
+                      "Highlighting",
+                      "Tick Latency",
+                      "Time spent highlighting per main loop tick in usec")
+
 struct _IdeHighlightEngine
 {
   IdeObject       parent_instance;
@@ -302,6 +308,7 @@ ide_highlight_engine_tick (IdeHighlightEngine *self)
   GtkTextIter invalid_begin;
   GtkTextIter invalid_end;
   GSList *tags_iter;
+  EGG_HISTOGRAM_SCOPE (tick_latency);
 
   IDE_PROBE;
 
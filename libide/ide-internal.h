@@ -37,6 +37,9 @@ void                _ide_battery_monitor_init               (void);
 void                _ide_battery_monitor_shutdown           (void);
 void                _ide_buffer_set_changed_on_volume       (IdeBuffer             *self,
                                                              gboolean               changed_on_volume);
+IdeProgress        *_ide_buffer_get_load_progress           (IdeBuffer             *self);
+void                _ide_buffer_set_load_progress           (IdeBuffer             *self,
+                                                             IdeProgress           *progress);
 gboolean            _ide_buffer_get_loading                 (IdeBuffer             *self);
 void                _ide_buffer_set_loading                 (IdeBuffer             *self,
                                                              gboolean               loading);
@@ -63,6 +66,9 @@ void                _ide_runtime_manager_unload             (IdeRuntimeManager
 void                _ide_search_context_add_provider        (IdeSearchContext      *context,
                                                              IdeSearchProvider     *provider,
                                                              gsize                  max_results);
+void                _ide_search_context_publish_results     (IdeSearchContext      *self,
+                                                             IdeSearchProvider     *provider,
+                                                             GPtrArray             *results);
 void                _ide_service_emit_context_loaded        (IdeService            *service);
 IdeSettings        *_ide_settings_new                       (IdeContext            *context,
                                                              const gchar           *schema_id,
@@ -79,6 +85,7 @@ void                _ide_source_view_set_count              (IdeSourceView
                                                              gint                   count);
 void                _ide_source_view_set_modifier           (IdeSourceView         *self,
                                                              gunichar               modifier);
+void                _ide_stall_monitor_init                 (void);
 void                _ide_thread_pool_init                   (gboolean               is_worker);
 IdeUnsavedFile     *_ide_unsaved_file_new                   (GFile                 *file,
                                                              GBytes                *content,
@@ -26,22 +26,68 @@
 #endif
 
 #include <glib.h>
+#include <stdlib.h>
 #include <string.h>
 #include <time.h>
 #include <unistd.h>
 
+#include "egg-counter.h"
+
 #include "ide-debug.h"
 #include "ide-log.h"
+#include "ide-trace.h"
+
+/*
+ * Log messages are not written by the thread that logged them. Instead, the
+ * message is copied into a fixed size record in a bounded queue which any
+ * thread may push to without taking a lock. A writer thread drains the
+ * queue, formats the records and writes them to the channels in batches.
+ *
+ * If the queue is full, the message is dropped and counted rather than
+ * blocking the caller. Fatal messages are written synchronously after the
+ * queue has been drained since the process is about to exit.
+ */
+
+#define LOG_QUEUE_SIZE    512
+#define LOG_QUEUE_MASK    (LOG_QUEUE_SIZE - 1)
+#define LOG_DOMAIN_SIZE   64
+#define LOG_MESSAGE_SIZE  1024
+#define LOG_BATCH_SIZE    (64 * 1024)
 
 typedef const gchar *(*IdeLogLevelStrFunc) (GLogLevelFlags log_level);
 
+typedef struct
+{
+  volatile gsize  sequence;
+  gint64          time;
+  GLogLevelFlags  log_level;
+  gint            thread;
+  /* Only used for messages that do not fit in @message */
+  gchar          *overflow;
+  gchar           domain [LOG_DOMAIN_SIZE];
+  gchar           message [LOG_MESSAGE_SIZE];
+} IdeLogRecord;
+
+G_STATIC_ASSERT ((LOG_QUEUE_SIZE & LOG_QUEUE_MASK) == 0);
+
 static GPtrArray          *channels;
 static GLogFunc            last_handler;
 static int                 log_verbosity;
 static IdeLogLevelStrFunc  log_level_str_func;
 
+static IdeLogRecord       *queue;
+static volatile gsize      enqueue_pos;
+static volatile gsize      dequeue_pos;
+static volatile gint       n_dropped;
+static volatile gint       writer_sleeping;
+static GThread            *writer_thread;
+static GMutex              writer_mutex;
+static GCond               writer_cond;
+
 G_LOCK_DEFINE (channels_lock);
 
+EGG_DEFINE_COUNTER (dropped, "Log", "Dropped Messages", "Log messages dropped because the queue was full")
+
 /**
  * ide_log_get_thread:
  *
@@ -105,19 +151,238 @@ ide_log_level_str_with_color (GLogLevelFlags log_level)
     }
 }
 
-/**
- * ide_log_write_to_channel:
- * @channel: A #GIOChannel.
- * @message: A string log message.
- *
- * Writes @message to @channel and flushes the channel.
+static void
+ide_log_format_record (GString            *str,
+                       const IdeLogRecord *record)
+{
+  static time_t last_second = -1;
+  static gchar ftime[32];
+  time_t t;
+
+  /* Only called with channels_lock held, so the cache is safe */
+  t = (time_t)(record->time / G_USEC_PER_SEC);
+
+  if (t != last_second)
+    {
+      struct tm tt;
+
+      localtime_r (&t, &tt);
+      strftime (ftime, sizeof (ftime), "%H:%M:%S", &tt);
+      last_second = t;
+    }
+
+  g_string_append_printf (str,
+                          "%s.%04ld  %30s[%d]: %s: %s\n",
+                          ftime,
+                          (glong)((record->time % G_USEC_PER_SEC) / 1000),
+                          record->domain,
+                          record->thread,
+                          log_level_str_func (record->log_level),
+                          record->overflow ? record->overflow : record->message);
+}
+
+static void
+ide_log_record_fill (IdeLogRecord   *record,
+                     const gchar    *log_domain,
+                     GLogLevelFlags  log_level,
+                     const gchar    *message)
+{
+  gsize len;
+
+  record->time = g_get_real_time ();
+  record->log_level = log_level;
+  record->thread = ide_log_get_thread ();
+  g_strlcpy (record->domain, log_domain ? log_domain : "(null)", sizeof record->domain);
+
+  len = strlen (message);
+
+  if (len < sizeof record->message)
+    {
+      memcpy (record->message, message, len + 1);
+      record->overflow = NULL;
+    }
+  else
+    record->overflow = g_strdup (message);
+}
+
+/*
+ * Pushes a message onto the queue. This may be called from any thread
+ * concurrently, and returns %FALSE if the queue was full.
+ */
+static gboolean
+ide_log_enqueue (const gchar    *log_domain,
+                 GLogLevelFlags  log_level,
+                 const gchar    *message)
+{
+  IdeLogRecord *record;
+  gsize pos;
+
+  for (;;)
+    {
+      gssize diff;
+
+      pos = enqueue_pos;
+      record = &queue [pos & LOG_QUEUE_MASK];
+      __sync_synchronize ();
+      diff = (gssize)record->sequence - (gssize)pos;
+
+      if (diff == 0)
+        {
+          if (__sync_bool_compare_and_swap (&enqueue_pos, pos, pos + 1))
+            break;
+        }
+      else if (diff < 0)
+        {
+          return FALSE;
+        }
+    }
+
+  ide_log_record_fill (record, log_domain, log_level, message);
+
+  /* Publish the record to the writer */
+  __sync_synchronize ();
+  record->sequence = pos + 1;
+
+  if (g_atomic_int_get (&writer_sleeping))
+    {
+      g_mutex_lock (&writer_mutex);
+      g_cond_signal (&writer_cond);
+      g_mutex_unlock (&writer_mutex);
+    }
+
+  return TRUE;
+}
+
+/*
+ * Pops a record off the queue. This must only be called by one thread at a
+ * time, which is either the writer thread or a caller holding channels_lock.
+ */
+static gboolean
+ide_log_dequeue (GString *str)
+{
+  IdeLogRecord *record;
+  gsize pos = dequeue_pos;
+
+  record = &queue [pos & LOG_QUEUE_MASK];
+  __sync_synchronize ();
+
+  if (record->sequence != pos + 1)
+    return FALSE;
+
+  ide_log_format_record (str, record);
+  g_clear_pointer (&record->overflow, g_free);
+
+  /* Hand the record back to the producers */
+  __sync_synchronize ();
+  record->sequence = pos + LOG_QUEUE_SIZE;
+  dequeue_pos = pos + 1;
+
+  return TRUE;
+}
+
+static void
+ide_log_write_batch (GString *str)
+{
+  guint i;
+
+  if (str->len == 0)
+    return;
+
+  for (i = 0; i < channels->len; i++)
+    {
+      GIOChannel *channel = g_ptr_array_index (channels, i);
+
+      g_io_channel_write_chars (channel, str->str, str->len, NULL, NULL);
+      g_io_channel_flush (channel, NULL);
+    }
+
+  g_string_truncate (str, 0);
+}
+
+/*
+ * Drains the queue into the channels. Returns %TRUE if anything was
+ * written. Must be called with channels_lock held.
+ */
+static gboolean
+ide_log_drain (GString *str)
+{
+  gboolean ret = FALSE;
+  gint dropped_count;
+
+  while (ide_log_dequeue (str))
+    {
+      ret = TRUE;
+
+      if (str->len >= LOG_BATCH_SIZE)
+        ide_log_write_batch (str);
+    }
+
+  if (0 != (dropped_count = g_atomic_int_get (&n_dropped)))
+    {
+      IdeLogRecord record = { 0 };
+      g_autofree gchar *message = NULL;
+
+      message = g_strdup_printf ("%d log messages were dropped", dropped_count);
+      ide_log_record_fill (&record, "ide-log", G_LOG_LEVEL_WARNING, message);
+      ide_log_format_record (str, &record);
+      g_free (record.overflow);
+      g_atomic_int_add (&n_dropped, -dropped_count);
+      ret = TRUE;
+    }
+
+  ide_log_write_batch (str);
+
+  return ret;
+}
+
+static gpointer
+ide_log_writer_worker (gpointer data)
+{
+  g_autoptr(GString) str = g_string_sized_new (LOG_BATCH_SIZE);
+
+  for (;;)
+    {
+      gboolean drained;
+
+      G_LOCK (channels_lock);
+      drained = ide_log_drain (str);
+      G_UNLOCK (channels_lock);
+
+      if (drained)
+        continue;
+
+      /*
+       * Producers only signal us if we are sleeping, so check the queue again
+       * after announcing that. The timeout protects against a missed wakeup.
+       */
+      g_mutex_lock (&writer_mutex);
+      g_atomic_int_set (&writer_sleeping, TRUE);
+      if (queue [dequeue_pos & LOG_QUEUE_MASK].sequence != dequeue_pos + 1)
+        g_cond_wait_until (&writer_cond, &writer_mutex,
+                           g_get_monotonic_time () + G_USEC_PER_SEC / 10);
+      g_atomic_int_set (&writer_sleeping, FALSE);
+      g_mutex_unlock (&writer_mutex);
+    }
+
+  return NULL;
+}
+
+/*
+ * Writes everything that is queued before returning.
  */
 static void
-ide_log_write_to_channel (GIOChannel  *channel,
-                          const gchar *message)
+ide_log_flush (void)
 {
-  g_io_channel_write_chars (channel, message, -1, NULL, NULL);
-  g_io_channel_flush (channel, NULL);
+  g_autoptr(GString) str = NULL;
+
+  if (writer_thread == NULL)
+    return;
+
+  str = g_string_new (NULL);
+
+  G_LOCK (channels_lock);
+  ide_log_drain (str);
+  G_UNLOCK (channels_lock);
 }
 
 /**
@@ -138,13 +403,6 @@ ide_log_handler (const gchar    *log_domain,
                  const gchar    *message,
                  gpointer        user_data)
 {
-  GTimeVal tv;
-  struct tm tt;
-  time_t t;
-  const gchar *level;
-  gchar ftime[32];
-  gchar *buffer;
-
   if (G_LIKELY (channels->len))
     {
       switch ((int)log_level)
@@ -173,22 +431,33 @@ ide_log_handler (const gchar    *log_domain,
           break;
         }
 
-      level = log_level_str_func (log_level);
-      g_get_current_time (&tv);
-      t = (time_t) tv.tv_sec;
-      tt = *localtime (&t);
-      strftime (ftime, sizeof (ftime), "%H:%M:%S", &tt);
-      buffer = g_strdup_printf ("%s.%04ld  %30s[%d]: %s: %s\n",
-                                ftime,
-                                tv.tv_usec / 1000,
-                                log_domain,
-                                ide_log_get_thread (),
-                                level,
-                                message);
-      G_LOCK (channels_lock);
-      g_ptr_array_foreach (channels, (GFunc) ide_log_write_to_channel, buffer);
-      G_UNLOCK (channels_lock);
-      g_free (buffer);
+      /*
+       * The process is about to abort, so write everything that is pending
+       * along with this message before returning.
+       */
+      if ((log_level & G_LOG_FLAG_FATAL) || (log_level & G_LOG_LEVEL_ERROR))
+        {
+          g_autoptr(GString) str = g_string_new (NULL);
+          IdeLogRecord record = { 0 };
+
+          ide_log_record_fill (&record, log_domain, log_level, message);
+
+          G_LOCK (channels_lock);
+          ide_log_drain (str);
+          ide_log_format_record (str, &record);
+          ide_log_write_batch (str);
+          G_UNLOCK (channels_lock);
+
+          g_free (record.overflow);
+
+          return;
+        }
+
+      if (!ide_log_enqueue (log_domain, log_level, message))
+        {
+          g_atomic_int_inc (&n_dropped);
+          EGG_COUNTER_INC (dropped);
+        }
     }
 }
 
@@ -223,7 +492,24 @@ ide_log_init (gboolean     stdout_,
             log_level_str_func = ide_log_level_str_with_color;
         }
 
+      if (channels->len > 0)
+        {
+          guint i;
+
+          queue = g_new0 (IdeLogRecord, LOG_QUEUE_SIZE);
+          for (i = 0; i < LOG_QUEUE_SIZE; i++)
+            queue [i].sequence = i;
+
+          writer_thread = g_thread_new ("ide-log-writer", ide_log_writer_worker, NULL);
+          atexit (ide_log_flush);
+        }
+
       g_log_set_default_handler (ide_log_handler, NULL);
+
+#ifdef IDE_ENABLE_TRACE
+      ide_trace_init ();
+#endif
+
       g_once_init_leave (&initialized, TRUE);
     }
 }
@@ -236,6 +522,8 @@ ide_log_init (gboolean     stdout_,
 void
 ide_log_shutdown (void)
 {
+  ide_log_flush ();
+
   if (last_handler)
     {
       g_log_set_default_handler (last_handler, NULL);
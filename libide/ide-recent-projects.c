@@ -31,7 +31,7 @@ struct _IdeRecentProjects
   GCancellable *cancellable;
   GPtrArray    *miners;
   GSequence    *projects;
-  GHashTable   *recent_uris;
+  GHashTable   *known_uris;
   gchar        *file_uri;
 
   gint          active;
@@ -66,7 +66,11 @@ ide_recent_projects_added (IdeRecentProjects *self,
   file = ide_project_info_get_file (project_info);
   uri = g_file_get_uri (file);
 
-  if (!g_hash_table_contains (self->recent_uris, uri))
+  /*
+   * Miners stream their discoveries as they find them, possibly from a
+   * cache first, so the same project may show up more than once.
+   */
+  if (g_hash_table_add (self->known_uris, g_steal_pointer (&uri)))
     {
       GSequenceIter *iter;
       gint position;
@@ -226,8 +230,6 @@ ide_recent_projects_load_recent (IdeRecentProjects *self)
                                    NULL);
 
       ide_recent_projects_added (self, project_info);
-
-      g_hash_table_insert (self->recent_uris, g_strdup (uri), NULL);
     }
   g_strfreev (uris);
 }
@@ -286,7 +288,7 @@ ide_recent_projects_finalize (GObject *object)
 
   g_clear_pointer (&self->miners, g_ptr_array_unref);
   g_clear_pointer (&self->projects, g_sequence_free);
-  g_clear_pointer (&self->recent_uris, g_hash_table_unref);
+  g_clear_pointer (&self->known_uris, g_hash_table_unref);
   g_clear_object (&self->cancellable);
   g_clear_pointer (&self->file_uri, g_free);
 
@@ -318,7 +320,7 @@ ide_recent_projects_init (IdeRecentProjects *self)
   self->projects = g_sequence_new (g_object_unref);
   self->miners = g_ptr_array_new_with_free_func (g_object_unref);
   self->cancellable = g_cancellable_new ();
-  self->recent_uris = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+  self->known_uris = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
   self->file_uri = g_build_filename (g_get_user_data_dir (),
                                      ide_get_program_name (),
                                      IDE_RECENT_PROJECTS_BOOKMARK_FILENAME,
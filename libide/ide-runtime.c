@@ -28,6 +28,15 @@ typedef struct
 {
   gchar *id;
   gchar *display_name;
+
+  /*
+   * Resolving programs can require spawning a process inside the runtime,
+   * so programs that were found are cached until the runtime is invalidated. The cache may
+   * be used from build threads, so it is protected by cache_mutex.
+   */
+  GMutex       cache_mutex;
+  GHashTable  *programs;
+  gchar      **environ;
 } IdeRuntimePrivate;
 
 G_DEFINE_TYPE_WITH_PRIVATE (IdeRuntime, ide_runtime, IDE_TYPE_OBJECT)
@@ -97,15 +106,18 @@ static IdeSubprocessLauncher *
 ide_runtime_real_create_launcher (IdeRuntime  *self,
                                   GError     **error)
 {
+  IdeRuntimePrivate *priv = ide_runtime_get_instance_private (self);
   IdeSubprocessLauncher *ret;
-  g_auto(GStrv) env = NULL;
 
   g_assert (IDE_IS_RUNTIME (self));
 
-  env = g_get_environ ();
-
   ret = ide_subprocess_launcher_new (G_SUBPROCESS_FLAGS_STDOUT_PIPE | G_SUBPROCESS_FLAGS_STDERR_PIPE);
-  ide_subprocess_launcher_set_environ (ret, (const gchar * const *)env);
+
+  g_mutex_lock (&priv->cache_mutex);
+  if (priv->environ == NULL)
+    priv->environ = g_get_environ ();
+  ide_subprocess_launcher_set_environ (ret, (const gchar * const *)priv->environ);
+  g_mutex_unlock (&priv->cache_mutex);
 
   return ret;
 }
@@ -129,16 +141,173 @@ ide_runtime_real_contains_program_in_path (IdeRuntime   *self,
   return ret;
 }
 
+static gboolean
+ide_runtime_lookup_program (IdeRuntime  *self,
+                            const gchar *program,
+                            gboolean    *found)
+{
+  IdeRuntimePrivate *priv = ide_runtime_get_instance_private (self);
+  gpointer value = NULL;
+  gboolean ret = FALSE;
+
+  g_mutex_lock (&priv->cache_mutex);
+  if (priv->programs != NULL &&
+      g_hash_table_lookup_extended (priv->programs, program, NULL, &value))
+    {
+      *found = GPOINTER_TO_INT (value);
+      ret = TRUE;
+    }
+  g_mutex_unlock (&priv->cache_mutex);
+
+  return ret;
+}
+
+/**
+ * ide_runtime_contains_program_in_path:
+ * @self: An #IdeRuntime
+ * @program: the name of a program such as "make"
+ * @cancellable: (nullable): A #GCancellable or %NULL
+ *
+ * Checks if @program can be found within the runtime. Once a program has
+ * been found, that is cached until ide_runtime_invalidate() is called.
+ * Programs that were not found are looked up again on each call.
+ *
+ * This may block, so it should not be called from the main thread. See
+ * ide_runtime_contains_program_in_path_async().
+ *
+ * Returns: %TRUE if @program was found.
+ */
 gboolean
 ide_runtime_contains_program_in_path (IdeRuntime   *self,
                                       const gchar  *program,
                                       GCancellable *cancellable)
 {
+  IdeRuntimePrivate *priv = ide_runtime_get_instance_private (self);
+  gboolean found;
+
   g_return_val_if_fail (IDE_IS_RUNTIME (self), FALSE);
   g_return_val_if_fail (program != NULL, FALSE);
   g_return_val_if_fail (!cancellable || G_IS_CANCELLABLE (cancellable), FALSE);
 
-  return IDE_RUNTIME_GET_CLASS (self)->contains_program_in_path (self, program, cancellable);
+  if (ide_runtime_lookup_program (self, program, &found))
+    return found;
+
+  found = IDE_RUNTIME_GET_CLASS (self)->contains_program_in_path (self, program, cancellable);
+
+  /*
+   * Only programs that were found are remembered, so installing a missing
+   * program is noticed on the next lookup. A cancelled lookup says nothing
+   * about the runtime either way.
+   */
+  if (found && !g_cancellable_is_cancelled (cancellable))
+    {
+      g_mutex_lock (&priv->cache_mutex);
+      if (priv->programs == NULL)
+        priv->programs = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+      g_hash_table_insert (priv->programs, g_strdup (program), GINT_TO_POINTER (found));
+      g_mutex_unlock (&priv->cache_mutex);
+    }
+
+  return found;
+}
+
+static void
+ide_runtime_contains_program_in_path_worker (GTask        *task,
+                                             gpointer      source_object,
+                                             gpointer      task_data,
+                                             GCancellable *cancellable)
+{
+  IdeRuntime *self = source_object;
+  const gchar *program = task_data;
+
+  g_assert (G_IS_TASK (task));
+  g_assert (IDE_IS_RUNTIME (self));
+  g_assert (program != NULL);
+
+  g_task_return_boolean (task, ide_runtime_contains_program_in_path (self, program, cancellable));
+}
+
+/**
+ * ide_runtime_contains_program_in_path_async:
+ * @self: An #IdeRuntime
+ * @program: the name of a program such as "make"
+ * @cancellable: (nullable): A #GCancellable or %NULL
+ * @callback: A callback to execute upon completion
+ * @user_data: user data for @callback
+ *
+ * Asynchronously checks if @program can be found within the runtime. Cached
+ * results complete without using a thread.
+ */
+void
+ide_runtime_contains_program_in_path_async (IdeRuntime          *self,
+                                            const gchar         *program,
+                                            GCancellable        *cancellable,
+                                            GAsyncReadyCallback  callback,
+                                            gpointer             user_data)
+{
+  g_autoptr(GTask) task = NULL;
+  gboolean found;
+
+  g_return_if_fail (IDE_IS_RUNTIME (self));
+  g_return_if_fail (program != NULL);
+  g_return_if_fail (!cancellable || G_IS_CANCELLABLE (cancellable));
+
+  task = g_task_new (self, cancellable, callback, user_data);
+  g_task_set_source_tag (task, ide_runtime_contains_program_in_path_async);
+
+  if (ide_runtime_lookup_program (self, program, &found))
+    {
+      g_task_return_boolean (task, found);
+      return;
+    }
+
+  g_task_set_task_data (task, g_strdup (program), g_free);
+  g_task_run_in_thread (task, ide_runtime_contains_program_in_path_worker);
+}
+
+/**
+ * ide_runtime_contains_program_in_path_finish:
+ * @self: An #IdeRuntime
+ * @result: A #GAsyncResult
+ * @error: A location for a #GError, or %NULL
+ *
+ * Completes an asynchronous request to
+ * ide_runtime_contains_program_in_path_async().
+ *
+ * Returns: %TRUE if the program was found, otherwise %FALSE and @error may
+ *   be set if the operation was cancelled.
+ */
+gboolean
+ide_runtime_contains_program_in_path_finish (IdeRuntime    *self,
+                                             GAsyncResult  *result,
+                                             GError       **error)
+{
+  g_return_val_if_fail (IDE_IS_RUNTIME (self), FALSE);
+  g_return_val_if_fail (G_IS_TASK (result), FALSE);
+
+  return g_task_propagate_boolean (G_TASK (result), error);
+}
+
+/**
+ * ide_runtime_invalidate:
+ * @self: An #IdeRuntime
+ *
+ * Drops the cached program lookups and environment of the runtime. This
+ * should be called by subclasses when the contents of the runtime change,
+ * such as when a prebuild creates the sandbox. It is done automatically when
+ * the runtime id changes and when the runtime prepares a configuration.
+ */
+void
+ide_runtime_invalidate (IdeRuntime *self)
+{
+  IdeRuntimePrivate *priv = ide_runtime_get_instance_private (self);
+
+  g_return_if_fail (IDE_IS_RUNTIME (self));
+
+  g_mutex_lock (&priv->cache_mutex);
+  g_clear_pointer (&priv->programs, g_hash_table_unref);
+  g_clear_pointer (&priv->environ, g_strfreev);
+  g_mutex_unlock (&priv->cache_mutex);
 }
 
 static void
@@ -175,6 +344,10 @@ ide_runtime_finalize (GObject *object)
   IdeRuntimePrivate *priv = ide_runtime_get_instance_private (self);
 
   g_clear_pointer (&priv->display_name, g_free);
+  g_clear_pointer (&priv->id, g_free);
+  g_clear_pointer (&priv->programs, g_hash_table_unref);
+  g_clear_pointer (&priv->environ, g_strfreev);
+  g_mutex_clear (&priv->cache_mutex);
 
   G_OBJECT_CLASS (ide_runtime_parent_class)->finalize (object);
 }
@@ -262,6 +435,9 @@ ide_runtime_class_init (IdeRuntimeClass *klass)
 static void
 ide_runtime_init (IdeRuntime *self)
 {
+  IdeRuntimePrivate *priv = ide_runtime_get_instance_private (self);
+
+  g_mutex_init (&priv->cache_mutex);
 }
 
 const gchar *
@@ -287,6 +463,7 @@ ide_runtime_set_id (IdeRuntime  *self,
     {
       g_free (priv->id);
       priv->id = g_strdup (id);
+      ide_runtime_invalidate (self);
       g_object_notify_by_pspec (G_OBJECT (self), properties [PROP_ID]);
     }
 }
@@ -404,5 +581,7 @@ ide_runtime_prepare_configuration (IdeRuntime       *self,
   g_return_if_fail (IDE_IS_RUNTIME (self));
   g_return_if_fail (IDE_IS_CONFIGURATION (configuration));
 
+  ide_runtime_invalidate (self);
+
   IDE_RUNTIME_GET_CLASS (self)->prepare_configuration (self, configuration);
 }
@@ -57,36 +57,45 @@ struct _IdeRuntimeClass
                                                       IdeConfiguration     *configuration);
 };
 
-void                   ide_runtime_prebuild_async           (IdeRuntime           *self,
-                                                             GCancellable         *cancellable,
-                                                             GAsyncReadyCallback   callback,
-                                                             gpointer              user_data);
-gboolean               ide_runtime_prebuild_finish          (IdeRuntime           *self,
-                                                             GAsyncResult         *result,
-                                                             GError              **error);
-void                   ide_runtime_postbuild_async          (IdeRuntime           *self,
-                                                             GCancellable         *cancellable,
-                                                             GAsyncReadyCallback   callback,
-                                                             gpointer              user_data);
-gboolean               ide_runtime_postbuild_finish         (IdeRuntime           *self,
-                                                             GAsyncResult         *result,
-                                                             GError              **error);
-gboolean               ide_runtime_contains_program_in_path (IdeRuntime           *self,
-                                                             const gchar          *program,
-                                                             GCancellable         *cancellable);
-IdeSubprocessLauncher *ide_runtime_create_launcher          (IdeRuntime           *self,
-                                                             GError              **error);
-void                   ide_runtime_prepare_configuration    (IdeRuntime           *self,
-                                                             IdeConfiguration     *configuration);
-IdeRuntime            *ide_runtime_new                      (IdeContext           *context,
-                                                             const gchar          *id,
-                                                             const gchar          *title);
-const gchar           *ide_runtime_get_id                   (IdeRuntime           *self);
-void                   ide_runtime_set_id                   (IdeRuntime           *self,
-                                                             const gchar          *id);
-const gchar           *ide_runtime_get_display_name         (IdeRuntime           *self);
-void                   ide_runtime_set_display_name         (IdeRuntime           *self,
-                                                             const gchar          *display_name);
+void                   ide_runtime_prebuild_async                  (IdeRuntime           *self,
+                                                                    GCancellable         *cancellable,
+                                                                    GAsyncReadyCallback   callback,
+                                                                    gpointer              user_data);
+gboolean               ide_runtime_prebuild_finish                 (IdeRuntime           *self,
+                                                                    GAsyncResult         *result,
+                                                                    GError              **error);
+void                   ide_runtime_postbuild_async                 (IdeRuntime           *self,
+                                                                    GCancellable         *cancellable,
+                                                                    GAsyncReadyCallback   callback,
+                                                                    gpointer              user_data);
+gboolean               ide_runtime_postbuild_finish                (IdeRuntime           *self,
+                                                                    GAsyncResult         *result,
+                                                                    GError              **error);
+gboolean               ide_runtime_contains_program_in_path        (IdeRuntime           *self,
+                                                                    const gchar          *program,
+                                                                    GCancellable         *cancellable);
+void                   ide_runtime_contains_program_in_path_async  (IdeRuntime           *self,
+                                                                    const gchar          *program,
+                                                                    GCancellable         *cancellable,
+                                                                    GAsyncReadyCallback   callback,
+                                                                    gpointer              user_data);
+gboolean               ide_runtime_contains_program_in_path_finish (IdeRuntime           *self,
+                                                                    GAsyncResult         *result,
+                                                                    GError              **error);
+void                   ide_runtime_invalidate                      (IdeRuntime           *self);
+IdeSubprocessLauncher *ide_runtime_create_launcher                 (IdeRuntime           *self,
+                                                                    GError              **error);
+void                   ide_runtime_prepare_configuration           (IdeRuntime           *self,
+                                                                    IdeConfiguration     *configuration);
+IdeRuntime            *ide_runtime_new                             (IdeContext           *context,
+                                                                    const gchar          *id,
+                                                                    const gchar          *title);
+const gchar           *ide_runtime_get_id                          (IdeRuntime           *self);
+void                   ide_runtime_set_id                          (IdeRuntime           *self,
+                                                                    const gchar          *id);
+const gchar           *ide_runtime_get_display_name                (IdeRuntime           *self);
+void                   ide_runtime_set_display_name                (IdeRuntime           *self,
+                                                                    const gchar          *display_name);
 
 G_END_DECLS
 
@@ -19,6 +19,7 @@
 #define G_LOG_DOMAIN "ide-search-context"
 
 #include "ide-debug.h"
+#include "ide-internal.h"
 #include "ide-search-context.h"
 #include "ide-search-provider.h"
 #include "ide-search-result.h"
@@ -31,9 +32,25 @@ struct _IdeSearchContext
   GList        *providers;
   gsize         max_results;
   guint         in_progress;
+
+  /*
+   * Snapshots of results published by reducers, possibly from threads,
+   * that have not yet been merged on the main thread.
+   * IdeSearchProvider -> GPtrArray of IdeSearchResult.
+   */
+  GMutex        pending_mutex;
+  GHashTable   *pending;
+  GSource      *merge_source;
+  GMainContext *main_context;
+
+  /* IdeSearchProvider -> GHashTable set of IdeSearchResult */
+  GHashTable   *current;
+
   guint         executed : 1;
 };
 
+#define MERGE_INTERVAL_MSEC (1000 / 60)
+
 G_DEFINE_TYPE (IdeSearchContext, ide_search_context, IDE_TYPE_OBJECT)
 
 enum {
@@ -54,6 +71,131 @@ ide_search_context_get_completed (IdeSearchContext *self)
   return (self->in_progress == 0);
 }
 
+static void
+ide_search_context_apply_snapshot (IdeSearchContext  *self,
+                                   IdeSearchProvider *provider,
+                                   GPtrArray         *snapshot)
+{
+  g_autoptr(GPtrArray) removed = NULL;
+  GHashTable *previous;
+  GHashTable *next;
+  GHashTableIter iter;
+  gpointer key;
+  guint i;
+
+  g_assert (IDE_IS_SEARCH_CONTEXT (self));
+  g_assert (IDE_IS_SEARCH_PROVIDER (provider));
+  g_assert (snapshot != NULL);
+
+  next = g_hash_table_new_full (NULL, NULL, g_object_unref, NULL);
+  for (i = 0; i < snapshot->len; i++)
+    g_hash_table_add (next, g_object_ref (g_ptr_array_index (snapshot, i)));
+
+  removed = g_ptr_array_new_with_free_func (g_object_unref);
+
+  if ((previous = g_hash_table_lookup (self->current, provider)))
+    {
+      g_hash_table_iter_init (&iter, previous);
+      while (g_hash_table_iter_next (&iter, &key, NULL))
+        {
+          if (!g_hash_table_contains (next, key))
+            g_ptr_array_add (removed, g_object_ref (key));
+        }
+    }
+
+  for (i = 0; i < removed->len; i++)
+    g_signal_emit (self, signals [RESULT_REMOVED], 0, provider, g_ptr_array_index (removed, i));
+
+  for (i = 0; i < snapshot->len; i++)
+    {
+      IdeSearchResult *result = g_ptr_array_index (snapshot, i);
+
+      if (previous == NULL || !g_hash_table_contains (previous, result))
+        g_signal_emit (self, signals [RESULT_ADDED], 0, provider, result);
+    }
+
+  g_hash_table_insert (self->current, g_object_ref (provider), next);
+}
+
+/*
+ * Merges all of the snapshots published since the last merge, emitting
+ * a single diff per provider. Must be called from the main thread.
+ */
+static void
+ide_search_context_merge (IdeSearchContext *self)
+{
+  g_autoptr(GHashTable) pending = NULL;
+  GHashTableIter iter;
+  gpointer key;
+  gpointer value;
+
+  g_assert (IDE_IS_SEARCH_CONTEXT (self));
+
+  g_mutex_lock (&self->pending_mutex);
+  pending = self->pending;
+  self->pending = g_hash_table_new_full (NULL, NULL, g_object_unref, (GDestroyNotify)g_ptr_array_unref);
+  if (self->merge_source != NULL)
+    {
+      g_source_destroy (self->merge_source);
+      g_clear_pointer (&self->merge_source, g_source_unref);
+    }
+  g_mutex_unlock (&self->pending_mutex);
+
+  g_hash_table_iter_init (&iter, pending);
+  while (g_hash_table_iter_next (&iter, &key, &value))
+    ide_search_context_apply_snapshot (self, key, value);
+}
+
+static gboolean
+ide_search_context_merge_cb (gpointer data)
+{
+  IdeSearchContext *self = data;
+
+  g_assert (IDE_IS_SEARCH_CONTEXT (self));
+
+  ide_search_context_merge (self);
+
+  return G_SOURCE_REMOVE;
+}
+
+/**
+ * _ide_search_context_publish_results:
+ * @self: An #IdeSearchContext
+ * @provider: An #IdeSearchProvider
+ * @results: (transfer full): A #GPtrArray of #IdeSearchResult
+ *
+ * Replaces the current set of results for @provider with @results. The
+ * change will be applied on the main thread during the next frame.
+ *
+ * This function is safe to call from a thread.
+ */
+void
+_ide_search_context_publish_results (IdeSearchContext  *self,
+                                     IdeSearchProvider *provider,
+                                     GPtrArray         *results)
+{
+  g_return_if_fail (IDE_IS_SEARCH_CONTEXT (self));
+  g_return_if_fail (IDE_IS_SEARCH_PROVIDER (provider));
+  g_return_if_fail (results != NULL);
+
+  g_mutex_lock (&self->pending_mutex);
+
+  g_hash_table_insert (self->pending, g_object_ref (provider), results);
+
+  if (self->merge_source == NULL)
+    {
+      self->merge_source = g_timeout_source_new (MERGE_INTERVAL_MSEC);
+      g_source_set_name (self->merge_source, "[ide] search context merge");
+      g_source_set_callback (self->merge_source,
+                             ide_search_context_merge_cb,
+                             g_object_ref (self),
+                             g_object_unref);
+      g_source_attach (self->merge_source, self->main_context);
+    }
+
+  g_mutex_unlock (&self->pending_mutex);
+}
+
 void
 ide_search_context_provider_completed (IdeSearchContext  *self,
                                        IdeSearchProvider *provider)
@@ -62,6 +204,9 @@ ide_search_context_provider_completed (IdeSearchContext  *self,
   g_return_if_fail (IDE_IS_SEARCH_PROVIDER (provider));
   g_return_if_fail (g_list_find (self->providers, provider));
 
+  /* Make sure results are delivered before completion */
+  ide_search_context_merge (self);
+
   if (--self->in_progress == 0)
     g_signal_emit (self, signals [COMPLETED], 0);
 }
@@ -185,6 +330,17 @@ ide_search_context_finalize (GObject *object)
 
   g_clear_object (&self->cancellable);
 
+  if (self->merge_source != NULL)
+    {
+      g_source_destroy (self->merge_source);
+      g_clear_pointer (&self->merge_source, g_source_unref);
+    }
+
+  g_clear_pointer (&self->pending, g_hash_table_unref);
+  g_clear_pointer (&self->current, g_hash_table_unref);
+  g_clear_pointer (&self->main_context, g_main_context_unref);
+  g_mutex_clear (&self->pending_mutex);
+
   G_OBJECT_CLASS (ide_search_context_parent_class)->finalize (object);
 }
 
@@ -242,6 +398,11 @@ static void
 ide_search_context_init (IdeSearchContext *self)
 {
   self->cancellable = g_cancellable_new ();
+  self->main_context = g_main_context_ref_thread_default ();
+
+  g_mutex_init (&self->pending_mutex);
+  self->pending = g_hash_table_new_full (NULL, NULL, g_object_unref, (GDestroyNotify)g_ptr_array_unref);
+  self->current = g_hash_table_new_full (NULL, NULL, g_object_unref, (GDestroyNotify)g_hash_table_unref);
 }
 
 gsize
@@ -16,11 +16,91 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include "ide-internal.h"
 #include "ide-search-context.h"
 #include "ide-search-provider.h"
 #include "ide-search-reducer.h"
 #include "ide-search-result.h"
 
+/*
+ * The reducer keeps the best @max_results results of a provider in a
+ * bounded min-heap so that accepting or rejecting a candidate is O(1) and
+ * inserting is O(log k).
+ *
+ * The reducer is owned by the thread running the provider and does not
+ * touch the #IdeSearchContext for every candidate. Instead, a snapshot of
+ * the heap is published to the context at most once per frame (and when
+ * the reducer is flushed or destroyed). The context merges snapshots from
+ * all providers on the main thread and emits a single diff of added and
+ * removed results per provider.
+ *
+ * This means providers may score candidates on worker threads.
+ */
+
+#define FLUSH_INTERVAL_USEC (G_USEC_PER_SEC / 60)
+
+static inline gint
+heap_compare (IdeSearchReducer *reducer,
+              guint             a,
+              guint             b)
+{
+  return ide_search_result_compare (g_ptr_array_index (reducer->heap, a),
+                                    g_ptr_array_index (reducer->heap, b));
+}
+
+static inline void
+heap_swap (IdeSearchReducer *reducer,
+           guint             a,
+           guint             b)
+{
+  gpointer tmp = reducer->heap->pdata [a];
+
+  reducer->heap->pdata [a] = reducer->heap->pdata [b];
+  reducer->heap->pdata [b] = tmp;
+}
+
+static void
+heap_sift_up (IdeSearchReducer *reducer,
+              guint             pos)
+{
+  while (pos > 0)
+    {
+      guint parent = (pos - 1) / 2;
+
+      if (heap_compare (reducer, pos, parent) >= 0)
+        break;
+
+      heap_swap (reducer, pos, parent);
+      pos = parent;
+    }
+}
+
+static void
+heap_sift_down (IdeSearchReducer *reducer,
+                guint             pos)
+{
+  guint len = reducer->heap->len;
+
+  for (;;)
+    {
+      guint left = pos * 2 + 1;
+      guint right = left + 1;
+      guint lowest = pos;
+
+      if (left < len && heap_compare (reducer, left, lowest) < 0)
+        lowest = left;
+
+      if (right < len && heap_compare (reducer, right, lowest) < 0)
+        lowest = right;
+
+      if (lowest == pos)
+        break;
+
+      heap_swap (reducer, pos, lowest);
+      pos = lowest;
+    }
+}
+
 void
 ide_search_reducer_init (IdeSearchReducer  *reducer,
                          IdeSearchContext  *context,
@@ -33,9 +113,48 @@ ide_search_reducer_init (IdeSearchReducer  *reducer,
 
   reducer->context = context;
   reducer->provider = provider;
-  reducer->sequence = g_sequence_new (g_object_unref);
   reducer->max_results = max_results ?: G_MAXSIZE;
+  reducer->heap = g_ptr_array_sized_new (MIN (reducer->max_results, 256));
+  g_ptr_array_set_free_func (reducer->heap, g_object_unref);
   reducer->count = 0;
+  reducer->last_flush = g_get_monotonic_time ();
+  reducer->dirty = FALSE;
+}
+
+/**
+ * ide_search_reducer_flush:
+ * @reducer: An #IdeSearchReducer
+ *
+ * Publishes the current set of results to the #IdeSearchContext. This is
+ * done automatically once per frame while pushing results, and when the
+ * reducer is destroyed.
+ *
+ * Providers that call ide_search_context_provider_completed() while the
+ * reducer is still alive should flush it first.
+ *
+ * This function is safe to call from a thread.
+ */
+void
+ide_search_reducer_flush (IdeSearchReducer *reducer)
+{
+  GPtrArray *snapshot;
+  guint i;
+
+  g_return_if_fail (reducer);
+
+  if (!reducer->dirty || reducer->heap == NULL)
+    return;
+
+  snapshot = g_ptr_array_sized_new (reducer->heap->len);
+  g_ptr_array_set_free_func (snapshot, g_object_unref);
+
+  for (i = 0; i < reducer->heap->len; i++)
+    g_ptr_array_add (snapshot, g_object_ref (g_ptr_array_index (reducer->heap, i)));
+
+  _ide_search_context_publish_results (reducer->context, reducer->provider, snapshot);
+
+  reducer->dirty = FALSE;
+  reducer->last_flush = g_get_monotonic_time ();
 }
 
 void
@@ -43,8 +162,11 @@ ide_search_reducer_destroy (IdeSearchReducer *reducer)
 {
   g_return_if_fail (reducer);
 
-  if (reducer->sequence)
-    g_sequence_free (reducer->sequence);
+  if (reducer->heap)
+    {
+      ide_search_reducer_flush (reducer);
+      g_clear_pointer (&reducer->heap, g_ptr_array_unref);
+    }
 }
 
 void
@@ -54,46 +176,38 @@ ide_search_reducer_push (IdeSearchReducer *reducer,
   g_return_if_fail (reducer);
   g_return_if_fail (IDE_IS_SEARCH_RESULT (result));
 
-  if (reducer->max_results <= g_sequence_get_length (reducer->sequence))
+  reducer->count++;
+
+  if (reducer->max_results <= reducer->heap->len)
+    {
+      /* Replace the lowest score, which is always the root */
+      if (ide_search_result_compare (result, g_ptr_array_index (reducer->heap, 0)) <= 0)
+        return;
+
+      g_object_unref (reducer->heap->pdata [0]);
+      reducer->heap->pdata [0] = g_object_ref (result);
+      heap_sift_down (reducer, 0);
+    }
+  else
     {
-      GSequenceIter *iter;
-      IdeSearchResult *lowest;
-
-      /* Remove lowest score */
-      iter = g_sequence_get_begin_iter (reducer->sequence);
-      lowest = g_sequence_get (iter);
-      ide_search_context_remove_result (reducer->context, reducer->provider, lowest);
-      g_sequence_remove (iter);
+      g_ptr_array_add (reducer->heap, g_object_ref (result));
+      heap_sift_up (reducer, reducer->heap->len - 1);
     }
 
-  g_sequence_insert_sorted (reducer->sequence,
-                            g_object_ref (result),
-                            (GCompareDataFunc)ide_search_result_compare,
-                            NULL);
-  ide_search_context_add_result (reducer->context, reducer->provider, result);
+  reducer->dirty = TRUE;
+
+  if (g_get_monotonic_time () - reducer->last_flush >= FLUSH_INTERVAL_USEC)
+    ide_search_reducer_flush (reducer);
 }
 
 gboolean
 ide_search_reducer_accepts (IdeSearchReducer *reducer,
                             gfloat            score)
 {
-  GSequenceIter *iter;
-
   g_return_val_if_fail (reducer, FALSE);
 
-  if (g_sequence_get_length (reducer->sequence) < reducer->max_results)
+  if (reducer->heap->len < reducer->max_results)
     return TRUE;
 
-  iter = g_sequence_get_begin_iter (reducer->sequence);
-
-  if (iter)
-    {
-      IdeSearchResult *result;
-
-      result = g_sequence_get (iter);
-      if (result)
-        return score > ide_search_result_get_score (result);
-    }
-
-  return FALSE;
+  return score > ide_search_result_get_score (g_ptr_array_index (reducer->heap, 0));
 }
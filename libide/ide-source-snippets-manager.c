@@ -18,14 +18,31 @@
 
 #define G_LOG_DOMAIN "ide-source-snippets-manager"
 
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
 #include <glib/gi18n.h>
+#include <stdlib.h>
 
 #include "ide-global.h"
 #include "ide-source-snippets-manager.h"
 #include "ide-source-snippet-parser.h"
 #include "ide-source-snippets.h"
+#include "ide-source-snippets-private.h"
 #include "ide-source-snippet.h"
 
+/*
+ * Parsing every .snippets file each time a context is loaded is wasteful,
+ * so the parsed snippets are compiled into a GVariant stored in the user
+ * cache directory. The cache records the list of source files along with
+ * their modification times (or size, for the bundled resources) and is
+ * discarded as soon as that list no longer matches what is on disk.
+ *
+ * A valid cache is loaded with a single read and the IdeSourceSnippet
+ * objects are only created when their trigger is requested.
+ */
+
 struct _IdeSourceSnippetsManager
 {
   GObject     parent_instance;
@@ -35,17 +52,26 @@ struct _IdeSourceSnippetsManager
 G_DEFINE_TYPE (IdeSourceSnippetsManager, ide_source_snippets_manager, G_TYPE_OBJECT)
 
 #define SNIPPETS_DIRECTORY "/org/gnome/builder/snippets/"
+#define SNIPPETS_CACHE_VERSION 1
+#define SNIPPETS_CACHE_TYPE G_VARIANT_TYPE ("(usa(st)a{sa(ssssa(si))})")
+
+static gint
+compare_strings (gconstpointer a,
+                 gconstpointer b)
+{
+  return g_strcmp0 (*(const gchar **)a, *(const gchar **)b);
+}
 
 static gboolean
-ide_source_snippets_manager_load_file (IdeSourceSnippetsManager  *self,
-                                       GFile                     *file,
-                                       GError                   **error)
+ide_source_snippets_manager_load_file (GHashTable  *by_language_id,
+                                       GFile       *file,
+                                       GError     **error)
 {
   IdeSourceSnippetParser *parser;
   GList *iter;
 
-  g_return_val_if_fail (IDE_IS_SOURCE_SNIPPETS_MANAGER (self), FALSE);
-  g_return_val_if_fail (G_IS_FILE (file), FALSE);
+  g_assert (by_language_id != NULL);
+  g_assert (G_IS_FILE (file));
 
   parser = ide_source_snippet_parser_new ();
 
@@ -63,12 +89,12 @@ ide_source_snippets_manager_load_file (IdeSourceSnippetsManager  *self,
 
       snippet  = iter->data;
       language = ide_source_snippet_get_language (snippet);
-      snippets = g_hash_table_lookup (self->by_language_id, language);
+      snippets = g_hash_table_lookup (by_language_id, language);
 
       if (!snippets)
         {
           snippets = ide_source_snippets_new ();
-          g_hash_table_insert (self->by_language_id, g_strdup (language), snippets);
+          g_hash_table_insert (by_language_id, g_strdup (language), snippets);
         }
 
       ide_source_snippets_add (snippets, snippet);
@@ -79,15 +105,58 @@ ide_source_snippets_manager_load_file (IdeSourceSnippetsManager  *self,
   return TRUE;
 }
 
-static void
-ide_source_snippets_manager_load_directory (IdeSourceSnippetsManager *manager,
-                                           const gchar             *path)
+/*
+ * Collects the bundled and user snippet files, in load order, into @files
+ * and returns a description of them suitable for validating the cache.
+ */
+static GVariant *
+ide_source_snippets_manager_collect_sources (GPtrArray *files)
 {
+  g_autoptr(GPtrArray) user_names = NULL;
+  g_autofree gchar *path = NULL;
+  GVariantBuilder builder;
   const gchar *name;
   GError *error = NULL;
-  gchar *filename;
-  GFile *file;
+  gchar **names;
   GDir *dir;
+  guint i;
+
+  g_assert (files != NULL);
+
+  g_variant_builder_init (&builder, G_VARIANT_TYPE ("a(st)"));
+
+  /* Bundled snippets only change along with the binary, so the resource size is enough */
+  names = g_resources_enumerate_children (SNIPPETS_DIRECTORY, G_RESOURCE_LOOKUP_FLAGS_NONE, &error);
+
+  if (names != NULL)
+    {
+      qsort (names, g_strv_length (names), sizeof (gchar *), compare_strings);
+
+      for (i = 0; names[i]; i++)
+        {
+          g_autofree gchar *resource_path = NULL;
+          g_autofree gchar *uri = NULL;
+          gsize size = 0;
+
+          resource_path = g_strconcat (SNIPPETS_DIRECTORY, names[i], NULL);
+          if (!g_resources_get_info (resource_path, G_RESOURCE_LOOKUP_FLAGS_NONE, &size, NULL, NULL))
+            continue;
+
+          uri = g_strconcat ("resource://", resource_path, NULL);
+          g_variant_builder_add (&builder, "(st)", uri, (guint64)size);
+          g_ptr_array_add (files, g_file_new_for_uri (uri));
+        }
+
+      g_strfreev (names);
+    }
+  else
+    {
+      g_message ("%s", error->message);
+      g_clear_error (&error);
+    }
+
+  path = g_build_filename (g_get_user_config_dir (), ide_get_program_name (), "snippets", NULL);
+  g_mkdir_with_parents (path, 0700);
 
   dir = g_dir_open (path, 0, &error);
 
@@ -95,26 +164,140 @@ ide_source_snippets_manager_load_directory (IdeSourceSnippetsManager *manager,
     {
       g_warning (_("Failed to open directory: %s"), error->message);
       g_error_free (error);
-      return;
+      return g_variant_builder_end (&builder);
     }
 
+  user_names = g_ptr_array_new_with_free_func (g_free);
+
   while ((name = g_dir_read_name (dir)))
     {
       if (g_str_has_suffix (name, ".snippets"))
-        {
-          filename = g_build_filename (path, name, NULL);
-          file = g_file_new_for_path (filename);
-          if (!ide_source_snippets_manager_load_file (manager, file, &error))
-            {
-              g_warning (_("Failed to load file: %s: %s"), filename, error->message);
-              g_clear_error (&error);
-            }
-          g_object_unref (file);
-          g_free (filename);
-        }
+        g_ptr_array_add (user_names, g_strdup (name));
     }
 
   g_dir_close (dir);
+
+  g_ptr_array_sort (user_names, compare_strings);
+
+  for (i = 0; i < user_names->len; i++)
+    {
+      g_autofree gchar *filename = NULL;
+      g_autoptr(GFileInfo) file_info = NULL;
+      GFile *file;
+      guint64 mtime = 0;
+
+      filename = g_build_filename (path, g_ptr_array_index (user_names, i), NULL);
+      file = g_file_new_for_path (filename);
+      file_info = g_file_query_info (file,
+                                     G_FILE_ATTRIBUTE_TIME_MODIFIED","
+                                     G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC,
+                                     G_FILE_QUERY_INFO_NONE,
+                                     NULL,
+                                     NULL);
+
+      if (file_info != NULL)
+        mtime = (g_file_info_get_attribute_uint64 (file_info, G_FILE_ATTRIBUTE_TIME_MODIFIED) * G_USEC_PER_SEC) +
+                g_file_info_get_attribute_uint32 (file_info, G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC);
+
+      g_variant_builder_add (&builder, "(st)", filename, mtime);
+      g_ptr_array_add (files, file);
+    }
+
+  return g_variant_builder_end (&builder);
+}
+
+static GHashTable *
+ide_source_snippets_manager_load_cache (const gchar *cache_path,
+                                        GVariant    *sources)
+{
+  g_autoptr(GBytes) bytes = NULL;
+  g_autoptr(GVariant) cache = NULL;
+  g_autoptr(GVariant) cached_sources = NULL;
+  g_autoptr(GVariant) languages = NULL;
+  GHashTable *by_language_id;
+  const gchar *program_version = NULL;
+  const gchar *language_id;
+  GVariantIter iter;
+  GVariant *compiled;
+  gchar *contents = NULL;
+  gsize len = 0;
+  guint32 version = 0;
+
+  g_assert (cache_path != NULL);
+  g_assert (sources != NULL);
+
+  if (!g_file_get_contents (cache_path, &contents, &len, NULL))
+    return NULL;
+
+  bytes = g_bytes_new_take (contents, len);
+  cache = g_variant_ref_sink (g_variant_new_from_bytes (SNIPPETS_CACHE_TYPE, bytes, FALSE));
+
+  g_variant_get (cache, "(u&s@a(st)@a{sa(ssssa(si))})",
+                 &version, &program_version, &cached_sources, &languages);
+
+  if (version != SNIPPETS_CACHE_VERSION ||
+      g_strcmp0 (program_version, PACKAGE_VERSION) != 0 ||
+      !g_variant_equal (sources, cached_sources))
+    return NULL;
+
+  by_language_id = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_object_unref);
+
+  g_variant_iter_init (&iter, languages);
+
+  while (g_variant_iter_next (&iter, "{&s@a(ssssa(si))}", &language_id, &compiled))
+    {
+      IdeSourceSnippets *snippets;
+
+      snippets = ide_source_snippets_new ();
+      _ide_source_snippets_set_compiled (snippets, compiled);
+      g_hash_table_insert (by_language_id, g_strdup (language_id), snippets);
+      g_variant_unref (compiled);
+    }
+
+  return by_language_id;
+}
+
+static void
+ide_source_snippets_manager_save_cache (const gchar *cache_path,
+                                        GVariant    *sources,
+                                        GHashTable  *by_language_id)
+{
+  g_autoptr(GVariant) cache = NULL;
+  g_autofree gchar *cache_dir = NULL;
+  GVariantBuilder builder;
+  GHashTableIter iter;
+  gpointer key;
+  gpointer value;
+  GError *error = NULL;
+
+  g_assert (cache_path != NULL);
+  g_assert (sources != NULL);
+  g_assert (by_language_id != NULL);
+
+  g_variant_builder_init (&builder, G_VARIANT_TYPE ("a{sa(ssssa(si))}"));
+
+  g_hash_table_iter_init (&iter, by_language_id);
+
+  while (g_hash_table_iter_next (&iter, &key, &value))
+    g_variant_builder_add (&builder, "{s@a(ssssa(si))}", key, _ide_source_snippets_compile (value));
+
+  cache = g_variant_ref_sink (g_variant_new ("(us@a(st)a{sa(ssssa(si))})",
+                                             SNIPPETS_CACHE_VERSION,
+                                             PACKAGE_VERSION,
+                                             sources,
+                                             &builder));
+
+  cache_dir = g_path_get_dirname (cache_path);
+  g_mkdir_with_parents (cache_dir, 0750);
+
+  if (!g_file_set_contents (cache_path,
+                            g_variant_get_data (cache),
+                            g_variant_get_size (cache),
+                            &error))
+    {
+      g_warning ("Failed to write snippets cache: %s", error->message);
+      g_clear_error (&error);
+    }
 }
 
 static void
@@ -123,15 +306,72 @@ ide_source_snippets_manager_load_worker (GTask        *task,
                                          gpointer      task_data,
                                          GCancellable *cancellable)
 {
-  g_autofree gchar *path = NULL;
+  g_autoptr(GPtrArray) files = NULL;
+  g_autoptr(GVariant) sources = NULL;
+  g_autofree gchar *cache_path = NULL;
+  GHashTable *by_language_id;
+  guint i;
 
   g_assert (G_IS_TASK (task));
   g_assert (IDE_IS_SOURCE_SNIPPETS_MANAGER (source_object));
 
-  /* Load internal snippets */
-  path = g_build_filename (g_get_user_config_dir (), ide_get_program_name (), "snippets", NULL);
-  g_mkdir_with_parents (path, 0700);
-  ide_source_snippets_manager_load_directory (source_object, path);
+  files = g_ptr_array_new_with_free_func (g_object_unref);
+  sources = g_variant_ref_sink (ide_source_snippets_manager_collect_sources (files));
+  cache_path = g_build_filename (g_get_user_cache_dir (),
+                                 ide_get_program_name (),
+                                 "snippets.cache",
+                                 NULL);
+
+  by_language_id = ide_source_snippets_manager_load_cache (cache_path, sources);
+
+  if (by_language_id == NULL)
+    {
+      by_language_id = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_object_unref);
+
+      for (i = 0; i < files->len; i++)
+        {
+          GFile *file = g_ptr_array_index (files, i);
+          GError *error = NULL;
+
+          if (!ide_source_snippets_manager_load_file (by_language_id, file, &error))
+            {
+              g_autofree gchar *uri = g_file_get_uri (file);
+
+              g_warning (_("Failed to load file: %s: %s"), uri, error->message);
+              g_clear_error (&error);
+            }
+        }
+
+      ide_source_snippets_manager_save_cache (cache_path, sources, by_language_id);
+    }
+
+  g_task_return_pointer (task, by_language_id, (GDestroyNotify)g_hash_table_unref);
+}
+
+static void
+ide_source_snippets_manager_load_cb (GObject      *object,
+                                     GAsyncResult *result,
+                                     gpointer      user_data)
+{
+  IdeSourceSnippetsManager *self = (IdeSourceSnippetsManager *)object;
+  g_autoptr(GTask) task = user_data;
+  GHashTable *by_language_id;
+  GError *error = NULL;
+
+  g_assert (IDE_IS_SOURCE_SNIPPETS_MANAGER (self));
+  g_assert (G_IS_TASK (result));
+  g_assert (G_IS_TASK (task));
+
+  by_language_id = g_task_propagate_pointer (G_TASK (result), &error);
+
+  if (by_language_id == NULL)
+    {
+      g_task_return_error (task, error);
+      return;
+    }
+
+  g_clear_pointer (&self->by_language_id, g_hash_table_unref);
+  self->by_language_id = by_language_id;
 
   g_task_return_boolean (task, TRUE);
 }
@@ -143,12 +383,16 @@ ide_source_snippets_manager_load_async (IdeSourceSnippetsManager *self,
                                         gpointer                  user_data)
 {
   g_autoptr(GTask) task = NULL;
+  g_autoptr(GTask) worker = NULL;
 
   g_return_if_fail (IDE_IS_SOURCE_SNIPPETS_MANAGER (self));
   g_return_if_fail (!cancellable || G_IS_CANCELLABLE (cancellable));
 
   task = g_task_new (self, cancellable, callback, user_data);
-  g_task_run_in_thread (task, ide_source_snippets_manager_load_worker);
+
+  /* Build the snippets off the main thread and swap them in once complete */
+  worker = g_task_new (self, cancellable, ide_source_snippets_manager_load_cb, g_object_ref (task));
+  g_task_run_in_thread (worker, ide_source_snippets_manager_load_worker);
 }
 
 gboolean
@@ -203,43 +447,6 @@ ide_source_snippets_manager_get_for_language (IdeSourceSnippetsManager *self,
   return snippets;
 }
 
-static void
-ide_source_snippets_manager_constructed (GObject *object)
-{
-  IdeSourceSnippetsManager *self = (IdeSourceSnippetsManager *)object;
-  GError *error = NULL;
-  gchar **names;
-  guint i;
-
-  g_assert (IDE_IS_SOURCE_SNIPPETS_MANAGER (self));
-
-  names = g_resources_enumerate_children (SNIPPETS_DIRECTORY, G_RESOURCE_LOOKUP_FLAGS_NONE, &error);
-
-  if (!names)
-    {
-      g_message ("%s", error->message);
-      g_clear_error (&error);
-      return;
-    }
-
-  for (i = 0; names[i]; i++)
-    {
-      g_autofree gchar *path = NULL;
-      g_autoptr(GFile) file = NULL;
-
-      path = g_strdup_printf ("resource://"SNIPPETS_DIRECTORY"%s", names[i]);
-      file = g_file_new_for_uri (path);
-
-      if (!ide_source_snippets_manager_load_file (self, file, &error))
-        {
-          g_message ("%s", error->message);
-          g_clear_error (&error);
-        }
-    }
-
-  g_strfreev (names);
-}
-
 static void
 ide_source_snippets_manager_finalize (GObject *object)
 {
@@ -255,7 +462,6 @@ ide_source_snippets_manager_class_init (IdeSourceSnippetsManagerClass *klass)
 {
   GObjectClass *object_class = G_OBJECT_CLASS (klass);
 
-  object_class->constructed = ide_source_snippets_manager_constructed;
   object_class->finalize = ide_source_snippets_manager_finalize;
 }
 
@@ -0,0 +1,35 @@
+/* ide-source-snippets-private.h
+ *
+ * Copyright (C) 2016 Christian Hergert <chergert@redhat.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef IDE_SOURCE_SNIPPETS_PRIVATE_H
+#define IDE_SOURCE_SNIPPETS_PRIVATE_H
+
+#include "ide-source-snippets.h"
+
+G_BEGIN_DECLS
+
+/* (trigger, language, description, snippet_text, [(spec, tab_stop)]) */
+#define IDE_SOURCE_SNIPPETS_COMPILED_TYPE G_VARIANT_TYPE ("a(ssssa(si))")
+
+void      _ide_source_snippets_set_compiled (IdeSourceSnippets *self,
+                                             GVariant          *compiled) G_GNUC_INTERNAL;
+GVariant *_ide_source_snippets_compile      (IdeSourceSnippets *self)     G_GNUC_INTERNAL;
+
+G_END_DECLS
+
+#endif /* IDE_SOURCE_SNIPPETS_PRIVATE_H */
@@ -23,20 +23,128 @@
 #include "ide-source-snippet-chunk.h"
 #include "ide-source-snippet-parser.h"
 #include "ide-source-snippets.h"
+#include "ide-source-snippets-private.h"
 
 #include "trie.h"
 
+/*
+ * Snippets loaded from the compiled cache are not turned into
+ * IdeSourceSnippet objects up front. Instead, the trie holds the index of
+ * the record within @compiled, tagged with the low bit (which is never set
+ * for a GObject pointer). The record is materialized the first time its
+ * trigger is requested and the object replaces the index in the trie.
+ */
+#define IS_COMPILED(v)         ((GPOINTER_TO_SIZE (v) & 1) != 0)
+#define COMPILED_TO_INDEX(v)   (GPOINTER_TO_SIZE (v) >> 1)
+#define INDEX_TO_COMPILED(i)   GSIZE_TO_POINTER (((gsize)(i) << 1) | 1)
+
 struct _IdeSourceSnippets
 {
-  GObject  parent_instance;
+  GObject   parent_instance;
 
-  Trie    *snippets;
+  Trie     *snippets;
+  GVariant *compiled;
 };
 
 
 G_DEFINE_TYPE (IdeSourceSnippets, ide_source_snippets, G_TYPE_OBJECT)
 
 
+static void
+ide_source_snippets_value_free (gpointer value)
+{
+  if (!IS_COMPILED (value))
+    g_object_unref (value);
+}
+
+static IdeSourceSnippet *
+ide_source_snippets_materialize (IdeSourceSnippets *self,
+                                 gsize              index)
+{
+  g_autoptr(GVariant) record = NULL;
+  g_autoptr(GVariantIter) chunks = NULL;
+  IdeSourceSnippet *snippet;
+  const gchar *trigger;
+  const gchar *language;
+  const gchar *description;
+  const gchar *snippet_text;
+  const gchar *spec;
+  gint32 tab_stop;
+
+  g_assert (IDE_IS_SOURCE_SNIPPETS (self));
+  g_assert (self->compiled != NULL);
+  g_assert (index < g_variant_n_children (self->compiled));
+
+  record = g_variant_get_child_value (self->compiled, index);
+  g_variant_get (record, "(&s&s&s&sa(si))",
+                 &trigger, &language, &description, &snippet_text, &chunks);
+
+  snippet = ide_source_snippet_new (trigger, language);
+  ide_source_snippet_set_description (snippet, *description ? description : NULL);
+  ide_source_snippet_set_snippet_text (snippet, snippet_text);
+
+  while (g_variant_iter_next (chunks, "(&si)", &spec, &tab_stop))
+    {
+      g_autoptr(IdeSourceSnippetChunk) chunk = NULL;
+
+      chunk = ide_source_snippet_chunk_new ();
+      ide_source_snippet_chunk_set_spec (chunk, spec);
+      ide_source_snippet_chunk_set_tab_stop (chunk, tab_stop);
+      ide_source_snippet_add_chunk (snippet, chunk);
+    }
+
+  return snippet;
+}
+
+/*
+ * Returns a new reference to the snippet stored as @value, materializing
+ * it from the compiled records if necessary. Materialized snippets are
+ * appended to @pending so the caller can store them back into the trie
+ * once the traversal has completed (inserting reorders trie nodes).
+ */
+static IdeSourceSnippet *
+ide_source_snippets_resolve (IdeSourceSnippets *self,
+                             const gchar       *key,
+                             gpointer           value,
+                             GPtrArray         *pending)
+{
+  IdeSourceSnippet *snippet;
+
+  if (!IS_COMPILED (value))
+    return g_object_ref (value);
+
+  snippet = ide_source_snippets_materialize (self, COMPILED_TO_INDEX (value));
+
+  if (pending != NULL)
+    {
+      g_ptr_array_add (pending, g_strdup (key));
+      g_ptr_array_add (pending, g_object_ref (snippet));
+    }
+
+  return snippet;
+}
+
+static void
+ide_source_snippets_store_pending (IdeSourceSnippets *self,
+                                   GPtrArray         *pending)
+{
+  guint i;
+
+  g_assert (IDE_IS_SOURCE_SNIPPETS (self));
+  g_assert (pending != NULL);
+
+  for (i = 0; i < pending->len; i += 2)
+    {
+      gchar *key = g_ptr_array_index (pending, i);
+      IdeSourceSnippet *snippet = g_ptr_array_index (pending, i + 1);
+
+      trie_insert (self->snippets, key, snippet);
+      g_free (key);
+    }
+
+  g_ptr_array_set_size (pending, 0);
+}
+
 IdeSourceSnippets *
 ide_source_snippets_new (void)
 {
@@ -50,7 +158,8 @@ ide_source_snippets_clear (IdeSourceSnippets *snippets)
   g_return_if_fail (IDE_IS_SOURCE_SNIPPETS (snippets));
 
   trie_destroy (snippets->snippets);
-  snippets->snippets = trie_new (g_object_unref);
+  snippets->snippets = trie_new (ide_source_snippets_value_free);
+  g_clear_pointer (&snippets->compiled, g_variant_unref);
 }
 
 static gboolean
@@ -59,13 +168,14 @@ copy_into (Trie        *trie,
            gpointer     value,
            gpointer     user_data)
 {
-  IdeSourceSnippet *snippet = value;
-  Trie *dest = user_data;
+  gpointer *closure = user_data;
+  IdeSourceSnippets *other = closure[0];
+  Trie *dest = closure[1];
 
+  g_assert (IDE_IS_SOURCE_SNIPPETS (other));
   g_assert (dest);
-  g_assert (IDE_IS_SOURCE_SNIPPET (snippet));
 
-  trie_insert (dest, key, g_object_ref (snippet));
+  trie_insert (dest, key, ide_source_snippets_resolve (other, key, value, NULL));
 
   return FALSE;
 }
@@ -74,16 +184,21 @@ void
 ide_source_snippets_merge (IdeSourceSnippets *snippets,
                            IdeSourceSnippets *other)
 {
+  gpointer closure[2];
+
   g_return_if_fail (IDE_IS_SOURCE_SNIPPETS (snippets));
   g_return_if_fail (IDE_IS_SOURCE_SNIPPETS (other));
 
+  closure[0] = other;
+  closure[1] = snippets->snippets;
+
   trie_traverse (other->snippets,
                  "",
                  G_PRE_ORDER,
                  G_TRAVERSE_LEAVES,
                  -1,
                  copy_into,
-                 snippets->snippets);
+                 closure);
 }
 
 void
@@ -106,8 +221,10 @@ ide_source_snippets_foreach_cb (Trie        *trie,
                                 gpointer     user_data)
 {
   gpointer *closure = user_data;
+  g_autoptr(IdeSourceSnippet) snippet = NULL;
 
-  ((GFunc) closure[0])(value, closure[1]);
+  snippet = ide_source_snippets_resolve (closure[2], key, value, closure[3]);
+  ((GFunc) closure[0])(snippet, closure[1]);
 
   return FALSE;
 }
@@ -123,11 +240,15 @@ ide_source_snippets_foreach (IdeSourceSnippets *snippets,
                              GFunc              foreach_func,
                              gpointer           user_data)
 {
-  gpointer closure[2] = { foreach_func, user_data };
+  g_autoptr(GPtrArray) pending = NULL;
+  gpointer closure[4] = { foreach_func, user_data, snippets, NULL };
 
   g_return_if_fail (IDE_IS_SOURCE_SNIPPETS (snippets));
   g_return_if_fail (foreach_func);
 
+  if (snippets->compiled != NULL)
+    closure[3] = pending = g_ptr_array_new ();
+
   if (!prefix)
     prefix = "";
 
@@ -138,6 +259,9 @@ ide_source_snippets_foreach (IdeSourceSnippets *snippets,
                  -1,
                  ide_source_snippets_foreach_cb,
                  (gpointer) closure);
+
+  if (pending != NULL)
+    ide_source_snippets_store_pending (snippets, pending);
 }
 
 static void
@@ -146,6 +270,7 @@ ide_source_snippets_finalize (GObject *object)
   IdeSourceSnippets *self = IDE_SOURCE_SNIPPETS (object);
 
   g_clear_pointer (&self->snippets, (GDestroyNotify) trie_destroy);
+  g_clear_pointer (&self->compiled, g_variant_unref);
 
   G_OBJECT_CLASS (ide_source_snippets_parent_class)->finalize (object);
 }
@@ -162,7 +287,7 @@ ide_source_snippets_class_init (IdeSourceSnippetsClass *klass)
 static void
 ide_source_snippets_init (IdeSourceSnippets *snippets)
 {
-  snippets->snippets = trie_new (g_object_unref);
+  snippets->snippets = trie_new (ide_source_snippets_value_free);
 }
 
 static gboolean
@@ -193,3 +318,110 @@ ide_source_snippets_count (IdeSourceSnippets *self)
 
   return count;
 }
+
+/**
+ * _ide_source_snippets_set_compiled:
+ * @self: An #IdeSourceSnippets
+ * @compiled: A #GVariant of type "a(ssssa(si))"
+ *
+ * Replaces the contents of @self with the compiled snippet records found
+ * in @compiled. Only the triggers are read; the #IdeSourceSnippet objects
+ * are created on demand when a matching trigger is requested.
+ */
+void
+_ide_source_snippets_set_compiled (IdeSourceSnippets *self,
+                                   GVariant          *compiled)
+{
+  GVariantIter iter;
+  const gchar *trigger;
+  gsize index = 0;
+
+  g_return_if_fail (IDE_IS_SOURCE_SNIPPETS (self));
+  g_return_if_fail (compiled != NULL);
+  g_return_if_fail (g_variant_is_of_type (compiled, IDE_SOURCE_SNIPPETS_COMPILED_TYPE));
+
+  ide_source_snippets_clear (self);
+
+  self->compiled = g_variant_ref_sink (compiled);
+
+  g_variant_iter_init (&iter, compiled);
+
+  while (g_variant_iter_next (&iter, "(&s&s&s&s@a(si))", &trigger, NULL, NULL, NULL, NULL))
+    {
+      trie_insert (self->snippets, trigger, INDEX_TO_COMPILED (index));
+      index++;
+    }
+}
+
+static gboolean
+compile_into (Trie        *trie,
+              const gchar *key,
+              gpointer     value,
+              gpointer     user_data)
+{
+  gpointer *closure = user_data;
+  IdeSourceSnippets *self = closure[0];
+  GVariantBuilder *builder = closure[1];
+  g_autoptr(IdeSourceSnippet) snippet = NULL;
+  const gchar *description;
+  const gchar *snippet_text;
+  guint n_chunks;
+  guint i;
+
+  snippet = ide_source_snippets_resolve (self, key, value, NULL);
+  description = ide_source_snippet_get_description (snippet);
+  snippet_text = ide_source_snippet_get_snippet_text (snippet);
+  n_chunks = ide_source_snippet_get_n_chunks (snippet);
+
+  g_variant_builder_open (builder, G_VARIANT_TYPE ("(ssssa(si))"));
+  g_variant_builder_add (builder, "s", key);
+  g_variant_builder_add (builder, "s", ide_source_snippet_get_language (snippet) ?: "");
+  g_variant_builder_add (builder, "s", description ?: "");
+  g_variant_builder_add (builder, "s", snippet_text ?: "");
+  g_variant_builder_open (builder, G_VARIANT_TYPE ("a(si)"));
+
+  for (i = 0; i < n_chunks; i++)
+    {
+      IdeSourceSnippetChunk *chunk = ide_source_snippet_get_nth_chunk (snippet, i);
+      const gchar *spec = ide_source_snippet_chunk_get_spec (chunk);
+
+      g_variant_builder_add (builder, "(si)",
+                             spec ?: "",
+                             ide_source_snippet_chunk_get_tab_stop (chunk));
+    }
+
+  g_variant_builder_close (builder);
+  g_variant_builder_close (builder);
+
+  return FALSE;
+}
+
+/**
+ * _ide_source_snippets_compile:
+ * @self: An #IdeSourceSnippets
+ *
+ * Serializes the snippets in @self into the record format consumed by
+ * _ide_source_snippets_set_compiled().
+ *
+ * Returns: (transfer floating): A #GVariant of type "a(ssssa(si))".
+ */
+GVariant *
+_ide_source_snippets_compile (IdeSourceSnippets *self)
+{
+  GVariantBuilder builder;
+  gpointer closure[2] = { self, &builder };
+
+  g_return_val_if_fail (IDE_IS_SOURCE_SNIPPETS (self), NULL);
+
+  g_variant_builder_init (&builder, IDE_SOURCE_SNIPPETS_COMPILED_TYPE);
+
+  trie_traverse (self->snippets,
+                 "",
+                 G_PRE_ORDER,
+                 G_TRAVERSE_LEAVES,
+                 -1,
+                 compile_into,
+                 closure);
+
+  return g_variant_builder_end (&builder);
+}
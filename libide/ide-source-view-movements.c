@@ -27,6 +27,7 @@
 #include "ide-source-iter.h"
 #include "ide-source-view-movements.h"
 #include "ide-text-iter.h"
+#include "ide-text-structure.h"
 
 #define ANCHOR_BEGIN "SELECTION_ANCHOR_BEGIN"
 #define ANCHOR_END   "SELECTION_ANCHOR_END"
@@ -951,6 +952,12 @@ bracket_predicate (GtkTextIter *iter,
 
 }
 
+static inline IdeTextStructure *
+get_text_structure (const GtkTextIter *iter)
+{
+  return _ide_text_structure_get_for_buffer (gtk_text_iter_get_buffer (iter));
+}
+
 /* find the matching char position in 'depth' outer levels */
 static gboolean
 match_char_with_depth (GtkTextIter      *iter,
@@ -994,6 +1001,9 @@ match_char_with_depth (GtkTextIter      *iter,
           gtk_text_iter_set_line_offset (&limit, 0);
           ret = _ide_text_iter_backward_find_char (iter, bracket_predicate, &state, &limit);
         }
+      else if (_ide_text_structure_can_match (left_char, right_char))
+        ret = _ide_text_structure_match_backward (get_text_structure (iter), iter,
+                                                  left_char, right_char, state.depth);
       else
         ret = _ide_text_iter_backward_find_char (iter, bracket_predicate, &state, NULL);
     }
@@ -1004,6 +1014,9 @@ match_char_with_depth (GtkTextIter      *iter,
           gtk_text_iter_forward_to_line_end (&limit);
           ret = _ide_text_iter_forward_find_char (iter, bracket_predicate, &state, &limit);
         }
+      else if (_ide_text_structure_can_match (left_char, right_char))
+        ret = _ide_text_structure_match_forward (get_text_structure (iter), iter,
+                                                 left_char, right_char, state.depth);
       else
         ret = _ide_text_iter_forward_find_char (iter, bracket_predicate, &state, NULL);
     }
@@ -1071,13 +1084,76 @@ macro_conditionals_qualify_iter (GtkTextIter *insert,
     return MACRO_COND_NONE;
 }
 
+/* Like gtk_text_iter_backward_find_char() for a '#' but only
+ * looks at the lines the text structure knows to contain one.
+ */
+static gboolean
+backward_find_hash (GtkTextIter *iter)
+{
+  IdeTextStructure *structure = get_text_structure (iter);
+  GtkTextIter limit;
+  gint line;
+
+  limit = *iter;
+  gtk_text_iter_set_line_offset (&limit, 0);
+
+  if (gtk_text_iter_backward_find_char (iter, find_char_predicate, GUINT_TO_POINTER ('#'), &limit))
+    return TRUE;
+
+  line = _ide_text_structure_previous_line (structure,
+                                            gtk_text_iter_get_line (iter),
+                                            IDE_TEXT_STRUCTURE_HASH);
+  if (line < 0)
+    return FALSE;
+
+  gtk_text_iter_set_line (iter, line);
+  limit = *iter;
+  if (!gtk_text_iter_ends_line (iter))
+    gtk_text_iter_forward_to_line_end (iter);
+
+  return gtk_text_iter_backward_find_char (iter, find_char_predicate, GUINT_TO_POINTER ('#'), &limit);
+}
+
+/* Like gtk_text_iter_forward_find_char() for a '#' but only
+ * looks at the lines the text structure knows to contain one.
+ */
+static gboolean
+forward_find_hash (GtkTextIter *iter)
+{
+  IdeTextStructure *structure = get_text_structure (iter);
+  GtkTextIter limit;
+  gint line;
+
+  limit = *iter;
+  if (!gtk_text_iter_ends_line (&limit))
+    gtk_text_iter_forward_to_line_end (&limit);
+
+  if (gtk_text_iter_forward_find_char (iter, find_char_predicate, GUINT_TO_POINTER ('#'), &limit))
+    return TRUE;
+
+  line = _ide_text_structure_next_line (structure,
+                                        gtk_text_iter_get_line (iter),
+                                        IDE_TEXT_STRUCTURE_HASH);
+  if (line < 0)
+    return FALSE;
+
+  gtk_text_iter_set_line (iter, line);
+  if (gtk_text_iter_get_char (iter) == '#')
+    return TRUE;
+
+  limit = *iter;
+  gtk_text_iter_forward_to_line_end (&limit);
+
+  return gtk_text_iter_forward_find_char (iter, find_char_predicate, GUINT_TO_POINTER ('#'), &limit);
+}
+
 static MacroCond
 find_macro_conditionals_backward (GtkTextIter *insert,
                                   GtkTextIter *cond_end)
 {
   MacroCond cond;
 
-  while (gtk_text_iter_backward_find_char (insert, find_char_predicate, GUINT_TO_POINTER ('#'), NULL))
+  while (backward_find_hash (insert))
     {
       cond = macro_conditionals_qualify_iter (insert, NULL, cond_end, TRUE);
       if (cond != MACRO_COND_NONE)
@@ -1093,7 +1169,7 @@ find_macro_conditionals_forward (GtkTextIter *insert,
 {
   MacroCond cond;
 
-  while (gtk_text_iter_forward_find_char (insert, find_char_predicate, GUINT_TO_POINTER ('#'), NULL))
+  while (forward_find_hash (insert))
     {
       cond = macro_conditionals_qualify_iter (insert, NULL, cond_end, TRUE);
       if (cond == MACRO_COND_NONE)
@@ -1223,6 +1299,85 @@ match_macro_conditionals (GtkTextIter *insert)
   return FALSE;
 }
 
+/* Finds the next comment end, only looking at the current line
+ * and the lines the text structure knows to contain one.
+ */
+static gboolean
+forward_find_comment_end (GtkTextIter *iter)
+{
+  IdeTextStructure *structure = get_text_structure (iter);
+  GtkTextIter cursor = *iter;
+  GtkTextIter limit;
+  gint line;
+
+  limit = cursor;
+  if (!gtk_text_iter_ends_line (&limit))
+    gtk_text_iter_forward_to_line_end (&limit);
+
+  if (!_ide_text_iter_find_chars_forward (&cursor, &limit, NULL, "*/", FALSE))
+    {
+      line = _ide_text_structure_next_line (structure,
+                                            gtk_text_iter_get_line (iter),
+                                            IDE_TEXT_STRUCTURE_COMMENT_END);
+      if (line < 0)
+        return FALSE;
+
+      gtk_text_iter_set_line (&cursor, line);
+      limit = cursor;
+      gtk_text_iter_forward_to_line_end (&limit);
+
+      if (!_ide_text_iter_find_chars_forward (&cursor, &limit, NULL, "*/", FALSE))
+        return FALSE;
+    }
+
+  *iter = cursor;
+
+  return TRUE;
+}
+
+/* Finds the previous comment start before @iter, only looking at the
+ * current line and the lines the text structure knows to contain one.
+ */
+static gboolean
+backward_find_comment_start (GtkTextIter *iter)
+{
+  IdeTextStructure *structure = get_text_structure (iter);
+  g_autofree gchar *text = NULL;
+  GtkTextIter begin;
+  GtkTextIter end = *iter;
+  const gchar *found;
+  gint line;
+
+  begin = end;
+  gtk_text_iter_set_line_offset (&begin, 0);
+  text = gtk_text_iter_get_slice (&begin, &end);
+
+  if (NULL == (found = g_strrstr (text, "/*")))
+    {
+      line = _ide_text_structure_previous_line (structure,
+                                                gtk_text_iter_get_line (iter),
+                                                IDE_TEXT_STRUCTURE_COMMENT_START);
+      if (line < 0)
+        return FALSE;
+
+      gtk_text_iter_set_line (&begin, line);
+      end = begin;
+      if (!gtk_text_iter_ends_line (&end))
+        gtk_text_iter_forward_to_line_end (&end);
+
+      g_free (text);
+      text = gtk_text_iter_get_slice (&begin, &end);
+
+      if (NULL == (found = g_strrstr (text, "/*")))
+        return FALSE;
+    }
+
+  *iter = begin;
+  gtk_text_iter_forward_chars (iter, g_utf8_pointer_to_offset (text, found));
+
+  return TRUE;
+}
+
 static gboolean
 match_comments (GtkTextIter *insert,
                 gunichar     ch)
@@ -1281,7 +1436,7 @@ match_comments (GtkTextIter *insert,
 
   if (comment_start && !gtk_text_iter_is_end (&cursor))
     {
-      if (_ide_text_iter_find_chars_forward (&cursor, NULL, NULL, "*/", FALSE))
+      if (forward_find_comment_end (&cursor))
         {
           gtk_text_iter_forward_char (&cursor);
           *insert = cursor;
@@ -1291,7 +1446,7 @@ match_comments (GtkTextIter *insert,
     }
   else if (!comment_start && !gtk_text_iter_is_start (&cursor))
     {
-      if (_ide_text_iter_find_chars_backward (&cursor, NULL, NULL, "/*", FALSE))
+      if (backward_find_comment_start (&cursor))
         {
           *insert = cursor;
 
@@ -1737,6 +1892,18 @@ ide_source_view_movements_previous_unmatched (Movement *mv,
 
   copy = mv->insert;
 
+  if (_ide_text_structure_can_match (target, opposite))
+    {
+      if (_ide_text_structure_match_backward (get_text_structure (&mv->insert),
+                                              &mv->insert, target, opposite, 1))
+        {
+          if (!mv->exclusive)
+            gtk_text_iter_forward_char (&mv->insert);
+        }
+
+      return;
+    }
+
   do
     {
       gunichar ch;
@@ -1780,6 +1947,18 @@ ide_source_view_movements_next_unmatched (Movement *mv,
 
   copy = mv->insert;
 
+  if (_ide_text_structure_can_match (opposite, target))
+    {
+      if (_ide_text_structure_match_forward (get_text_structure (&mv->insert),
+                                             &mv->insert, opposite, target, 1))
+        {
+          if (!mv->exclusive)
+            gtk_text_iter_forward_char (&mv->insert);
+        }
+
+      return;
+    }
+
   do
     {
       gunichar ch;
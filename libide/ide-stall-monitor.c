@@ -0,0 +1,309 @@
+/* ide-stall-monitor.c
+ *
+ * Copyright (C) 2016 Christian Hergert <chergert@redhat.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define G_LOG_DOMAIN "ide-stall-monitor"
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <errno.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef HAVE_EXECINFO_H
+# include <execinfo.h>
+#endif
+
+#include "egg-counter.h"
+
+#include "ide-internal.h"
+
+/*
+ * Detects stalls of the main loop and reports what was running at the time.
+ *
+ * This is enabled by setting IDE_STALL_THRESHOLD to a number of milliseconds.
+ *
+ * A source with a very high priority is attached to the default main context
+ * so that its prepare() and check() functions run on every iteration. check()
+ * runs after poll() and just before sources are dispatched, and prepare()
+ * runs once they have all been dispatched, so the time between them is the
+ * time spent dispatching.
+ *
+ * A watchdog thread looks at that time periodically. When it exceeds the
+ * threshold, the main thread is interrupted with a signal so that the
+ * handler can capture a backtrace and the name of the source currently being
+ * dispatched, and the watchdog writes them to the log. Stalls are counted
+ * and their duration recorded in the MainLoop counters.
+ *
+ * Time spent in nested main loops is not attributed to the outer source.
+ */
+
+#define MAX_FRAMES      64
+#define MAX_SOURCE_NAME 64
+
+EGG_DEFINE_COUNTER (stalls, "MainLoop", "Stalls", "Number of main loop iterations exceeding IDE_STALL_THRESHOLD")
+EGG_DEFINE_HISTOGRAM (dispatch_latency,
+                      "MainLoop",
+                      "Dispatch Latency",
+                      "Time spent dispatching sources per main loop iteration in usec")
+
+static gint64           threshold;
+static pthread_t        main_thread;
+static gint             stall_signal;
+
+/* Written by the main thread and read by the watchdog */
+static volatile gint64  dispatch_begin;
+static volatile gint    dispatch_generation;
+static volatile gint    sampled_generation;
+
+/* Written by the signal handler and read by the watchdog */
+static volatile gint    sample_ready;
+static gpointer         sample_frames [MAX_FRAMES];
+static gint             sample_n_frames;
+static gchar            sample_source [MAX_SOURCE_NAME];
+
+static gboolean
+ide_stall_monitor_prepare (GSource *source,
+                           gint    *timeout)
+{
+  gint64 begin = dispatch_begin;
+
+  *timeout = -1;
+
+  if (begin != 0)
+    {
+      gint64 elapsed = g_get_monotonic_time () - begin;
+
+      dispatch_begin = 0;
+
+      EGG_HISTOGRAM_RECORD (dispatch_latency, elapsed);
+
+      if (elapsed >= threshold)
+        {
+          EGG_COUNTER_INC (stalls);
+
+          if (g_atomic_int_get (&sampled_generation) == g_atomic_int_get (&dispatch_generation))
+            g_message ("Main loop was blocked for %"G_GINT64_FORMAT" msec",
+                       elapsed / 1000);
+        }
+    }
+
+  return FALSE;
+}
+
+static gboolean
+ide_stall_monitor_check (GSource *source)
+{
+  dispatch_begin = g_get_monotonic_time ();
+  g_atomic_int_inc (&dispatch_generation);
+
+  return FALSE;
+}
+
+static gboolean
+ide_stall_monitor_dispatch (GSource     *source,
+                            GSourceFunc  callback,
+                            gpointer     user_data)
+{
+  return G_SOURCE_CONTINUE;
+}
+
+static GSourceFuncs heartbeat_funcs = {
+  ide_stall_monitor_prepare,
+  ide_stall_monitor_check,
+  ide_stall_monitor_dispatch,
+};
+
+/*
+ * This runs on the main thread while it is stalled, so it may only do
+ * things that are safe within a signal handler. g_main_current_source()
+ * only reads thread-local state which exists once anything has been
+ * dispatched, and backtrace() was primed in _ide_stall_monitor_init() so
+ * that it does not need to load libgcc here.
+ */
+static void
+ide_stall_monitor_signal_handler (int signum)
+{
+  GSource *source;
+  const gchar *name = NULL;
+  gint saved_errno = errno;
+  guint i = 0;
+
+#ifdef HAVE_EXECINFO_H
+  sample_n_frames = backtrace (sample_frames, G_N_ELEMENTS (sample_frames));
+#endif
+
+  if (NULL != (source = g_main_current_source ()))
+    name = g_source_get_name (source);
+
+  if (name != NULL)
+    {
+      for (i = 0; i < sizeof sample_source - 1 && name [i]; i++)
+        sample_source [i] = name [i];
+    }
+
+  sample_source [i] = '\0';
+
+  g_atomic_int_set (&sample_ready, TRUE);
+
+  errno = saved_errno;
+}
+
+static void
+ide_stall_monitor_report (gint64 begin)
+{
+  g_autoptr(GString) str = NULL;
+  guint i;
+
+  g_atomic_int_set (&sample_ready, FALSE);
+
+  if (pthread_kill (main_thread, stall_signal) != 0)
+    return;
+
+  /* Give the main thread a chance to run the handler */
+  for (i = 0; i < 100 && !g_atomic_int_get (&sample_ready); i++)
+    g_usleep (G_USEC_PER_SEC / 1000);
+
+  str = g_string_new (NULL);
+
+  g_string_append_printf (str,
+                          "Main loop has been blocked for %"G_GINT64_FORMAT" msec",
+                          (g_get_monotonic_time () - begin) / 1000);
+
+  if (!g_atomic_int_get (&sample_ready))
+    {
+      g_warning ("%s", str->str);
+      return;
+    }
+
+  g_string_append_printf (str, " while dispatching %s",
+                          sample_source [0] ? sample_source : "an unnamed source");
+
+#ifdef HAVE_EXECINFO_H
+  {
+    gchar **symbols;
+
+    /* Skip the signal handler frame */
+    if (NULL != (symbols = backtrace_symbols (sample_frames, sample_n_frames)))
+      {
+        for (i = 1; i < (guint)sample_n_frames; i++)
+          g_string_append_printf (str, "\n  #%-2u %s", i - 1, symbols [i]);
+        free (symbols);
+      }
+  }
+#endif
+
+  g_warning ("%s", str->str);
+}
+
+static gpointer
+ide_stall_monitor_worker (gpointer data)
+{
+  guint reported = 0;
+
+  for (;;)
+    {
+      gint64 begin;
+      guint generation;
+
+      g_usleep (threshold / 4);
+
+      generation = g_atomic_int_get (&dispatch_generation);
+      begin = dispatch_begin;
+
+      if (begin == 0 ||
+          generation == reported ||
+          generation != (guint)g_atomic_int_get (&dispatch_generation) ||
+          g_get_monotonic_time () - begin < threshold)
+        continue;
+
+      /* Only sample each stalled iteration once */
+      reported = generation;
+      g_atomic_int_set (&sampled_generation, generation);
+
+      ide_stall_monitor_report (begin);
+    }
+
+  return NULL;
+}
+
+/**
+ * _ide_stall_monitor_init:
+ *
+ * Starts monitoring the default main context for stalls if the
+ * IDE_STALL_THRESHOLD environment variable is set.
+ *
+ * This must be called from the main thread.
+ */
+void
+_ide_stall_monitor_init (void)
+{
+  static gsize initialized;
+
+  if (g_once_init_enter (&initialized))
+    {
+      struct sigaction sa = { 0 };
+      const gchar *env;
+      GSource *source;
+      gint64 msec;
+
+      if (NULL == (env = g_getenv ("IDE_STALL_THRESHOLD")) ||
+          (msec = g_ascii_strtoll (env, NULL, 10)) <= 0)
+        goto finish;
+
+#ifdef HAVE_EXECINFO_H
+      /* Load the unwinder now rather than from the signal handler */
+      sample_n_frames = backtrace (sample_frames, G_N_ELEMENTS (sample_frames));
+#endif
+
+      threshold = msec * 1000;
+      main_thread = pthread_self ();
+
+#ifdef SIGRTMIN
+      stall_signal = SIGRTMIN + 4;
+#else
+      stall_signal = SIGURG;
+#endif
+
+      sa.sa_handler = ide_stall_monitor_signal_handler;
+      sa.sa_flags = SA_RESTART;
+      sigemptyset (&sa.sa_mask);
+
+      if (sigaction (stall_signal, &sa, NULL) != 0)
+        {
+          g_warning ("Failed to install stall signal handler: %s", g_strerror (errno));
+          goto finish;
+        }
+
+      source = g_source_new (&heartbeat_funcs, sizeof (GSource));
+      g_source_set_name (source, "[ide-stall-monitor]");
+      g_source_set_priority (source, G_MININT);
+      g_source_attach (source, NULL);
+      g_source_unref (source);
+
+      g_thread_unref (g_thread_new ("ide-stall-monitor", ide_stall_monitor_worker, NULL));
+
+      g_message ("Reporting main loop stalls longer than %"G_GINT64_FORMAT" msec", msec);
+
+    finish:
+      g_once_init_leave (&initialized, TRUE);
+    }
+}
@@ -0,0 +1,937 @@
+/* ide-text-structure.c
+ *
+ * Copyright (C) 2016 Christian Hergert <chergert@redhat.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define G_LOG_DOMAIN "ide-text-structure"
+
+#include <string.h>
+
+#include "egg-counter.h"
+
+#include "ide-text-structure.h"
+
+/*
+ * The text structure is a per-buffer index used by the source view
+ * movements to avoid walking the buffer a character at a time.
+ *
+ * For every line we keep, for each bracket kind, the net bracket count of
+ * the line (opening brackets count +1, closing brackets -1) along with the
+ * lowest running count seen while walking the line. This is enough to know
+ * whether a depth reaches zero within the line, in either direction, since
+ * the highest running count walking backwards is sum - min_prefix. We also
+ * keep a bitmask of the markers (#, comment delimiters) found on the line.
+ *
+ * Lines are grouped in blocks, and a segment tree over the blocks combines
+ * those summaries so that finding the line where a depth reaches zero, or
+ * the next line with a marker, takes logarithmic time. Only the lines that
+ * contain the match are then scanned a character at a time.
+ *
+ * Edits invalidate the edited lines, which are rescanned lazily on the next
+ * query. If the edit did not change the number of lines we only update the
+ * path to the root for the affected blocks, otherwise the tree is rebuilt
+ * from the (mostly cached) line summaries.
+ */
+
+#define STRUCTURE_KEY "IDE_TEXT_STRUCTURE"
+#define BLOCK_SHIFT   4
+#define BLOCK_SIZE    (1 << BLOCK_SHIFT)
+
+enum {
+  KIND_PAREN,
+  KIND_BRACKET,
+  KIND_BRACE,
+  N_KINDS
+};
+
+typedef struct
+{
+  gint32 sum [N_KINDS];
+  gint32 min_prefix [N_KINDS];
+  guint8 markers;
+  guint8 valid;
+} Summary;
+
+struct _IdeTextStructure
+{
+  /* Weak pointer, the structure is owned by the buffer */
+  GtkTextBuffer *buffer;
+
+  /* Summary of each line */
+  GArray        *lines;
+
+  /* Segment tree over the blocks of lines, the root is at index 1 */
+  GArray        *tree;
+  guint          n_leaves;
+
+  /* Range of lines that need to be rescanned */
+  gint           dirty_begin;
+  gint           dirty_end;
+
+  guint          needs_rebuild : 1;
+};
+
+EGG_DEFINE_COUNTER (lines_scanned, "IdeTextStructure", "Lines Scanned", "Number of lines scanned by the text structure index")
+
+static const Summary empty_summary;
+
+static inline gint
+get_kind (gunichar open_char,
+          gunichar close_char)
+{
+  if (open_char == '(' && close_char == ')')
+    return KIND_PAREN;
+  else if (open_char == '[' && close_char == ']')
+    return KIND_BRACKET;
+  else if (open_char == '{' && close_char == '}')
+    return KIND_BRACE;
+  else
+    return -1;
+}
+
+static inline void
+summary_combine (Summary       *dest,
+                 const Summary *left,
+                 const Summary *right)
+{
+  guint i;
+
+  for (i = 0; i < N_KINDS; i++)
+    {
+      dest->min_prefix [i] = MIN (left->min_prefix [i], left->sum [i] + right->min_prefix [i]);
+      dest->sum [i] = left->sum [i] + right->sum [i];
+    }
+
+  dest->markers = left->markers | right->markers;
+}
+
+static void
+ide_text_structure_scan_line (IdeTextStructure *self,
+                              gint              line,
+                              Summary          *summary)
+{
+  g_autofree gchar *text = NULL;
+  GtkTextIter begin;
+  GtkTextIter end;
+  const gchar *c;
+
+  g_assert (self != NULL);
+  g_assert (summary != NULL);
+
+  EGG_COUNTER_INC (lines_scanned);
+
+  *summary = empty_summary;
+  summary->valid = TRUE;
+
+  gtk_text_buffer_get_iter_at_line (self->buffer, &begin, line);
+  end = begin;
+  if (!gtk_text_iter_ends_line (&end))
+    gtk_text_iter_forward_to_line_end (&end);
+
+  text = gtk_text_iter_get_slice (&begin, &end);
+
+  /* Everything we look for is ASCII, so we can walk the bytes */
+  for (c = text; *c; c++)
+    {
+      gint kind;
+      gint delta = 1;
+
+      switch (*c)
+        {
+        case '(': kind = KIND_PAREN; break;
+        case ')': kind = KIND_PAREN; delta = -1; break;
+        case '[': kind = KIND_BRACKET; break;
+        case ']': kind = KIND_BRACKET; delta = -1; break;
+        case '{': kind = KIND_BRACE; break;
+        case '}': kind = KIND_BRACE; delta = -1; break;
+
+        case '#':
+          summary->markers |= IDE_TEXT_STRUCTURE_HASH;
+          continue;
+
+        case '/':
+          if (c [1] == '*')
+            summary->markers |= IDE_TEXT_STRUCTURE_COMMENT_START;
+          if (c > text && c [-1] == '*')
+            summary->markers |= IDE_TEXT_STRUCTURE_COMMENT_END;
+          continue;
+
+        default:
+          continue;
+        }
+
+      summary->sum [kind] += delta;
+      summary->min_prefix [kind] = MIN (summary->min_prefix [kind], summary->sum [kind]);
+    }
+}
+
+static void
+ide_text_structure_update_leaf (IdeTextStructure *self,
+                                guint             block)
+{
+  Summary *leaf;
+  guint begin;
+  guint end;
+  guint i;
+
+  g_assert (self != NULL);
+  g_assert (block < self->n_leaves);
+
+  leaf = &g_array_index (self->tree, Summary, self->n_leaves + block);
+  *leaf = empty_summary;
+
+  begin = block << BLOCK_SHIFT;
+  end = MIN (self->lines->len, begin + BLOCK_SIZE);
+
+  for (i = begin; i < end; i++)
+    summary_combine (leaf, leaf, &g_array_index (self->lines, Summary, i));
+}
+
+static void
+ide_text_structure_rebuild (IdeTextStructure *self)
+{
+  guint n_blocks;
+  guint i;
+
+  g_assert (self != NULL);
+
+  n_blocks = (self->lines->len + BLOCK_SIZE - 1) >> BLOCK_SHIFT;
+
+  self->n_leaves = 1;
+  while (self->n_leaves < n_blocks)
+    self->n_leaves <<= 1;
+
+  g_array_set_size (self->tree, 0);
+  g_array_set_size (self->tree, self->n_leaves * 2);
+
+  for (i = 0; i < n_blocks; i++)
+    ide_text_structure_update_leaf (self, i);
+
+  for (i = self->n_leaves - 1; i > 0; i--)
+    summary_combine (&g_array_index (self->tree, Summary, i),
+                     &g_array_index (self->tree, Summary, i * 2),
+                     &g_array_index (self->tree, Summary, i * 2 + 1));
+
+  self->needs_rebuild = FALSE;
+}
+
+static void
+ide_text_structure_update_block (IdeTextStructure *self,
+                                 guint             block)
+{
+  guint i;
+
+  g_assert (self != NULL);
+
+  ide_text_structure_update_leaf (self, block);
+
+  for (i = (self->n_leaves + block) / 2; i > 0; i /= 2)
+    summary_combine (&g_array_index (self->tree, Summary, i),
+                     &g_array_index (self->tree, Summary, i * 2),
+                     &g_array_index (self->tree, Summary, i * 2 + 1));
+}
+
+static void
+ide_text_structure_invalidate (IdeTextStructure *self,
+                               gint              begin,
+                               gint              end)
+{
+  gint i;
+
+  g_assert (self != NULL);
+
+  begin = CLAMP (begin, 0, (gint)self->lines->len);
+  end = CLAMP (end, begin, (gint)self->lines->len);
+
+  if (begin == end)
+    return;
+
+  for (i = begin; i < end; i++)
+    g_array_index (self->lines, Summary, i).valid = FALSE;
+
+  if (self->dirty_begin == self->dirty_end)
+    {
+      self->dirty_begin = begin;
+      self->dirty_end = end;
+    }
+  else
+    {
+      self->dirty_begin = MIN (self->dirty_begin, begin);
+      self->dirty_end = MAX (self->dirty_end, end);
+    }
+}
+
+/*
+ * Adds or removes @delta lines after @position, keeping the summaries of
+ * the lines that were not touched by the edit.
+ */
+static void
+ide_text_structure_splice (IdeTextStructure *self,
+                           gint              position,
+                           gint              delta)
+{
+  g_assert (self != NULL);
+
+  if (delta == 0)
+    return;
+
+  position = CLAMP (position, 0, (gint)self->lines->len);
+
+  if (delta > 0)
+    {
+      g_autofree Summary *added = g_new0 (Summary, delta);
+
+      g_array_insert_vals (self->lines, position, added, delta);
+
+      if (self->dirty_begin != self->dirty_end && self->dirty_end > position)
+        self->dirty_end += delta;
+    }
+  else
+    {
+      delta = MIN (-delta, (gint)self->lines->len - position);
+      g_array_remove_range (self->lines, position, delta);
+
+      /*
+       * Dirty lines below the removed block moved up by @delta, and those
+       * within it are gone, so the range collapses onto @position.
+       */
+      if (self->dirty_begin != self->dirty_end)
+        {
+          if (self->dirty_begin > position)
+            self->dirty_begin = MAX (position, self->dirty_begin - delta);
+          if (self->dirty_end > position)
+            self->dirty_end = MAX (position, self->dirty_end - delta);
+
+          self->dirty_begin = MIN (self->dirty_begin, (gint)self->lines->len);
+          self->dirty_end = MIN (self->dirty_end, (gint)self->lines->len);
+        }
+    }
+
+  self->needs_rebuild = TRUE;
+}
+
+static void
+ide_text_structure_insert_text (IdeTextStructure *self,
+                                GtkTextIter      *location,
+                                const gchar      *text,
+                                gint              len,
+                                GtkTextBuffer    *buffer)
+{
+  gint end_line;
+  gint begin_line;
+  gint delta;
+
+  g_assert (self != NULL);
+  g_assert (location != NULL);
+
+  /* Not yet populated, nothing to track */
+  if (self->lines->len == 0)
+    return;
+
+  /* @location has been revalidated to the end of the inserted text */
+  end_line = gtk_text_iter_get_line (location);
+  delta = gtk_text_buffer_get_line_count (buffer) - (gint)self->lines->len;
+
+  /*
+   * A \r\n pair may have been joined or split by the insertion, so be
+   * generous about the lines we consider touched.
+   */
+  begin_line = MAX (0, end_line - MAX (0, delta) - 1);
+
+  ide_text_structure_splice (self, begin_line + 1, delta);
+  ide_text_structure_invalidate (self, begin_line, end_line + 2);
+}
+
+static void
+ide_text_structure_delete_range (IdeTextStructure *self,
+                                 GtkTextIter      *begin,
+                                 GtkTextIter      *end,
+                                 GtkTextBuffer    *buffer)
+{
+  gint line;
+  gint delta;
+
+  g_assert (self != NULL);
+  g_assert (begin != NULL);
+  g_assert (end != NULL);
+
+  if (self->lines->len == 0)
+    return;
+
+  /* Both iters have been revalidated to the deletion point */
+  line = gtk_text_iter_get_line (begin);
+  delta = gtk_text_buffer_get_line_count (buffer) - (gint)self->lines->len;
+
+  ide_text_structure_splice (self, line + 1, delta);
+  ide_text_structure_invalidate (self, line - 1, line + 2);
+}
+
+static void
+ide_text_structure_ensure (IdeTextStructure *self)
+{
+  gint line_count;
+  gint i;
+
+  g_assert (self != NULL);
+
+  line_count = gtk_text_buffer_get_line_count (self->buffer);
+
+  /* First use (or something we failed to track), start over */
+  if ((gint)self->lines->len != line_count)
+    {
+      g_array_set_size (self->lines, 0);
+      g_array_set_size (self->lines, line_count);
+      self->dirty_begin = 0;
+      self->dirty_end = line_count;
+      self->needs_rebuild = TRUE;
+    }
+
+  for (i = self->dirty_begin; i < self->dirty_end; i++)
+    {
+      Summary *summary = &g_array_index (self->lines, Summary, i);
+
+      if (!summary->valid)
+        ide_text_structure_scan_line (self, i, summary);
+    }
+
+  if (self->needs_rebuild)
+    {
+      ide_text_structure_rebuild (self);
+    }
+  else if (self->dirty_begin != self->dirty_end)
+    {
+      guint block;
+
+      for (block = self->dirty_begin >> BLOCK_SHIFT;
+           block <= (guint)(self->dirty_end - 1) >> BLOCK_SHIFT;
+           block++)
+        ide_text_structure_update_block (self, block);
+    }
+
+  self->dirty_begin = 0;
+  self->dirty_end = 0;
+}
+
+static gint
+tree_find_forward (IdeTextStructure *self,
+                   guint             node,
+                   guint             lo,
+                   guint             hi,
+                   guint             from,
+                   gint              kind,
+                   gint             *depth)
+{
+  const Summary *summary = &g_array_index (self->tree, Summary, node);
+  guint mid;
+  gint ret;
+
+  if (hi <= from)
+    return -1;
+
+  if (lo >= from)
+    {
+      if (*depth + summary->min_prefix [kind] > 0)
+        {
+          *depth += summary->sum [kind];
+          return -1;
+        }
+
+      if (hi - lo == 1)
+        return lo;
+    }
+
+  mid = lo + (hi - lo) / 2;
+
+  if (-1 != (ret = tree_find_forward (self, node * 2, lo, mid, from, kind, depth)))
+    return ret;
+
+  return tree_find_forward (self, node * 2 + 1, mid, hi, from, kind, depth);
+}
+
+static gint
+tree_find_backward (IdeTextStructure *self,
+                    guint             node,
+                    guint             lo,
+                    guint             hi,
+                    guint             to,
+                    gint              kind,
+                    gint             *depth)
+{
+  const Summary *summary = &g_array_index (self->tree, Summary, node);
+  guint mid;
+  gint ret;
+
+  if (lo >= to)
+    return -1;
+
+  if (hi <= to)
+    {
+      if (*depth - (summary->sum [kind] - summary->min_prefix [kind]) > 0)
+        {
+          *depth -= summary->sum [kind];
+          return -1;
+        }
+
+      if (hi - lo == 1)
+        return lo;
+    }
+
+  mid = lo + (hi - lo) / 2;
+
+  if (-1 != (ret = tree_find_backward (self, node * 2 + 1, mid, hi, to, kind, depth)))
+    return ret;
+
+  return tree_find_backward (self, node * 2, lo, mid, to, kind, depth);
+}
+
+static gint
+tree_find_marker_forward (IdeTextStructure *self,
+                          guint             node,
+                          guint             lo,
+                          guint             hi,
+                          guint             from,
+                          guint             marker)
+{
+  const Summary *summary = &g_array_index (self->tree, Summary, node);
+  guint mid;
+  gint ret;
+
+  if (hi <= from || !(summary->markers & marker))
+    return -1;
+
+  if (hi - lo == 1)
+    return lo;
+
+  mid = lo + (hi - lo) / 2;
+
+  if (-1 != (ret = tree_find_marker_forward (self, node * 2, lo, mid, from, marker)))
+    return ret;
+
+  return tree_find_marker_forward (self, node * 2 + 1, mid, hi, from, marker);
+}
+
+static gint
+tree_find_marker_backward (IdeTextStructure *self,
+                           guint             node,
+                           guint             lo,
+                           guint             hi,
+                           guint             to,
+                           guint             marker)
+{
+  const Summary *summary = &g_array_index (self->tree, Summary, node);
+  guint mid;
+  gint ret;
+
+  if (lo >= to || !(summary->markers & marker))
+    return -1;
+
+  if (hi - lo == 1)
+    return lo;
+
+  mid = lo + (hi - lo) / 2;
+
+  if (-1 != (ret = tree_find_marker_backward (self, node * 2 + 1, mid, hi, to, marker)))
+    return ret;
+
+  return tree_find_marker_backward (self, node * 2, lo, mid, to, marker);
+}
+
+/*
+ * Finds the first line at or after @from in which @depth reaches zero,
+ * updating @depth to the depth at the start of that line.
+ */
+static gint
+find_line_forward (IdeTextStructure *self,
+                   gint              from,
+                   gint              kind,
+                   gint             *depth)
+{
+  gint block_end;
+  gint block;
+  gint i;
+
+  if (from >= (gint)self->lines->len)
+    return -1;
+
+  block_end = MIN ((gint)self->lines->len, (from | (BLOCK_SIZE - 1)) + 1);
+
+  for (i = from; i < block_end; i++)
+    {
+      const Summary *summary = &g_array_index (self->lines, Summary, i);
+
+      if (*depth + summary->min_prefix [kind] <= 0)
+        return i;
+
+      *depth += summary->sum [kind];
+    }
+
+  block = tree_find_forward (self, 1, 0, self->n_leaves, (from >> BLOCK_SHIFT) + 1, kind, depth);
+  if (block < 0)
+    return -1;
+
+  for (i = block << BLOCK_SHIFT; i < (gint)self->lines->len; i++)
+    {
+      const Summary *summary = &g_array_index (self->lines, Summary, i);
+
+      if (*depth + summary->min_prefix [kind] <= 0)
+        return i;
+
+      *depth += summary->sum [kind];
+    }
+
+  g_return_val_if_reached (-1);
+}
+
+/*
+ * Finds the last line at or before @from in which @depth reaches zero when
+ * walking backwards, updating @depth to the depth at the end of that line.
+ */
+static gint
+find_line_backward (IdeTextStructure *self,
+                    gint              from,
+                    gint              kind,
+                    gint             *depth)
+{
+  gint block_begin;
+  gint block;
+  gint i;
+
+  if (from < 0)
+    return -1;
+
+  block_begin = from & ~(BLOCK_SIZE - 1);
+
+  for (i = from; i >= block_begin; i--)
+    {
+      const Summary *summary = &g_array_index (self->lines, Summary, i);
+
+      if (*depth - (summary->sum [kind] - summary->min_prefix [kind]) <= 0)
+        return i;
+
+      *depth -= summary->sum [kind];
+    }
+
+  block = tree_find_backward (self, 1, 0, self->n_leaves, block_begin >> BLOCK_SHIFT, kind, depth);
+  if (block < 0)
+    return -1;
+
+  for (i = MIN ((gint)self->lines->len, (block + 1) << BLOCK_SHIFT) - 1; i >= 0; i--)
+    {
+      const Summary *summary = &g_array_index (self->lines, Summary, i);
+
+      if (*depth - (summary->sum [kind] - summary->min_prefix [kind]) <= 0)
+        return i;
+
+      *depth -= summary->sum [kind];
+    }
+
+  g_return_val_if_reached (-1);
+}
+
+static inline gboolean
+update_depth (gunichar  ch,
+              gunichar  open_char,
+              gunichar  close_char,
+              gint      direction,
+              gint     *depth)
+{
+  if (ch == open_char)
+    *depth += direction;
+  else if (ch == close_char)
+    *depth -= direction;
+
+  return (*depth == 0);
+}
+
+/**
+ * _ide_text_structure_can_match:
+ *
+ * Checks if the pair of characters is indexed, only (), [] and {} are.
+ *
+ * Returns: %TRUE if _ide_text_structure_match_forward() and
+ *   _ide_text_structure_match_backward() may be used with the pair.
+ */
+gboolean
+_ide_text_structure_can_match (gunichar open_char,
+                               gunichar close_char)
+{
+  return get_kind (open_char, close_char) != -1;
+}
+
+/**
+ * _ide_text_structure_match_forward:
+ * @depth: the initial depth, must be positive
+ *
+ * Walks forward from @iter, excluding the character at @iter, adding 1 to
+ * @depth for each @open_char and removing 1 for each @close_char, until
+ * @depth reaches zero.
+ *
+ * Returns: %TRUE and moves @iter to the character that brought the depth
+ *   to zero, otherwise %FALSE and @iter is left untouched.
+ */
+gboolean
+_ide_text_structure_match_forward (IdeTextStructure *self,
+                                   GtkTextIter      *iter,
+                                   gunichar          open_char,
+                                   gunichar          close_char,
+                                   gint              depth)
+{
+  GtkTextIter cur;
+  gint kind;
+  gint line;
+
+  g_return_val_if_fail (self != NULL, FALSE);
+  g_return_val_if_fail (iter != NULL, FALSE);
+  g_return_val_if_fail (depth > 0, FALSE);
+
+  if (-1 == (kind = get_kind (open_char, close_char)))
+    return FALSE;
+
+  ide_text_structure_ensure (self);
+
+  line = gtk_text_iter_get_line (iter);
+  cur = *iter;
+
+  while (gtk_text_iter_forward_char (&cur) && gtk_text_iter_get_line (&cur) == line)
+    {
+      if (update_depth (gtk_text_iter_get_char (&cur), open_char, close_char, 1, &depth))
+        goto found;
+    }
+
+  if (-1 == (line = find_line_forward (self, line + 1, kind, &depth)))
+    return FALSE;
+
+  gtk_text_buffer_get_iter_at_line (self->buffer, &cur, line);
+
+  do
+    {
+      if (update_depth (gtk_text_iter_get_char (&cur), open_char, close_char, 1, &depth))
+        goto found;
+    }
+  while (gtk_text_iter_forward_char (&cur) && gtk_text_iter_get_line (&cur) == line);
+
+  g_return_val_if_reached (FALSE);
+
+found:
+  *iter = cur;
+
+  return TRUE;
+}
+
+/**
+ * _ide_text_structure_match_backward:
+ * @depth: the initial depth, must be positive
+ *
+ * Like _ide_text_structure_match_forward() but walks backward from @iter,
+ * adding 1 to @depth for each @close_char and removing 1 for each
+ * @open_char.
+ *
+ * Returns: %TRUE and moves @iter to the character that brought the depth
+ *   to zero, otherwise %FALSE and @iter is left untouched.
+ */
+gboolean
+_ide_text_structure_match_backward (IdeTextStructure *self,
+                                    GtkTextIter      *iter,
+                                    gunichar          open_char,
+                                    gunichar          close_char,
+                                    gint              depth)
+{
+  GtkTextIter cur;
+  gint kind;
+  gint line;
+
+  g_return_val_if_fail (self != NULL, FALSE);
+  g_return_val_if_fail (iter != NULL, FALSE);
+  g_return_val_if_fail (depth > 0, FALSE);
+
+  if (-1 == (kind = get_kind (open_char, close_char)))
+    return FALSE;
+
+  ide_text_structure_ensure (self);
+
+  line = gtk_text_iter_get_line (iter);
+  cur = *iter;
+
+  while (gtk_text_iter_backward_char (&cur) && gtk_text_iter_get_line (&cur) == line)
+    {
+      if (update_depth (gtk_text_iter_get_char (&cur), open_char, close_char, -1, &depth))
+        goto found;
+    }
+
+  if (-1 == (line = find_line_backward (self, line - 1, kind, &depth)))
+    return FALSE;
+
+  gtk_text_buffer_get_iter_at_line (self->buffer, &cur, line);
+  if (!gtk_text_iter_ends_line (&cur))
+    gtk_text_iter_forward_to_line_end (&cur);
+
+  while (gtk_text_iter_backward_char (&cur) && gtk_text_iter_get_line (&cur) == line)
+    {
+      if (update_depth (gtk_text_iter_get_char (&cur), open_char, close_char, -1, &depth))
+        goto found;
+    }
+
+  g_return_val_if_reached (FALSE);
+
+found:
+  *iter = cur;
+
+  return TRUE;
+}
+
+/**
+ * _ide_text_structure_next_line:
+ *
+ * Returns: the first line after @line containing @marker, or -1.
+ */
+gint
+_ide_text_structure_next_line (IdeTextStructure       *self,
+                               gint                    line,
+                               IdeTextStructureMarker  marker)
+{
+  gint block_end;
+  gint block;
+  gint i;
+
+  g_return_val_if_fail (self != NULL, -1);
+
+  ide_text_structure_ensure (self);
+
+  line = MAX (0, line + 1);
+
+  if (line >= (gint)self->lines->len)
+    return -1;
+
+  block_end = MIN ((gint)self->lines->len, (line | (BLOCK_SIZE - 1)) + 1);
+
+  for (i = line; i < block_end; i++)
+    {
+      if (g_array_index (self->lines, Summary, i).markers & marker)
+        return i;
+    }
+
+  block = tree_find_marker_forward (self, 1, 0, self->n_leaves, (line >> BLOCK_SHIFT) + 1, marker);
+  if (block < 0)
+    return -1;
+
+  for (i = block << BLOCK_SHIFT; i < (gint)self->lines->len; i++)
+    {
+      if (g_array_index (self->lines, Summary, i).markers & marker)
+        return i;
+    }
+
+  g_return_val_if_reached (-1);
+}
+
+/**
+ * _ide_text_structure_previous_line:
+ *
+ * Returns: the last line before @line containing @marker, or -1.
+ */
+gint
+_ide_text_structure_previous_line (IdeTextStructure       *self,
+                                   gint                    line,
+                                   IdeTextStructureMarker  marker)
+{
+  gint block_begin;
+  gint block;
+  gint i;
+
+  g_return_val_if_fail (self != NULL, -1);
+
+  ide_text_structure_ensure (self);
+
+  line = MIN (line - 1, (gint)self->lines->len - 1);
+
+  if (line < 0)
+    return -1;
+
+  block_begin = line & ~(BLOCK_SIZE - 1);
+
+  for (i = line; i >= block_begin; i--)
+    {
+      if (g_array_index (self->lines, Summary, i).markers & marker)
+        return i;
+    }
+
+  block = tree_find_marker_backward (self, 1, 0, self->n_leaves, block_begin >> BLOCK_SHIFT, marker);
+  if (block < 0)
+    return -1;
+
+  for (i = MIN ((gint)self->lines->len, (block + 1) << BLOCK_SHIFT) - 1; i >= 0; i--)
+    {
+      if (g_array_index (self->lines, Summary, i).markers & marker)
+        return i;
+    }
+
+  g_return_val_if_reached (-1);
+}
+
+static void
+ide_text_structure_free (gpointer data)
+{
+  IdeTextStructure *self = data;
+
+  g_clear_pointer (&self->lines, g_array_unref);
+  g_clear_pointer (&self->tree, g_array_unref);
+  g_slice_free (IdeTextStructure, self);
+}
+
+/**
+ * _ide_text_structure_get_for_buffer:
+ * @buffer: A #GtkTextBuffer
+ *
+ * Gets the structure index for @buffer, creating it if necessary. The
+ * index is owned by @buffer and populated on first use.
+ *
+ * Returns: (transfer none): An #IdeTextStructure.
+ */
+IdeTextStructure *
+_ide_text_structure_get_for_buffer (GtkTextBuffer *buffer)
+{
+  IdeTextStructure *self;
+
+  g_return_val_if_fail (GTK_IS_TEXT_BUFFER (buffer), NULL);
+
+  if ((self = g_object_get_data (G_OBJECT (buffer), STRUCTURE_KEY)))
+    return self;
+
+  self = g_slice_new0 (IdeTextStructure);
+  self->buffer = buffer;
+  self->lines = g_array_new (FALSE, TRUE, sizeof (Summary));
+  self->tree = g_array_new (FALSE, TRUE, sizeof (Summary));
+
+  /*
+   * The handlers run after the default handler so that we can compare the
+   * new line count of the buffer with the one we have.
+   */
+  g_signal_connect_data (buffer,
+                         "insert-text",
+                         G_CALLBACK (ide_text_structure_insert_text),
+                         self,
+                         NULL,
+                         G_CONNECT_SWAPPED | G_CONNECT_AFTER);
+  g_signal_connect_data (buffer,
+                         "delete-range",
+                         G_CALLBACK (ide_text_structure_delete_range),
+                         self,
+                         NULL,
+                         G_CONNECT_SWAPPED | G_CONNECT_AFTER);
+
+  g_object_set_data_full (G_OBJECT (buffer), STRUCTURE_KEY, self, ide_text_structure_free);
+
+  return self;
+}
@@ -0,0 +1,57 @@
+/* ide-text-structure.h
+ *
+ * Copyright (C) 2016 Christian Hergert <chergert@redhat.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef IDE_TEXT_STRUCTURE_H
+#define IDE_TEXT_STRUCTURE_H
+
+#include <gtk/gtk.h>
+
+G_BEGIN_DECLS
+
+typedef struct _IdeTextStructure IdeTextStructure;
+
+typedef enum
+{
+  IDE_TEXT_STRUCTURE_HASH          = 1 << 0,
+  IDE_TEXT_STRUCTURE_COMMENT_START = 1 << 1,
+  IDE_TEXT_STRUCTURE_COMMENT_END   = 1 << 2,
+} IdeTextStructureMarker;
+
+IdeTextStructure *_ide_text_structure_get_for_buffer (GtkTextBuffer          *buffer);
+gboolean          _ide_text_structure_can_match      (gunichar                open_char,
+                                                      gunichar                close_char);
+gboolean          _ide_text_structure_match_forward  (IdeTextStructure       *self,
+                                                      GtkTextIter            *iter,
+                                                      gunichar                open_char,
+                                                      gunichar                close_char,
+                                                      gint                    depth);
+gboolean          _ide_text_structure_match_backward (IdeTextStructure       *self,
+                                                      GtkTextIter            *iter,
+                                                      gunichar                open_char,
+                                                      gunichar                close_char,
+                                                      gint                    depth);
+gint              _ide_text_structure_next_line      (IdeTextStructure       *self,
+                                                      gint                    line,
+                                                      IdeTextStructureMarker  marker);
+gint              _ide_text_structure_previous_line  (IdeTextStructure       *self,
+                                                      gint                    line,
+                                                      IdeTextStructureMarker  marker);
+
+G_END_DECLS
+
+#endif /* IDE_TEXT_STRUCTURE_H */
@@ -23,12 +23,50 @@
 #include "ide-debug.h"
 #include "ide-thread-pool.h"
 
-#define COMPILER_MAX_THREADS 4
-#define INDEXER_MAX_THREADS  1
+/*
+ * This is a small priority-aware executor shared by all thread pool kinds.
+ *
+ * Each worker thread has a local queue per priority. Work pushed from a
+ * worker thread (such as a task spawning a sub-task) is placed on that
+ * worker's local queue and popped LIFO by its owner for cache locality.
+ * Idle workers steal from the other end of those queues. Work pushed from
+ * any other thread goes to the shared injection queues.
+ *
+ * Workers always take the highest priority work available, subject to a
+ * per-kind concurrency limit (we do not want to run too many indexers at
+ * once and saturate the disk). One worker is kept free of background and
+ * idle work so that interactive requests never wait behind a long ctags
+ * or makecache job.
+ *
+ * Tasks with a #GCancellable are removed from the queue and completed as
+ * soon as the cancellable is triggered if they have not yet started.
+ */
+
+#define MIN_WORKERS 2
+#define MAX_WORKERS 16
+
+typedef enum
+{
+  WORK_ITEM_NEW,
+  WORK_ITEM_QUEUED,
+  WORK_ITEM_RUNNING,
+  WORK_ITEM_CANCELLED,
+} WorkItemState;
+
+typedef struct _Worker Worker;
 
 typedef struct
 {
-  int type;
+  volatile gint          ref_count;
+  int                    type;
+  IdeThreadPoolKind      kind;
+  IdeThreadPoolPriority  priority;
+  WorkItemState          state;
+  GQueue                *queue;
+  GList                  link;
+  GCancellable          *cancellable;
+  gulong                 cancelled_handler;
+  gint64                 queued_at;
   union {
     struct {
       GTask           *task;
@@ -41,179 +79,582 @@ typedef struct
   };
 } WorkItem;
 
+struct _Worker
+{
+  GThread *thread;
+  guint    id;
+  GQueue   local [IDE_THREAD_POOL_PRIORITY_LAST];
+};
+
+typedef struct
+{
+  GMutex   mutex;
+  GCond    cond;
+  GQueue   global [IDE_THREAD_POOL_PRIORITY_LAST];
+  Worker  *workers;
+  guint    n_workers;
+  guint    n_queued;
+  guint    n_running_low_priority;
+  guint    n_running [IDE_THREAD_POOL_LAST];
+  guint    max_running [IDE_THREAD_POOL_LAST];
+} Executor;
+
 EGG_DEFINE_COUNTER (TotalTasks, "ThreadPool", "Total Tasks", "Total number of tasks processed.")
 EGG_DEFINE_COUNTER (QueuedTasks, "ThreadPool", "Queued Tasks", "Current number of pending tasks.")
+EGG_DEFINE_COUNTER (QueuedInteractive, "ThreadPool", "Queued Interactive", "Current number of pending interactive tasks.")
+EGG_DEFINE_COUNTER (QueuedBackground, "ThreadPool", "Queued Background", "Current number of pending background tasks.")
+EGG_DEFINE_COUNTER (QueuedIdle, "ThreadPool", "Queued Idle", "Current number of pending idle tasks.")
+EGG_DEFINE_COUNTER (CancelledTasks, "ThreadPool", "Cancelled Tasks", "Number of tasks cancelled before they started.")
+EGG_DEFINE_COUNTER (StolenTasks, "ThreadPool", "Stolen Tasks", "Number of tasks stolen from another worker.")
+EGG_DEFINE_COUNTER (QueueLatency, "ThreadPool", "Queue Latency", "Total time in usec that tasks waited to be started.")
+EGG_DEFINE_COUNTER (InteractiveLatency, "ThreadPool", "Interactive Latency", "Total time in usec that interactive tasks waited to be started.")
 
-static GThreadPool *thread_pools [IDE_THREAD_POOL_LAST];
+static Executor *executor;
+static GPrivate current_worker;
 
 enum {
   TYPE_TASK,
   TYPE_FUNC,
 };
 
-static inline GThreadPool *
-ide_thread_pool_get_pool (IdeThreadPoolKind kind)
+static inline void
+counter_add_queued (IdeThreadPoolPriority priority,
+                    gint                  count)
+{
+  EGG_COUNTER_ADD (QueuedTasks, count);
+
+  switch (priority)
+    {
+    case IDE_THREAD_POOL_PRIORITY_INTERACTIVE:
+      EGG_COUNTER_ADD (QueuedInteractive, count);
+      break;
+
+    case IDE_THREAD_POOL_PRIORITY_BACKGROUND:
+      EGG_COUNTER_ADD (QueuedBackground, count);
+      break;
+
+    case IDE_THREAD_POOL_PRIORITY_IDLE:
+      EGG_COUNTER_ADD (QueuedIdle, count);
+      break;
+
+    case IDE_THREAD_POOL_PRIORITY_LAST:
+    default:
+      g_assert_not_reached ();
+    }
+}
+
+static IdeThreadPoolPriority
+get_default_priority (IdeThreadPoolKind kind)
+{
+  switch (kind)
+    {
+    case IDE_THREAD_POOL_COMPILER:
+      return IDE_THREAD_POOL_PRIORITY_BACKGROUND;
+
+    case IDE_THREAD_POOL_INDEXER:
+      return IDE_THREAD_POOL_PRIORITY_IDLE;
+
+    case IDE_THREAD_POOL_LAST:
+    default:
+      g_return_val_if_reached (IDE_THREAD_POOL_PRIORITY_BACKGROUND);
+    }
+}
+
+static WorkItem *
+work_item_ref (WorkItem *work_item)
+{
+  g_assert (work_item != NULL);
+  g_assert (work_item->ref_count > 0);
+
+  g_atomic_int_inc (&work_item->ref_count);
+
+  return work_item;
+}
+
+static void
+work_item_unref (gpointer data)
+{
+  WorkItem *work_item = data;
+
+  g_assert (work_item != NULL);
+  g_assert (work_item->ref_count > 0);
+
+  if (g_atomic_int_dec_and_test (&work_item->ref_count))
+    {
+      if (work_item->type == TYPE_TASK)
+        g_clear_object (&work_item->task.task);
+      g_clear_object (&work_item->cancellable);
+      g_slice_free (WorkItem, work_item);
+    }
+}
+
+/*
+ * Must be called with the executor lock held.
+ */
+static void
+work_item_unqueue_locked (WorkItem *work_item)
+{
+  g_assert (work_item != NULL);
+  g_assert (work_item->state == WORK_ITEM_QUEUED);
+  g_assert (work_item->queue != NULL);
+
+  g_queue_unlink (work_item->queue, &work_item->link);
+  work_item->queue = NULL;
+  executor->n_queued--;
+
+  counter_add_queued (work_item->priority, -1);
+}
+
+static void
+work_item_cancelled_cb (GCancellable *cancellable,
+                        WorkItem     *work_item)
+{
+  gboolean complete = FALSE;
+  gulong handler_id = 0;
+
+  g_assert (G_IS_CANCELLABLE (cancellable));
+  g_assert (work_item != NULL);
+
+  g_mutex_lock (&executor->mutex);
+
+  if (work_item->state == WORK_ITEM_QUEUED)
+    {
+      work_item_unqueue_locked (work_item);
+      work_item->state = WORK_ITEM_CANCELLED;
+      handler_id = work_item->cancelled_handler;
+      work_item->cancelled_handler = 0;
+      complete = TRUE;
+    }
+  else if (work_item->state == WORK_ITEM_NEW)
+    {
+      /* The pusher will notice and complete the task */
+      work_item->state = WORK_ITEM_CANCELLED;
+    }
+
+  g_mutex_unlock (&executor->mutex);
+
+  if (complete)
+    {
+      /*
+       * The handler owns a reference to the work item, which in turn owns
+       * the cancellable. g_cancellable_disconnect() would deadlock from
+       * within the handler, so drop the signal handler directly. The
+       * closure (and its reference) is released once emission completes.
+       */
+      if (handler_id != 0)
+        g_signal_handler_disconnect (cancellable, handler_id);
+
+      EGG_COUNTER_INC (CancelledTasks);
+      g_task_return_error_if_cancelled (work_item->task.task);
+
+      /* Release the reference owned by the queue */
+      work_item_unref (work_item);
+    }
+}
+
+static void
+ide_thread_pool_push_item (WorkItem *work_item)
+{
+  Worker *worker;
+  GQueue *queue;
+
+  g_assert (work_item != NULL);
+  g_assert (executor != NULL);
+
+  EGG_COUNTER_INC (TotalTasks);
+
+  work_item->link.data = work_item;
+  work_item->queued_at = g_get_monotonic_time ();
+
+  if (work_item->cancellable != NULL)
+    work_item->cancelled_handler =
+      g_cancellable_connect (work_item->cancellable,
+                             G_CALLBACK (work_item_cancelled_cb),
+                             work_item_ref (work_item),
+                             work_item_unref);
+
+  g_mutex_lock (&executor->mutex);
+
+  if (work_item->state == WORK_ITEM_CANCELLED)
+    {
+      g_mutex_unlock (&executor->mutex);
+
+      /*
+       * If the cancellable was already cancelled, the handler has been run
+       * and released by g_cancellable_connect() and the id is zero.
+       */
+      if (work_item->cancelled_handler != 0)
+        {
+          g_cancellable_disconnect (work_item->cancellable, work_item->cancelled_handler);
+          work_item->cancelled_handler = 0;
+        }
+
+      EGG_COUNTER_INC (CancelledTasks);
+      g_task_return_error_if_cancelled (work_item->task.task);
+      work_item_unref (work_item);
+      return;
+    }
+
+  /*
+   * Sub-tasks pushed from a worker stay on that worker for locality, but
+   * may be stolen by any other idle worker.
+   */
+  if ((worker = g_private_get (&current_worker)))
+    queue = &worker->local [work_item->priority];
+  else
+    queue = &executor->global [work_item->priority];
+
+  work_item->state = WORK_ITEM_QUEUED;
+  work_item->queue = queue;
+  g_queue_push_tail_link (queue, &work_item->link);
+  executor->n_queued++;
+
+  counter_add_queued (work_item->priority, 1);
+
+  g_cond_signal (&executor->cond);
+
+  g_mutex_unlock (&executor->mutex);
+
+  /* The queue now owns the reference */
+}
+
+static inline gboolean
+can_run_locked (WorkItem *work_item)
+{
+  if (executor->n_running [work_item->kind] >= executor->max_running [work_item->kind])
+    return FALSE;
+
+  /* Keep one worker available for interactive work */
+  if (work_item->priority != IDE_THREAD_POOL_PRIORITY_INTERACTIVE &&
+      executor->n_running_low_priority + 1 >= executor->n_workers)
+    return FALSE;
+
+  return TRUE;
+}
+
+static WorkItem *
+find_runnable_locked (GQueue   *queue,
+                      gboolean  from_tail)
+{
+  GList *iter;
+
+  for (iter = from_tail ? queue->tail : queue->head;
+       iter != NULL;
+       iter = from_tail ? iter->prev : iter->next)
+    {
+      WorkItem *work_item = iter->data;
+
+      if (can_run_locked (work_item))
+        return work_item;
+    }
+
+  return NULL;
+}
+
+/*
+ * Locates the next work item for @worker, in priority order, preferring
+ * the worker's own queue, then the injection queue and lastly stealing
+ * from the other workers.
+ *
+ * Must be called with the executor lock held.
+ */
+static WorkItem *
+next_work_item_locked (Worker *worker)
+{
+  guint priority;
+
+  if (executor->n_queued == 0)
+    return NULL;
+
+  for (priority = 0; priority < IDE_THREAD_POOL_PRIORITY_LAST; priority++)
+    {
+      WorkItem *work_item;
+      guint i;
+
+      if ((work_item = find_runnable_locked (&worker->local [priority], TRUE)) ||
+          (work_item = find_runnable_locked (&executor->global [priority], FALSE)))
+        return work_item;
+
+      for (i = 1; i < executor->n_workers; i++)
+        {
+          Worker *victim = &executor->workers [(worker->id + i) % executor->n_workers];
+
+          if ((work_item = find_runnable_locked (&victim->local [priority], FALSE)))
+            {
+              EGG_COUNTER_INC (StolenTasks);
+              return work_item;
+            }
+        }
+    }
+
+  return NULL;
+}
+
+static void
+ide_thread_pool_run_item (WorkItem *work_item)
+{
+  if (work_item->type == TYPE_TASK)
+    {
+      GTask *task = work_item->task.task;
+
+      /* Cancelled, but we lost the race with the cancelled handler */
+      if (g_task_return_error_if_cancelled (task))
+        {
+          EGG_COUNTER_INC (CancelledTasks);
+          return;
+        }
+
+      work_item->task.func (task,
+                            g_task_get_source_object (task),
+                            g_task_get_task_data (task),
+                            g_task_get_cancellable (task));
+    }
+  else if (work_item->type == TYPE_FUNC)
+    {
+      work_item->func.callback (work_item->func.data);
+    }
+}
+
+static gpointer
+ide_thread_pool_worker (gpointer data)
 {
-  return thread_pools [kind];
+  Worker *worker = data;
+
+  g_assert (worker != NULL);
+
+  g_private_set (&current_worker, worker);
+
+  g_mutex_lock (&executor->mutex);
+
+  for (;;)
+    {
+      WorkItem *work_item;
+      gint64 waited;
+
+      if (!(work_item = next_work_item_locked (worker)))
+        {
+          g_cond_wait (&executor->cond, &executor->mutex);
+          continue;
+        }
+
+      work_item_unqueue_locked (work_item);
+      work_item->state = WORK_ITEM_RUNNING;
+
+      executor->n_running [work_item->kind]++;
+      if (work_item->priority != IDE_THREAD_POOL_PRIORITY_INTERACTIVE)
+        executor->n_running_low_priority++;
+
+      g_mutex_unlock (&executor->mutex);
+
+      waited = g_get_monotonic_time () - work_item->queued_at;
+      EGG_COUNTER_ADD (QueueLatency, waited);
+      if (work_item->priority == IDE_THREAD_POOL_PRIORITY_INTERACTIVE)
+        EGG_COUNTER_ADD (InteractiveLatency, waited);
+
+      /* Not within the handler, so safe to disconnect */
+      if (work_item->cancelled_handler != 0)
+        g_cancellable_disconnect (work_item->cancellable, work_item->cancelled_handler);
+
+      ide_thread_pool_run_item (work_item);
+
+      g_mutex_lock (&executor->mutex);
+
+      executor->n_running [work_item->kind]--;
+      if (work_item->priority != IDE_THREAD_POOL_PRIORITY_INTERACTIVE)
+        executor->n_running_low_priority--;
+
+      /* Work that was blocked on concurrency limits may now be runnable */
+      if (executor->n_queued > 0)
+        g_cond_broadcast (&executor->cond);
+
+      work_item_unref (work_item);
+    }
+
+  g_assert_not_reached ();
+
+  return NULL;
 }
 
 /**
- * ide_thread_pool_push_task:
+ * ide_thread_pool_push_task_with_priority:
  * @kind: The task kind.
+ * @priority: The priority class of the task.
  * @task: A #GTask to execute.
  * @func: (scope async): The thread worker to execute for @task.
  *
- * This pushes a task to be executed on a worker thread based on the task kind as denoted by
- * @kind. Some tasks will be placed on special work queues or throttled based on proirity.
+ * Like ide_thread_pool_push_task() but allows the caller to specify the
+ * priority class of the work. If the cancellable of @task is cancelled
+ * before a worker has started it, @func is never called and @task is
+ * completed with %G_IO_ERROR_CANCELLED.
  */
 void
-ide_thread_pool_push_task (IdeThreadPoolKind  kind,
-                           GTask             *task,
-                           GTaskThreadFunc    func)
+ide_thread_pool_push_task_with_priority (IdeThreadPoolKind      kind,
+                                         IdeThreadPoolPriority  priority,
+                                         GTask                 *task,
+                                         GTaskThreadFunc        func)
 {
-  GThreadPool *pool;
+  WorkItem *work_item;
+  GCancellable *cancellable;
 
   IDE_ENTRY;
 
   g_return_if_fail (kind >= 0);
   g_return_if_fail (kind < IDE_THREAD_POOL_LAST);
+  g_return_if_fail (priority >= 0);
+  g_return_if_fail (priority < IDE_THREAD_POOL_PRIORITY_LAST);
   g_return_if_fail (G_IS_TASK (task));
   g_return_if_fail (func != NULL);
 
-  EGG_COUNTER_INC (TotalTasks);
-
-  pool = ide_thread_pool_get_pool (kind);
-
-  if (pool != NULL)
+  if (executor == NULL)
     {
-      WorkItem *work_item;
+      EGG_COUNTER_INC (TotalTasks);
+      g_task_run_in_thread (task, func);
+      IDE_EXIT;
+    }
 
-      work_item = g_slice_new0 (WorkItem);
-      work_item->type = TYPE_TASK;
-      work_item->task.task = g_object_ref (task);
-      work_item->task.func = func;
+  work_item = g_slice_new0 (WorkItem);
+  work_item->ref_count = 1;
+  work_item->type = TYPE_TASK;
+  work_item->kind = kind;
+  work_item->priority = priority;
+  work_item->task.task = g_object_ref (task);
+  work_item->task.func = func;
 
-      EGG_COUNTER_INC (QueuedTasks);
+  if ((cancellable = g_task_get_cancellable (task)))
+    work_item->cancellable = g_object_ref (cancellable);
 
-      g_thread_pool_push (pool, work_item, NULL);
-    }
-  else
-    {
-      g_task_run_in_thread (task, func);
-    }
+  ide_thread_pool_push_item (work_item);
 
   IDE_EXIT;
 }
 
 /**
- * ide_thread_pool_push:
+ * ide_thread_pool_push_task:
+ * @kind: The task kind.
+ * @task: A #GTask to execute.
+ * @func: (scope async): The thread worker to execute for @task.
+ *
+ * This pushes a task to be executed on a worker thread based on the task kind as denoted by
+ * @kind. Some tasks will be placed on special work queues or throttled based on proirity.
+ */
+void
+ide_thread_pool_push_task (IdeThreadPoolKind  kind,
+                           GTask             *task,
+                           GTaskThreadFunc    func)
+{
+  g_return_if_fail (kind >= 0);
+  g_return_if_fail (kind < IDE_THREAD_POOL_LAST);
+
+  ide_thread_pool_push_task_with_priority (kind, get_default_priority (kind), task, func);
+}
+
+/**
+ * ide_thread_pool_push_with_priority:
  * @kind: the threadpool kind to use.
+ * @priority: The priority class of the work.
  * @func: (scope async) (closure func_data): A function to call in the worker thread.
  * @func_data: user data for @func.
  *
  * Runs the callback on the thread pool thread.
  */
 void
-ide_thread_pool_push (IdeThreadPoolKind kind,
-                      IdeThreadFunc     func,
-                      gpointer          func_data)
+ide_thread_pool_push_with_priority (IdeThreadPoolKind     kind,
+                                    IdeThreadPoolPriority priority,
+                                    IdeThreadFunc         func,
+                                    gpointer              func_data)
 {
-  GThreadPool *pool;
+  WorkItem *work_item;
 
   IDE_ENTRY;
 
   g_return_if_fail (kind >= 0);
   g_return_if_fail (kind < IDE_THREAD_POOL_LAST);
+  g_return_if_fail (priority >= 0);
+  g_return_if_fail (priority < IDE_THREAD_POOL_PRIORITY_LAST);
   g_return_if_fail (func != NULL);
 
-  EGG_COUNTER_INC (TotalTasks);
-
-  pool = ide_thread_pool_get_pool (kind);
-
-  if (pool != NULL)
-    {
-      WorkItem *work_item;
-
-      work_item = g_slice_new0 (WorkItem);
-      work_item->type = TYPE_FUNC;
-      work_item->func.callback = func;
-      work_item->func.data = func_data;
-
-      EGG_COUNTER_INC (QueuedTasks);
-
-      g_thread_pool_push (pool, work_item, NULL);
-    }
-  else
+  if (executor == NULL)
     {
       g_critical ("No such thread pool %02x", kind);
+      IDE_EXIT;
     }
 
+  work_item = g_slice_new0 (WorkItem);
+  work_item->ref_count = 1;
+  work_item->type = TYPE_FUNC;
+  work_item->kind = kind;
+  work_item->priority = priority;
+  work_item->func.callback = func;
+  work_item->func.data = func_data;
+
+  ide_thread_pool_push_item (work_item);
+
   IDE_EXIT;
 }
 
-static void
-ide_thread_pool_worker (gpointer data,
-                        gpointer user_data)
+/**
+ * ide_thread_pool_push:
+ * @kind: the threadpool kind to use.
+ * @func: (scope async) (closure func_data): A function to call in the worker thread.
+ * @func_data: user data for @func.
+ *
+ * Runs the callback on the thread pool thread.
+ */
+void
+ide_thread_pool_push (IdeThreadPoolKind kind,
+                      IdeThreadFunc     func,
+                      gpointer          func_data)
 {
-  WorkItem *work_item = data;
-  gpointer source_object;
-  gpointer task_data;
-  GCancellable *cancellable;
-
-  g_assert (work_item != NULL);
-
-  EGG_COUNTER_DEC (QueuedTasks);
-
-  if (work_item->type == TYPE_TASK)
-    {
-      source_object = g_task_get_source_object (work_item->task.task);
-      task_data = g_task_get_task_data (work_item->task.task);
-      cancellable = g_task_get_cancellable (work_item->task.task);
-
-      work_item->task.func (work_item->task.task, source_object, task_data, cancellable);
-
-      g_object_unref (work_item->task.task);
-    }
-  else if (work_item->type == TYPE_FUNC)
-    {
-      work_item->func.callback (work_item->func.data);
-    }
+  g_return_if_fail (kind >= 0);
+  g_return_if_fail (kind < IDE_THREAD_POOL_LAST);
 
-  g_slice_free (WorkItem, work_item);
+  ide_thread_pool_push_with_priority (kind, get_default_priority (kind), func, func_data);
 }
 
 void
 _ide_thread_pool_init (gboolean is_worker)
 {
-  gint compiler = COMPILER_MAX_THREADS;
-  gint indexer = INDEXER_MAX_THREADS;
-  gboolean shared = FALSE;
+  guint n_workers;
+  guint i;
+
+  g_return_if_fail (executor == NULL);
 
   if (is_worker)
-    {
-      compiler = 1;
-      indexer = 1;
-      shared = TRUE;
-    }
+    n_workers = MIN_WORKERS;
+  else
+    n_workers = CLAMP (g_get_num_processors (), MIN_WORKERS, MAX_WORKERS);
+
+  executor = g_new0 (Executor, 1);
+  g_mutex_init (&executor->mutex);
+  g_cond_init (&executor->cond);
+  executor->n_workers = n_workers;
+  executor->workers = g_new0 (Worker, n_workers);
+
+  for (i = 0; i < IDE_THREAD_POOL_PRIORITY_LAST; i++)
+    g_queue_init (&executor->global [i]);
 
   /*
-   * Create our thread pool exclusive to compiler tasks (such as those from Clang).
-   * We don't want to consume threads fro other GTask's such as those regarding IO so we manage
-   * these work items exclusively.
+   * Compiler tasks (such as those from Clang) may use every worker. We don't
+   * want to consume threads from other GTask's such as those regarding IO
+   * so we manage these work items exclusively.
    */
-  thread_pools [IDE_THREAD_POOL_COMPILER] = g_thread_pool_new (ide_thread_pool_worker,
-                                                               NULL,
-                                                               compiler,
-                                                               shared,
-                                                               NULL);
+  executor->max_running [IDE_THREAD_POOL_COMPILER] = n_workers;
 
   /*
-   * Create our pool exclusive to things like indexing. Such examples including building of
-   * ctags indexes or highlight indexes.
+   * Indexing (such as building of ctags or highlight indexes) is mostly
+   * I/O bound, so only allow a fraction of the workers to index at once.
    */
-  thread_pools [IDE_THREAD_POOL_INDEXER] = g_thread_pool_new (ide_thread_pool_worker,
-                                                              NULL,
-                                                              indexer,
-                                                              shared,
-                                                              NULL);
+  executor->max_running [IDE_THREAD_POOL_INDEXER] = MAX (1, n_workers / 4);
+
+  for (i = 0; i < n_workers; i++)
+    {
+      Worker *worker = &executor->workers [i];
+      g_autofree gchar *name = g_strdup_printf ("ide-worker-%u", i);
+      guint j;
+
+      worker->id = i;
+      for (j = 0; j < IDE_THREAD_POOL_PRIORITY_LAST; j++)
+        g_queue_init (&worker->local [j]);
+      worker->thread = g_thread_new (name, ide_thread_pool_worker, worker);
+    }
 }
@@ -32,6 +32,27 @@ typedef enum
   IDE_THREAD_POOL_LAST
 } IdeThreadPoolKind;
 
+/**
+ * IdeThreadPoolPriority:
+ * @IDE_THREAD_POOL_PRIORITY_INTERACTIVE: work a user is actively waiting on,
+ *   such as code completion.
+ * @IDE_THREAD_POOL_PRIORITY_BACKGROUND: work that should complete soon, but
+ *   that the user is not blocked on, such as parsing for diagnostics.
+ * @IDE_THREAD_POOL_PRIORITY_IDLE: work that may be deferred indefinitely,
+ *   such as building indexes.
+ *
+ * Interactive work always runs before background work, which always runs
+ * before idle work. One worker is reserved for interactive work so that
+ * long running background jobs cannot starve it.
+ */
+typedef enum
+{
+  IDE_THREAD_POOL_PRIORITY_INTERACTIVE,
+  IDE_THREAD_POOL_PRIORITY_BACKGROUND,
+  IDE_THREAD_POOL_PRIORITY_IDLE,
+  IDE_THREAD_POOL_PRIORITY_LAST
+} IdeThreadPoolPriority;
+
 /**
  * IdeThreadFunc:
  * @user_data: (closure) (transfer full): The closure for the callback.
@@ -39,12 +60,20 @@ typedef enum
  */
 typedef void (*IdeThreadFunc) (gpointer user_data);
 
-void     ide_thread_pool_push      (IdeThreadPoolKind     kind,
-                                    IdeThreadFunc         func,
-                                    gpointer              func_data);
-void     ide_thread_pool_push_task (IdeThreadPoolKind     kind,
-                                    GTask                *task,
-                                    GTaskThreadFunc       func);
+void     ide_thread_pool_push                    (IdeThreadPoolKind      kind,
+                                                  IdeThreadFunc          func,
+                                                  gpointer               func_data);
+void     ide_thread_pool_push_with_priority      (IdeThreadPoolKind      kind,
+                                                  IdeThreadPoolPriority  priority,
+                                                  IdeThreadFunc          func,
+                                                  gpointer               func_data);
+void     ide_thread_pool_push_task               (IdeThreadPoolKind      kind,
+                                                  GTask                 *task,
+                                                  GTaskThreadFunc        func);
+void     ide_thread_pool_push_task_with_priority (IdeThreadPoolKind      kind,
+                                                  IdeThreadPoolPriority  priority,
+                                                  GTask                 *task,
+                                                  GTaskThreadFunc        func);
 
 G_END_DECLS
 
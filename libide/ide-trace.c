@@ -0,0 +1,431 @@
+/* ide-trace.c
+ *
+ * Copyright (C) 2016 Christian Hergert <chergert@redhat.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _GNU_SOURCE
+# define _GNU_SOURCE
+#endif
+
+#include <errno.h>
+#include <fcntl.h>
+#include <gio/gio.h>
+#include <glib/gi18n.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#ifdef __linux__
+# include <sys/syscall.h>
+#endif
+
+#include "ide-trace.h"
+
+/*
+ * Binary tracing for IDE_ENTRY, IDE_EXIT and IDE_PROBE.
+ *
+ * Formatting a log line for every function entry is far too expensive to
+ * leave enabled, so when IDE_TRACE_SPANS is set in the environment those
+ * macros instead append a fixed size record to a ring buffer owned by the
+ * calling thread. Each thread has its own ring, so recording requires no
+ * locks or atomic operations; the oldest records are overwritten.
+ *
+ * Like EggCounter, the rings live in a shared memory segment named after
+ * the pid so that an external process (see tools/ide-trace-export.c) can
+ * read them without disturbing the traced process.
+ *
+ * The segment is laid out as follows:
+ *
+ *   [Header][MAX_FUNCS function names][MAX_RINGS rings]
+ *
+ * Functions are registered the first time a call site is reached and
+ * records refer to them by index. They are keyed by source file and name,
+ * so that static functions with the same name in different files are kept
+ * apart, and are exported as "file:function".
+ */
+
+#define NAME_FORMAT "/IdeTrace-%u"
+#define MAGIC       0x49445452
+#define MAX_FUNCS   4096
+#define MAX_NAME    64
+#define MAX_RINGS   64
+#define RING_SIZE   4096
+#define RING_MASK   (RING_SIZE - 1)
+
+typedef struct
+{
+  guint32 magic;
+  guint32 size;
+  volatile guint32 n_funcs;
+  guint32 n_rings;
+  guint32 ring_size;
+  guint32 padding[11];
+} Header;
+
+typedef struct
+{
+  gchar name[MAX_NAME];
+} Func;
+
+typedef struct
+{
+  gint64  time;
+  guint32 func;
+  guint32 kind;
+} Record;
+
+typedef struct
+{
+  volatile gint    in_use;
+  gint32           thread;
+  volatile guint64 head;
+  guint8           padding[48];
+  Record           records[RING_SIZE];
+} Ring;
+
+typedef struct
+{
+  Header header;
+  Func   funcs[MAX_FUNCS];
+  Ring   rings[MAX_RINGS];
+} Segment;
+
+G_STATIC_ASSERT (sizeof (Header) == 64);
+G_STATIC_ASSERT (sizeof (Record) == 16);
+G_STATIC_ASSERT ((RING_SIZE & RING_MASK) == 0);
+
+gboolean _ide_trace_enabled;
+
+static Segment *segment;
+static GHashTable *func_ids;
+static Ring no_ring;
+
+G_LOCK_DEFINE_STATIC (func_ids);
+
+static void
+ide_trace_release_ring (gpointer data)
+{
+  Ring *ring = data;
+
+  if (ring != &no_ring)
+    g_atomic_int_set (&ring->in_use, FALSE);
+}
+
+static GPrivate current_ring = G_PRIVATE_INIT (ide_trace_release_ring);
+
+static inline gint
+ide_trace_get_thread (void)
+{
+#ifdef __linux__
+  return (gint) syscall (SYS_gettid);
+#else
+  return GPOINTER_TO_INT (g_thread_self ());
+#endif
+}
+
+static Ring *
+ide_trace_claim_ring (void)
+{
+  guint i;
+
+  for (i = 0; i < MAX_RINGS; i++)
+    {
+      Ring *ring = &segment->rings[i];
+
+      if (g_atomic_int_compare_and_exchange (&ring->in_use, FALSE, TRUE))
+        {
+          ring->thread = ide_trace_get_thread ();
+          ring->head = 0;
+          g_private_set (&current_ring, ring);
+          return ring;
+        }
+    }
+
+  /* Out of rings, don't try again for this thread */
+  g_private_set (&current_ring, &no_ring);
+
+  return &no_ring;
+}
+
+static guint
+ide_trace_register_func (const gchar *file,
+                         const gchar *func)
+{
+  const gchar *basename;
+  gchar *key;
+  guint id;
+
+  if (NULL != (basename = strrchr (file, G_DIR_SEPARATOR)))
+    file = basename + 1;
+
+  key = g_strdup_printf ("%s:%s", file, func);
+
+  G_LOCK (func_ids);
+
+  id = GPOINTER_TO_UINT (g_hash_table_lookup (func_ids, key));
+
+  if (id == 0 && segment->header.n_funcs < MAX_FUNCS)
+    {
+      Func *entry = &segment->funcs[segment->header.n_funcs];
+
+      g_strlcpy (entry->name, key, sizeof entry->name);
+      __sync_synchronize ();
+      id = ++segment->header.n_funcs;
+      g_hash_table_insert (func_ids, g_steal_pointer (&key), GUINT_TO_POINTER (id));
+    }
+
+  G_UNLOCK (func_ids);
+
+  g_free (key);
+
+  return id;
+}
+
+static void
+ide_trace_atexit (void)
+{
+  gchar name[32];
+
+  g_snprintf (name, sizeof name, NAME_FORMAT, (guint)getpid ());
+  shm_unlink (name);
+}
+
+/**
+ * ide_trace_init:
+ *
+ * Enables binary span tracing if the IDE_TRACE_SPANS environment variable
+ * is set. This is called from ide_log_init().
+ *
+ * This has no effect unless Builder was built with tracing enabled.
+ */
+void
+ide_trace_init (void)
+{
+  static gsize initialized;
+
+  if (g_once_init_enter (&initialized))
+    {
+      gchar name[32];
+      gpointer mem;
+      gint fd;
+
+      if (g_getenv ("IDE_TRACE_SPANS") == NULL)
+        goto finish;
+
+      g_snprintf (name, sizeof name, NAME_FORMAT, (guint)getpid ());
+
+      if (-1 == (fd = shm_open (name, O_CREAT|O_RDWR, S_IRUSR|S_IWUSR|S_IRGRP)))
+        {
+          g_warning ("Failed to create trace segment: %s", g_strerror (errno));
+          goto finish;
+        }
+
+      /* ftruncate() zeroes the segment and pages are only backed once touched */
+      if (-1 == ftruncate (fd, sizeof (Segment)) ||
+          MAP_FAILED == (mem = mmap (NULL, sizeof (Segment), PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0)))
+        {
+          g_warning ("Failed to map trace segment: %s", g_strerror (errno));
+          shm_unlink (name);
+          close (fd);
+          goto finish;
+        }
+
+      close (fd);
+      atexit (ide_trace_atexit);
+
+      segment = mem;
+      segment->header.n_rings = MAX_RINGS;
+      segment->header.ring_size = RING_SIZE;
+      segment->header.size = sizeof (Segment);
+      __sync_synchronize ();
+      segment->header.magic = MAGIC;
+
+      func_ids = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+
+      _ide_trace_enabled = TRUE;
+
+    finish:
+      g_once_init_leave (&initialized, TRUE);
+    }
+}
+
+/**
+ * ide_trace_record:
+ * @func_id: the location of the cached identifier for @func
+ * @file: the source file containing @func
+ * @func: the name of the function
+ * @kind: an #IdeTraceKind
+ *
+ * Records a span boundary for the current thread. This is used by the
+ * tracing macros in ide-debug.h and should not need to be called directly.
+ */
+void
+ide_trace_record (guint        *func_id,
+                  const gchar  *file,
+                  const gchar  *func,
+                  IdeTraceKind  kind)
+{
+  Record *record;
+  Ring *ring;
+  guint64 head;
+
+  if (G_UNLIKELY (segment == NULL))
+    return;
+
+  if (G_UNLIKELY (*func_id == 0))
+    *func_id = ide_trace_register_func (file, func);
+
+  if (G_UNLIKELY (NULL == (ring = g_private_get (&current_ring))))
+    ring = ide_trace_claim_ring ();
+
+  if (G_UNLIKELY (ring == &no_ring))
+    return;
+
+  head = ring->head;
+  record = &ring->records[head & RING_MASK];
+  record->time = g_get_monotonic_time ();
+  record->func = *func_id;
+  record->kind = kind;
+
+  /* Make sure the record is visible before publishing it to readers */
+  __sync_synchronize ();
+
+  ring->head = head + 1;
+}
+
+/**
+ * ide_trace_read:
+ * @pid: the process to read from
+ * @func: (scope call): a callback for each record
+ * @user_data: closure data for @func
+ * @error: a location for a #GError, or %NULL
+ *
+ * Reads the records currently held in the trace segment of @pid. Records
+ * that are overwritten while reading are skipped.
+ *
+ * Returns: %TRUE if successful; otherwise %FALSE and @error is set.
+ */
+gboolean
+ide_trace_read (GPid               pid,
+                IdeTraceSpanFunc   func,
+                gpointer           user_data,
+                GError           **error)
+{
+  g_autofree Record *copy = NULL;
+  const Segment *remote;
+  Header header;
+  gchar name[32];
+  gpointer mem;
+  guint n_funcs;
+  guint i;
+  gint fd;
+
+  g_return_val_if_fail (func != NULL, FALSE);
+
+  g_snprintf (name, sizeof name, NAME_FORMAT, (guint)pid);
+
+  if (-1 == (fd = shm_open (name, O_RDONLY, 0)))
+    {
+      g_set_error (error,
+                   G_IO_ERROR,
+                   g_io_error_from_errno (errno),
+                   _("No trace found for process %u, is IDE_TRACE_SPANS set?"),
+                   (guint)pid);
+      return FALSE;
+    }
+
+  if (pread (fd, &header, sizeof header, 0) != sizeof header ||
+      header.magic != MAGIC ||
+      header.size != sizeof (Segment) ||
+      header.n_rings != MAX_RINGS ||
+      header.ring_size != RING_SIZE)
+    {
+      close (fd);
+      g_set_error (error,
+                   G_IO_ERROR,
+                   G_IO_ERROR_INVALID_DATA,
+                   _("The trace segment for process %u is not supported"),
+                   (guint)pid);
+      return FALSE;
+    }
+
+  mem = mmap (NULL, sizeof (Segment), PROT_READ, MAP_SHARED, fd, 0);
+  close (fd);
+
+  if (mem == MAP_FAILED)
+    {
+      g_set_error (error,
+                   G_IO_ERROR,
+                   g_io_error_from_errno (errno),
+                   "%s", g_strerror (errno));
+      return FALSE;
+    }
+
+  remote = mem;
+  copy = g_new (Record, RING_SIZE);
+
+  for (i = 0; i < MAX_RINGS; i++)
+    {
+      const Ring *ring = &remote->rings[i];
+      guint64 begin;
+      guint64 end;
+      guint64 after;
+      guint64 j;
+
+      if (0 == (end = ring->head))
+        continue;
+
+      __sync_synchronize ();
+      memcpy (copy, (gconstpointer)ring->records, sizeof (Record) * RING_SIZE);
+      __sync_synchronize ();
+
+      /*
+       * Drop anything the writer may have overwritten while we copied. The
+       * slot of the record at the head may also be in the middle of being
+       * written, so once the ring has wrapped the oldest slot is unsafe.
+       */
+      after = ring->head;
+      begin = end >= RING_SIZE ? end - RING_SIZE + 1 : 0;
+      if (after >= RING_SIZE && after - RING_SIZE + 1 > begin)
+        begin = after - RING_SIZE + 1;
+
+      n_funcs = MIN (remote->header.n_funcs, MAX_FUNCS);
+
+      for (j = begin; j < end; j++)
+        {
+          const Record *record = &copy[j & RING_MASK];
+          gchar fname[MAX_NAME];
+
+          if (record->func == 0 || record->func > n_funcs)
+            g_strlcpy (fname, "<unknown>", sizeof fname);
+          else
+            {
+              /* The segment is not trusted, so don't rely on it being terminated */
+              memcpy (fname, remote->funcs[record->func - 1].name, sizeof fname - 1);
+              fname[sizeof fname - 1] = '\0';
+            }
+
+          func (fname, ring->thread, record->kind, record->time, user_data);
+        }
+    }
+
+  munmap (mem, sizeof (Segment));
+
+  return TRUE;
+}
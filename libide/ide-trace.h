@@ -0,0 +1,67 @@
+/* ide-trace.h
+ *
+ * Copyright (C) 2016 Christian Hergert <chergert@redhat.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef IDE_TRACE_H
+#define IDE_TRACE_H
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+typedef enum
+{
+  IDE_TRACE_ENTRY = 1,
+  IDE_TRACE_EXIT  = 2,
+  IDE_TRACE_PROBE = 3,
+} IdeTraceKind;
+
+/**
+ * IdeTraceSpanFunc:
+ * @func: the source file and name of the function, as "file:function"
+ * @thread: the thread that recorded the span
+ * @kind: an #IdeTraceKind
+ * @time: the monotonic time of the record, in microseconds
+ * @user_data: closure data for the callback
+ *
+ * Callback for ide_trace_read(). Records for a given thread are delivered
+ * in the order they were recorded.
+ */
+typedef void (*IdeTraceSpanFunc) (const gchar  *func,
+                                  gint          thread,
+                                  IdeTraceKind  kind,
+                                  gint64        time,
+                                  gpointer      user_data);
+
+/* Checked by IDE_ENTRY and friends before recording, see ide-debug.h */
+extern gboolean _ide_trace_enabled;
+
+#define ide_trace_is_enabled() (G_LIKELY (_ide_trace_enabled))
+
+void     ide_trace_init   (void);
+void     ide_trace_record (guint            *func_id,
+                           const gchar      *file,
+                           const gchar      *func,
+                           IdeTraceKind      kind);
+gboolean ide_trace_read   (GPid              pid,
+                           IdeTraceSpanFunc  func,
+                           gpointer          user_data,
+                           GError          **error);
+
+G_END_DECLS
+
+#endif /* IDE_TRACE_H */
@@ -47,6 +47,56 @@ ide_vcs_is_ignored (IdeVcs  *self,
   return FALSE;
 }
 
+/**
+ * ide_vcs_check_ignored:
+ * @self: An #IdeVcs
+ * @directory: the directory containing @file_infos
+ * @file_infos: (element-type Gio.FileInfo): the children of @directory
+ *
+ * Checks a whole directory listing against the ignore rules of the version
+ * control system at once. The #GFileInfo should contain the
+ * %G_FILE_ATTRIBUTE_STANDARD_NAME and %G_FILE_ATTRIBUTE_STANDARD_TYPE
+ * attributes, such as those returned from g_file_enumerator_next_file().
+ *
+ * Implementations may resolve the ignore rules for @directory a single time
+ * and may be called from a thread, making this preferable to calling
+ * ide_vcs_is_ignored() for every file when crawling the project tree.
+ *
+ * Returns: (transfer full) (element-type gboolean): A #GArray of the same
+ *   length as @file_infos containing %TRUE for each ignored file.
+ */
+GArray *
+ide_vcs_check_ignored (IdeVcs     *self,
+                       GFile      *directory,
+                       GPtrArray  *file_infos,
+                       GError    **error)
+{
+  GArray *ret;
+  guint i;
+
+  g_return_val_if_fail (IDE_IS_VCS (self), NULL);
+  g_return_val_if_fail (G_IS_FILE (directory), NULL);
+  g_return_val_if_fail (file_infos != NULL, NULL);
+
+  if (IDE_VCS_GET_IFACE (self)->check_ignored)
+    return IDE_VCS_GET_IFACE (self)->check_ignored (self, directory, file_infos, error);
+
+  ret = g_array_sized_new (FALSE, TRUE, sizeof (gboolean), file_infos->len);
+
+  for (i = 0; i < file_infos->len; i++)
+    {
+      GFileInfo *file_info = g_ptr_array_index (file_infos, i);
+      g_autoptr(GFile) file = NULL;
+      gboolean ignored;
+
+      file = g_file_get_child (directory, g_file_info_get_name (file_info));
+      ignored = ide_vcs_is_ignored (self, file, NULL);
+      g_array_append_val (ret, ignored);
+    }
+
+  return ret;
+}
+
 gint
 ide_vcs_get_priority (IdeVcs *self)
 {
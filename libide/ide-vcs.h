@@ -40,6 +40,10 @@ struct _IdeVcsInterface
                                                         GFile      *file,
                                                         GError    **error);
   gint                    (*get_priority)              (IdeVcs     *self);
+  GArray                 *(*check_ignored)             (IdeVcs     *self,
+                                                        GFile      *directory,
+                                                        GPtrArray  *file_infos,
+                                                        GError    **error);
 };
 
 IdeBufferChangeMonitor *ide_vcs_get_buffer_change_monitor (IdeVcs               *self,
@@ -56,6 +60,10 @@ gboolean                ide_vcs_is_ignored                (IdeVcs
                                                            GFile                *file,
                                                            GError              **error);
 gint                    ide_vcs_get_priority              (IdeVcs               *self);
+GArray                 *ide_vcs_check_ignored             (IdeVcs               *self,
+                                                           GFile                *directory,
+                                                           GPtrArray            *file_infos,
+                                                           GError              **error);
 
 G_END_DECLS
 
@@ -115,6 +115,7 @@ G_BEGIN_DECLS
 #include "ide-test-case.h"
 #include "ide-test-suite.h"
 #include "ide-thread-pool.h"
+#include "ide-trace.h"
 #include "ide-tree-types.h"
 #include "ide-tree.h"
 #include "ide-tree-builder.h"
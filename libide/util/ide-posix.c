@@ -44,3 +44,22 @@ ide_get_system_page_size (void)
 {
   return sysconf (_SC_PAGE_SIZE);
 }
+
+/**
+ * ide_get_system_memory:
+ *
+ * Gets the amount of physical memory in bytes, or zero if it could not
+ * be determined.
+ */
+guint64
+ide_get_system_memory (void)
+{
+  glong n_pages;
+
+  n_pages = sysconf (_SC_PHYS_PAGES);
+
+  if (n_pages <= 0)
+    return 0;
+
+  return (guint64)n_pages * ide_get_system_page_size ();
+}
@@ -23,8 +23,9 @@
 
 G_BEGIN_DECLS
 
-gchar *ide_get_system_arch      (void);
-gsize  ide_get_system_page_size (void) G_GNUC_CONST;
+gchar   *ide_get_system_arch      (void);
+gsize    ide_get_system_page_size (void) G_GNUC_CONST;
+guint64  ide_get_system_memory    (void);
 
 G_END_DECLS
 
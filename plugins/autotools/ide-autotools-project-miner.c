@@ -18,12 +18,30 @@
 
 #define G_LOG_DOMAIN "ide-autotools-project-miner"
 
+#include <errno.h>
 #include <glib/gi18n.h>
 #include <ide.h>
 
 #include "ide-autotools-project-miner.h"
 
-#define MAX_MINE_DEPTH 5
+#define MAX_MINE_DEPTH    5
+#define MAX_MINE_THREADS  4
+#define MINE_TIME_BUDGET  (10 * G_USEC_PER_SEC)
+#define CACHE_FILENAME    "autotools-project-miner.cache"
+
+/*
+ * Mining is split into one work item per directory, processed by a small
+ * thread pool so that sibling directories are enumerated in parallel.
+ * Items that have not started once the time budget is exhausted are
+ * dropped.
+ *
+ * Every directory we enumerate is recorded in a cache keyed by its path,
+ * along with its modification time. A directory whose mtime did not change
+ * still has the same entries, so on the next run we can reuse the project
+ * found there, or the list of its subdirectories, without enumerating it.
+ * Cached projects whose directory is unchanged are emitted before mining
+ * starts so that the greeter can show them right away.
+ */
 
 struct _IdeAutotoolsProjectMiner
 {
@@ -31,6 +49,30 @@ struct _IdeAutotoolsProjectMiner
   GFile   *root_directory;
 };
 
+typedef struct
+{
+  GTask         *task;
+  GFile         *root_directory;
+  GThreadPool   *pool;
+  gchar         *cache_path;
+
+  /* Protects the fields below */
+  GMutex         mutex;
+  GKeyFile      *old_cache;
+  GKeyFile      *new_cache;
+  GHashTable    *emitted;
+
+  gint64         deadline;
+  volatile gint  n_active;
+  volatile gint  timed_out;
+} MineState;
+
+typedef struct
+{
+  GFile *directory;
+  guint  depth;
+} MineItem;
+
 static void project_miner_iface_init (IdeProjectMinerInterface *iface);
 
 static GPtrArray *ignored_directories;
@@ -46,10 +88,57 @@ enum {
 
 static GParamSpec *properties [LAST_PROP];
 
+static void
+mine_state_free (MineState *state)
+{
+  g_clear_object (&state->task);
+  g_clear_object (&state->root_directory);
+  g_clear_pointer (&state->cache_path, g_free);
+  g_clear_pointer (&state->old_cache, g_key_file_unref);
+  g_clear_pointer (&state->new_cache, g_key_file_unref);
+  g_clear_pointer (&state->emitted, g_hash_table_unref);
+  g_mutex_clear (&state->mutex);
+  g_slice_free (MineState, state);
+}
+
+static void
+mine_item_free (MineItem *item)
+{
+  g_clear_object (&item->directory);
+  g_slice_free (MineItem, item);
+}
+
+static inline guint64
+get_mtime (GFileInfo *file_info)
+{
+  return (g_file_info_get_attribute_uint64 (file_info, G_FILE_ATTRIBUTE_TIME_MODIFIED) * G_USEC_PER_SEC) +
+         g_file_info_get_attribute_uint32 (file_info, G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC);
+}
+
+static gboolean
+is_cacheable_path (const gchar *path)
+{
+  /*
+   * Paths we can't use as a GKeyFile group name are simply not cached. The
+   * key file must also stay UTF-8 or it will fail to load next time.
+   */
+  if (!g_utf8_validate (path, -1, NULL))
+    return FALSE;
+
+  for (; *path; path++)
+    {
+      if (*path == '[' || *path == ']' || g_ascii_iscntrl (*path))
+        return FALSE;
+    }
+
+  return TRUE;
+}
+
 static IdeDoap *
-ide_autotools_project_miner_find_doap (IdeAutotoolsProjectMiner *self,
-                                       GCancellable             *cancellable,
-                                       GFile                    *directory)
+ide_autotools_project_miner_find_doap (IdeAutotoolsProjectMiner  *self,
+                                       GCancellable              *cancellable,
+                                       GFile                     *directory,
+                                       gchar                    **doap_filename)
 {
   g_autoptr(GFileEnumerator) enumerator = NULL;
   GFileInfo *file_info = NULL;
@@ -57,6 +146,9 @@ ide_autotools_project_miner_find_doap (IdeAutotoolsProjectMiner *self,
   g_assert (IDE_IS_AUTOTOOLS_PROJECT_MINER (self));
   g_assert (!cancellable || G_IS_CANCELLABLE (cancellable));
   g_assert (G_IS_FILE (directory));
+  g_assert (doap_filename != NULL);
+
+  *doap_filename = NULL;
 
   enumerator = g_file_enumerate_children (directory,
                                           G_FILE_ATTRIBUTE_STANDARD_NAME,
@@ -85,6 +177,8 @@ ide_autotools_project_miner_find_doap (IdeAutotoolsProjectMiner *self,
               continue;
             }
 
+          *doap_filename = g_steal_pointer (&name);
+
           return doap;
         }
     }
@@ -96,7 +190,9 @@ static void
 ide_autotools_project_miner_discovered (IdeAutotoolsProjectMiner *self,
                                         GCancellable             *cancellable,
                                         GFile                    *directory,
-                                        GFileInfo                *file_info)
+                                        const gchar              *filename,
+                                        guint64                   mtime,
+                                        IdeDoap                  *doap)
 {
   g_autofree gchar *uri = NULL;
   g_autofree gchar *name = NULL;
@@ -105,25 +201,19 @@ ide_autotools_project_miner_discovered (IdeAutotoolsProjectMiner *self,
   g_autoptr(GFileInfo) index_info = NULL;
   g_autoptr(IdeProjectInfo) project_info = NULL;
   g_autoptr(GDateTime) last_modified_at = NULL;
-  g_autoptr(IdeDoap) doap = NULL;
-  const gchar *filename;
   const gchar *shortdesc = NULL;
   gchar **languages = NULL;
-  guint64 mtime;
 
   IDE_ENTRY;
 
   g_assert (IDE_IS_AUTOTOOLS_PROJECT_MINER (self));
   g_assert (G_IS_FILE (directory));
-  g_assert (G_IS_FILE_INFO (file_info));
+  g_assert (filename != NULL);
+  g_assert (!doap || IDE_IS_DOAP (doap));
 
   uri = g_file_get_uri (directory);
   g_debug ("Discovered autotools project at %s", uri);
 
-  mtime = g_file_info_get_attribute_uint64 (file_info, G_FILE_ATTRIBUTE_TIME_MODIFIED);
-
-  doap = ide_autotools_project_miner_find_doap (self, cancellable, directory);
-
   /*
    * If there is a git repo, trust the .git/index file for time info,
    * it is more reliable than our directory mtime.
@@ -139,7 +229,6 @@ ide_autotools_project_miner_discovered (IdeAutotoolsProjectMiner *self,
 
   last_modified_at = g_date_time_new_from_unix_local (mtime);
 
-  filename = g_file_info_get_attribute_byte_string (file_info, G_FILE_ATTRIBUTE_STANDARD_NAME);
   file = g_file_get_child (directory, filename);
   name = g_file_get_basename (directory);
 
@@ -173,6 +262,49 @@ ide_autotools_project_miner_discovered (IdeAutotoolsProjectMiner *self,
   IDE_EXIT;
 }
 
+/*
+ * Emits a project recorded in the cache, unless it was already emitted
+ * during this run. @state->mutex must not be held.
+ */
+static void
+ide_autotools_project_miner_discovered_cached (IdeAutotoolsProjectMiner *self,
+                                               MineState                *state,
+                                               GFile                    *directory,
+                                               const gchar              *filename,
+                                               guint64                   mtime,
+                                               const gchar              *doap_filename,
+                                               GCancellable             *cancellable)
+{
+  g_autoptr(IdeDoap) doap = NULL;
+  g_autofree gchar *path = NULL;
+  gboolean emit;
+
+  g_assert (IDE_IS_AUTOTOOLS_PROJECT_MINER (self));
+  g_assert (state != NULL);
+  g_assert (G_IS_FILE (directory));
+
+  path = g_file_get_path (directory);
+
+  g_mutex_lock (&state->mutex);
+  emit = g_hash_table_add (state->emitted, g_strdup (path));
+  g_mutex_unlock (&state->mutex);
+
+  if (!emit)
+    return;
+
+  if (!ide_str_empty0 (doap_filename))
+    {
+      g_autoptr(GFile) doap_file = g_file_get_child (directory, doap_filename);
+
+      doap = ide_doap_new ();
+
+      if (!ide_doap_load_from_file (doap, doap_file, cancellable, NULL))
+        g_clear_object (&doap);
+    }
+
+  ide_autotools_project_miner_discovered (self, cancellable, directory, filename, mtime, doap);
+}
+
 static gboolean
 directory_is_ignored (GFile *directory)
 {
@@ -193,17 +325,131 @@ directory_is_ignored (GFile *directory)
   return FALSE;
 }
 
+static void
+ide_autotools_project_miner_push (MineState *state,
+                                  GFile     *directory,
+                                  guint      depth)
+{
+  MineItem *item;
+
+  g_assert (state != NULL);
+  g_assert (G_IS_FILE (directory));
+
+  item = g_slice_new0 (MineItem);
+  item->directory = g_object_ref (directory);
+  item->depth = depth;
+
+  g_atomic_int_inc (&state->n_active);
+  g_thread_pool_push (state->pool, item, NULL);
+}
+
+static void
+copy_group (GKeyFile    *src,
+            GKeyFile    *dst,
+            const gchar *group)
+{
+  g_auto(GStrv) keys = NULL;
+  guint i;
+
+  if (NULL == (keys = g_key_file_get_keys (src, group, NULL, NULL)))
+    return;
+
+  for (i = 0; keys [i]; i++)
+    {
+      g_autofree gchar *value = g_key_file_get_value (src, group, keys [i], NULL);
+
+      if (value != NULL)
+        g_key_file_set_value (dst, group, keys [i], value);
+    }
+}
+
+/*
+ * Reuses the cache entry for @directory if it was recorded with the same
+ * mtime, either emitting the project it contains or queuing its
+ * subdirectories. Returns FALSE if the directory must be enumerated.
+ */
+static gboolean
+ide_autotools_project_miner_mine_cached (IdeAutotoolsProjectMiner *self,
+                                         MineState                *state,
+                                         GFile                    *directory,
+                                         const gchar              *path,
+                                         guint64                   mtime,
+                                         guint                     depth,
+                                         GCancellable             *cancellable)
+{
+  g_autofree gchar *project = NULL;
+  g_autofree gchar *doap_filename = NULL;
+  g_auto(GStrv) children = NULL;
+  guint64 project_mtime = 0;
+
+  g_assert (IDE_IS_AUTOTOOLS_PROJECT_MINER (self));
+  g_assert (state != NULL);
+  g_assert (G_IS_FILE (directory));
+
+  g_mutex_lock (&state->mutex);
+
+  if (!g_key_file_has_group (state->old_cache, path) ||
+      g_key_file_get_uint64 (state->old_cache, path, "mtime", NULL) != mtime)
+    {
+      g_mutex_unlock (&state->mutex);
+      return FALSE;
+    }
+
+  project = g_key_file_get_string (state->old_cache, path, "project", NULL);
+
+  if (project != NULL)
+    {
+      doap_filename = g_key_file_get_string (state->old_cache, path, "doap", NULL);
+      project_mtime = g_key_file_get_uint64 (state->old_cache, path, "project-mtime", NULL);
+    }
+  else
+    {
+      children = g_key_file_get_string_list (state->old_cache, path, "children", NULL, NULL);
+    }
+
+  copy_group (state->old_cache, state->new_cache, path);
+
+  g_mutex_unlock (&state->mutex);
+
+  if (project != NULL)
+    {
+      ide_autotools_project_miner_discovered_cached (self, state, directory, project,
+                                                     project_mtime, doap_filename,
+                                                     cancellable);
+    }
+  else if (children != NULL)
+    {
+      guint i;
+
+      for (i = 0; children [i]; i++)
+        {
+          g_autoptr(GFile) child = g_file_get_child (directory, children [i]);
+
+          ide_autotools_project_miner_push (state, child, depth + 1);
+        }
+    }
+
+  return TRUE;
+}
+
 static void
 ide_autotools_project_miner_mine_directory (IdeAutotoolsProjectMiner *self,
+                                            MineState                *state,
                                             GFile                    *directory,
                                             guint                     depth,
                                             GCancellable             *cancellable)
 {
   g_autoptr(GFileEnumerator) file_enum = NULL;
+  g_autoptr(GFileInfo) directory_info = NULL;
   g_autoptr(GPtrArray) directories = NULL;
+  g_autoptr(GError) error = NULL;
+  g_autofree gchar *path = NULL;
   gpointer file_info_ptr;
+  gboolean cacheable;
+  guint64 mtime;
 
   g_assert (IDE_IS_AUTOTOOLS_PROJECT_MINER (self));
+  g_assert (state != NULL);
   g_assert (G_IS_FILE (directory));
   g_assert (!cancellable || G_IS_CANCELLABLE (cancellable));
 
@@ -222,6 +468,23 @@ ide_autotools_project_miner_mine_directory (IdeAutotoolsProjectMiner *self,
   }
 #endif
 
+  directory_info = g_file_query_info (directory,
+                                      G_FILE_ATTRIBUTE_TIME_MODIFIED","
+                                      G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC,
+                                      G_FILE_QUERY_INFO_NONE,
+                                      cancellable,
+                                      NULL);
+
+  if (directory_info == NULL)
+    return;
+
+  mtime = get_mtime (directory_info);
+  path = g_file_get_path (directory);
+  cacheable = (path != NULL && is_cacheable_path (path));
+
+  if (cacheable && ide_autotools_project_miner_mine_cached (self, state, directory, path, mtime, depth, cancellable))
+    return;
+
   file_enum = g_file_enumerate_children (directory,
                                          G_FILE_ATTRIBUTE_STANDARD_NAME","
                                          G_FILE_ATTRIBUTE_STANDARD_TYPE","
@@ -233,34 +496,57 @@ ide_autotools_project_miner_mine_directory (IdeAutotoolsProjectMiner *self,
   if (file_enum == NULL)
     return;
 
-  while ((file_info_ptr = g_file_enumerator_next_file (file_enum, cancellable, NULL)))
+  directories = g_ptr_array_new_with_free_func (g_free);
+
+  while ((file_info_ptr = g_file_enumerator_next_file (file_enum, cancellable, &error)))
     {
       g_autoptr(GFileInfo) file_info = file_info_ptr;
       const gchar *filename;
       GFileType file_type;
-      GFile *child;
 
       file_type = g_file_info_get_attribute_uint32 (file_info, G_FILE_ATTRIBUTE_STANDARD_TYPE);
       filename = g_file_info_get_attribute_byte_string (file_info, G_FILE_ATTRIBUTE_STANDARD_NAME);
 
-      if (filename && filename [0] == '.')
+      if (filename == NULL || filename [0] == '.')
         continue;
 
       switch (file_type)
         {
         case G_FILE_TYPE_DIRECTORY:
-          if (directories == NULL)
-            directories = g_ptr_array_new_with_free_func (g_object_unref);
-          child = g_file_get_child (directory, filename);
-          g_ptr_array_add (directories, child);
+          /* A child we can't store in the cache means the listing can't be either */
+          if (cacheable && !g_utf8_validate (filename, -1, NULL))
+            cacheable = FALSE;
+          g_ptr_array_add (directories, g_strdup (filename));
           break;
 
         case G_FILE_TYPE_REGULAR:
           if ((0 == g_strcmp0 (filename, "configure.ac")) ||
               (0 == g_strcmp0 (filename, "configure.in")))
             {
-              ide_autotools_project_miner_discovered (self, cancellable, directory, file_info);
-              g_clear_object (&file_info);
+              g_autoptr(IdeDoap) doap = NULL;
+              g_autofree gchar *doap_filename = NULL;
+              guint64 project_mtime;
+              gboolean emit;
+
+              project_mtime = g_file_info_get_attribute_uint64 (file_info, G_FILE_ATTRIBUTE_TIME_MODIFIED);
+              doap = ide_autotools_project_miner_find_doap (self, cancellable, directory, &doap_filename);
+
+              g_mutex_lock (&state->mutex);
+              if (cacheable)
+                {
+                  g_key_file_set_uint64 (state->new_cache, path, "mtime", mtime);
+                  g_key_file_set_string (state->new_cache, path, "project", filename);
+                  g_key_file_set_uint64 (state->new_cache, path, "project-mtime", project_mtime);
+                  if (doap_filename != NULL)
+                    g_key_file_set_string (state->new_cache, path, "doap", doap_filename);
+                }
+              emit = (path == NULL || g_hash_table_add (state->emitted, g_strdup (path)));
+              g_mutex_unlock (&state->mutex);
+
+              if (emit)
+                ide_autotools_project_miner_discovered (self, cancellable, directory, filename,
+                                                        project_mtime, doap);
+
               return;
             }
           break;
@@ -275,35 +561,207 @@ ide_autotools_project_miner_mine_directory (IdeAutotoolsProjectMiner *self,
         }
     }
 
-  if (directories != NULL)
+  /* We may have stopped early, don't cache a partial listing */
+  if (g_cancellable_is_cancelled (cancellable))
+    return;
+
+  if (error != NULL)
     {
-      gsize i;
+      g_debug ("Failed to enumerate directory: %s", error->message);
+      cacheable = FALSE;
+    }
+
+  if (cacheable)
+    {
+      g_mutex_lock (&state->mutex);
+      g_key_file_set_uint64 (state->new_cache, path, "mtime", mtime);
+      g_key_file_set_string_list (state->new_cache, path, "children",
+                                  (const gchar * const *)directories->pdata,
+                                  directories->len);
+      g_mutex_unlock (&state->mutex);
+    }
+
+  for (guint i = 0; i < directories->len; i++)
+    {
+      g_autoptr(GFile) child = g_file_get_child (directory, g_ptr_array_index (directories, i));
+
+      ide_autotools_project_miner_push (state, child, depth + 1);
+    }
+}
+
+static void
+ide_autotools_project_miner_complete (MineState *state)
+{
+  GCancellable *cancellable;
+
+  g_assert (state != NULL);
+
+  cancellable = g_task_get_cancellable (state->task);
 
-      for (i = 0; i < directories->len; i++)
+  /*
+   * If we ran out of time, keep the entries of the directories we did
+   * not get to so that the next run can still make use of them.
+   */
+  if (g_atomic_int_get (&state->timed_out))
+    {
+      g_auto(GStrv) groups = g_key_file_get_groups (state->old_cache, NULL);
+      guint i;
+
+      for (i = 0; groups [i]; i++)
         {
-          GFile *child = g_ptr_array_index (directories, i);
-          ide_autotools_project_miner_mine_directory (self, child, depth + 1, cancellable);
+          if (!g_key_file_has_group (state->new_cache, groups [i]))
+            copy_group (state->old_cache, state->new_cache, groups [i]);
         }
     }
+
+  if (!g_cancellable_is_cancelled (cancellable))
+    {
+      g_autoptr(GError) error = NULL;
+      g_autofree gchar *dir = NULL;
+      g_autofree gchar *data = NULL;
+      gsize len = 0;
+
+      data = g_key_file_to_data (state->new_cache, &len, NULL);
+      dir = g_path_get_dirname (state->cache_path);
+
+      if (g_mkdir_with_parents (dir, 0750) != 0 ||
+          !g_file_set_contents (state->cache_path, data, len, &error))
+        g_warning ("Failed to save project miner cache: %s",
+                   error ? error->message : g_strerror (errno));
+    }
+
+  g_task_return_boolean (state->task, TRUE);
+
+  /* We are running on the pool, so it can't wait for its threads */
+  g_thread_pool_free (state->pool, FALSE, FALSE);
+
+  mine_state_free (state);
+}
+
+static void
+ide_autotools_project_miner_worker (gpointer data,
+                                    gpointer user_data)
+{
+  MineItem *item = data;
+  MineState *state = user_data;
+  IdeAutotoolsProjectMiner *self;
+  GCancellable *cancellable;
+
+  g_assert (item != NULL);
+  g_assert (state != NULL);
+
+  self = g_task_get_source_object (state->task);
+  cancellable = g_task_get_cancellable (state->task);
+
+  if (g_cancellable_is_cancelled (cancellable))
+    goto finish;
+
+  if (g_get_monotonic_time () > state->deadline)
+    {
+      g_atomic_int_set (&state->timed_out, TRUE);
+      goto finish;
+    }
+
+  ide_autotools_project_miner_mine_directory (self, state, item->directory, item->depth, cancellable);
+
+finish:
+  mine_item_free (item);
+
+  if (g_atomic_int_dec_and_test (&state->n_active))
+    ide_autotools_project_miner_complete (state);
+}
+
+/*
+ * Loads the cache and emits the projects it contains whose directory has
+ * not changed, before any mining happens. Runs on the pool.
+ */
+static void
+ide_autotools_project_miner_load_cache (IdeAutotoolsProjectMiner *self,
+                                        MineState                *state,
+                                        GCancellable             *cancellable)
+{
+  g_auto(GStrv) groups = NULL;
+  guint i;
+
+  g_assert (IDE_IS_AUTOTOOLS_PROJECT_MINER (self));
+  g_assert (state != NULL);
+
+  g_mutex_lock (&state->mutex);
+  g_key_file_load_from_file (state->old_cache, state->cache_path, G_KEY_FILE_NONE, NULL);
+  groups = g_key_file_get_groups (state->old_cache, NULL);
+  g_mutex_unlock (&state->mutex);
+
+  for (i = 0; groups [i]; i++)
+    {
+      g_autoptr(GFile) directory = NULL;
+      g_autoptr(GFileInfo) directory_info = NULL;
+      g_autofree gchar *project = NULL;
+      g_autofree gchar *doap_filename = NULL;
+      guint64 project_mtime;
+      guint64 mtime;
+
+      if (g_cancellable_is_cancelled (cancellable))
+        return;
+
+      g_mutex_lock (&state->mutex);
+      project = g_key_file_get_string (state->old_cache, groups [i], "project", NULL);
+      doap_filename = g_key_file_get_string (state->old_cache, groups [i], "doap", NULL);
+      project_mtime = g_key_file_get_uint64 (state->old_cache, groups [i], "project-mtime", NULL);
+      mtime = g_key_file_get_uint64 (state->old_cache, groups [i], "mtime", NULL);
+      g_mutex_unlock (&state->mutex);
+
+      if (project == NULL)
+        continue;
+
+      directory = g_file_new_for_path (groups [i]);
+
+      if (!g_file_equal (directory, state->root_directory) &&
+          !g_file_has_prefix (directory, state->root_directory))
+        continue;
+
+      directory_info = g_file_query_info (directory,
+                                          G_FILE_ATTRIBUTE_TIME_MODIFIED","
+                                          G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC,
+                                          G_FILE_QUERY_INFO_NONE,
+                                          cancellable,
+                                          NULL);
+
+      if (directory_info == NULL || get_mtime (directory_info) != mtime)
+        continue;
+
+      ide_autotools_project_miner_discovered_cached (self, state, directory, project,
+                                                     project_mtime, doap_filename,
+                                                     cancellable);
+    }
 }
 
 static void
-ide_autotools_project_miner_worker (GTask        *task,
-                                    gpointer      source_object,
-                                    gpointer      task_data,
-                                    GCancellable *cancellable)
+ide_autotools_project_miner_start (GTask        *task,
+                                   gpointer      source_object,
+                                   gpointer      task_data,
+                                   GCancellable *cancellable)
 {
   IdeAutotoolsProjectMiner *self = source_object;
-  GFile *directory = task_data;
+  MineState *state = task_data;
 
   IDE_ENTRY;
 
   g_assert (G_IS_TASK (task));
   g_assert (IDE_IS_AUTOTOOLS_PROJECT_MINER (self));
-  g_assert (G_IS_FILE (directory));
-  g_assert (!cancellable || G_IS_CANCELLABLE (cancellable));
+  g_assert (state != NULL);
 
-  ide_autotools_project_miner_mine_directory (self, directory, 0, cancellable);
+  ide_autotools_project_miner_load_cache (self, state, cancellable);
+
+  /* The budget starts once the cached projects are visible */
+  state->deadline = g_get_monotonic_time () + MINE_TIME_BUDGET;
+
+  state->pool = g_thread_pool_new (ide_autotools_project_miner_worker,
+                                   state,
+                                   MAX_MINE_THREADS,
+                                   FALSE,
+                                   NULL);
+
+  ide_autotools_project_miner_push (state, state->root_directory, 0);
 
   g_task_return_boolean (task, TRUE);
 
@@ -318,21 +776,38 @@ ide_autotools_project_miner_mine_async (IdeProjectMiner     *miner,
 {
   IdeAutotoolsProjectMiner *self = (IdeAutotoolsProjectMiner *)miner;
   g_autoptr(GTask) task = NULL;
-  g_autoptr(GFile) directory = NULL;
+  g_autoptr(GTask) start_task = NULL;
+  MineState *state;
 
   g_assert (IDE_IS_AUTOTOOLS_PROJECT_MINER (self));
   g_assert (!cancellable || G_IS_CANCELLABLE (cancellable));
 
   task = g_task_new (miner, cancellable, callback, user_data);
 
-  directory = g_file_new_for_path (g_get_home_dir ());
+  state = g_slice_new0 (MineState);
+  state->task = g_object_ref (task);
+  state->old_cache = g_key_file_new ();
+  state->new_cache = g_key_file_new ();
+  state->emitted = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+  state->cache_path = g_build_filename (g_get_user_cache_dir (),
+                                        ide_get_program_name (),
+                                        CACHE_FILENAME,
+                                        NULL);
+  g_mutex_init (&state->mutex);
 
   if (self->root_directory)
-    g_task_set_task_data (task, g_object_ref (self->root_directory), g_object_unref);
+    state->root_directory = g_object_ref (self->root_directory);
   else
-    g_task_set_task_data (task, g_object_ref (directory), g_object_unref);
+    state->root_directory = g_file_new_for_path (g_get_home_dir ());
 
-  g_task_run_in_thread (task, ide_autotools_project_miner_worker);
+  /*
+   * @task completes once the last directory has been mined, which
+   * @state takes care of. This task only loads the cache and starts the
+   * pool from a thread.
+   */
+  start_task = g_task_new (miner, cancellable, NULL, NULL);
+  g_task_set_task_data (start_task, state, NULL);
+  g_task_run_in_thread (start_task, ide_autotools_project_miner_start);
 }
 
 static gboolean
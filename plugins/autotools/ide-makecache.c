@@ -52,6 +52,15 @@ struct _IdeMakecache
   GMappedFile  *mapped;
   EggTaskCache *file_targets_cache;
   EggTaskCache *file_flags_cache;
+
+  /*
+   * Automake applies compiler flags per target, so once flags have been
+   * extracted for one C or C++ file of a target, they are reused for the
+   * rest of its files rather than running make again. Keyed by
+   * "subdir/target:compiler" and accessed from the compiler thread pool.
+   */
+  GMutex        target_flags_mutex;
+  GHashTable   *target_flags;
 };
 
 typedef struct
@@ -956,6 +965,37 @@ ide_makecache_parse_line (IdeMakecache *self,
   IDE_RETURN (NULL);
 }
 
+static const gchar *
+get_file_compiler (const gchar *relpath)
+{
+  const gchar *dot;
+
+  g_assert (relpath != NULL);
+
+  if (NULL == (dot = strrchr (relpath, '.')))
+    return NULL;
+
+  if (g_str_equal (dot, ".c"))
+    return FAKE_CC;
+
+  if (g_str_equal (dot, ".cc") ||
+      g_str_equal (dot, ".cpp") ||
+      g_str_equal (dot, ".cxx") ||
+      g_str_equal (dot, ".C"))
+    return FAKE_CXX;
+
+  /* Vala flags contain paths relative to the file, so they are not shared */
+  return NULL;
+}
+
+static gchar *
+get_target_flags_key (const gchar *subdir,
+                      const gchar *targetstr,
+                      const gchar *compiler)
+{
+  return g_strdup_printf ("%s/%s:%s", subdir ?: ".", targetstr, compiler);
+}
+
 static void
 ide_makecache_get_file_flags_worker (GTask        *task,
                                      gpointer      source_object,
@@ -985,9 +1025,11 @@ ide_makecache_get_file_flags_worker (GTask        *task,
       g_autoptr(GPtrArray) argv = NULL;
       g_autofree gchar *stdoutstr = NULL;
       g_autofree gchar *cwd = NULL;
+      g_autofree gchar *target_key = NULL;
       const gchar *subdir;
       const gchar *targetstr;
       const gchar *relpath;
+      const gchar *compiler;
       GError *error = NULL;
       gchar **lines;
       gchar **ret = NULL;
@@ -1001,6 +1043,22 @@ ide_makecache_get_file_flags_worker (GTask        *task,
       subdir = ide_makecache_target_get_subdir (target);
       targetstr = ide_makecache_target_get_target (target);
 
+      if (NULL != (compiler = get_file_compiler (lookup->relative_path)))
+        {
+          target_key = get_target_flags_key (subdir, targetstr, compiler);
+
+          g_mutex_lock (&lookup->self->target_flags_mutex);
+          ret = g_strdupv (g_hash_table_lookup (lookup->self->target_flags, target_key));
+          g_mutex_unlock (&lookup->self->target_flags_mutex);
+
+          if (ret != NULL)
+            {
+              IDE_TRACE_MSG ("Reusing flags for target %s", target_key);
+              g_task_return_pointer (task, ret, (GDestroyNotify)g_strfreev);
+              IDE_EXIT;
+            }
+        }
+
       cwd = g_file_get_path (lookup->self->parent);
 
       if ((subdir != NULL) && g_str_has_prefix (lookup->relative_path, subdir))
@@ -1091,6 +1149,15 @@ ide_makecache_get_file_flags_worker (GTask        *task,
       if (ret == NULL)
         continue;
 
+      if (target_key != NULL)
+        {
+          g_mutex_lock (&lookup->self->target_flags_mutex);
+          g_hash_table_insert (lookup->self->target_flags,
+                               g_steal_pointer (&target_key),
+                               g_strdupv (ret));
+          g_mutex_unlock (&lookup->self->target_flags_mutex);
+        }
+
       g_task_return_pointer (task, ret, (GDestroyNotify)g_strfreev);
 
       IDE_EXIT;
@@ -1389,6 +1456,8 @@ ide_makecache_finalize (GObject *object)
   g_clear_pointer (&self->mapped, g_mapped_file_unref);
   g_clear_object (&self->file_targets_cache);
   g_clear_object (&self->file_flags_cache);
+  g_clear_pointer (&self->target_flags, g_hash_table_unref);
+  g_mutex_clear (&self->target_flags_mutex);
   g_clear_pointer (&self->llvm_flags, g_free);
 
   G_OBJECT_CLASS (ide_makecache_parent_class)->finalize (object);
@@ -1458,6 +1527,9 @@ ide_makecache_init (IdeMakecache *self)
 {
   EGG_COUNTER_INC (instances);
 
+  g_mutex_init (&self->target_flags_mutex);
+  self->target_flags = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, (GDestroyNotify)g_strfreev);
+
   self->file_targets_cache = egg_task_cache_new ((GHashFunc)g_file_hash,
                                                  (GEqualFunc)g_file_equal,
                                                  g_object_ref,
@@ -23,6 +23,7 @@
 
 #include "c-parse-helper.h"
 #include "ide-c-indenter.h"
+#include "ide-c-line-cache.h"
 #include "ide-debug.h"
 #include "ide-source-view.h"
 
@@ -119,22 +120,6 @@ build_indent (IdeCIndenter *c,
     }
 }
 
-static gboolean
-iter_ends_c89_comment (const GtkTextIter *iter)
-{
-  if (gtk_text_iter_get_char (iter) == '/')
-    {
-      GtkTextIter tmp;
-
-      tmp = *iter;
-
-      if (gtk_text_iter_backward_char (&tmp) && ('*' == gtk_text_iter_get_char (&tmp)))
-        return TRUE;
-    }
-
-  return FALSE;
-}
-
 static gboolean
 non_space_predicate (gunichar ch,
                      gpointer user_data)
@@ -290,78 +275,18 @@ static gboolean
 backward_find_matching_char (GtkTextIter *iter,
                              gunichar     ch)
 {
-  GtkTextIter copy;
-  gunichar match = 0;
-  gunichar cur;
-  guint count = 1;
+  IdeCLineCache *cache;
 
-  switch (ch) {
-  case ')':
-    match = '(';
-    break;
-  case '}':
-    match = '{';
-    break;
-  case '[':
-    match = ']';
-    break;
-  default:
-    g_assert_not_reached ();
-    break;
-  }
-
-  gtk_text_iter_assign (&copy, iter);
+  g_assert (ch == ')' || ch == '}' || ch == ']');
 
-  while (gtk_text_iter_backward_char (iter))
-    {
-      cur = gtk_text_iter_get_char (iter);
-
-      if ((cur == '\'') || (cur == '"'))
-        {
-          gunichar strcur = 0;
-
-          while (gtk_text_iter_backward_char (iter))
-            {
-              strcur = gtk_text_iter_get_char (iter);
-              if (strcur == cur)
-                {
-                  GtkTextIter copy2 = *iter;
-
-                  /* check if the character before this is an escape char */
-                  if (gtk_text_iter_backward_char (&copy2) &&
-                      ('\\' == gtk_text_iter_get_char (&copy2)))
-                    continue;
-
-                  break;
-                }
-            }
-
-          if (strcur != cur)
-            break;
-        }
-      else if ((cur == '/') && iter_ends_c89_comment (iter))
-        {
-          GtkTextIter tmp = *iter;
-
-          if (backward_before_c89_comment (&tmp))
-            {
-              *iter = tmp;
-              cur = gtk_text_iter_get_char (iter);
-            }
-        }
-
-      if (cur == match)
-        {
-          if (--count == 0)
-            return TRUE;
-        }
-      else if (cur == ch)
-        count++;
-    }
-
-  gtk_text_iter_assign (iter, &copy);
+  /*
+   * The line cache tracks the unmatched brackets at the start of every
+   * line, so we only need to scan the current line rather than walking
+   * backwards through the entire buffer.
+   */
+  cache = ide_c_line_cache_get_for_buffer (gtk_text_iter_get_buffer (iter));
 
-  return FALSE;
+  return ide_c_line_cache_backward_find_unmatched (cache, iter, ch);
 }
 
 static gboolean
@@ -478,12 +403,21 @@ in_comment (const GtkTextIter *location,
 
   copy = iter;
 
-  while (gtk_source_buffer_iter_has_context_class (buffer, &iter, "comment"))
+  /*
+   * Multi-line comments can be very long, so use the line cache to locate
+   * the beginning of C89 comments rather than walking backwards.
+   */
+  if (!ide_c_line_cache_get_c89_comment_start (ide_c_line_cache_get_for_buffer (GTK_TEXT_BUFFER (buffer)),
+                                               &iter,
+                                               &copy))
     {
-      copy = iter;
+      while (gtk_source_buffer_iter_has_context_class (buffer, &iter, "comment"))
+        {
+          copy = iter;
 
-      if (!gtk_text_iter_backward_char (&iter))
-        break;
+          if (!gtk_text_iter_backward_char (&iter))
+            break;
+        }
     }
 
   *match_begin = copy;
@@ -0,0 +1,450 @@
+/* ide-c-line-cache.c
+ *
+ * Copyright (C) 2016 Christian Hergert <chergert@redhat.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define G_LOG_DOMAIN "ide-c-line-cache"
+
+#include "egg-counter.h"
+
+#include "ide-c-line-cache.h"
+
+/*
+ * The line cache keeps the lexer state at the start of each line of a
+ * buffer so that the C indenter does not need to walk backwards through
+ * the buffer (possibly thousands of lines) to locate the opening of the
+ * current scope or comment.
+ *
+ * The state contains whether we are within a C89 comment (and where it
+ * started) and a stack of unmatched (, { and [ for each bracket kind. The
+ * stacks are stored as a persistent linked list in a single array of
+ * nodes, so lines share the nodes of the lines before them. Since nodes
+ * are appended in the order the buffer is scanned, invalidating from a
+ * line forward is simply a truncation of both arrays.
+ *
+ * Lines are scanned lazily, only up to the line being queried. Edits
+ * invalidate the state from the edited line forward.
+ */
+
+#define CACHE_KEY "IDE_C_LINE_CACHE"
+
+enum {
+  STACK_PAREN,
+  STACK_BRACE,
+  STACK_BRACKET,
+  N_STACKS
+};
+
+typedef struct
+{
+  gint    line;
+  gint    line_offset;
+  /* Index + 1 of the parent node, or 0 */
+  guint32 parent;
+} OpenNode;
+
+typedef struct
+{
+  /* Index + 1 of the innermost unmatched bracket, or 0 */
+  guint32 top [N_STACKS];
+  /* Length of the node array when this state was computed */
+  guint32 n_nodes;
+  /* Start of the C89 comment we are within, or -1 */
+  gint    comment_line;
+  gint    comment_offset;
+} LineState;
+
+struct _IdeCLineCache
+{
+  /* Weak pointer, the cache is owned by the buffer */
+  GtkTextBuffer *buffer;
+
+  /* states[n] is the state at the start of line n */
+  GArray        *states;
+  GArray        *nodes;
+};
+
+EGG_DEFINE_COUNTER (lines_scanned, "IdeCLineCache", "Lines Scanned", "Number of lines scanned by the C indenter line cache")
+EGG_DEFINE_COUNTER (lines_invalidated, "IdeCLineCache", "Lines Invalidated", "Number of cached line states invalidated")
+
+static void
+ide_c_line_cache_invalidate (IdeCLineCache *self,
+                             gint           line)
+{
+  const LineState *state;
+
+  g_assert (self != NULL);
+  g_assert (line >= 0);
+
+  if ((guint)line + 1 >= self->states->len)
+    return;
+
+  EGG_COUNTER_ADD (lines_invalidated, self->states->len - line - 1);
+
+  state = &g_array_index (self->states, LineState, line);
+  g_array_set_size (self->nodes, state->n_nodes);
+  g_array_set_size (self->states, line + 1);
+}
+
+static void
+ide_c_line_cache_insert_text (IdeCLineCache *self,
+                              GtkTextIter   *location,
+                              const gchar   *text,
+                              gint           len,
+                              GtkTextBuffer *buffer)
+{
+  g_assert (self != NULL);
+  g_assert (location != NULL);
+
+  ide_c_line_cache_invalidate (self, gtk_text_iter_get_line (location));
+}
+
+static void
+ide_c_line_cache_delete_range (IdeCLineCache *self,
+                               GtkTextIter   *begin,
+                               GtkTextIter   *end,
+                               GtkTextBuffer *buffer)
+{
+  g_assert (self != NULL);
+  g_assert (begin != NULL);
+  g_assert (end != NULL);
+
+  ide_c_line_cache_invalidate (self, MIN (gtk_text_iter_get_line (begin),
+                                          gtk_text_iter_get_line (end)));
+}
+
+static inline void
+push_node (IdeCLineCache *self,
+           LineState     *state,
+           guint          stack,
+           gint           line,
+           gint           line_offset)
+{
+  OpenNode node = { line, line_offset, state->top [stack] };
+
+  g_array_append_val (self->nodes, node);
+  state->top [stack] = self->nodes->len;
+}
+
+static inline void
+pop_node (IdeCLineCache *self,
+          LineState     *state,
+          guint          stack)
+{
+  if (state->top [stack] != 0)
+    state->top [stack] = g_array_index (self->nodes, OpenNode, state->top [stack] - 1).parent;
+}
+
+/*
+ * Advances @state over @line, up to (but not including) the character
+ * at @limit, or the whole line if @limit is negative.
+ */
+static void
+scan_line (IdeCLineCache *self,
+           LineState     *state,
+           gint           line,
+           gint           limit)
+{
+  g_autofree gchar *text = NULL;
+  GtkTextIter begin;
+  GtkTextIter end;
+  const gchar *p;
+  gunichar quote = 0;
+  gint offset = 0;
+
+  g_assert (self != NULL);
+  g_assert (state != NULL);
+
+  gtk_text_buffer_get_iter_at_line (self->buffer, &begin, line);
+  end = begin;
+  if (!gtk_text_iter_ends_line (&end))
+    gtk_text_iter_forward_to_line_end (&end);
+
+  /* Use a slice so that offsets match those of GtkTextIter */
+  text = gtk_text_iter_get_slice (&begin, &end);
+
+  EGG_COUNTER_INC (lines_scanned);
+
+  for (p = text; *p && (limit < 0 || offset < limit); p = g_utf8_next_char (p), offset++)
+    {
+      gunichar ch = g_utf8_get_char (p);
+
+      if (state->comment_line >= 0)
+        {
+          if (ch == '*' && p [1] == '/')
+            {
+              state->comment_line = -1;
+              state->comment_offset = -1;
+              p++, offset++;
+            }
+          continue;
+        }
+
+      if (quote != 0)
+        {
+          if (ch == '\\' && p [1] != '\0')
+            p = g_utf8_next_char (p), offset++;
+          else if (ch == quote)
+            quote = 0;
+          continue;
+        }
+
+      switch (ch)
+        {
+        case '/':
+          /* The rest of the line is a C99 comment */
+          if (p [1] == '/')
+            return;
+
+          if (p [1] == '*')
+            {
+              state->comment_line = line;
+              state->comment_offset = offset;
+              p++, offset++;
+            }
+          break;
+
+        case '"':
+        case '\'':
+          quote = ch;
+          break;
+
+        case '(':
+          push_node (self, state, STACK_PAREN, line, offset);
+          break;
+
+        case ')':
+          pop_node (self, state, STACK_PAREN);
+          break;
+
+        case '{':
+          push_node (self, state, STACK_BRACE, line, offset);
+          break;
+
+        case '}':
+          pop_node (self, state, STACK_BRACE);
+          break;
+
+        case '[':
+          push_node (self, state, STACK_BRACKET, line, offset);
+          break;
+
+        case ']':
+          pop_node (self, state, STACK_BRACKET);
+          break;
+
+        default:
+          break;
+        }
+    }
+}
+
+static const LineState *
+ide_c_line_cache_ensure_line (IdeCLineCache *self,
+                              gint           line)
+{
+  g_assert (self != NULL);
+  g_assert (line >= 0);
+
+  while (self->states->len <= (guint)line)
+    {
+      LineState next;
+
+      next = g_array_index (self->states, LineState, self->states->len - 1);
+      scan_line (self, &next, self->states->len - 1, -1);
+      next.n_nodes = self->nodes->len;
+      g_array_append_val (self->states, next);
+    }
+
+  return &g_array_index (self->states, LineState, line);
+}
+
+/*
+ * Computes the state at @iter. The nodes created while scanning the
+ * partial line are appended after the cached nodes, so the caller must
+ * truncate the node array to @n_nodes after using the result.
+ */
+static void
+ide_c_line_cache_get_state (IdeCLineCache     *self,
+                            const GtkTextIter *iter,
+                            LineState         *state,
+                            guint             *n_nodes)
+{
+  gint line;
+
+  g_assert (self != NULL);
+  g_assert (iter != NULL);
+  g_assert (state != NULL);
+  g_assert (n_nodes != NULL);
+
+  line = gtk_text_iter_get_line (iter);
+
+  *state = *ide_c_line_cache_ensure_line (self, line);
+  *n_nodes = self->nodes->len;
+
+  scan_line (self, state, line, gtk_text_iter_get_line_offset (iter));
+}
+
+/**
+ * ide_c_line_cache_backward_find_unmatched:
+ * @self: An #IdeCLineCache
+ * @iter: A #GtkTextIter
+ * @ch: the closing character, one of ')', '}' or ']'
+ *
+ * Locates the innermost unmatched opening character for @ch before @iter,
+ * ignoring brackets in comments, strings and character constants.
+ *
+ * Returns: %TRUE and moves @iter to the opening character if found.
+ */
+gboolean
+ide_c_line_cache_backward_find_unmatched (IdeCLineCache *self,
+                                          GtkTextIter   *iter,
+                                          gunichar       ch)
+{
+  LineState state;
+  guint n_nodes;
+  guint stack;
+  gboolean ret = FALSE;
+
+  g_return_val_if_fail (self != NULL, FALSE);
+  g_return_val_if_fail (iter != NULL, FALSE);
+
+  switch (ch)
+    {
+    case ')':
+      stack = STACK_PAREN;
+      break;
+
+    case '}':
+      stack = STACK_BRACE;
+      break;
+
+    case ']':
+      stack = STACK_BRACKET;
+      break;
+
+    default:
+      g_return_val_if_reached (FALSE);
+    }
+
+  ide_c_line_cache_get_state (self, iter, &state, &n_nodes);
+
+  if (state.top [stack] != 0)
+    {
+      const OpenNode *node = &g_array_index (self->nodes, OpenNode, state.top [stack] - 1);
+
+      gtk_text_buffer_get_iter_at_line_offset (self->buffer, iter, node->line, node->line_offset);
+      ret = TRUE;
+    }
+
+  g_array_set_size (self->nodes, n_nodes);
+
+  return ret;
+}
+
+/**
+ * ide_c_line_cache_get_c89_comment_start:
+ * @self: An #IdeCLineCache
+ * @iter: A #GtkTextIter
+ * @begin: (out): A location for the start of the comment
+ *
+ * Checks to see if @iter is within a C89 comment, and if so, locates
+ * the "/" starting the comment.
+ *
+ * Returns: %TRUE if @iter is within a C89 comment.
+ */
+gboolean
+ide_c_line_cache_get_c89_comment_start (IdeCLineCache     *self,
+                                        const GtkTextIter *iter,
+                                        GtkTextIter       *begin)
+{
+  LineState state;
+  guint n_nodes;
+
+  g_return_val_if_fail (self != NULL, FALSE);
+  g_return_val_if_fail (iter != NULL, FALSE);
+  g_return_val_if_fail (begin != NULL, FALSE);
+
+  ide_c_line_cache_get_state (self, iter, &state, &n_nodes);
+  g_array_set_size (self->nodes, n_nodes);
+
+  if (state.comment_line < 0)
+    return FALSE;
+
+  gtk_text_buffer_get_iter_at_line_offset (self->buffer,
+                                           begin,
+                                           state.comment_line,
+                                           state.comment_offset);
+
+  return TRUE;
+}
+
+static void
+ide_c_line_cache_free (gpointer data)
+{
+  IdeCLineCache *self = data;
+
+  g_clear_pointer (&self->states, g_array_unref);
+  g_clear_pointer (&self->nodes, g_array_unref);
+  g_slice_free (IdeCLineCache, self);
+}
+
+/**
+ * ide_c_line_cache_get_for_buffer:
+ * @buffer: A #GtkTextBuffer
+ *
+ * Gets the line cache for @buffer, creating it if necessary. The cache
+ * is owned by @buffer.
+ *
+ * Returns: (transfer none): An #IdeCLineCache.
+ */
+IdeCLineCache *
+ide_c_line_cache_get_for_buffer (GtkTextBuffer *buffer)
+{
+  IdeCLineCache *self;
+
+  g_return_val_if_fail (GTK_IS_TEXT_BUFFER (buffer), NULL);
+
+  if ((self = g_object_get_data (G_OBJECT (buffer), CACHE_KEY)))
+    return self;
+
+  self = g_slice_new0 (IdeCLineCache);
+  self->buffer = buffer;
+  self->states = g_array_new (FALSE, TRUE, sizeof (LineState));
+  self->nodes = g_array_new (FALSE, FALSE, sizeof (OpenNode));
+
+  /* The state at the start of the buffer */
+  g_array_set_size (self->states, 1);
+  g_array_index (self->states, LineState, 0).comment_line = -1;
+  g_array_index (self->states, LineState, 0).comment_offset = -1;
+
+  /*
+   * The handlers are run before the default handler so that the iters
+   * still describe the buffer before the change.
+   */
+  g_signal_connect_swapped (buffer,
+                            "insert-text",
+                            G_CALLBACK (ide_c_line_cache_insert_text),
+                            self);
+  g_signal_connect_swapped (buffer,
+                            "delete-range",
+                            G_CALLBACK (ide_c_line_cache_delete_range),
+                            self);
+
+  g_object_set_data_full (G_OBJECT (buffer), CACHE_KEY, self, ide_c_line_cache_free);
+
+  return self;
+}
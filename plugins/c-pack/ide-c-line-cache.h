@@ -0,0 +1,38 @@
+/* ide-c-line-cache.h
+ *
+ * Copyright (C) 2016 Christian Hergert <chergert@redhat.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef IDE_C_LINE_CACHE_H
+#define IDE_C_LINE_CACHE_H
+
+#include <gtk/gtk.h>
+
+G_BEGIN_DECLS
+
+typedef struct _IdeCLineCache IdeCLineCache;
+
+IdeCLineCache *ide_c_line_cache_get_for_buffer          (GtkTextBuffer     *buffer);
+gboolean       ide_c_line_cache_backward_find_unmatched (IdeCLineCache     *self,
+                                                         GtkTextIter       *iter,
+                                                         gunichar           ch);
+gboolean       ide_c_line_cache_get_c89_comment_start   (IdeCLineCache     *self,
+                                                         const GtkTextIter *iter,
+                                                         GtkTextIter       *begin);
+
+G_END_DECLS
+
+#endif /* IDE_C_LINE_CACHE_H */
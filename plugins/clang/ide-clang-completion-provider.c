@@ -20,6 +20,8 @@
 
 #include <string.h>
 
+#include "egg-counter.h"
+
 #include "ide-buffer.h"
 #include "ide-completion-provider.h"
 #include "ide-clang-completion-item.h"
@@ -58,6 +60,12 @@ struct _IdeClangCompletionProvider
    */
   guint stop_line;
   guint stop_line_offset;
+  /*
+   * The cancellable for the in-flight completion request, if any. It is
+   * cancelled when a new request is made so that stale requests do not
+   * hold up the completion translation unit.
+   */
+  GCancellable *cancellable;
 };
 
 typedef struct
@@ -68,8 +76,14 @@ typedef struct
   GCancellable *cancellable;
   gchar *line;
   gchar *query;
+  gint64 begin_time;
 } IdeClangCompletionState;
 
+EGG_DEFINE_HISTOGRAM (complete_latency,
+                      "Clang",
+                      "Completion Latency",
+                      "Time from requesting completions to results in usec")
+
 static void ide_clang_completion_provider_iface_init (GtkSourceCompletionProviderIface *iface);
 
 G_DEFINE_TYPE_EXTENDED (IdeClangCompletionProvider,
@@ -361,6 +375,8 @@ ide_clang_completion_provider_code_complete_cb (GObject      *object,
       IDE_EXIT;
     }
 
+  EGG_HISTOGRAM_RECORD (complete_latency, g_get_monotonic_time () - state->begin_time);
+
   ide_clang_completion_provider_save_results (state->self, results, state->line, state->query);
   ide_clang_completion_provider_update_links (state->self, results);
 
@@ -414,7 +430,7 @@ ide_clang_completion_provider_get_translation_unit_cb (GObject      *object,
   g_assert (IDE_IS_FILE (state->file));
   g_assert (GTK_SOURCE_IS_COMPLETION_CONTEXT (state->context));
 
-  if (!(unit = ide_clang_service_get_translation_unit_finish (service, result, &error)))
+  if (!(unit = ide_clang_service_get_completion_unit_finish (service, result, &error)))
     {
       g_debug ("%s", error->message);
       if (!g_cancellable_is_cancelled (state->cancellable))
@@ -441,7 +457,7 @@ ide_clang_completion_provider_get_translation_unit_cb (GObject      *object,
   ide_clang_translation_unit_code_complete_async (unit,
                                                   ide_file_get_file (state->file),
                                                   &iter,
-                                                  NULL,
+                                                  state->cancellable,
                                                   ide_clang_completion_provider_code_complete_cb,
                                                   state);
 
@@ -560,6 +576,7 @@ ide_clang_completion_provider_populate (GtkSourceCompletionProvider *provider,
   state->cancellable = g_cancellable_new ();
   state->query = prefix, prefix = NULL;
   state->line = line, line = NULL;
+  state->begin_time = g_get_monotonic_time ();
 
   g_signal_connect_object (context,
                            "cancelled",
@@ -567,12 +584,19 @@ ide_clang_completion_provider_populate (GtkSourceCompletionProvider *provider,
                            state->cancellable,
                            G_CONNECT_SWAPPED);
 
-  ide_clang_service_get_translation_unit_async (service,
-                                                state->file,
-                                                0,
-                                                NULL,
-                                                ide_clang_completion_provider_get_translation_unit_cb,
-                                                state);
+  /*
+   * The insertion cursor has moved somewhere we cannot replay from, so any
+   * request still in flight is stale.
+   */
+  if (self->cancellable != NULL)
+    g_cancellable_cancel (self->cancellable);
+  g_set_object (&self->cancellable, state->cancellable);
+
+  ide_clang_service_get_completion_unit_async (service,
+                                               state->file,
+                                               state->cancellable,
+                                               ide_clang_completion_provider_get_translation_unit_cb,
+                                               state);
 
   IDE_EXIT;
 
@@ -662,6 +686,10 @@ ide_clang_completion_provider_finalize (GObject *object)
   g_clear_pointer (&self->last_query, g_free);
   g_clear_object (&self->settings);
 
+  if (self->cancellable != NULL)
+    g_cancellable_cancel (self->cancellable);
+  g_clear_object (&self->cancellable);
+
   G_OBJECT_CLASS (ide_clang_completion_provider_parent_class)->finalize (object);
 }
 
@@ -37,6 +37,7 @@
 #include "ide-unsaved-files.h"
 
 #define DEFAULT_EVICTION_MSEC (60 * 1000)
+#define COMPLETION_EVICTION_MSEC (5 * 60 * 1000)
 
 struct _IdeClangService
 {
@@ -45,6 +46,14 @@ struct _IdeClangService
   CXIndex       index;
   GCancellable *cancellable;
   EggTaskCache *units_cache;
+  /*
+   * Translation units dedicated to code completion. They are parsed with
+   * a precompiled preamble and cached completion results, and are never
+   * reparsed for new content since clang_codeCompleteAt() takes the
+   * unsaved files directly. Keeping them separate allows diagnostics and
+   * highlighting to be reparsed while a completion is in progress.
+   */
+  EggTaskCache *completion_cache;
 };
 
 typedef struct
@@ -56,6 +65,7 @@ typedef struct
   GPtrArray  *unsaved_files;
   gint64      sequence;
   guint       options;
+  guint       for_completion : 1;
 } ParseRequest;
 
 typedef struct
@@ -74,6 +84,10 @@ EGG_DEFINE_COUNTER (ParseAttempts,
                     "Clang",
                     "Total Parse Attempts",
                     "Total number of attempts to create a translation unit.")
+EGG_DEFINE_COUNTER (CompletionParseAttempts,
+                    "Clang",
+                    "Completion Parse Attempts",
+                    "Number of attempts to create a code completion translation unit.")
 
 static void
 parse_request_free (gpointer data)
@@ -258,9 +272,29 @@ ide_clang_service_parse_worker (GTask        *task,
                                       request->options,
                                       &tu);
 
+  if (request->for_completion)
+    EGG_COUNTER_INC (CompletionParseAttempts);
+
   switch (code)
     {
     case CXError_Success:
+      if (request->for_completion)
+        {
+          /*
+           * The precompiled preamble is only built on the first reparse, so
+           * do that now rather than on the first completion request.
+           */
+          if (0 != clang_reparseTranslationUnit (tu,
+                                                 ar->len,
+                                                 (struct CXUnsavedFile *)(void *)ar->data,
+                                                 clang_defaultReparseOptions (tu)))
+            {
+              g_clear_pointer (&tu, clang_disposeTranslationUnit);
+              detail_error = _("Failed to build precompiled preamble");
+            }
+          break;
+        }
+
       index = ide_clang_service_build_index (self, tu, request);
 #ifdef IDE_ENABLE_TRACE
       ide_highlight_index_dump (index);
@@ -345,9 +379,16 @@ ide_clang_service__get_build_flags_cb (GObject      *object,
   }
 #endif
 
-  ide_thread_pool_push_task (IDE_THREAD_POOL_COMPILER,
-                             task,
-                             ide_clang_service_parse_worker);
+  /*
+   * Someone is waiting on the completion unit to be able to show results,
+   * so let it skip ahead of background parsing.
+   */
+  ide_thread_pool_push_task_with_priority (IDE_THREAD_POOL_COMPILER,
+                                           request->for_completion
+                                             ? IDE_THREAD_POOL_PRIORITY_INTERACTIVE
+                                             : IDE_THREAD_POOL_PRIORITY_BACKGROUND,
+                                           task,
+                                           ide_clang_service_parse_worker);
 }
 
 static void
@@ -370,23 +411,20 @@ ide_clang_service_unit_completed_cb (GObject      *object,
 }
 
 static void
-ide_clang_service_get_translation_unit_worker (EggTaskCache  *cache,
-                                               gconstpointer  key,
-                                               GTask         *task,
-                                               gpointer       user_data)
+ide_clang_service_parse (IdeClangService *self,
+                         IdeFile         *file,
+                         gboolean         for_completion,
+                         GTask           *task)
 {
   g_autoptr(GTask) real_task = NULL;
-  IdeClangService *self = user_data;
   IdeUnsavedFiles *unsaved_files;
   IdeBuildSystem *build_system;
   ParseRequest *request;
   IdeContext *context;
   const gchar *path;
-  IdeFile *file = (IdeFile *)key;
   GFile *gfile;
 
   g_assert (IDE_IS_CLANG_SERVICE (self));
-  g_assert (IDE_IS_FILE ((IdeFile *)key));
   g_assert (IDE_IS_FILE (file));
   g_assert (G_IS_TASK (task));
 
@@ -411,6 +449,7 @@ ide_clang_service_get_translation_unit_worker (EggTaskCache  *cache,
   request->command_line_args = NULL;
   request->unsaved_files = ide_unsaved_files_to_array (unsaved_files);
   request->sequence = ide_unsaved_files_get_sequence (unsaved_files);
+  request->for_completion = !!for_completion;
   /*
    * NOTE:
    *
@@ -419,8 +458,13 @@ ide_clang_service_get_translation_unit_worker (EggTaskCache  *cache,
    * quality highlighting, I'm going try try enabling it for now and see how
    * things go.
    */
-  request->options = (clang_defaultEditingTranslationUnitOptions () |
-                      CXTranslationUnit_DetailedPreprocessingRecord);
+  if (for_completion)
+    request->options = (clang_defaultEditingTranslationUnitOptions () |
+                        CXTranslationUnit_PrecompiledPreamble |
+                        CXTranslationUnit_CacheCompletionResults);
+  else
+    request->options = (clang_defaultEditingTranslationUnitOptions () |
+                        CXTranslationUnit_DetailedPreprocessingRecord);
 
   real_task = g_task_new (self,
                           g_task_get_cancellable (task),
@@ -439,6 +483,38 @@ ide_clang_service_get_translation_unit_worker (EggTaskCache  *cache,
                                           g_object_ref (real_task));
 }
 
+static void
+ide_clang_service_get_translation_unit_worker (EggTaskCache  *cache,
+                                               gconstpointer  key,
+                                               GTask         *task,
+                                               gpointer       user_data)
+{
+  IdeClangService *self = user_data;
+
+  g_assert (EGG_IS_TASK_CACHE (cache));
+  g_assert (IDE_IS_CLANG_SERVICE (self));
+  g_assert (IDE_IS_FILE ((IdeFile *)key));
+  g_assert (G_IS_TASK (task));
+
+  ide_clang_service_parse (self, (IdeFile *)key, FALSE, task);
+}
+
+static void
+ide_clang_service_get_completion_unit_worker (EggTaskCache  *cache,
+                                              gconstpointer  key,
+                                              GTask         *task,
+                                              gpointer       user_data)
+{
+  IdeClangService *self = user_data;
+
+  g_assert (EGG_IS_TASK_CACHE (cache));
+  g_assert (IDE_IS_CLANG_SERVICE (self));
+  g_assert (IDE_IS_FILE ((IdeFile *)key));
+  g_assert (G_IS_TASK (task));
+
+  ide_clang_service_parse (self, (IdeFile *)key, TRUE, task);
+}
+
 static void
 ide_clang_service_get_translation_unit_cb (GObject      *object,
                                            GAsyncResult *result,
@@ -526,6 +602,74 @@ ide_clang_service_get_translation_unit_async (IdeClangService     *self,
                             g_object_ref (task));
 }
 
+/**
+ * ide_clang_service_get_completion_unit_async:
+ *
+ * Asynchronously retrieves a translation unit suitable for code completion
+ * on @file. This is a separate translation unit from the one returned by
+ * ide_clang_service_get_translation_unit_async() so that completion does not
+ * contend with diagnostics and highlighting.
+ *
+ * The unit is not reparsed when the buffer changes, since the unsaved files
+ * are provided to clang_codeCompleteAt() directly.
+ */
+void
+ide_clang_service_get_completion_unit_async (IdeClangService     *self,
+                                             IdeFile             *file,
+                                             GCancellable        *cancellable,
+                                             GAsyncReadyCallback  callback,
+                                             gpointer             user_data)
+{
+  g_autoptr(GTask) task = NULL;
+
+  g_return_if_fail (IDE_IS_CLANG_SERVICE (self));
+  g_return_if_fail (IDE_IS_FILE (file));
+  g_return_if_fail (!cancellable || G_IS_CANCELLABLE (cancellable));
+
+  task = g_task_new (self, cancellable, callback, user_data);
+
+  if (ide_file_get_is_temporary (file))
+    {
+      g_task_return_new_error (task,
+                               G_IO_ERROR,
+                               G_IO_ERROR_NOT_FOUND,
+                               "File does not yet exist, ignoring translation unit request.");
+      return;
+    }
+
+  /*
+   * The unit is shared by every completion request for @file, and requests
+   * are cancelled on each keystroke. Only the service may cancel building it,
+   * @cancellable is checked when our own task completes.
+   */
+  egg_task_cache_get_async (self->completion_cache,
+                            file,
+                            FALSE,
+                            self->cancellable,
+                            ide_clang_service_get_translation_unit_cb,
+                            g_object_ref (task));
+}
+
+/**
+ * ide_clang_service_get_completion_unit_finish:
+ *
+ * Completes an asynchronous request to
+ * ide_clang_service_get_completion_unit_async().
+ *
+ * Returns: (transfer full): An #IdeClangTranslationUnit or %NULL up on failure.
+ */
+IdeClangTranslationUnit *
+ide_clang_service_get_completion_unit_finish (IdeClangService  *self,
+                                              GAsyncResult     *result,
+                                              GError          **error)
+{
+  GTask *task = (GTask *)result;
+
+  g_return_val_if_fail (IDE_IS_CLANG_SERVICE (self), NULL);
+
+  return g_task_propagate_pointer (task, error);
+}
+
 /**
  * ide_clang_service_get_translation_unit_finish:
  *
@@ -567,6 +711,17 @@ ide_clang_service_start (IdeService *service)
                                           g_object_ref (self),
                                           g_object_unref);
 
+  self->completion_cache = egg_task_cache_new ((GHashFunc)ide_file_hash,
+                                               (GEqualFunc)ide_file_equal,
+                                               g_object_ref,
+                                               g_object_unref,
+                                               g_object_ref,
+                                               g_object_unref,
+                                               COMPLETION_EVICTION_MSEC,
+                                               ide_clang_service_get_completion_unit_worker,
+                                               g_object_ref (self),
+                                               g_object_unref);
+
   self->index = clang_createIndex (0, 0);
   clang_CXIndex_setGlobalOptions (self->index,
                                   CXGlobalOpt_ThreadBackgroundPriorityForAll);
@@ -582,6 +737,7 @@ ide_clang_service_stop (IdeService *service)
 
   g_cancellable_cancel (self->cancellable);
   g_clear_object (&self->units_cache);
+  g_clear_object (&self->completion_cache);
 }
 
 static void
@@ -592,6 +748,7 @@ ide_clang_service_dispose (GObject *object)
   IDE_ENTRY;
 
   g_clear_object (&self->units_cache);
+  g_clear_object (&self->completion_cache);
   g_clear_object (&self->cancellable);
   g_clear_pointer (&self->index, clang_disposeIndex);
 
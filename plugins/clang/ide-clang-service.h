@@ -39,6 +39,14 @@ IdeClangTranslationUnit *ide_clang_service_get_translation_unit_finish (IdeClang
                                                                         GError              **error);
 IdeClangTranslationUnit *ide_clang_service_get_cached_translation_unit (IdeClangService      *self,
                                                                         IdeFile              *file);
+void                     ide_clang_service_get_completion_unit_async   (IdeClangService      *self,
+                                                                        IdeFile              *file,
+                                                                        GCancellable         *cancellable,
+                                                                        GAsyncReadyCallback   callback,
+                                                                        gpointer              user_data);
+IdeClangTranslationUnit *ide_clang_service_get_completion_unit_finish  (IdeClangService      *self,
+                                                                        GAsyncResult         *result,
+                                                                        GError              **error);
 
 G_END_DECLS
 
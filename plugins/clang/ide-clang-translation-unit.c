@@ -48,6 +48,12 @@ struct _IdeClangTranslationUnit
 {
   IdeObject          parent_instance;
 
+  /*
+   * The CXTranslationUnit is not safe to use from multiple threads at
+   * once. All access to native must be performed while holding mutex.
+   * If the project reader lock is needed too, it must be acquired first.
+   */
+  GMutex             mutex;
   IdeRefPtr         *native;
   gint64             serial;
   GFile             *file;
@@ -207,37 +213,58 @@ get_path (const gchar *workpath,
   return g_strdup (path);
 }
 
-static IdeSourceLocation *
-create_location (IdeClangTranslationUnit *self,
-                 IdeProject              *project,
-                 const gchar             *workpath,
-                 CXSourceLocation         cxloc)
+/*
+ * Resolves @cxloc into a path relative to @workpath. This only touches the
+ * translation unit, so it may be called while holding the mutex.
+ */
+static gchar *
+get_file_location (const gchar      *workpath,
+                   CXSourceLocation  cxloc,
+                   guint            *line,
+                   guint            *column,
+                   guint            *offset)
 {
-  IdeSourceLocation *ret = NULL;
-  IdeFile *file = NULL;
   CXFile cxfile = NULL;
-  g_autofree gchar *path = NULL;
+  gchar *path = NULL;
   const gchar *cstr;
   CXString str;
-  unsigned line;
-  unsigned column;
-  unsigned offset;
-
-  g_return_val_if_fail (self, NULL);
-  g_return_val_if_fail (workpath, NULL);
+  unsigned cxline;
+  unsigned cxcolumn;
+  unsigned cxoffset;
 
-  clang_getFileLocation (cxloc, &cxfile, &line, &column, &offset);
+  clang_getFileLocation (cxloc, &cxfile, &cxline, &cxcolumn, &cxoffset);
 
-  if (line > 0) line--;
-  if (column > 0) column--;
+  *line = cxline > 0 ? cxline - 1 : 0;
+  *column = cxcolumn > 0 ? cxcolumn - 1 : 0;
+  *offset = cxoffset;
 
   str = clang_getFileName (cxfile);
   cstr = clang_getCString (str);
   if (cstr != NULL)
     path = get_path (workpath, cstr);
   clang_disposeString (str);
-  if (cstr == NULL)
-    return NULL;
+
+  return path;
+}
+
+/*
+ * Looks up the project file for @path, which takes the project reader lock.
+ * Never call this while holding the mutex, as the project lock must always
+ * be acquired first.
+ */
+static IdeSourceLocation *
+create_location_for_path (IdeClangTranslationUnit *self,
+                          IdeProject              *project,
+                          const gchar             *path,
+                          guint                    line,
+                          guint                    column,
+                          guint                    offset)
+{
+  IdeFile *file;
+
+  g_assert (IDE_IS_CLANG_TRANSLATION_UNIT (self));
+  g_assert (IDE_IS_PROJECT (project));
+  g_assert (path != NULL);
 
   file = ide_project_get_file_for_path (project, path);
 
@@ -256,9 +283,27 @@ create_location (IdeClangTranslationUnit *self,
                            NULL);
     }
 
-  ret = ide_source_location_new (file, line, column, offset);
+  return ide_source_location_new (file, line, column, offset);
+}
 
-  return ret;
+static IdeSourceLocation *
+create_location (IdeClangTranslationUnit *self,
+                 IdeProject              *project,
+                 const gchar             *workpath,
+                 CXSourceLocation         cxloc)
+{
+  g_autofree gchar *path = NULL;
+  guint line;
+  guint column;
+  guint offset;
+
+  g_return_val_if_fail (self, NULL);
+  g_return_val_if_fail (workpath, NULL);
+
+  if (!(path = get_file_location (workpath, cxloc, &line, &column, &offset)))
+    return NULL;
+
+  return create_location_for_path (self, project, path, line, column, offset);
 }
 
 static IdeSourceRange *
@@ -413,6 +458,7 @@ ide_clang_translation_unit_get_diagnostics_for_file (IdeClangTranslationUnit *se
       workpath = g_file_get_path (workdir);
 
       ide_project_reader_lock (project);
+      g_mutex_lock (&self->mutex);
 
       count = clang_getNumDiagnostics (tu);
       for (i = 0; i < count; i++)
@@ -452,6 +498,7 @@ ide_clang_translation_unit_get_diagnostics_for_file (IdeClangTranslationUnit *se
           clang_disposeDiagnostic (cxdiag);
         }
 
+      g_mutex_unlock (&self->mutex);
       ide_project_reader_unlock (project);
 
       g_hash_table_insert (self->diagnostics, g_object_ref (file), ide_diagnostics_new (diags));
@@ -502,6 +549,7 @@ ide_clang_translation_unit_finalize (GObject *object)
   g_clear_object (&self->file);
   g_clear_pointer (&self->index, ide_highlight_index_unref);
   g_clear_pointer (&self->diagnostics, g_hash_table_unref);
+  g_mutex_clear (&self->mutex);
 
   G_OBJECT_CLASS (ide_clang_translation_unit_parent_class)->finalize (object);
 
@@ -614,6 +662,8 @@ ide_clang_translation_unit_init (IdeClangTranslationUnit *self)
 {
   EGG_COUNTER_INC (instances);
 
+  g_mutex_init (&self->mutex);
+
   self->diagnostics = g_hash_table_new_full ((GHashFunc)g_file_hash,
                                              (GEqualFunc)g_file_equal,
                                              g_object_unref,
@@ -643,9 +693,11 @@ ide_clang_translation_unit_code_complete_worker (GTask        *task,
   tu = ide_ref_ptr_get (self->native);
 
   /*
-   * FIXME: Not thread safe! We should probably add a "Pending" flag or something that is
-   *        similar to g_input_stream_set_pending().
+   * Don't bother if the request went stale while we were queued (such as the
+   * insertion cursor moving on).
    */
+  if (g_task_return_error_if_cancelled (task))
+    return;
 
   if (!state->path)
     {
@@ -686,6 +738,23 @@ ide_clang_translation_unit_code_complete_worker (GTask        *task,
         }
     }
 
+  /*
+   * Only one thread may use the translation unit at a time. The request may
+   * also have become stale while we were waiting on another completion to
+   * finish, so check again once we own the translation unit.
+   */
+  g_mutex_lock (&self->mutex);
+
+  if (g_cancellable_is_cancelled (cancellable))
+    {
+      g_mutex_unlock (&self->mutex);
+      g_task_return_new_error (task,
+                               G_IO_ERROR,
+                               G_IO_ERROR_CANCELLED,
+                               "The operation was cancelled");
+      goto cleanup;
+    }
+
   results = clang_codeCompleteAt (tu,
                                   state->path,
                                   state->line + 1,
@@ -693,6 +762,17 @@ ide_clang_translation_unit_code_complete_worker (GTask        *task,
                                   ufs, j,
                                   clang_defaultCodeCompleteOptions ());
 
+  g_mutex_unlock (&self->mutex);
+
+  if (results == NULL)
+    {
+      g_task_return_new_error (task,
+                               G_IO_ERROR,
+                               G_IO_ERROR_FAILED,
+                               "clang_codeCompleteAt() failed");
+      goto cleanup;
+    }
+
   /*
    * encapsulate in refptr so we don't need to malloc lots of little strings.
    * we will inflate result strings as necessary.
@@ -710,6 +790,7 @@ ide_clang_translation_unit_code_complete_worker (GTask        *task,
 
   g_task_return_pointer (task, ar, (GDestroyNotify)g_ptr_array_unref);
 
+cleanup:
   /* cleanup malloc'd state */
   for (i = 0; i < j; i++)
     g_free ((gchar *)ufs [i].Filename);
@@ -748,16 +829,12 @@ ide_clang_translation_unit_code_complete_async (IdeClangTranslationUnit *self,
   state->line_offset = gtk_text_iter_get_line_offset (location);
   state->unsaved_files = ide_unsaved_files_to_array (unsaved_files);
 
-  /*
-   * TODO: Technically it is not safe for us to go run this in a thread. We need to ensure
-   *       that only one thread is dealing with this at a time.
-   */
-
   g_task_set_task_data (task, state, code_complete_state_free);
 
-  ide_thread_pool_push_task (IDE_THREAD_POOL_COMPILER,
-                             task,
-                             ide_clang_translation_unit_code_complete_worker);
+  ide_thread_pool_push_task_with_priority (IDE_THREAD_POOL_COMPILER,
+                                           IDE_THREAD_POOL_PRIORITY_INTERACTIVE,
+                                           task,
+                                           ide_clang_translation_unit_code_complete_worker);
 
   IDE_EXIT;
 }
@@ -892,10 +969,13 @@ ide_clang_translation_unit_lookup_symbol (IdeClangTranslationUnit  *self,
 {
   g_autofree gchar *filename = NULL;
   g_autofree gchar *workpath = NULL;
-  g_auto(CXString) cxstr = { 0 };
+  g_autofree gchar *definition_path = NULL;
+  g_autofree gchar *included_path = NULL;
+  g_autofree gchar *name = NULL;
   g_autoptr(IdeSourceLocation) declaration = NULL;
   g_autoptr(IdeSourceLocation) definition = NULL;
   g_autoptr(IdeSourceLocation) canonical = NULL;
+  g_auto(CXString) cxstr = { 0 };
   CXTranslationUnit tu;
   IdeSymbolKind symkind = 0;
   IdeSymbolFlags symflags = 0;
@@ -912,6 +992,9 @@ ide_clang_translation_unit_lookup_symbol (IdeClangTranslationUnit  *self,
   GFile *gfile;
   guint line;
   guint line_offset;
+  guint def_line = 0;
+  guint def_column = 0;
+  guint def_offset = 0;
 
   IDE_ENTRY;
 
@@ -931,14 +1014,29 @@ ide_clang_translation_unit_lookup_symbol (IdeClangTranslationUnit  *self,
 
   if (!(file = ide_source_location_get_file (location)) ||
       !(gfile = ide_file_get_file (file)) ||
-      !(filename = g_file_get_path (gfile)) ||
-      !(cxfile = clang_getFile (tu, filename)))
+      !(filename = g_file_get_path (gfile)))
     IDE_RETURN (NULL);
 
+  /*
+   * Only extract plain data from the translation unit while holding the
+   * mutex. Resolving project files takes the project reader lock, which
+   * must never be acquired after the mutex.
+   */
+  g_mutex_lock (&self->mutex);
+
+  if (!(cxfile = clang_getFile (tu, filename)))
+    {
+      g_mutex_unlock (&self->mutex);
+      IDE_RETURN (NULL);
+    }
+
   cxlocation = clang_getLocation (tu, cxfile, line + 1, line_offset + 1);
   cursor = clang_getCursor (tu, cxlocation);
   if (clang_Cursor_isNull (cursor))
-    IDE_RETURN (NULL);
+    {
+      g_mutex_unlock (&self->mutex);
+      IDE_RETURN (NULL);
+    }
 
   tmpcursor = clang_getCursorReferenced (cursor);
   if (!clang_Cursor_isNull (tmpcursor))
@@ -948,7 +1046,7 @@ ide_clang_translation_unit_lookup_symbol (IdeClangTranslationUnit  *self,
 
       cxrange = clang_getCursorExtent (tmpcursor);
       tmploc = clang_getRangeStart (cxrange);
-      definition = create_location (self, project, workpath, tmploc);
+      definition_path = get_file_location (workpath, tmploc, &def_line, &def_column, &def_offset);
     }
 
   symkind = get_symbol_kind (cursor, &symflags);
@@ -957,31 +1055,39 @@ ide_clang_translation_unit_lookup_symbol (IdeClangTranslationUnit  *self,
     {
       CXFile included_file;
       CXString included_file_name;
-      const gchar *path;
 
       included_file = clang_getIncludedFile (cursor);
       included_file_name = clang_getFileName (included_file);
-      path = clang_getCString (included_file_name);
-
-      if (path != NULL)
-        {
-          gfile = g_file_new_for_path (path);
-          file = g_object_new (IDE_TYPE_FILE,
-                               "context", context,
-                               "file", gfile,
-                               "path", path,
-                               NULL);
-
-          g_clear_pointer (&definition, ide_symbol_unref);
-          definition = ide_source_location_new (file, 0, 0, 0);
-
-          g_clear_object (&file);
-          g_clear_object (&gfile);
-        }
+      included_path = g_strdup (clang_getCString (included_file_name));
+      clang_disposeString (included_file_name);
     }
 
   cxstr = clang_getCursorDisplayName (cursor);
-  ret = ide_symbol_new (clang_getCString (cxstr), symkind, symflags,
+  name = g_strdup (clang_getCString (cxstr));
+
+  g_mutex_unlock (&self->mutex);
+
+  if (included_path != NULL)
+    {
+      gfile = g_file_new_for_path (included_path);
+      file = g_object_new (IDE_TYPE_FILE,
+                           "context", context,
+                           "file", gfile,
+                           "path", included_path,
+                           NULL);
+
+      definition = ide_source_location_new (file, 0, 0, 0);
+
+      g_clear_object (&file);
+      g_clear_object (&gfile);
+    }
+  else if (definition_path != NULL)
+    {
+      definition = create_location_for_path (self, project, definition_path,
+                                             def_line, def_column, def_offset);
+    }
+
+  ret = ide_symbol_new (name, symkind, symflags,
                         declaration, definition, canonical);
 
   /*
@@ -1089,10 +1195,12 @@ ide_clang_translation_unit_get_symbols (IdeClangTranslationUnit *self,
   state.file = file;
   state.path = g_file_get_path (ide_file_get_file (file));
 
+  g_mutex_lock (&self->mutex);
   cursor = clang_getTranslationUnitCursor (ide_ref_ptr_get (self->native));
   clang_visitChildren (cursor,
                        ide_clang_translation_unit_get_symbols__visitor_cb,
                        &state);
+  g_mutex_unlock (&self->mutex);
 
   g_ptr_array_sort (state.ar, sort_symbols_by_name);
 
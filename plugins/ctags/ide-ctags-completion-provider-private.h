@@ -19,19 +19,43 @@
 #ifndef IDE_CTAGS_COMPLETION_PROVIDER_PRIVATE_H
 #define IDE_CTAGS_COMPLETION_PROVIDER_PRIVATE_H
 
+#include "ide-ctags-completion-item.h"
 #include "ide-ctags-completion-provider.h"
-#include "ide-completion-results.h"
+#include "ide-ctags-index.h"
 
 G_BEGIN_DECLS
 
+/*
+ * A compact record for a single completion candidate. These live inline
+ * in the candidates array for the current query so that filtering and
+ * ranking tens of thousands of entries does not require a GObject per
+ * entry. The item is only created once the candidate is presented.
+ */
+typedef struct
+{
+  const IdeCtagsIndexEntry *entry;
+  IdeCtagsCompletionItem   *item;
+  guint                     priority;
+} IdeCtagsCompletionCandidate;
+
 struct _IdeCtagsCompletionProvider
 {
-  IdeObject             parent_instance;
-  gint                  minimum_word_size;
-  GSettings            *settings;
-  GPtrArray            *indexes;
-  IdeCompletionResults *results;
-  gchar                *current_word;
+  IdeObject  parent_instance;
+  gint       minimum_word_size;
+  GSettings *settings;
+  GPtrArray *indexes;
+  gchar     *current_word;
+
+  /*
+   * State for the current query. query_indexes holds a reference to the
+   * indexes backing the candidate entries, matches contains offsets into
+   * candidates for the items matching replay, sorted by rank.
+   */
+  GPtrArray *query_indexes;
+  GArray    *candidates;
+  GArray    *matches;
+  gchar     *query;
+  gchar     *replay;
 };
 
 G_END_DECLS
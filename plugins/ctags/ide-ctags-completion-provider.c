@@ -21,9 +21,10 @@
 #include <glib/gi18n.h>
 #include <ide.h>
 
+#include "egg-counter.h"
+
 #include "ide-completion-provider.h"
 #include "ide-completion-item.h"
-#include "ide-completion-results.h"
 #include "ide-context.h"
 #include "ide-ctags-completion-item.h"
 #include "ide-ctags-completion-provider.h"
@@ -33,6 +34,13 @@
 #include "ide-debug.h"
 #include "ide-macros.h"
 
+/*
+ * The completion window only ever shows a handful of rows, so there is no
+ * point in creating proposals for every match of a short prefix. Only the
+ * best ranked matches are materialized as GtkSourceCompletionProposal.
+ */
+#define MAX_VISIBLE_PROPOSALS 250
+
 static void provider_iface_init (GtkSourceCompletionProviderIface *iface);
 
 G_DEFINE_DYNAMIC_TYPE_EXTENDED (IdeCtagsCompletionProvider,
@@ -42,6 +50,9 @@ G_DEFINE_DYNAMIC_TYPE_EXTENDED (IdeCtagsCompletionProvider,
                                 G_IMPLEMENT_INTERFACE (GTK_SOURCE_TYPE_COMPLETION_PROVIDER, provider_iface_init)
                                 G_IMPLEMENT_INTERFACE (IDE_TYPE_COMPLETION_PROVIDER, NULL))
 
+EGG_DEFINE_COUNTER (candidates, "IdeCtagsCompletionProvider", "Candidates", "Number of completion candidates scanned")
+EGG_DEFINE_COUNTER (materialized, "IdeCtagsCompletionProvider", "Materialized", "Number of completion candidates materialized as proposals")
+
 void
 ide_ctags_completion_provider_add_index (IdeCtagsCompletionProvider *self,
                                          IdeCtagsIndex              *index)
@@ -76,6 +87,26 @@ ide_ctags_completion_provider_add_index (IdeCtagsCompletionProvider *self,
   IDE_EXIT;
 }
 
+static void
+clear_candidate (gpointer data)
+{
+  IdeCtagsCompletionCandidate *candidate = data;
+
+  g_clear_object (&candidate->item);
+}
+
+static void
+ide_ctags_completion_provider_clear_query (IdeCtagsCompletionProvider *self)
+{
+  g_assert (IDE_IS_CTAGS_COMPLETION_PROVIDER (self));
+
+  g_clear_pointer (&self->matches, g_array_unref);
+  g_clear_pointer (&self->candidates, g_array_unref);
+  g_clear_pointer (&self->query_indexes, g_ptr_array_unref);
+  g_clear_pointer (&self->query, g_free);
+  g_clear_pointer (&self->replay, g_free);
+}
+
 static void
 ide_ctags_completion_provider_constructed (GObject *object)
 {
@@ -109,10 +140,11 @@ ide_ctags_completion_provider_finalize (GObject *object)
 {
   IdeCtagsCompletionProvider *self = (IdeCtagsCompletionProvider *)object;
 
+  ide_ctags_completion_provider_clear_query (self);
+
   g_clear_pointer (&self->current_word, g_free);
   g_clear_pointer (&self->indexes, g_ptr_array_unref);
   g_clear_object (&self->settings);
-  g_clear_object (&self->results);
 
   G_OBJECT_CLASS (ide_ctags_completion_provider_parent_class)->finalize (object);
 }
@@ -164,64 +196,64 @@ get_allowed_suffixes (GtkSourceCompletionContext *context)
   return ide_ctags_get_allowed_suffixes (lang_id);
 }
 
-static void
-ide_ctags_completion_provider_populate (GtkSourceCompletionProvider *provider,
-                                        GtkSourceCompletionContext  *context)
+/*
+ * Checks if the candidates for the current query can be reused for @word.
+ * Just like ide_completion_results_replay(), the new word must extend the
+ * query with characters that could continue an identifier.
+ */
+static gboolean
+ide_ctags_completion_provider_can_replay (IdeCtagsCompletionProvider *self,
+                                          const gchar                *word)
 {
-  IdeCtagsCompletionProvider *self = (IdeCtagsCompletionProvider *)provider;
-  const gchar * const *allowed;
-  g_autofree gchar *casefold = NULL;
-  gint word_len;
-  guint i;
-  guint j;
-  g_autoptr(GHashTable) completions = NULL;
-
-  IDE_ENTRY;
+  const gchar *suffix;
 
   g_assert (IDE_IS_CTAGS_COMPLETION_PROVIDER (self));
-  g_assert (GTK_SOURCE_IS_COMPLETION_CONTEXT (context));
+  g_assert (word != NULL);
 
-  g_clear_pointer (&self->current_word, g_free);
-  self->current_word = ide_completion_provider_context_current_word (context);
-
-  allowed = get_allowed_suffixes (context);
+  if (self->query == NULL || !g_str_has_prefix (word, self->query))
+    return FALSE;
 
-  if (self->results != NULL)
+  for (suffix = word + strlen (self->query); *suffix; suffix = g_utf8_next_char (suffix))
     {
-      if (ide_completion_results_replay (self->results, self->current_word))
-        {
-          ide_completion_results_present (self->results, provider, context);
-          IDE_EXIT;
-        }
-      g_clear_pointer (&self->results, g_object_unref);
+      gunichar ch = g_utf8_get_char (suffix);
+
+      if (!(ch == '_' || g_unichar_isalnum (ch)))
+        return FALSE;
     }
 
-  word_len = strlen (self->current_word);
-  if (word_len < self->minimum_word_size)
-    IDE_GOTO (word_too_small);
+  return TRUE;
+}
 
-  casefold = g_utf8_casefold (self->current_word, -1);
+static void
+ide_ctags_completion_provider_build_candidates (IdeCtagsCompletionProvider *self,
+                                                const gchar * const        *allowed)
+{
+  g_autoptr(GHashTable) seen = NULL;
+  gsize word_len;
+  guint i;
+
+  g_assert (IDE_IS_CTAGS_COMPLETION_PROVIDER (self));
+  g_assert (self->current_word != NULL);
+
+  ide_ctags_completion_provider_clear_query (self);
+
+  word_len = strlen (self->current_word);
 
-  self->results = ide_completion_results_new (self->current_word);
+  self->query = g_strdup (self->current_word);
+  self->query_indexes = g_ptr_array_new_with_free_func (g_object_unref);
+  self->candidates = g_array_new (FALSE, FALSE, sizeof (IdeCtagsCompletionCandidate));
+  g_array_set_clear_func (self->candidates, clear_candidate);
 
-  completions = g_hash_table_new (g_str_hash, g_str_equal);
+  seen = g_hash_table_new (g_str_hash, g_str_equal);
 
   for (i = 0; i < self->indexes->len; i++)
     {
       g_autofree gchar *copy = g_strdup (self->current_word);
       IdeCtagsIndex *index = g_ptr_array_index (self->indexes, i);
       const IdeCtagsIndexEntry *entries = NULL;
-      guint tmp_len = word_len;
+      gsize tmp_len = word_len;
       gsize n_entries = 0;
-      gchar gdata_key[64];
-
-      /*
-       * Make sure we hold a reference to the index for the lifetime of the results.
-       * When the results are released, so could our indexes.
-       */
-      g_snprintf (gdata_key, sizeof gdata_key, "ctags-%d", i);
-      g_object_set_data_full (G_OBJECT (self->results), gdata_key,
-                              g_object_ref (index), g_object_unref);
+      gsize j;
 
       while (entries == NULL && *copy)
         {
@@ -232,32 +264,181 @@ ide_ctags_completion_provider_populate (GtkSourceCompletionProvider *provider,
       if ((entries == NULL) || (n_entries == 0))
         continue;
 
+      /*
+       * Make sure we hold a reference to the index for the lifetime of the
+       * candidates, as they point directly into the index entries.
+       */
+      g_ptr_array_add (self->query_indexes, g_object_ref (index));
+
       for (j = 0; j < n_entries; j++)
         {
           const IdeCtagsIndexEntry *entry = &entries [j];
-          IdeCtagsCompletionItem *item;
+          IdeCtagsCompletionCandidate candidate = { entry, NULL, 0 };
 
-          if (g_hash_table_contains (completions, entry->name))
+          if (!ide_ctags_is_allowed (entry, allowed))
             continue;
 
-          g_hash_table_add (completions, (gchar *)entry->name);
-
-          if (!ide_ctags_is_allowed (entry, allowed))
+          if (g_hash_table_contains (seen, entry->name))
             continue;
 
-          item = ide_ctags_completion_item_new (self, entry);
+          g_hash_table_add (seen, (gchar *)entry->name);
+          g_array_append_val (self->candidates, candidate);
+        }
+    }
+
+  EGG_COUNTER_ADD (candidates, self->candidates->len);
+}
 
-          if (!ide_completion_item_match (IDE_COMPLETION_ITEM (item), self->current_word, casefold))
-            {
-              g_object_unref (item);
-              continue;
-            }
+static gint
+compare_matches (gconstpointer a,
+                 gconstpointer b,
+                 gpointer      user_data)
+{
+  GArray *candidates = user_data;
+  guint offset_a = *(const guint *)a;
+  guint offset_b = *(const guint *)b;
+  const IdeCtagsCompletionCandidate *ca = &g_array_index (candidates, IdeCtagsCompletionCandidate, offset_a);
+  const IdeCtagsCompletionCandidate *cb = &g_array_index (candidates, IdeCtagsCompletionCandidate, offset_b);
+
+  if (ca->priority < cb->priority)
+    return -1;
+  else if (ca->priority > cb->priority)
+    return 1;
+
+  /* Keep index order for equally ranked items, like ide_list_sort() did */
+  return (offset_a < offset_b) ? -1 : (offset_a > offset_b);
+}
 
-          ide_completion_results_take_proposal (self->results, IDE_COMPLETION_ITEM (item));
+static void
+ide_ctags_completion_provider_refilter (IdeCtagsCompletionProvider *self,
+                                        const gchar                *word)
+{
+  g_autofree gchar *casefold = NULL;
+  gboolean can_reuse;
+  guint n_matches = 0;
+  guint i;
+
+  g_assert (IDE_IS_CTAGS_COMPLETION_PROVIDER (self));
+  g_assert (self->candidates != NULL);
+  g_assert (word != NULL);
+
+  casefold = g_utf8_casefold (word, -1);
+
+  /*
+   * If we are diving deeper into the previous replay, only the items that
+   * matched last time can possibly match now.
+   */
+  can_reuse = (self->matches != NULL &&
+               self->replay != NULL &&
+               g_str_has_prefix (word, self->replay));
+
+  if (!can_reuse)
+    {
+      g_clear_pointer (&self->matches, g_array_unref);
+      self->matches = g_array_sized_new (FALSE, FALSE, sizeof (guint), self->candidates->len);
+
+      for (i = 0; i < self->candidates->len; i++)
+        g_array_append_val (self->matches, i);
+    }
+
+  g_free (self->replay);
+  self->replay = g_strdup (word);
+
+  if (G_UNLIKELY (!g_str_is_ascii (casefold)))
+    {
+      g_warning ("Item filtering requires ascii input.");
+      g_array_set_size (self->matches, 0);
+      return;
+    }
+
+  /* Compact the matches in place, preserving their relative order */
+  for (i = 0; i < self->matches->len; i++)
+    {
+      guint offset = g_array_index (self->matches, guint, i);
+      IdeCtagsCompletionCandidate *candidate;
+
+      candidate = &g_array_index (self->candidates, IdeCtagsCompletionCandidate, offset);
+
+      if (ide_completion_item_fuzzy_match (candidate->entry->name, casefold, &candidate->priority))
+        g_array_index (self->matches, guint, n_matches++) = offset;
+    }
+
+  g_array_set_size (self->matches, n_matches);
+
+  g_array_sort_with_data (self->matches, compare_matches, self->candidates);
+}
+
+static void
+ide_ctags_completion_provider_present (IdeCtagsCompletionProvider *self,
+                                       GtkSourceCompletionContext *context)
+{
+  GList *list = NULL;
+  guint n_visible;
+  guint i;
+
+  g_assert (IDE_IS_CTAGS_COMPLETION_PROVIDER (self));
+  g_assert (GTK_SOURCE_IS_COMPLETION_CONTEXT (context));
+  g_assert (self->matches != NULL);
+
+  n_visible = MIN (self->matches->len, MAX_VISIBLE_PROPOSALS);
+
+  for (i = n_visible; i > 0; i--)
+    {
+      guint offset = g_array_index (self->matches, guint, i - 1);
+      IdeCtagsCompletionCandidate *candidate;
+
+      candidate = &g_array_index (self->candidates, IdeCtagsCompletionCandidate, offset);
+
+      if (candidate->item == NULL)
+        {
+          candidate->item = ide_ctags_completion_item_new (self, candidate->entry);
+          EGG_COUNTER_INC (materialized);
         }
+
+      ide_completion_item_set_priority (IDE_COMPLETION_ITEM (candidate->item), candidate->priority);
+
+      list = g_list_prepend (list, candidate->item);
+    }
+
+  gtk_source_completion_context_add_proposals (context,
+                                               GTK_SOURCE_COMPLETION_PROVIDER (self),
+                                               list,
+                                               TRUE);
+
+  g_list_free (list);
+}
+
+static void
+ide_ctags_completion_provider_populate (GtkSourceCompletionProvider *provider,
+                                        GtkSourceCompletionContext  *context)
+{
+  IdeCtagsCompletionProvider *self = (IdeCtagsCompletionProvider *)provider;
+  const gchar * const *allowed;
+  gint word_len;
+
+  IDE_ENTRY;
+
+  g_assert (IDE_IS_CTAGS_COMPLETION_PROVIDER (self));
+  g_assert (GTK_SOURCE_IS_COMPLETION_CONTEXT (context));
+
+  g_clear_pointer (&self->current_word, g_free);
+  self->current_word = ide_completion_provider_context_current_word (context);
+
+  allowed = get_allowed_suffixes (context);
+
+  if (!ide_ctags_completion_provider_can_replay (self, self->current_word))
+    {
+      ide_ctags_completion_provider_clear_query (self);
+
+      word_len = strlen (self->current_word);
+      if (word_len < self->minimum_word_size)
+        IDE_GOTO (word_too_small);
+
+      ide_ctags_completion_provider_build_candidates (self, allowed);
     }
 
-  ide_completion_results_present (self->results, provider, context);
+  ide_ctags_completion_provider_refilter (self, self->current_word);
+  ide_ctags_completion_provider_present (self, context);
 
   IDE_EXIT;
 
@@ -119,6 +119,7 @@ gbp_devhelp_search_provider_populate (IdeSearchProvider *provider,
       ide_search_reducer_push (&reducer, result);
     }
 
+  ide_search_reducer_flush (&reducer);
   ide_search_context_provider_completed (context, provider);
 }
 
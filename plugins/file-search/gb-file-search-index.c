@@ -16,6 +16,7 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <egg-counter.h>
 #include <fuzzy.h>
 #include <glib/gi18n.h>
 #include <ide.h>
@@ -23,6 +24,11 @@
 #include "gb-file-search-index.h"
 #include "gb-file-search-result.h"
 
+EGG_DEFINE_HISTOGRAM (populate_latency,
+                      "File Search",
+                      "Populate Latency",
+                      "Time to match and push file search results in usec")
+
 struct _GbFileSearchIndex
 {
   IdeObject     parent_instance;
@@ -136,18 +142,22 @@ populate_from_dir (Fuzzy        *fuzzy,
                    GFile        *directory,
                    GCancellable *cancellable)
 {
+  g_autoptr(GPtrArray) file_infos = NULL;
+  g_autoptr(GArray) ignored = NULL;
   GFileEnumerator *enumerator;
   GPtrArray *children = NULL;
   gpointer file_info_ptr;
+  guint i;
 
   g_assert (fuzzy != NULL);
   g_assert (G_IS_FILE (directory));
   g_assert (!cancellable || G_IS_CANCELLABLE (cancellable));
 
-  if (ide_vcs_is_ignored (vcs, directory, NULL))
+  if (relpath == NULL && ide_vcs_is_ignored (vcs, directory, NULL))
     return;
 
   enumerator = g_file_enumerate_children (directory,
+                                          G_FILE_ATTRIBUTE_STANDARD_NAME","
                                           G_FILE_ATTRIBUTE_STANDARD_DISPLAY_NAME","
                                           G_FILE_ATTRIBUTE_STANDARD_TYPE,
                                           G_FILE_QUERY_INFO_NONE,
@@ -157,39 +167,46 @@ populate_from_dir (Fuzzy        *fuzzy,
   if (enumerator == NULL)
     return;
 
+  file_infos = g_ptr_array_new_with_free_func (g_object_unref);
+
   while ((file_info_ptr = g_file_enumerator_next_file (enumerator, cancellable, NULL)))
+    g_ptr_array_add (file_infos, file_info_ptr);
+
+  g_clear_object (&enumerator);
+
+  /*
+   * Check the whole directory listing at once so that the VCS only needs
+   * to resolve the ignore rules for this directory a single time.
+   */
+  ignored = ide_vcs_check_ignored (vcs, directory, file_infos, NULL);
+
+  for (i = 0; i < file_infos->len; i++)
     {
-      g_autoptr(GFileInfo) file_info = file_info_ptr;
+      GFileInfo *file_info = g_ptr_array_index (file_infos, i);
       g_autofree gchar *path = NULL;
-      g_autoptr(GFile) file = NULL;
       const gchar *name;
 
+      if (ignored != NULL && g_array_index (ignored, gboolean, i))
+        continue;
+
       name = g_file_info_get_display_name (file_info);
-      file = g_file_get_child (directory, name);
 
       if (g_file_info_get_file_type (file_info) == G_FILE_TYPE_DIRECTORY)
         {
           if (children == NULL)
             children = g_ptr_array_new_with_free_func (g_object_unref);
-          g_ptr_array_add (children, g_object_ref (file));
+          g_ptr_array_add (children, g_file_get_child (directory, g_file_info_get_name (file_info)));
           continue;
         }
 
-      if (ide_vcs_is_ignored (vcs, file, NULL))
-        continue;
-
       if (relpath != NULL)
         name = path = g_build_filename (relpath, name, NULL);
 
       fuzzy_insert (fuzzy, name, NULL);
     }
 
-  g_clear_object (&enumerator);
-
   if (children != NULL)
     {
-      gsize i;
-
       for (i = 0; i < children->len; i++)
         {
           g_autofree gchar *path = NULL;
@@ -299,6 +316,7 @@ gb_file_search_index_populate (GbFileSearchIndex *self,
   IdeContext *icontext;
   gsize max_matches;
   gsize i;
+  EGG_HISTOGRAM_SCOPE (populate_latency);
 
   g_return_if_fail (GB_IS_FILE_SEARCH_INDEX (self));
   g_return_if_fail (IDE_IS_SEARCH_CONTEXT (context));
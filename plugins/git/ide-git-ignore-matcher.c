@@ -0,0 +1,694 @@
+/* ide-git-ignore-matcher.c
+ *
+ * Copyright (C) 2016 Christian Hergert <chergert@redhat.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define G_LOG_DOMAIN "ide-git-ignore-matcher"
+
+#include <string.h>
+#include <sys/stat.h>
+
+#include "egg-counter.h"
+
+#include "ide-git-ignore-matcher.h"
+
+/**
+ * SECTION:ide-git-ignore-matcher
+ *
+ * This is a compiled form of the .gitignore rules for a working directory.
+ *
+ * ggit_repository_path_is_ignored() serializes on the repository and must
+ * recompute the relative path and reload the attribute stack for every
+ * file it is asked about. Crawlers such as the file search index and the
+ * project tree ask about every file in the project, so instead we parse
+ * each ignore file once, compile its globs into #GRegex and keep them in a
+ * cache keyed by the ignore file path.
+ *
+ * Cached entries are revalidated against the ignore file's stat() info at
+ * most once per %RECHECK_INTERVAL, so edits to a .gitignore are picked up
+ * without the need for a file monitor per directory.
+ *
+ * The matcher is safe to use from multiple threads. The cache is protected
+ * by a mutex, but matching is performed outside of the lock against
+ * immutable, reference counted rule sets.
+ */
+
+#define RECHECK_INTERVAL (G_USEC_PER_SEC)
+
+typedef struct
+{
+  GRegex *regex;
+  guint   negate : 1;
+  guint   dir_only : 1;
+  guint   anchored : 1;
+} IgnoreRule;
+
+typedef struct
+{
+  volatile gint  ref_count;
+
+  /* Directory (relative to workdir) the rules are relative to */
+  gchar         *base;
+  gsize          base_len;
+
+  /* Compiled rules, in file order. Last match wins. */
+  GArray        *rules;
+
+  /* Used to validate the entry against the ignore file */
+  gint64         checked_at;
+  gint64         mtime_sec;
+  glong          mtime_nsec;
+  goffset        size;
+  guint64        inode;
+} IgnoreRules;
+
+struct _IdeGitIgnoreMatcher
+{
+  volatile gint  ref_count;
+
+  GMutex         mutex;
+
+  gchar         *workdir;
+  gchar         *info_exclude;
+  gchar         *excludes_file;
+
+  /* ignore file path -> IgnoreRules */
+  GHashTable    *cache;
+};
+
+EGG_DEFINE_COUNTER (cache_hits, "IdeGitIgnoreMatcher", "Cache Hits", "Number of ignore rule cache hits")
+EGG_DEFINE_COUNTER (cache_misses, "IdeGitIgnoreMatcher", "Cache Misses", "Number of ignore files parsed")
+
+static void
+ignore_rule_clear (gpointer data)
+{
+  IgnoreRule *rule = data;
+
+  g_clear_pointer (&rule->regex, g_regex_unref);
+}
+
+static IgnoreRules *
+ignore_rules_ref (IgnoreRules *rules)
+{
+  g_assert (rules != NULL);
+  g_assert (rules->ref_count > 0);
+
+  g_atomic_int_inc (&rules->ref_count);
+
+  return rules;
+}
+
+static void
+ignore_rules_unref (IgnoreRules *rules)
+{
+  g_assert (rules != NULL);
+  g_assert (rules->ref_count > 0);
+
+  if (g_atomic_int_dec_and_test (&rules->ref_count))
+    {
+      g_clear_pointer (&rules->rules, g_array_unref);
+      g_free (rules->base);
+      g_slice_free (IgnoreRules, rules);
+    }
+}
+
+/*
+ * Translates a gitignore(5) glob into a regular expression.
+ *
+ * "*" and "?" never match "/", a leading "**" followed by "/" matches in
+ * all directories, a trailing "/**" matches everything inside and "/**\/"
+ * matches zero or more directories.
+ */
+static gchar *
+glob_to_regex (const gchar *glob)
+{
+  GString *str;
+  const gchar *p;
+
+  g_assert (glob != NULL);
+
+  str = g_string_new ("^");
+
+  for (p = glob; *p; p++)
+    {
+      switch (*p)
+        {
+        case '*':
+          if (p[1] == '*')
+            {
+              if ((p == glob || p[-1] == '/') && p[2] == '/')
+                {
+                  g_string_append (str, "(?:.*/)?");
+                  p += 2;
+                }
+              else
+                {
+                  g_string_append (str, ".*");
+                  p++;
+                }
+            }
+          else
+            g_string_append (str, "[^/]*");
+          break;
+
+        case '?':
+          g_string_append (str, "[^/]");
+          break;
+
+        case '[':
+          {
+            const gchar *end = p + 1;
+
+            if (*end == '!' || *end == '^')
+              end++;
+            if (*end == ']')
+              end++;
+            while (*end && *end != ']')
+              end++;
+
+            if (*end == '\0')
+              {
+                g_string_append (str, "\\[");
+                break;
+              }
+
+            g_string_append_c (str, '[');
+            p++;
+            if (*p == '!' || *p == '^')
+              {
+                g_string_append_c (str, '^');
+                p++;
+              }
+            for (; p < end; p++)
+              {
+                if (*p == '\\' || *p == '[')
+                  g_string_append_c (str, '\\');
+                g_string_append_c (str, *p);
+              }
+            g_string_append_c (str, ']');
+          }
+          break;
+
+        case '\\':
+          if (p[1] == '\0')
+            break;
+          p++;
+          /* Fall through */
+
+        default:
+          if (strchr ("\\.^$|()[]{}+*?", *p) != NULL)
+            g_string_append_c (str, '\\');
+          g_string_append_c (str, *p);
+          break;
+        }
+    }
+
+  g_string_append_c (str, '$');
+
+  return g_string_free (str, FALSE);
+}
+
+static gboolean
+ignore_rule_parse (IgnoreRule  *rule,
+                   gchar       *line)
+{
+  g_autofree gchar *pattern = NULL;
+  g_autoptr(GError) error = NULL;
+  gsize len;
+
+  g_assert (rule != NULL);
+  g_assert (line != NULL);
+
+  memset (rule, 0, sizeof *rule);
+
+  /* Trailing whitespace is ignored unless escaped */
+  len = strlen (line);
+  while (len > 0 && (line [len - 1] == ' ' || line [len - 1] == '\r' || line [len - 1] == '\t'))
+    {
+      if (len > 1 && line [len - 2] == '\\')
+        break;
+      line [--len] = '\0';
+    }
+
+  if (*line == '\0' || *line == '#')
+    return FALSE;
+
+  if (*line == '!')
+    {
+      rule->negate = TRUE;
+      line++;
+    }
+  else if (*line == '\\' && (line [1] == '#' || line [1] == '!'))
+    {
+      line++;
+    }
+
+  len = strlen (line);
+
+  if (len > 0 && line [len - 1] == '/')
+    {
+      rule->dir_only = TRUE;
+      line [--len] = '\0';
+    }
+
+  if (*line == '\0')
+    return FALSE;
+
+  /* A slash anywhere but the end anchors the pattern to the ignore file's directory */
+  rule->anchored = (strchr (line, '/') != NULL);
+
+  if (*line == '/')
+    line++;
+
+  pattern = glob_to_regex (line);
+  rule->regex = g_regex_new (pattern, G_REGEX_OPTIMIZE, 0, &error);
+
+  if (rule->regex == NULL)
+    {
+      g_debug ("Failed to compile ignore rule \"%s\": %s", line, error->message);
+      return FALSE;
+    }
+
+  return TRUE;
+}
+
+static IgnoreRules *
+ignore_rules_new (const gchar    *path,
+                  const gchar    *base,
+                  struct stat    *st)
+{
+  g_autofree gchar *contents = NULL;
+  IgnoreRules *rules;
+  gsize len = 0;
+
+  g_assert (path != NULL);
+  g_assert (base != NULL);
+
+  rules = g_slice_new0 (IgnoreRules);
+  rules->ref_count = 1;
+  rules->base = g_strdup (base);
+  rules->base_len = strlen (base);
+  rules->rules = g_array_new (FALSE, FALSE, sizeof (IgnoreRule));
+  g_array_set_clear_func (rules->rules, ignore_rule_clear);
+  rules->checked_at = g_get_monotonic_time ();
+
+  if (st != NULL)
+    {
+      rules->mtime_sec = st->st_mtim.tv_sec;
+      rules->mtime_nsec = st->st_mtim.tv_nsec;
+      rules->size = st->st_size;
+      rules->inode = st->st_ino;
+    }
+
+  if (st != NULL && g_file_get_contents (path, &contents, &len, NULL))
+    {
+      gchar **lines;
+      guint i;
+
+      lines = g_strsplit (contents, "\n", 0);
+
+      for (i = 0; lines [i] != NULL; i++)
+        {
+          IgnoreRule rule;
+
+          if (ignore_rule_parse (&rule, lines [i]))
+            g_array_append_val (rules->rules, rule);
+        }
+
+      g_strfreev (lines);
+    }
+
+  EGG_COUNTER_INC (cache_misses);
+
+  return rules;
+}
+
+static gboolean
+ignore_rules_is_valid (IgnoreRules *rules,
+                       struct stat *st)
+{
+  g_assert (rules != NULL);
+
+  if (st == NULL)
+    return rules->inode == 0;
+
+  return (rules->mtime_sec == st->st_mtim.tv_sec &&
+          rules->mtime_nsec == st->st_mtim.tv_nsec &&
+          rules->size == st->st_size &&
+          rules->inode == st->st_ino);
+}
+
+/*
+ * Locates (or parses) the rules for the ignore file at @path.
+ * The rules are relative to @base within the working directory.
+ *
+ * Must be called with the matcher's mutex held.
+ */
+static IgnoreRules *
+ide_git_ignore_matcher_lookup_locked (IdeGitIgnoreMatcher *self,
+                                      const gchar         *path,
+                                      const gchar         *base)
+{
+  IgnoreRules *rules;
+  struct stat st;
+  gboolean exists;
+  gint64 now;
+
+  g_assert (self != NULL);
+  g_assert (path != NULL);
+  g_assert (base != NULL);
+
+  now = g_get_monotonic_time ();
+  rules = g_hash_table_lookup (self->cache, path);
+
+  if (rules != NULL && (now - rules->checked_at) < RECHECK_INTERVAL)
+    {
+      EGG_COUNTER_INC (cache_hits);
+      return ignore_rules_ref (rules);
+    }
+
+  exists = (stat (path, &st) == 0 && S_ISREG (st.st_mode));
+
+  if (rules != NULL && ignore_rules_is_valid (rules, exists ? &st : NULL))
+    {
+      EGG_COUNTER_INC (cache_hits);
+      rules->checked_at = now;
+      return ignore_rules_ref (rules);
+    }
+
+  rules = ignore_rules_new (path, base, exists ? &st : NULL);
+  g_hash_table_insert (self->cache, g_strdup (path), ignore_rules_ref (rules));
+
+  return rules;
+}
+
+static void
+ide_git_ignore_matcher_push_dir_locked (IdeGitIgnoreMatcher *self,
+                                        GPtrArray           *stack,
+                                        const gchar         *dir_relpath)
+{
+  g_autofree gchar *path = NULL;
+
+  g_assert (self != NULL);
+  g_assert (stack != NULL);
+  g_assert (dir_relpath != NULL);
+
+  path = g_build_filename (self->workdir, dir_relpath, ".gitignore", NULL);
+  g_ptr_array_add (stack, ide_git_ignore_matcher_lookup_locked (self, path, dir_relpath));
+}
+
+/*
+ * Evaluates @relpath against the rule sets in @stack, which are ordered
+ * from lowest to highest precedence.
+ */
+static gboolean
+evaluate (GPtrArray   *stack,
+          const gchar *relpath,
+          gboolean     is_dir)
+{
+  const gchar *basename;
+  gboolean ret = FALSE;
+  guint i;
+
+  g_assert (stack != NULL);
+  g_assert (relpath != NULL);
+
+  if ((basename = strrchr (relpath, '/')))
+    basename++;
+  else
+    basename = relpath;
+
+  if (is_dir && strcmp (basename, ".git") == 0)
+    return TRUE;
+
+  for (i = 0; i < stack->len; i++)
+    {
+      IgnoreRules *rules = g_ptr_array_index (stack, i);
+      const gchar *rel = relpath;
+      guint j;
+
+      if (rules->base_len > 0)
+        {
+          if (strncmp (relpath, rules->base, rules->base_len) != 0 ||
+              relpath [rules->base_len] != '/')
+            continue;
+          rel = relpath + rules->base_len + 1;
+        }
+
+      for (j = 0; j < rules->rules->len; j++)
+        {
+          const IgnoreRule *rule = &g_array_index (rules->rules, IgnoreRule, j);
+
+          if (rule->dir_only && !is_dir)
+            continue;
+
+          if (rule->negate == !ret)
+            continue;
+
+          if (g_regex_match (rule->regex, rule->anchored ? rel : basename, 0, NULL))
+            ret = !rule->negate;
+        }
+    }
+
+  return ret;
+}
+
+/*
+ * Builds the stack of rule sets that apply to the children of @dir_relpath
+ * while checking that none of the parent directories are ignored. Git will
+ * not descend into ignored directories, so neither do we.
+ */
+static GPtrArray *
+ide_git_ignore_matcher_build_stack (IdeGitIgnoreMatcher *self,
+                                    const gchar         *dir_relpath,
+                                    gboolean            *dir_ignored)
+{
+  g_auto(GStrv) parts = NULL;
+  GPtrArray *stack;
+  GString *prefix;
+  guint i;
+
+  g_assert (self != NULL);
+  g_assert (dir_relpath != NULL);
+  g_assert (dir_ignored != NULL);
+
+  *dir_ignored = FALSE;
+
+  stack = g_ptr_array_new_with_free_func ((GDestroyNotify)ignore_rules_unref);
+  parts = g_strsplit (dir_relpath, "/", 0);
+  prefix = g_string_new (NULL);
+
+  g_mutex_lock (&self->mutex);
+
+  if (self->excludes_file != NULL)
+    g_ptr_array_add (stack, ide_git_ignore_matcher_lookup_locked (self, self->excludes_file, ""));
+  g_ptr_array_add (stack, ide_git_ignore_matcher_lookup_locked (self, self->info_exclude, ""));
+  ide_git_ignore_matcher_push_dir_locked (self, stack, "");
+
+  for (i = 0; parts [i] != NULL; i++)
+    {
+      if (parts [i][0] == '\0')
+        continue;
+
+      if (prefix->len > 0)
+        g_string_append_c (prefix, '/');
+      g_string_append (prefix, parts [i]);
+
+      /*
+       * Drop the lock while evaluating so that other threads may make
+       * progress. The rule sets in @stack are immutable.
+       */
+      g_mutex_unlock (&self->mutex);
+      *dir_ignored = evaluate (stack, prefix->str, TRUE);
+      g_mutex_lock (&self->mutex);
+
+      if (*dir_ignored)
+        break;
+
+      ide_git_ignore_matcher_push_dir_locked (self, stack, prefix->str);
+    }
+
+  g_mutex_unlock (&self->mutex);
+
+  g_string_free (prefix, TRUE);
+
+  return stack;
+}
+
+gboolean
+ide_git_ignore_matcher_is_ignored (IdeGitIgnoreMatcher *self,
+                                   const gchar         *relpath,
+                                   gboolean             is_dir)
+{
+  g_autofree gchar *dir_relpath = NULL;
+  g_autoptr(GPtrArray) stack = NULL;
+  gboolean dir_ignored = FALSE;
+
+  g_return_val_if_fail (self != NULL, FALSE);
+  g_return_val_if_fail (relpath != NULL, FALSE);
+
+  if (*relpath == '\0')
+    return FALSE;
+
+  dir_relpath = g_path_get_dirname (relpath);
+  if (g_strcmp0 (dir_relpath, ".") == 0)
+    dir_relpath [0] = '\0';
+
+  stack = ide_git_ignore_matcher_build_stack (self, dir_relpath, &dir_ignored);
+
+  if (dir_ignored)
+    return TRUE;
+
+  return evaluate (stack, relpath, is_dir);
+}
+
+/**
+ * ide_git_ignore_matcher_check_children:
+ * @self: An #IdeGitIgnoreMatcher
+ * @dir_relpath: the directory containing @names, relative to the workdir
+ * @names: (array zero-terminated=1): the names of the children
+ * @is_dir: an array of the same length as @names
+ * @ignored: (out caller-allocates): the location to store the results
+ *
+ * Checks all of the children of a directory at once. The rule stack for
+ * the directory is only resolved a single time.
+ *
+ * Returns: %TRUE if @dir_relpath itself is ignored, in which case all
+ *   elements of @ignored are set to %TRUE.
+ */
+gboolean
+ide_git_ignore_matcher_check_children (IdeGitIgnoreMatcher *self,
+                                       const gchar         *dir_relpath,
+                                       const gchar * const *names,
+                                       const gboolean      *is_dir,
+                                       gboolean            *ignored)
+{
+  g_autoptr(GPtrArray) stack = NULL;
+  gboolean dir_ignored = FALSE;
+  guint i;
+
+  g_return_val_if_fail (self != NULL, FALSE);
+  g_return_val_if_fail (dir_relpath != NULL, FALSE);
+  g_return_val_if_fail (names != NULL, FALSE);
+  g_return_val_if_fail (is_dir != NULL, FALSE);
+  g_return_val_if_fail (ignored != NULL, FALSE);
+
+  stack = ide_git_ignore_matcher_build_stack (self, dir_relpath, &dir_ignored);
+
+  for (i = 0; names [i] != NULL; i++)
+    {
+      g_autofree gchar *relpath = NULL;
+
+      if (dir_ignored)
+        {
+          ignored [i] = TRUE;
+          continue;
+        }
+
+      if (*dir_relpath != '\0')
+        relpath = g_strdup_printf ("%s/%s", dir_relpath, names [i]);
+
+      ignored [i] = evaluate (stack, relpath ? relpath : names [i], is_dir [i]);
+    }
+
+  return dir_ignored;
+}
+
+/**
+ * ide_git_ignore_matcher_invalidate:
+ *
+ * Drops all cached rule sets. They will be reloaded upon the next request.
+ */
+void
+ide_git_ignore_matcher_invalidate (IdeGitIgnoreMatcher *self)
+{
+  g_return_if_fail (self != NULL);
+
+  g_mutex_lock (&self->mutex);
+  g_hash_table_remove_all (self->cache);
+  g_mutex_unlock (&self->mutex);
+}
+
+/**
+ * ide_git_ignore_matcher_new:
+ * @workdir: the working directory of the repository
+ * @gitdir: the location of the .git directory
+ * @excludes_file: (nullable): the value of core.excludesfile, if any
+ *
+ * Returns: (transfer full): An #IdeGitIgnoreMatcher.
+ */
+IdeGitIgnoreMatcher *
+ide_git_ignore_matcher_new (const gchar *workdir,
+                            const gchar *gitdir,
+                            const gchar *excludes_file)
+{
+  IdeGitIgnoreMatcher *self;
+
+  g_return_val_if_fail (workdir != NULL, NULL);
+  g_return_val_if_fail (gitdir != NULL, NULL);
+
+  self = g_slice_new0 (IdeGitIgnoreMatcher);
+  self->ref_count = 1;
+  g_mutex_init (&self->mutex);
+  self->workdir = g_strdup (workdir);
+  self->info_exclude = g_build_filename (gitdir, "info", "exclude", NULL);
+  self->cache = g_hash_table_new_full (g_str_hash,
+                                       g_str_equal,
+                                       g_free,
+                                       (GDestroyNotify)ignore_rules_unref);
+
+  if (excludes_file != NULL)
+    {
+      if (excludes_file [0] == '~' && excludes_file [1] == '/')
+        self->excludes_file = g_build_filename (g_get_home_dir (), excludes_file + 2, NULL);
+      else
+        self->excludes_file = g_strdup (excludes_file);
+    }
+  else
+    {
+      self->excludes_file = g_build_filename (g_get_user_config_dir (), "git", "ignore", NULL);
+    }
+
+  return self;
+}
+
+IdeGitIgnoreMatcher *
+ide_git_ignore_matcher_ref (IdeGitIgnoreMatcher *self)
+{
+  g_return_val_if_fail (self != NULL, NULL);
+  g_return_val_if_fail (self->ref_count > 0, NULL);
+
+  g_atomic_int_inc (&self->ref_count);
+
+  return self;
+}
+
+void
+ide_git_ignore_matcher_unref (IdeGitIgnoreMatcher *self)
+{
+  g_return_if_fail (self != NULL);
+  g_return_if_fail (self->ref_count > 0);
+
+  if (g_atomic_int_dec_and_test (&self->ref_count))
+    {
+      g_clear_pointer (&self->cache, g_hash_table_unref);
+      g_free (self->workdir);
+      g_free (self->info_exclude);
+      g_free (self->excludes_file);
+      g_mutex_clear (&self->mutex);
+      g_slice_free (IdeGitIgnoreMatcher, self);
+    }
+}
@@ -26,6 +26,7 @@
 #include "ide-context.h"
 #include "ide-debug.h"
 #include "ide-git-buffer-change-monitor.h"
+#include "ide-git-ignore-matcher.h"
 #include "ide-git-vcs.h"
 #include "ide-project.h"
 #include "ide-project-file.h"
@@ -40,6 +41,8 @@ struct _IdeGitVcs
   GgitRepository *repository;
   GgitRepository *change_monitor_repository;
 
+  IdeGitIgnoreMatcher *ignore_matcher;
+
   GFile          *working_directory;
   GFileMonitor   *monitor;
 
@@ -148,6 +151,40 @@ ide_git_vcs_load (IdeGitVcs  *self,
   return repository;
 }
 
+static IdeGitIgnoreMatcher *
+ide_git_vcs_create_ignore_matcher (IdeGitVcs      *self,
+                                  GgitRepository *repository)
+{
+  IdeGitIgnoreMatcher *ret;
+  g_autoptr(GFile) location = NULL;
+  g_autofree gchar *workdir = NULL;
+  g_autofree gchar *gitdir = NULL;
+  GgitConfig *orig_config;
+  GgitConfig *config = NULL;
+  const gchar *excludes_file = NULL;
+
+  g_assert (IDE_IS_GIT_VCS (self));
+  g_assert (GGIT_IS_REPOSITORY (repository));
+
+  location = ggit_repository_get_location (repository);
+  gitdir = g_file_get_path (location);
+  workdir = g_file_get_path (self->working_directory);
+
+  if (workdir == NULL || gitdir == NULL)
+    return NULL;
+
+  if ((orig_config = ggit_repository_get_config (repository, NULL)) &&
+      (config = ggit_config_snapshot (orig_config, NULL)))
+    excludes_file = ggit_config_get_string (config, "core.excludesfile", NULL);
+
+  ret = ide_git_ignore_matcher_new (workdir, gitdir, excludes_file);
+
+  g_clear_object (&config);
+  g_clear_object (&orig_config);
+
+  return ret;
+}
+
 static gboolean
 ide_git_vcs__changed_timeout_cb (gpointer user_data)
 {
@@ -229,6 +266,7 @@ ide_git_vcs_reload_worker (GTask        *task,
   IdeGitVcs *self = source_object;
   g_autoptr(GgitRepository) repository1 = NULL;
   g_autoptr(GgitRepository) repository2 = NULL;
+  IdeGitIgnoreMatcher *matcher;
   GError *error = NULL;
 
   g_assert (G_IS_TASK (task));
@@ -245,6 +283,20 @@ ide_git_vcs_reload_worker (GTask        *task,
   g_set_object (&self->repository, repository1);
   g_set_object (&self->change_monitor_repository, repository2);
 
+  /*
+   * Only created once, on load, so that threads checking ignored files
+   * never see the matcher change underneath them. Later reloads simply
+   * drop the cached rules. Readers may be running on other threads, so
+   * the matcher is published with an atomic exchange.
+   */
+  matcher = g_atomic_pointer_get (&self->ignore_matcher);
+
+  if (matcher != NULL)
+    ide_git_ignore_matcher_invalidate (matcher);
+  else if ((matcher = ide_git_vcs_create_ignore_matcher (self, repository1)) &&
+           !g_atomic_pointer_compare_and_exchange (&self->ignore_matcher, NULL, matcher))
+    ide_git_ignore_matcher_unref (matcher);
+
   if (!ide_git_vcs_load_monitor (self, &error))
     {
       g_task_return_error (task, error);
@@ -299,7 +351,8 @@ ide_git_vcs_is_ignored (IdeVcs  *vcs,
 {
   g_autofree gchar *name = NULL;
   IdeGitVcs *self = (IdeGitVcs *)vcs;
-  gboolean ret = FALSE;
+  IdeGitIgnoreMatcher *matcher;
+  gboolean is_dir;
 
   g_assert (IDE_IS_GIT_VCS (self));
   g_assert (G_IS_FILE (file));
@@ -308,9 +361,75 @@ ide_git_vcs_is_ignored (IdeVcs  *vcs,
   if (g_strcmp0 (name, ".git") == 0)
     return TRUE;
 
-  if (name != NULL)
+  if (name == NULL)
+    return FALSE;
+
+  if (!(matcher = g_atomic_pointer_get (&self->ignore_matcher)))
     return ggit_repository_path_is_ignored (self->repository, name, error);
 
+  is_dir = g_file_query_file_type (file, G_FILE_QUERY_INFO_NONE, NULL) == G_FILE_TYPE_DIRECTORY;
+
+  return ide_git_ignore_matcher_is_ignored (matcher, name, is_dir);
+}
+
+static GArray *
+ide_git_vcs_check_ignored (IdeVcs     *vcs,
+                           GFile      *directory,
+                           GPtrArray  *file_infos,
+                           GError    **error)
+{
+  IdeGitVcs *self = (IdeGitVcs *)vcs;
+  g_autofree gchar *dir_relpath = NULL;
+  g_autofree const gchar **names = NULL;
+  g_autofree gboolean *is_dir = NULL;
+  IdeGitIgnoreMatcher *matcher;
+  GArray *ret;
+  guint i;
+
+  g_assert (IDE_IS_GIT_VCS (self));
+  g_assert (G_IS_FILE (directory));
+  g_assert (file_infos != NULL);
+
+  ret = g_array_sized_new (FALSE, TRUE, sizeof (gboolean), file_infos->len);
+  g_array_set_size (ret, file_infos->len);
+
+  if (g_file_equal (directory, self->working_directory))
+    dir_relpath = g_strdup ("");
+  else if (!(dir_relpath = g_file_get_relative_path (self->working_directory, directory)))
+    return ret;
+
+  if (!(matcher = g_atomic_pointer_get (&self->ignore_matcher)))
+    {
+      for (i = 0; i < file_infos->len; i++)
+        {
+          GFileInfo *file_info = g_ptr_array_index (file_infos, i);
+          g_autofree gchar *relpath = NULL;
+
+          relpath = g_build_filename (dir_relpath, g_file_info_get_name (file_info), NULL);
+          g_array_index (ret, gboolean, i) =
+            ggit_repository_path_is_ignored (self->repository, relpath, NULL);
+        }
+
+      return ret;
+    }
+
+  names = g_new0 (const gchar *, file_infos->len + 1);
+  is_dir = g_new0 (gboolean, file_infos->len);
+
+  for (i = 0; i < file_infos->len; i++)
+    {
+      GFileInfo *file_info = g_ptr_array_index (file_infos, i);
+
+      names [i] = g_file_info_get_name (file_info);
+      is_dir [i] = g_file_info_get_file_type (file_info) == G_FILE_TYPE_DIRECTORY;
+    }
+
+  ide_git_ignore_matcher_check_children (matcher,
+                                         dir_relpath,
+                                         (const gchar * const *)names,
+                                         is_dir,
+                                         (gboolean *)(gpointer)ret->data);
+
   return ret;
 }
 
@@ -334,6 +453,7 @@ ide_git_vcs_dispose (GObject *object)
       g_clear_object (&self->monitor);
     }
 
+  g_clear_pointer (&self->ignore_matcher, ide_git_ignore_matcher_unref);
   g_clear_object (&self->change_monitor_repository);
   g_clear_object (&self->repository);
   g_clear_object (&self->working_directory);
@@ -368,6 +488,7 @@ ide_git_vcs_init_iface (IdeVcsInterface *iface)
   iface->get_working_directory = ide_git_vcs_get_working_directory;
   iface->get_buffer_change_monitor = ide_git_vcs_get_buffer_change_monitor;
   iface->is_ignored = ide_git_vcs_is_ignored;
+  iface->check_ignored = ide_git_vcs_check_ignored;
 }
 
 static void
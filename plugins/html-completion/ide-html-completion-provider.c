@@ -24,11 +24,11 @@
 #include "ide-completion-provider.h"
 #include "ide-html-completion-provider.h"
 
-#include "trie.h"
-
-static GHashTable *element_attrs;
-static Trie *css_styles;
-static Trie *elements;
+typedef struct
+{
+  const gchar *element;
+  const gchar *attribute;
+} HtmlAttribute;
 
 enum {
   MODE_NONE,
@@ -50,6 +50,265 @@ struct _IdeHtmlCompletionProvider
   IdeObject parent_instance;
 };
 
+/*
+ * http://www.w3.org/TR/html-markup/elements.html
+ *
+ * These tables must be kept sorted with strcmp() ordering since they are
+ * searched with a binary search. Attributes are sorted by element and then
+ * by attribute. The "*" element holds the global attributes.
+ */
+static const gchar *html_elements[] = {
+  "a", "abbr", "acronym", "address", "applet", "area", "article", "aside",
+  "audio", "b", "base", "basefont", "bdi", "bdo", "big", "blockquote", "body",
+  "br", "button", "canvas", "caption", "center", "cite", "code", "col",
+  "colgroup", "datalist", "dd", "del", "details", "dfn", "dialog", "dir",
+  "div", "dl", "dt", "em", "embed", "fieldset", "figcaption", "figure", "font",
+  "footer", "form", "frame", "frameset", "h1", "h2", "h3", "h4", "h5", "h6",
+  "head", "header", "hgroup", "hr", "html", "i", "iframe", "img", "input",
+  "ins", "kbd", "keygen", "label", "legend", "li", "link", "main", "map",
+  "mark", "menu", "menuitem", "meta", "meter", "nav", "noframes", "noscript",
+  "object", "ol", "optgroup", "option", "output", "p", "param", "pre",
+  "progress", "q", "rp", "rt", "ruby", "s", "samp", "script", "section",
+  "select", "small", "source", "span", "strike", "strong", "style", "sub",
+  "summary", "sup", "table", "tbody", "td", "textarea", "tfoot", "th", "thead",
+  "time", "title", "tr", "track", "tt", "u", "ul", "var", "video", "wbr",
+};
+
+static const HtmlAttribute html_attributes[] = {
+  { "*",          "accesskey" },
+  { "*",          "class" },
+  { "*",          "contenteditable" },
+  { "*",          "contextmenu" },
+  { "*",          "dir" },
+  { "*",          "draggable" },
+  { "*",          "dropzone" },
+  { "*",          "hidden" },
+  { "*",          "id" },
+  { "*",          "lang" },
+  { "*",          "spellcheck" },
+  { "*",          "style" },
+  { "*",          "tabindex" },
+  { "*",          "title" },
+  { "*",          "translate" },
+  { "a",          "href" },
+  { "a",          "hreflang" },
+  { "a",          "media" },
+  { "a",          "rel" },
+  { "a",          "target" },
+  { "a",          "type" },
+  { "area",       "alt" },
+  { "area",       "coords" },
+  { "area",       "href" },
+  { "area",       "hreflang" },
+  { "area",       "media" },
+  { "area",       "rel" },
+  { "area",       "shape" },
+  { "area",       "target" },
+  { "area",       "type" },
+  { "audio",      "autoplay" },
+  { "audio",      "controls" },
+  { "audio",      "loop" },
+  { "audio",      "mediagroup" },
+  { "audio",      "muted" },
+  { "audio",      "preload" },
+  { "audio",      "src" },
+  { "base",       "href" },
+  { "base",       "target" },
+  { "blockquote", "cite" },
+  { "button",     "autofocus" },
+  { "button",     "disabled" },
+  { "button",     "form" },
+  { "button",     "formaction" },
+  { "button",     "formmethod" },
+  { "button",     "formnovalidate" },
+  { "button",     "formtarget" },
+  { "button",     "name" },
+  { "button",     "type" },
+  { "button",     "value" },
+  { "canvas",     "height" },
+  { "canvas",     "width" },
+  { "col",        "span" },
+  { "colgroup",   "span" },
+  { "command",    "checked" },
+  { "command",    "icon" },
+  { "command",    "label" },
+  { "command",    "radiogroup" },
+  { "command",    "type" },
+  { "del",        "cite" },
+  { "del",        "datetime" },
+  { "details",    "open" },
+  { "embed",      "height" },
+  { "embed",      "src" },
+  { "embed",      "type" },
+  { "embed",      "width" },
+  { "fieldset",   "disabled" },
+  { "fieldset",   "form" },
+  { "fieldset",   "name" },
+  { "form",       "accept-charset" },
+  { "form",       "action" },
+  { "form",       "autocomplete" },
+  { "form",       "enctype" },
+  { "form",       "method" },
+  { "form",       "name" },
+  { "form",       "novalidate" },
+  { "form",       "target" },
+  { "html",       "manifest" },
+  { "iframe",     "height" },
+  { "iframe",     "name" },
+  { "iframe",     "sandbox" },
+  { "iframe",     "seamless" },
+  { "iframe",     "src" },
+  { "iframe",     "srcdoc" },
+  { "iframe",     "width" },
+  { "img",        "alt" },
+  { "img",        "height" },
+  { "img",        "ismap" },
+  { "img",        "src" },
+  { "img",        "usemap" },
+  { "img",        "width" },
+  { "input",      "accept" },
+  { "input",      "alt" },
+  { "input",      "autocomplete" },
+  { "input",      "autofocus" },
+  { "input",      "dirname" },
+  { "input",      "disabled" },
+  { "input",      "form" },
+  { "input",      "formaction" },
+  { "input",      "formenctype" },
+  { "input",      "formmethod" },
+  { "input",      "formnovalidate" },
+  { "input",      "formtarget" },
+  { "input",      "height" },
+  { "input",      "list" },
+  { "input",      "max" },
+  { "input",      "maxlength" },
+  { "input",      "min" },
+  { "input",      "multiple" },
+  { "input",      "name" },
+  { "input",      "pattern" },
+  { "input",      "placeholder" },
+  { "input",      "readonly" },
+  { "input",      "required" },
+  { "input",      "size" },
+  { "input",      "src" },
+  { "input",      "step" },
+  { "input",      "type" },
+  { "input",      "value" },
+  { "input",      "width" },
+  { "ins",        "cite" },
+  { "ins",        "datetime" },
+  { "keygen",     "autofocus" },
+  { "keygen",     "challenge" },
+  { "keygen",     "disabled" },
+  { "keygen",     "form" },
+  { "keygen",     "keytype" },
+  { "keygen",     "name" },
+  { "label",      "for" },
+  { "label",      "form" },
+  { "li",         "value" },
+  { "link",       "href" },
+  { "link",       "hreflang" },
+  { "link",       "media" },
+  { "link",       "rel" },
+  { "link",       "sizes" },
+  { "link",       "type" },
+  { "map",        "name" },
+  { "menu",       "label" },
+  { "menu",       "type" },
+  { "meta",       "charset" },
+  { "meta",       "content" },
+  { "meta",       "http-equiv" },
+  { "meter",      "high" },
+  { "meter",      "low" },
+  { "meter",      "max" },
+  { "meter",      "min" },
+  { "meter",      "optimum" },
+  { "meter",      "value" },
+  { "object",     "data" },
+  { "object",     "form" },
+  { "object",     "height" },
+  { "object",     "name" },
+  { "object",     "type" },
+  { "object",     "usemap" },
+  { "object",     "width" },
+  { "ol",         "reversed" },
+  { "ol",         "start" },
+  { "ol",         "type" },
+  { "optgroup",   "disabled" },
+  { "optgroup",   "label" },
+  { "option",     "disabled" },
+  { "option",     "label" },
+  { "option",     "selected" },
+  { "option",     "value" },
+  { "output",     "for" },
+  { "output",     "form" },
+  { "output",     "name" },
+  { "param",      "name" },
+  { "param",      "value" },
+  { "progress",   "max" },
+  { "progress",   "value" },
+  { "q",          "cite" },
+  { "script",     "async" },
+  { "script",     "charset" },
+  { "script",     "defer" },
+  { "script",     "language" },
+  { "script",     "src" },
+  { "script",     "type" },
+  { "select",     "autofocus" },
+  { "select",     "disabled" },
+  { "select",     "form" },
+  { "select",     "multiple" },
+  { "select",     "name" },
+  { "select",     "required" },
+  { "select",     "size" },
+  { "source",     "media" },
+  { "source",     "src" },
+  { "source",     "type" },
+  { "style",      "media" },
+  { "style",      "scoped" },
+  { "style",      "type" },
+  { "table",      "border" },
+  { "td",         "colspan" },
+  { "td",         "headers" },
+  { "td",         "rowspan" },
+  { "textarea",   "autofocus" },
+  { "textarea",   "cols" },
+  { "textarea",   "dirname" },
+  { "textarea",   "disabled" },
+  { "textarea",   "form" },
+  { "textarea",   "maxlength" },
+  { "textarea",   "name" },
+  { "textarea",   "placeholder" },
+  { "textarea",   "readonly" },
+  { "textarea",   "required" },
+  { "textarea",   "rows" },
+  { "textarea",   "wrap" },
+  { "th",         "colspan" },
+  { "th",         "headers" },
+  { "th",         "rowspan" },
+  { "th",         "scope" },
+  { "time",       "datetime" },
+  { "track",      "default" },
+  { "track",      "kind" },
+  { "track",      "label" },
+  { "track",      "src" },
+  { "track",      "srclang" },
+  { "video",      "autoplay" },
+  { "video",      "controls" },
+  { "video",      "height" },
+  { "video",      "loop" },
+  { "video",      "mediagroup" },
+  { "video",      "muted" },
+  { "video",      "poster" },
+  { "video",      "preload" },
+  { "video",      "src" },
+  { "video",      "width" },
+};
+
+static const gchar *css_properties[] = {
+  "background", "background-color", "background-image", "border", "text-align",
+};
+
 static void completion_provider_init (GtkSourceCompletionProviderIface *);
 
 G_DEFINE_DYNAMIC_TYPE_EXTENDED (IdeHtmlCompletionProvider,
@@ -263,20 +522,14 @@ get_mode (GtkSourceCompletionContext *context)
   return MODE_NONE;
 }
 
-static gboolean
-traverse_cb (Trie        *trie,
-             const gchar *key,
-             gpointer     value,
-             gpointer     user_data)
+static void
+add_item (SearchState *state,
+          const gchar *key)
 {
-  SearchState *state = user_data;
   GtkSourceCompletionItem *item;
   const gchar *text = key;
   gchar *tmp = NULL;
 
-  g_return_val_if_fail (trie, FALSE);
-  g_return_val_if_fail (state, FALSE);
-
   if (state->mode == MODE_ATTRIBUTE_NAME)
     {
       tmp = g_strdup_printf ("%s=", key);
@@ -291,8 +544,126 @@ traverse_cb (Trie        *trie,
   state->results = g_list_prepend (state->results, item);
 
   g_free (tmp);
+}
 
-  return FALSE;
+/*
+ * Locates the first string in the sorted @strv that is not less than
+ * @prefix. Every string starting with @prefix follows it.
+ */
+static gsize
+strv_lower_bound (const gchar **strv,
+                  gsize         len,
+                  const gchar  *prefix)
+{
+  gsize lo = 0;
+  gsize hi = len;
+
+  while (lo < hi)
+    {
+      gsize mid = lo + ((hi - lo) / 2);
+
+      if (strcmp (strv [mid], prefix) < 0)
+        lo = mid + 1;
+      else
+        hi = mid;
+    }
+
+  return lo;
+}
+
+static void
+add_strv_matches (SearchState  *state,
+                  const gchar **strv,
+                  gsize         len,
+                  const gchar  *prefix)
+{
+  gsize i;
+
+  for (i = strv_lower_bound (strv, len, prefix);
+       i < len && g_str_has_prefix (strv [i], prefix);
+       i++)
+    add_item (state, strv [i]);
+}
+
+/*
+ * Gets the range of attributes of @element starting with @prefix.
+ */
+static void
+get_attribute_range (const gchar *element,
+                     const gchar *prefix,
+                     gsize       *begin,
+                     gsize       *end)
+{
+  gsize lo = 0;
+  gsize hi = G_N_ELEMENTS (html_attributes);
+  gsize i;
+
+  while (lo < hi)
+    {
+      const HtmlAttribute *attr = &html_attributes [(lo + hi) / 2];
+      gint cmp;
+
+      cmp = strcmp (attr->element, element);
+      if (cmp == 0)
+        cmp = strcmp (attr->attribute, prefix);
+
+      if (cmp < 0)
+        lo = ((lo + hi) / 2) + 1;
+      else
+        hi = (lo + hi) / 2;
+    }
+
+  for (i = lo;
+       i < G_N_ELEMENTS (html_attributes) &&
+       g_str_equal (html_attributes [i].element, element) &&
+       g_str_has_prefix (html_attributes [i].attribute, prefix);
+       i++)
+    {
+      /* Do nothing */
+    }
+
+  *begin = lo;
+  *end = i;
+}
+
+/*
+ * Adds the attributes of @element along with the global attributes, keeping
+ * the results sorted.
+ */
+static void
+add_attribute_matches (SearchState *state,
+                       const gchar *element,
+                       const gchar *prefix)
+{
+  gsize begin = 0;
+  gsize end = 0;
+  gsize gbegin;
+  gsize gend;
+
+  if (element != NULL)
+    get_attribute_range (element, prefix, &begin, &end);
+  get_attribute_range ("*", prefix, &gbegin, &gend);
+
+  while (begin < end || gbegin < gend)
+    {
+      gint cmp;
+
+      if (begin == end)
+        cmp = 1;
+      else if (gbegin == gend)
+        cmp = -1;
+      else
+        cmp = strcmp (html_attributes [begin].attribute, html_attributes [gbegin].attribute);
+
+      if (cmp <= 0)
+        add_item (state, html_attributes [begin++].attribute);
+      else
+        add_item (state, html_attributes [gbegin++].attribute);
+
+      /* Skip attributes that are also global */
+      if (cmp == 0)
+        gbegin++;
+    }
 }
 
 static gboolean
@@ -327,41 +698,11 @@ get_element (GtkSourceCompletionContext *context)
   return NULL;
 }
 
-static gint
-sort_completion_items (gconstpointer a,
-                       gconstpointer b)
-{
-  gchar *astr;
-  gchar *bstr;
-  gint ret;
-
-  /*
-   * XXX: This is very much not ideal. We are allocating a string for every
-   *      compare! But we don't have accessor funcs into the completion item.
-   *      We should probably make our completion item class.
-   */
-
-  g_object_get (GTK_SOURCE_COMPLETION_ITEM (a),
-                "label", &astr,
-                NULL);
-  g_object_get (GTK_SOURCE_COMPLETION_ITEM (b),
-                "label", &bstr,
-                NULL);
-
-  ret = g_strcmp0 (astr, bstr);
-
-  g_free (astr);
-  g_free (bstr);
-
-  return ret;
-}
-
 static void
 ide_html_completion_provider_populate (GtkSourceCompletionProvider *provider,
                                       GtkSourceCompletionContext  *context)
 {
   SearchState state = { 0 };
-  Trie *trie = NULL;
   gchar *word;
   gint mode;
 
@@ -371,67 +712,43 @@ ide_html_completion_provider_populate (GtkSourceCompletionProvider *provider,
   mode = get_mode (context);
   word = get_word (context);
 
-  switch (mode)
-    {
-    case MODE_NONE:
-      break;
-
-    case MODE_ELEMENT_END:
-    case MODE_ELEMENT_START:
-      trie = elements;
-      break;
-
-    case MODE_ATTRIBUTE_NAME:
-      {
-        gchar *element;
-
-        if ((element = get_element (context)))
-          {
-            trie = g_hash_table_lookup (element_attrs, element);
-            g_free (element);
-          }
-
-        break;
-      }
-
-    case MODE_CSS:
-      trie = css_styles;
-      break;
-
-    case MODE_ATTRIBUTE_VALUE:
-      break;
-
-    default:
-      break;
-    }
-
   state.mode = mode;
 
   /*
-   * Load the values for the context.
+   * The tables are sorted, so the matches are found with a binary search
+   * and are produced in order.
    */
-  if (trie && word)
+  if (word != NULL)
     {
-      trie_traverse (trie, word, G_PRE_ORDER, G_TRAVERSE_LEAVES, -1,
-                     traverse_cb, &state);
-    }
+      switch (mode)
+        {
+        case MODE_ELEMENT_END:
+        case MODE_ELEMENT_START:
+          add_strv_matches (&state, html_elements, G_N_ELEMENTS (html_elements), word);
+          break;
 
-  /*
-   * If we are in an attribute, also load the global attributes values.
-   */
-  if (mode == MODE_ATTRIBUTE_NAME)
-    {
-      Trie *global;
+        case MODE_ATTRIBUTE_NAME:
+          {
+            gchar *element = get_element (context);
+
+            add_attribute_matches (&state, element, word);
+            g_free (element);
 
-      global = g_hash_table_lookup (element_attrs, "*");
-      trie_traverse (global, word, G_PRE_ORDER, G_TRAVERSE_LEAVES, -1,
-                     traverse_cb, &state);
+            break;
+          }
+
+        case MODE_CSS:
+          add_strv_matches (&state, css_properties, G_N_ELEMENTS (css_properties), word);
+          break;
+
+        case MODE_NONE:
+        case MODE_ATTRIBUTE_VALUE:
+        default:
+          break;
+        }
     }
 
-  /*
-   * TODO: Not exactly an ideal sort mechanism.
-   */
-  state.results = g_list_sort (state.results, sort_completion_items);
+  state.results = g_list_reverse (state.results);
 
   gtk_source_completion_context_add_proposals (context, provider,
                                                state.results, TRUE);
@@ -456,439 +773,20 @@ ide_html_completion_provider_class_finalize (IdeHtmlCompletionProviderClass *kla
 static void
 ide_html_completion_provider_class_init (IdeHtmlCompletionProviderClass *klass)
 {
-  elements = trie_new (NULL);
-  element_attrs = g_hash_table_new (g_str_hash, g_str_equal);
-  css_styles = trie_new (NULL);
-
-#define ADD_ELEMENT(str)        trie_insert(elements,str,str)
-#define ADD_STRING(dict, str)   trie_insert(dict,str,str)
-#define ADD_ATTRIBUTE(ele,attr) \
-  G_STMT_START { \
-    Trie *t = g_hash_table_lookup (element_attrs, ele); \
-    if (!t) { \
-      t = trie_new (NULL); \
-      g_hash_table_insert (element_attrs, ele, t); \
-    } \
-    trie_insert (t,attr,attr); \
-  } G_STMT_END
+#ifndef G_DISABLE_ASSERT
+  guint i;
 
-  /*
-   * TODO: We should determine what are valid attributes for given elements
-   *       and only provide those based upon the completion context.
-   */
+  for (i = 1; i < G_N_ELEMENTS (html_elements); i++)
+    g_assert (strcmp (html_elements [i - 1], html_elements [i]) < 0);
 
-  /*
-   * http://www.w3.org/TR/html-markup/elements.html
-   */
+  for (i = 1; i < G_N_ELEMENTS (html_attributes); i++)
+    g_assert (strcmp (html_attributes [i - 1].element, html_attributes [i].element) < 0 ||
+              (g_str_equal (html_attributes [i - 1].element, html_attributes [i].element) &&
+               strcmp (html_attributes [i - 1].attribute, html_attributes [i].attribute) < 0));
 
-  ADD_ELEMENT ("a");
-  ADD_ELEMENT ("abbr");
-  ADD_ELEMENT ("acronym");
-  ADD_ELEMENT ("address");
-  ADD_ELEMENT ("applet");
-  ADD_ELEMENT ("area");
-  ADD_ELEMENT ("article");
-  ADD_ELEMENT ("aside");
-  ADD_ELEMENT ("audio");
-  ADD_ELEMENT ("b");
-  ADD_ELEMENT ("base");
-  ADD_ELEMENT ("basefont");
-  ADD_ELEMENT ("bdi");
-  ADD_ELEMENT ("bdo");
-  ADD_ELEMENT ("big");
-  ADD_ELEMENT ("blockquote");
-  ADD_ELEMENT ("body");
-  ADD_ELEMENT ("br");
-  ADD_ELEMENT ("button");
-  ADD_ELEMENT ("canvas");
-  ADD_ELEMENT ("caption");
-  ADD_ELEMENT ("center");
-  ADD_ELEMENT ("cite");
-  ADD_ELEMENT ("code");
-  ADD_ELEMENT ("col");
-  ADD_ELEMENT ("colgroup");
-  ADD_ELEMENT ("datalist");
-  ADD_ELEMENT ("dd");
-  ADD_ELEMENT ("del");
-  ADD_ELEMENT ("details");
-  ADD_ELEMENT ("dfn");
-  ADD_ELEMENT ("dialog");
-  ADD_ELEMENT ("dir");
-  ADD_ELEMENT ("div");
-  ADD_ELEMENT ("dl");
-  ADD_ELEMENT ("dt");
-  ADD_ELEMENT ("em");
-  ADD_ELEMENT ("embed");
-  ADD_ELEMENT ("fieldset");
-  ADD_ELEMENT ("figcaption");
-  ADD_ELEMENT ("figure");
-  ADD_ELEMENT ("font");
-  ADD_ELEMENT ("footer");
-  ADD_ELEMENT ("form");
-  ADD_ELEMENT ("frame");
-  ADD_ELEMENT ("frameset");
-  ADD_ELEMENT ("head");
-  ADD_ELEMENT ("header");
-  ADD_ELEMENT ("hgroup");
-  ADD_ELEMENT ("h1");
-  ADD_ELEMENT ("h2");
-  ADD_ELEMENT ("h3");
-  ADD_ELEMENT ("h4");
-  ADD_ELEMENT ("h5");
-  ADD_ELEMENT ("h6");
-  ADD_ELEMENT ("hr");
-  ADD_ELEMENT ("html");
-  ADD_ELEMENT ("i");
-  ADD_ELEMENT ("iframe");
-  ADD_ELEMENT ("img");
-  ADD_ELEMENT ("input");
-  ADD_ELEMENT ("ins");
-  ADD_ELEMENT ("kbd");
-  ADD_ELEMENT ("keygen");
-  ADD_ELEMENT ("label");
-  ADD_ELEMENT ("legend");
-  ADD_ELEMENT ("li");
-  ADD_ELEMENT ("link");
-  ADD_ELEMENT ("main");
-  ADD_ELEMENT ("map");
-  ADD_ELEMENT ("mark");
-  ADD_ELEMENT ("menu");
-  ADD_ELEMENT ("menuitem");
-  ADD_ELEMENT ("meta");
-  ADD_ELEMENT ("meter");
-  ADD_ELEMENT ("nav");
-  ADD_ELEMENT ("noframes");
-  ADD_ELEMENT ("noscript");
-  ADD_ELEMENT ("object");
-  ADD_ELEMENT ("ol");
-  ADD_ELEMENT ("optgroup");
-  ADD_ELEMENT ("option");
-  ADD_ELEMENT ("output");
-  ADD_ELEMENT ("p");
-  ADD_ELEMENT ("param");
-  ADD_ELEMENT ("pre");
-  ADD_ELEMENT ("progress");
-  ADD_ELEMENT ("q");
-  ADD_ELEMENT ("rp");
-  ADD_ELEMENT ("rt");
-  ADD_ELEMENT ("ruby");
-  ADD_ELEMENT ("s");
-  ADD_ELEMENT ("samp");
-  ADD_ELEMENT ("script");
-  ADD_ELEMENT ("section");
-  ADD_ELEMENT ("select");
-  ADD_ELEMENT ("small");
-  ADD_ELEMENT ("source");
-  ADD_ELEMENT ("span");
-  ADD_ELEMENT ("strike");
-  ADD_ELEMENT ("strong");
-  ADD_ELEMENT ("style");
-  ADD_ELEMENT ("sub");
-  ADD_ELEMENT ("summary");
-  ADD_ELEMENT ("sup");
-  ADD_ELEMENT ("table");
-  ADD_ELEMENT ("tbody");
-  ADD_ELEMENT ("td");
-  ADD_ELEMENT ("textarea");
-  ADD_ELEMENT ("tfoot");
-  ADD_ELEMENT ("th");
-  ADD_ELEMENT ("thead");
-  ADD_ELEMENT ("time");
-  ADD_ELEMENT ("title");
-  ADD_ELEMENT ("tr");
-  ADD_ELEMENT ("track");
-  ADD_ELEMENT ("tt");
-  ADD_ELEMENT ("u");
-  ADD_ELEMENT ("ul");
-  ADD_ELEMENT ("var");
-  ADD_ELEMENT ("video");
-  ADD_ELEMENT ("wbr");
-
-  ADD_ATTRIBUTE ("*", "accesskey");
-  ADD_ATTRIBUTE ("*", "class");
-  ADD_ATTRIBUTE ("*", "contenteditable");
-  ADD_ATTRIBUTE ("*", "contextmenu");
-  ADD_ATTRIBUTE ("*", "dir");
-  ADD_ATTRIBUTE ("*", "draggable");
-  ADD_ATTRIBUTE ("*", "dropzone");
-  ADD_ATTRIBUTE ("*", "hidden");
-  ADD_ATTRIBUTE ("*", "id");
-  ADD_ATTRIBUTE ("*", "lang");
-  ADD_ATTRIBUTE ("*", "spellcheck");
-  ADD_ATTRIBUTE ("*", "style");
-  ADD_ATTRIBUTE ("*", "tabindex");
-  ADD_ATTRIBUTE ("*", "title");
-  ADD_ATTRIBUTE ("*", "translate");
-
-  ADD_ATTRIBUTE ("a", "href");
-  ADD_ATTRIBUTE ("a", "target");
-  ADD_ATTRIBUTE ("a", "rel");
-  ADD_ATTRIBUTE ("a", "hreflang");
-  ADD_ATTRIBUTE ("a", "media");
-  ADD_ATTRIBUTE ("a", "type");
-
-  ADD_ATTRIBUTE ("area", "alt");
-  ADD_ATTRIBUTE ("area", "href");
-  ADD_ATTRIBUTE ("area", "target");
-  ADD_ATTRIBUTE ("area", "rel");
-  ADD_ATTRIBUTE ("area", "media");
-  ADD_ATTRIBUTE ("area", "hreflang");
-  ADD_ATTRIBUTE ("area", "type");
-  ADD_ATTRIBUTE ("area", "shape");
-  ADD_ATTRIBUTE ("area", "coords");
-
-  ADD_ATTRIBUTE ("audio", "autoplay");
-  ADD_ATTRIBUTE ("audio", "preload");
-  ADD_ATTRIBUTE ("audio", "controls");
-  ADD_ATTRIBUTE ("audio", "loop");
-  ADD_ATTRIBUTE ("audio", "mediagroup");
-  ADD_ATTRIBUTE ("audio", "muted");
-  ADD_ATTRIBUTE ("audio", "src");
-
-  ADD_ATTRIBUTE ("base", "href");
-  ADD_ATTRIBUTE ("base", "target");
-
-  ADD_ATTRIBUTE ("blockquote", "cite");
-
-  ADD_ATTRIBUTE ("button", "type");
-  ADD_ATTRIBUTE ("button", "name");
-  ADD_ATTRIBUTE ("button", "disabled");
-  ADD_ATTRIBUTE ("button", "form");
-  ADD_ATTRIBUTE ("button", "value");
-  ADD_ATTRIBUTE ("button", "formaction");
-  ADD_ATTRIBUTE ("button", "autofocus");
-  ADD_ATTRIBUTE ("button", "formmethod");
-  ADD_ATTRIBUTE ("button", "formtarget");
-  ADD_ATTRIBUTE ("button", "formnovalidate");
-
-  ADD_ATTRIBUTE ("canvas", "height");
-  ADD_ATTRIBUTE ("canvas", "width");
-
-  ADD_ATTRIBUTE ("col", "span");
-
-  ADD_ATTRIBUTE ("colgroup", "span");
-
-  ADD_ATTRIBUTE ("command", "type");
-  ADD_ATTRIBUTE ("command", "label");
-  ADD_ATTRIBUTE ("command", "icon");
-  ADD_ATTRIBUTE ("command", "radiogroup");
-  ADD_ATTRIBUTE ("command", "checked");
-  ADD_ATTRIBUTE ("command", "type");
-
-  ADD_ATTRIBUTE ("del", "cite");
-  ADD_ATTRIBUTE ("del", "datetime");
-
-  ADD_ATTRIBUTE ("details", "open");
-
-  ADD_ATTRIBUTE ("embed", "src");
-  ADD_ATTRIBUTE ("embed", "type");
-  ADD_ATTRIBUTE ("embed", "height");
-  ADD_ATTRIBUTE ("embed", "width");
-
-  ADD_ATTRIBUTE ("fieldset", "name");
-  ADD_ATTRIBUTE ("fieldset", "disabled");
-  ADD_ATTRIBUTE ("fieldset", "form");
-
-  ADD_ATTRIBUTE ("form", "action");
-  ADD_ATTRIBUTE ("form", "method");
-  ADD_ATTRIBUTE ("form", "enctype");
-  ADD_ATTRIBUTE ("form", "name");
-  ADD_ATTRIBUTE ("form", "accept-charset");
-  ADD_ATTRIBUTE ("form", "novalidate");
-  ADD_ATTRIBUTE ("form", "target");
-  ADD_ATTRIBUTE ("form", "autocomplete");
-
-  ADD_ATTRIBUTE ("html", "manifest");
-
-  ADD_ATTRIBUTE ("iframe", "src");
-  ADD_ATTRIBUTE ("iframe", "srcdoc");
-  ADD_ATTRIBUTE ("iframe", "name");
-  ADD_ATTRIBUTE ("iframe", "width");
-  ADD_ATTRIBUTE ("iframe", "height");
-  ADD_ATTRIBUTE ("iframe", "sandbox");
-  ADD_ATTRIBUTE ("iframe", "seamless");
-
-  ADD_ATTRIBUTE ("img", "src");
-  ADD_ATTRIBUTE ("img", "alt");
-  ADD_ATTRIBUTE ("img", "height");
-  ADD_ATTRIBUTE ("img", "width");
-  ADD_ATTRIBUTE ("img", "usemap");
-  ADD_ATTRIBUTE ("img", "ismap");
-
-  ADD_ATTRIBUTE ("input", "accept");
-  ADD_ATTRIBUTE ("input", "alt");
-  ADD_ATTRIBUTE ("input", "autocomplete");
-  ADD_ATTRIBUTE ("input", "autofocus");
-  ADD_ATTRIBUTE ("input", "dirname");
-  ADD_ATTRIBUTE ("input", "disabled");
-  ADD_ATTRIBUTE ("input", "form");
-  ADD_ATTRIBUTE ("input", "formaction");
-  ADD_ATTRIBUTE ("input", "formenctype");
-  ADD_ATTRIBUTE ("input", "formmethod");
-  ADD_ATTRIBUTE ("input", "formnovalidate");
-  ADD_ATTRIBUTE ("input", "formtarget");
-  ADD_ATTRIBUTE ("input", "height");
-  ADD_ATTRIBUTE ("input", "list");
-  ADD_ATTRIBUTE ("input", "list");
-  ADD_ATTRIBUTE ("input", "max");
-  ADD_ATTRIBUTE ("input", "maxlength");
-  ADD_ATTRIBUTE ("input", "min");
-  ADD_ATTRIBUTE ("input", "multiple");
-  ADD_ATTRIBUTE ("input", "name");
-  ADD_ATTRIBUTE ("input", "pattern");
-  ADD_ATTRIBUTE ("input", "placeholder");
-  ADD_ATTRIBUTE ("input", "readonly");
-  ADD_ATTRIBUTE ("input", "required");
-  ADD_ATTRIBUTE ("input", "size");
-  ADD_ATTRIBUTE ("input", "src");
-  ADD_ATTRIBUTE ("input", "step");
-  ADD_ATTRIBUTE ("input", "type");
-  ADD_ATTRIBUTE ("input", "value");
-  ADD_ATTRIBUTE ("input", "width");
-
-  ADD_ATTRIBUTE ("ins", "cite");
-  ADD_ATTRIBUTE ("ins", "datetime");
-
-  ADD_ATTRIBUTE ("keygen", "challenge");
-  ADD_ATTRIBUTE ("keygen", "keytype");
-  ADD_ATTRIBUTE ("keygen", "autofocus");
-  ADD_ATTRIBUTE ("keygen", "name");
-  ADD_ATTRIBUTE ("keygen", "disabled");
-  ADD_ATTRIBUTE ("keygen", "form");
-
-  ADD_ATTRIBUTE ("label", "for");
-  ADD_ATTRIBUTE ("label", "form");
-
-  ADD_ATTRIBUTE ("li", "value");
-
-  ADD_ATTRIBUTE ("link", "href");
-  ADD_ATTRIBUTE ("link", "rel");
-  ADD_ATTRIBUTE ("link", "hreflang");
-  ADD_ATTRIBUTE ("link", "media");
-  ADD_ATTRIBUTE ("link", "type");
-  ADD_ATTRIBUTE ("link", "sizes");
-
-  ADD_ATTRIBUTE ("map", "name");
-
-  ADD_ATTRIBUTE ("menu", "type");
-  ADD_ATTRIBUTE ("menu", "label");
-
-  ADD_ATTRIBUTE ("meta", "http-equiv");
-  ADD_ATTRIBUTE ("meta", "content");
-  ADD_ATTRIBUTE ("meta", "charset");
-
-  ADD_ATTRIBUTE ("meter", "high");
-  ADD_ATTRIBUTE ("meter", "low");
-  ADD_ATTRIBUTE ("meter", "max");
-  ADD_ATTRIBUTE ("meter", "min");
-  ADD_ATTRIBUTE ("meter", "optimum");
-  ADD_ATTRIBUTE ("meter", "value");
-
-  ADD_ATTRIBUTE ("object", "data");
-  ADD_ATTRIBUTE ("object", "type");
-  ADD_ATTRIBUTE ("object", "height");
-  ADD_ATTRIBUTE ("object", "width");
-  ADD_ATTRIBUTE ("object", "usemap");
-  ADD_ATTRIBUTE ("object", "name");
-  ADD_ATTRIBUTE ("object", "form");
-
-  ADD_ATTRIBUTE ("ol", "start");
-  ADD_ATTRIBUTE ("ol", "reversed");
-  ADD_ATTRIBUTE ("ol", "type");
-
-  ADD_ATTRIBUTE ("optgroup", "label");
-  ADD_ATTRIBUTE ("optgroup", "disabled");
-
-  ADD_ATTRIBUTE ("option", "disabled");
-  ADD_ATTRIBUTE ("option", "selected");
-  ADD_ATTRIBUTE ("option", "label");
-  ADD_ATTRIBUTE ("option", "value");
-
-  ADD_ATTRIBUTE ("output", "name");
-  ADD_ATTRIBUTE ("output", "form");
-  ADD_ATTRIBUTE ("output", "for");
-
-  ADD_ATTRIBUTE ("param", "name");
-  ADD_ATTRIBUTE ("param", "value");
-
-  ADD_ATTRIBUTE ("progress", "value");
-  ADD_ATTRIBUTE ("progress", "max");
-
-  ADD_ATTRIBUTE ("q", "cite");
-
-  ADD_ATTRIBUTE ("script", "type");
-  ADD_ATTRIBUTE ("script", "language");
-  ADD_ATTRIBUTE ("script", "src");
-  ADD_ATTRIBUTE ("script", "defer");
-  ADD_ATTRIBUTE ("script", "async");
-  ADD_ATTRIBUTE ("script", "charset");
-
-  ADD_ATTRIBUTE ("select", "name");
-  ADD_ATTRIBUTE ("select", "disabled");
-  ADD_ATTRIBUTE ("select", "form");
-  ADD_ATTRIBUTE ("select", "size");
-  ADD_ATTRIBUTE ("select", "multiple");
-  ADD_ATTRIBUTE ("select", "autofocus");
-  ADD_ATTRIBUTE ("select", "required");
-
-  ADD_ATTRIBUTE ("source", "src");
-  ADD_ATTRIBUTE ("source", "type");
-  ADD_ATTRIBUTE ("source", "media");
-
-  ADD_ATTRIBUTE ("style", "type");
-  ADD_ATTRIBUTE ("style", "media");
-  ADD_ATTRIBUTE ("style", "scoped");
-
-  ADD_ATTRIBUTE ("table", "border");
-
-  ADD_ATTRIBUTE ("td", "colspan");
-  ADD_ATTRIBUTE ("td", "rowspan");
-  ADD_ATTRIBUTE ("td", "headers");
-
-  ADD_ATTRIBUTE ("textarea", "name");
-  ADD_ATTRIBUTE ("textarea", "disabled");
-  ADD_ATTRIBUTE ("textarea", "form");
-  ADD_ATTRIBUTE ("textarea", "readonly");
-  ADD_ATTRIBUTE ("textarea", "maxlength");
-  ADD_ATTRIBUTE ("textarea", "autofocus");
-  ADD_ATTRIBUTE ("textarea", "required");
-  ADD_ATTRIBUTE ("textarea", "placeholder");
-  ADD_ATTRIBUTE ("textarea", "dirname");
-  ADD_ATTRIBUTE ("textarea", "rows");
-  ADD_ATTRIBUTE ("textarea", "wrap");
-  ADD_ATTRIBUTE ("textarea", "cols");
-
-  ADD_ATTRIBUTE ("th", "scope");
-  ADD_ATTRIBUTE ("th", "colspan");
-  ADD_ATTRIBUTE ("th", "rowspan");
-  ADD_ATTRIBUTE ("th", "headers");
-
-  ADD_ATTRIBUTE ("time", "datetime");
-
-  ADD_ATTRIBUTE ("track", "kind");
-  ADD_ATTRIBUTE ("track", "src");
-  ADD_ATTRIBUTE ("track", "srclang");
-  ADD_ATTRIBUTE ("track", "label");
-  ADD_ATTRIBUTE ("track", "default");
-
-  ADD_ATTRIBUTE ("video", "autoplay");
-  ADD_ATTRIBUTE ("video", "preload");
-  ADD_ATTRIBUTE ("video", "controls");
-  ADD_ATTRIBUTE ("video", "loop");
-  ADD_ATTRIBUTE ("video", "poster");
-  ADD_ATTRIBUTE ("video", "height");
-  ADD_ATTRIBUTE ("video", "width");
-  ADD_ATTRIBUTE ("video", "mediagroup");
-  ADD_ATTRIBUTE ("video", "muted");
-  ADD_ATTRIBUTE ("video", "src");
-
-  ADD_STRING (css_styles, "border");
-  ADD_STRING (css_styles, "background");
-  ADD_STRING (css_styles, "background-image");
-  ADD_STRING (css_styles, "background-color");
-  ADD_STRING (css_styles, "text-align");
-
-#undef ADD_STRING
+  for (i = 1; i < G_N_ELEMENTS (css_properties); i++)
+    g_assert (strcmp (css_properties [i - 1], css_properties [i]) < 0);
+#endif
 }
 
 static void
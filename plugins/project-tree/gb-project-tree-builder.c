@@ -118,8 +118,11 @@ build_file (GbProjectTreeBuilder *self,
             IdeTreeNode          *node)
 {
   g_autoptr(GFileEnumerator) enumerator = NULL;
+  g_autoptr(GPtrArray) file_infos = NULL;
+  g_autoptr(GArray) ignored = NULL;
   GbProjectFile *project_file;
   gpointer file_info_ptr;
+  guint i;
   IdeVcs *vcs;
   GFile *file;
   IdeTree *tree;
@@ -156,24 +159,31 @@ build_file (GbProjectTreeBuilder *self,
   if (enumerator == NULL)
     return;
 
+  file_infos = g_ptr_array_new_with_free_func (g_object_unref);
+
   while ((file_info_ptr = g_file_enumerator_next_file (enumerator, NULL, NULL)))
+    g_ptr_array_add (file_infos, file_info_ptr);
+
+  ignored = ide_vcs_check_ignored (vcs, file, file_infos, NULL);
+
+  for (i = 0; i < file_infos->len; i++)
     {
-      g_autoptr(GFileInfo) item_file_info = file_info_ptr;
+      GFileInfo *item_file_info = g_ptr_array_index (file_infos, i);
       g_autoptr(GFile) item_file = NULL;
       g_autoptr(GbProjectFile) item = NULL;
       IdeTreeNode *child;
       const gchar *name;
       const gchar *display_name;
       const gchar *icon_name;
-      gboolean ignored;
+      gboolean is_ignored;
+
+      is_ignored = (ignored != NULL && g_array_index (ignored, gboolean, i));
+      if (is_ignored && !show_ignored_files)
+        continue;
 
       name = g_file_info_get_name (item_file_info);
       item_file = g_file_get_child (file, name);
 
-      ignored = ide_vcs_is_ignored (vcs, item_file, NULL);
-      if (ignored && !show_ignored_files)
-        continue;
-
       item = gb_project_file_new (item_file, item_file_info);
 
       display_name = gb_project_file_get_display_name (item);
@@ -183,7 +193,7 @@ build_file (GbProjectTreeBuilder *self,
                             "icon-name", icon_name,
                             "text", display_name,
                             "item", item,
-                            "use-dim-label", ignored,
+                            "use-dim-label", is_ignored,
                             NULL);
 
       ide_tree_node_insert_sorted (node, child, compare_nodes_func, self);
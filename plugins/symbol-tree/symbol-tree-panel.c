@@ -24,6 +24,7 @@
 #include <ide.h>
 
 #include "egg-task-cache.h"
+#include "ide-tree-private.h"
 
 #include "symbol-tree.h"
 #include "symbol-tree-builder.h"
@@ -59,6 +60,188 @@ refresh_tree_timeout (gpointer user_data)
   return G_SOURCE_CONTINUE;
 }
 
+static GQuark position_quark;
+
+static gchar *
+make_symbol_key (IdeSymbolNode *symbol)
+{
+  g_assert (IDE_IS_SYMBOL_NODE (symbol));
+
+  return g_strdup_printf ("%d:%s",
+                          ide_symbol_node_get_kind (symbol),
+                          ide_symbol_node_get_name (symbol));
+}
+
+static gint
+compare_by_position (IdeTreeNode *a,
+                     IdeTreeNode *b,
+                     gpointer     user_data)
+{
+  guint pos_a = GPOINTER_TO_UINT (g_object_get_qdata (G_OBJECT (a), position_quark));
+  guint pos_b = GPOINTER_TO_UINT (g_object_get_qdata (G_OBJECT (b), position_quark));
+
+  return (gint)pos_a - (gint)pos_b;
+}
+
+static GPtrArray *
+get_child_nodes (IdeTree     *tree,
+                 IdeTreeNode *node)
+{
+  GtkTreeModel *model;
+  GtkTreeIter *parent = NULL;
+  GtkTreeIter node_iter;
+  GtkTreeIter iter;
+  GPtrArray *ar;
+
+  g_assert (IDE_IS_TREE (tree));
+  g_assert (IDE_IS_TREE_NODE (node));
+
+  ar = g_ptr_array_new_with_free_func (g_object_unref);
+
+  /* Node iters belong to the store, not to the filter model of the view */
+  model = GTK_TREE_MODEL (_ide_tree_get_store (tree));
+
+  if (ide_tree_node_get_iter (node, &node_iter))
+    parent = &node_iter;
+
+  if (gtk_tree_model_iter_children (model, &iter, parent))
+    {
+      do
+        {
+          IdeTreeNode *child = NULL;
+
+          gtk_tree_model_get (model, &iter, 0, &child, -1);
+
+          /* Skip the placeholder used for unbuilt nodes */
+          if (child != NULL && !IDE_IS_SYMBOL_NODE (ide_tree_node_get_item (child)))
+            g_clear_object (&child);
+
+          if (child != NULL)
+            g_ptr_array_add (ar, child);
+        }
+      while (gtk_tree_model_iter_next (model, &iter));
+    }
+
+  return ar;
+}
+
+/*
+ * Applies the children of @parent within @symbol_tree to @node. Nodes that
+ * still exist (matched by kind and name, in order) are kept in place and
+ * have their item replaced, so that expansion and selection survive the
+ * update. Only nodes that were already built are descended into; the rest
+ * will be built lazily from the new tree by the SymbolTreeBuilder.
+ */
+static void
+apply_symbol_tree (SymbolTreePanel *self,
+                   IdeSymbolTree   *symbol_tree,
+                   IdeTreeNode     *node,
+                   IdeSymbolNode   *parent)
+{
+  g_autoptr(GHashTable) by_key = NULL;
+  g_autoptr(GPtrArray) symbols = NULL;
+  g_autoptr(GPtrArray) children = NULL;
+  g_autofree gboolean *claimed = NULL;
+  gboolean is_root;
+  guint n_children;
+  guint last_pos = 0;
+  guint i;
+
+  g_assert (SYMBOL_IS_TREE_PANEL (self));
+  g_assert (IDE_IS_SYMBOL_TREE (symbol_tree));
+  g_assert (IDE_IS_TREE_NODE (node));
+  g_assert (!parent || IDE_IS_SYMBOL_NODE (parent));
+
+  /*
+   * If the node has not been built yet, there is nothing to diff against.
+   * The builder will consult the new symbol tree when it is expanded.
+   */
+  if (_ide_tree_node_get_needs_build (node))
+    return;
+
+  children = get_child_nodes (self->tree, node);
+
+  is_root = (ide_tree_node_get_parent (node) == NULL);
+  n_children = ide_symbol_tree_get_n_children (symbol_tree, parent);
+  symbols = g_ptr_array_new_with_free_func (g_object_unref);
+  claimed = g_new0 (gboolean, n_children);
+  by_key = g_hash_table_new_full (g_str_hash,
+                                  g_str_equal,
+                                  g_free,
+                                  (GDestroyNotify)g_queue_free);
+
+  for (i = 0; i < n_children; i++)
+    {
+      IdeSymbolNode *symbol;
+      gchar *key;
+      GQueue *queue;
+
+      symbol = ide_symbol_tree_get_nth_child (symbol_tree, parent, i);
+      g_ptr_array_add (symbols, symbol);
+
+      key = make_symbol_key (symbol);
+
+      if (!(queue = g_hash_table_lookup (by_key, key)))
+        {
+          queue = g_queue_new ();
+          g_hash_table_insert (by_key, key, queue);
+        }
+      else
+        g_free (key);
+
+      g_queue_push_tail (queue, GUINT_TO_POINTER (i));
+    }
+
+  /*
+   * Walk the existing nodes in display order and claim the matching symbol.
+   * A match that would move a node backwards cannot be expressed without
+   * reordering rows, so such nodes are replaced instead.
+   */
+  for (i = 0; i < children->len; i++)
+    {
+      IdeTreeNode *child = g_ptr_array_index (children, i);
+      IdeSymbolNode *old_symbol = IDE_SYMBOL_NODE (ide_tree_node_get_item (child));
+      g_autofree gchar *key = make_symbol_key (old_symbol);
+      GQueue *queue;
+      IdeSymbolNode *symbol;
+      guint pos;
+
+      if (!(queue = g_hash_table_lookup (by_key, key)) ||
+          g_queue_is_empty (queue) ||
+          (pos = GPOINTER_TO_UINT (g_queue_peek_head (queue))) < last_pos)
+        {
+          ide_tree_node_remove (node, child);
+          continue;
+        }
+
+      g_queue_pop_head (queue);
+
+      symbol = g_ptr_array_index (symbols, pos);
+      claimed [pos] = TRUE;
+      last_pos = pos;
+
+      g_object_set_qdata (G_OBJECT (child), position_quark, GUINT_TO_POINTER (pos));
+      ide_tree_node_set_item (child, G_OBJECT (symbol));
+
+      apply_symbol_tree (self, symbol_tree, child, symbol);
+    }
+
+  for (i = 0; i < n_children; i++)
+    {
+      IdeTreeNode *child;
+
+      if (claimed [i])
+        continue;
+
+      child = symbol_tree_builder_create_node (g_ptr_array_index (symbols, i));
+      g_object_set_qdata (G_OBJECT (child), position_quark, GUINT_TO_POINTER (i));
+      ide_tree_node_insert_sorted (node, child, compare_by_position, NULL);
+
+      if (is_root)
+        ide_tree_node_expand (child, FALSE);
+    }
+}
+
 static void
 get_cached_symbol_tree_cb (GObject      *object,
                            GAsyncResult *result,
@@ -69,8 +252,6 @@ get_cached_symbol_tree_cb (GObject      *object,
   g_autoptr(IdeSymbolTree) symbol_tree = NULL;
   g_autoptr(GError) error = NULL;
   IdeTreeNode *root;
-  GtkTreeIter iter;
-  GtkTreeModel *model;
 
   IDE_ENTRY;
 
@@ -90,25 +271,14 @@ get_cached_symbol_tree_cb (GObject      *object,
                                               refresh_tree_timeout,
                                               self);
 
-  root = g_object_new (IDE_TYPE_TREE_NODE,
-                       "item", symbol_tree,
-                       NULL);
-  ide_tree_set_root (self->tree, root);
-
-  model = gtk_tree_view_get_model (GTK_TREE_VIEW (self->tree));
-
-  if (gtk_tree_model_get_iter_first (model, &iter))
-    {
-      do
-        {
-          g_autoptr(IdeTreeNode) node = NULL;
-
-          gtk_tree_model_get (model, &iter, 0, &node, -1);
-          if (node != NULL)
-            ide_tree_node_expand (node, FALSE);
-        }
-      while (gtk_tree_model_iter_next (model, &iter));
-    }
+  /*
+   * Rather than replacing the root (which would throw away the expansion
+   * state and force a full repopulate of the GtkTreeStore), swap the item
+   * on the existing root and only touch the rows that changed.
+   */
+  root = ide_tree_get_root (self->tree);
+  ide_tree_node_set_item (root, G_OBJECT (symbol_tree));
+  apply_symbol_tree (self, symbol_tree, root, NULL);
 
   IDE_EXIT;
 }
@@ -141,20 +311,25 @@ refresh_tree (SymbolTreePanel *self)
 
   if ((document != self->last_document) || (self->last_change_count < change_count))
     {
+      gboolean force_update = FALSE;
+
       IDE_PROBE;
 
       ide_clear_source (&self->refresh_tree_timeout);
 
-      self->last_document = document;
-      self->last_change_count = change_count;
-
       /*
-       * Clear the old tree items.
-       *
-       * TODO: Get cross compile names for nodes so that we can
-       *       recompute the open state.
+       * Only clear the old tree items when switching documents. For changes
+       * to the same document, the new symbol tree is diffed against the
+       * existing nodes so that expansion and selection are preserved. The
+       * cached tree is stale in that case, so bypass the cache.
        */
-      ide_tree_set_root (self->tree, ide_tree_node_new ());
+      if (document != self->last_document)
+        ide_tree_set_root (self->tree, ide_tree_node_new ());
+      else
+        force_update = TRUE;
+
+      self->last_document = document;
+      self->last_change_count = change_count;
 
       /*
        * Fetch the symbols via the transparent cache.
@@ -171,7 +346,7 @@ refresh_tree (SymbolTreePanel *self)
 
           egg_task_cache_get_async (self->symbols_cache,
                                     document,
-                                    FALSE,
+                                    force_update,
                                     self->cancellable,
                                     get_cached_symbol_tree_cb,
                                     g_object_ref (self));
@@ -306,6 +481,8 @@ symbol_tree_panel_class_init (SymbolTreePanelClass *klass)
 
   object_class->finalize = symbol_tree_panel_finalize;
 
+  position_quark = g_quark_from_static_string ("SYMBOL_TREE_POSITION");
+
   gtk_widget_class_set_css_name (widget_class, "symboltreepanel");
   gtk_widget_class_set_template_from_resource (widget_class, "/org/gnome/builder/plugins/symbol-tree/symbol-tree-panel.ui");
   gtk_widget_class_bind_template_child (widget_class, SymbolTreePanel, tree);
@@ -16,18 +16,84 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <glib/gi18n.h>
 #include <realtime-graphs.h>
 
 #include "gb-sysmon-panel.h"
 
+#define TIMESPAN    (30 * G_USEC_PER_SEC)
+#define MAX_SAMPLES 60
+
 struct _GbSysmonPanel
 {
   PnlDockWidget  parent_instance;
+  GtkBox        *box;
   RgCpuGraph    *cpu_graph;
 };
 
 G_DEFINE_TYPE (GbSysmonPanel, gb_sysmon_panel, PNL_TYPE_DOCK_WIDGET)
 
+static const gchar *colors[] = {
+  "#3465a4",
+  "#f57900",
+};
+
+static void
+gb_sysmon_panel_add_graph (GbSysmonPanel *self,
+                           const gchar   *title,
+                           GType          table_type)
+{
+  g_autoptr(RgTable) table = NULL;
+  GtkWidget *graph;
+  GtkWidget *label;
+  GtkWidget *box;
+  guint n_columns;
+  guint i;
+
+  g_assert (GB_IS_SYSMON_PANEL (self));
+  g_assert (g_type_is_a (table_type, RG_TYPE_SAMPLED_TABLE));
+
+  /* One more sample than we show so the graph scrolls in smoothly */
+  table = g_object_new (table_type,
+                        "timespan", (gint64)TIMESPAN,
+                        "max-samples", MAX_SAMPLES + 1,
+                        NULL);
+
+  box = g_object_new (GTK_TYPE_BOX,
+                      "orientation", GTK_ORIENTATION_VERTICAL,
+                      "visible", TRUE,
+                      NULL);
+  gtk_container_add (GTK_CONTAINER (self->box), box);
+
+  label = g_object_new (GTK_TYPE_LABEL,
+                        "label", title,
+                        "visible", TRUE,
+                        "xalign", 0.0f,
+                        NULL);
+  gtk_style_context_add_class (gtk_widget_get_style_context (label), "dim-label");
+  gtk_container_add (GTK_CONTAINER (box), label);
+
+  graph = g_object_new (RG_TYPE_GRAPH,
+                        "expand", TRUE,
+                        "table", table,
+                        "visible", TRUE,
+                        NULL);
+  gtk_container_add (GTK_CONTAINER (box), graph);
+
+  n_columns = rg_table_get_n_columns (table);
+
+  for (i = 0; i < n_columns; i++)
+    {
+      g_autoptr(RgRenderer) renderer = NULL;
+
+      renderer = g_object_new (RG_TYPE_LINE_RENDERER,
+                               "column", i,
+                               "stroke-color", colors [i % G_N_ELEMENTS (colors)],
+                               NULL);
+      rg_graph_add_renderer (RG_GRAPH (graph), renderer);
+    }
+}
+
 static void
 gb_sysmon_panel_finalize (GObject *object)
 {
@@ -43,6 +109,7 @@ gb_sysmon_panel_class_init (GbSysmonPanelClass *klass)
   object_class->finalize = gb_sysmon_panel_finalize;
 
   gtk_widget_class_set_template_from_resource (widget_class, "/org/gnome/builder/plugins/sysmon/gb-sysmon-panel.ui");
+  gtk_widget_class_bind_template_child (widget_class, GbSysmonPanel, box);
   gtk_widget_class_bind_template_child (widget_class, GbSysmonPanel, cpu_graph);
 
   g_type_ensure (RG_TYPE_CPU_GRAPH);
@@ -52,4 +119,10 @@ static void
 gb_sysmon_panel_init (GbSysmonPanel *self)
 {
   gtk_widget_init_template (GTK_WIDGET (self));
+
+  gb_sysmon_panel_add_graph (self, _("Memory and Swap"), RG_TYPE_MEMORY_TABLE);
+#ifdef __linux__
+  gb_sysmon_panel_add_graph (self, _("Disk I/O"), RG_TYPE_DISK_TABLE);
+#endif
+  gb_sysmon_panel_add_graph (self, _("Builder and Subprocesses"), RG_TYPE_PROCESS_TABLE);
 }
@@ -134,6 +134,13 @@ gbp_xdg_runtime_prebuild_worker (GTask        *task,
                                             self->branch,
                                             NULL);
 
+  /* The sandbox now exists, so lookups made without it are stale */
+  if (subprocess != NULL)
+    {
+      g_subprocess_wait (subprocess, cancellable, NULL);
+      ide_runtime_invalidate (IDE_RUNTIME (self));
+    }
+
   g_task_return_boolean (task, TRUE);
 }
 
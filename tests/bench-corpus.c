@@ -0,0 +1,506 @@
+/* bench-corpus.c
+ *
+ * Copyright (C) 2016 Christian Hergert <chergert@redhat.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+
+#include "bench-harness.h"
+
+/*
+ * Generators for synthetic inputs that resemble what Builder sees on a
+ * large project. Everything is derived from the #GRand passed in, so the
+ * same seed always produces the same corpus.
+ */
+
+static const gchar *namespaces[] = {
+  "Ide", "Gb", "Gtk", "Egg", "Pnl", "G", "Rg", "Tmpl",
+};
+
+static const gchar *words[] = {
+  "Buffer", "Source", "View", "Context", "Build", "Search", "Tree", "Symbol",
+  "Diagnostic", "Completion", "Provider", "Manager", "Index", "File",
+  "Project", "Runtime", "Highlight", "Engine", "Worker", "Result", "Item",
+  "Node", "Cache", "Settings", "Device", "Language", "Formatter", "Unsaved",
+  "Indenter", "Snippet", "Parser", "Task", "Widget", "Panel", "Layout",
+  "Stack", "Editor", "Frame", "Workbench", "Perspective", "Vcs", "Git",
+};
+
+static const gchar *verbs[] = {
+  "get", "set", "new", "free", "ref", "unref", "load", "save", "find",
+  "lookup", "insert", "remove", "update", "build", "parse", "reload",
+  "activate", "invalidate", "foreach", "apply",
+};
+
+static const gchar *extensions[] = {
+  ".c", ".c", ".c", ".h", ".h", ".vala", ".ui", ".py", ".md", ".js",
+};
+
+static const gchar *ctags_kinds = "cdefgmpstuv";
+
+#define PICK(rand, array) (array [g_rand_int_range (rand, 0, G_N_ELEMENTS (array))])
+
+static void
+append_lower (GString     *str,
+              const gchar *word)
+{
+  for (; *word; word++)
+    g_string_append_c (str, g_ascii_tolower (*word));
+}
+
+/**
+ * bench_corpus_identifiers:
+ * @rand: a #GRand
+ * @n_identifiers: the number of identifiers to generate
+ *
+ * Generates unique GObject style identifiers, a mix of type names,
+ * function names and macros.
+ *
+ * Returns: (transfer full): a #GPtrArray of strings.
+ */
+GPtrArray *
+bench_corpus_identifiers (GRand *rand,
+                          guint  n_identifiers)
+{
+  g_autoptr(GHashTable) seen = NULL;
+  GPtrArray *ar;
+
+  seen = g_hash_table_new (g_str_hash, g_str_equal);
+  ar = g_ptr_array_new_with_free_func (g_free);
+
+  while (ar->len < n_identifiers)
+    {
+      const gchar *ns = PICK (rand, namespaces);
+      GString *str = g_string_new (NULL);
+      guint n_words = g_rand_int_range (rand, 1, 4);
+      guint kind = g_rand_int_range (rand, 0, 10);
+      guint i;
+
+      if (kind < 3)
+        {
+          /* IdeBufferManager */
+          g_string_append (str, ns);
+          for (i = 0; i < n_words; i++)
+            g_string_append (str, PICK (rand, words));
+        }
+      else if (kind < 9)
+        {
+          /* ide_buffer_manager_get_focus_buffer */
+          append_lower (str, ns);
+          for (i = 0; i < n_words; i++)
+            {
+              g_string_append_c (str, '_');
+              append_lower (str, PICK (rand, words));
+            }
+          g_string_append_c (str, '_');
+          g_string_append (str, PICK (rand, verbs));
+          if (g_rand_boolean (rand))
+            {
+              g_string_append_c (str, '_');
+              append_lower (str, PICK (rand, words));
+            }
+        }
+      else
+        {
+          /* IDE_IS_BUFFER_MANAGER */
+          for (i = 0; ns [i]; i++)
+            g_string_append_c (str, g_ascii_toupper (ns [i]));
+          g_string_append (str, "_IS");
+          for (i = 0; i < n_words; i++)
+            {
+              const gchar *word = PICK (rand, words);
+
+              g_string_append_c (str, '_');
+              for (; *word; word++)
+                g_string_append_c (str, g_ascii_toupper (*word));
+            }
+        }
+
+      if (g_hash_table_contains (seen, str->str))
+        {
+          g_string_append_printf (str, "%u", ar->len);
+          if (g_hash_table_contains (seen, str->str))
+            {
+              g_string_free (str, TRUE);
+              continue;
+            }
+        }
+
+      g_ptr_array_add (ar, g_string_free (str, FALSE));
+      g_hash_table_add (seen, g_ptr_array_index (ar, ar->len - 1));
+    }
+
+  return ar;
+}
+
+/**
+ * bench_corpus_paths:
+ * @rand: a #GRand
+ * @n_paths: the number of paths to generate
+ *
+ * Generates unique relative paths spread over a tree of nested
+ * directories, like those found in a large source tree.
+ *
+ * Returns: (transfer full): a #GPtrArray of strings.
+ */
+GPtrArray *
+bench_corpus_paths (GRand *rand,
+                    guint  n_paths)
+{
+  g_autoptr(GHashTable) seen = NULL;
+  g_autoptr(GPtrArray) dirs = NULL;
+  GPtrArray *ar;
+  guint n_dirs;
+  guint i;
+
+  seen = g_hash_table_new (g_str_hash, g_str_equal);
+  dirs = g_ptr_array_new_with_free_func (g_free);
+  ar = g_ptr_array_new_with_free_func (g_free);
+
+  /* Files are spread over a tree with roughly 30 files per directory */
+  n_dirs = MAX (1, n_paths / 30);
+
+  g_ptr_array_add (dirs, g_strdup ("src"));
+  for (i = 1; i < n_dirs; i++)
+    {
+      const gchar *parent = g_ptr_array_index (dirs, g_rand_int_range (rand, 0, dirs->len));
+      GString *str = g_string_new (parent);
+
+      /* Don't nest too deeply */
+      if (g_rand_int_range (rand, 0, 4) == 0 || strlen (parent) > 40)
+        g_string_assign (str, PICK (rand, verbs));
+
+      g_string_append_c (str, '/');
+      append_lower (str, PICK (rand, words));
+
+      g_ptr_array_add (dirs, g_string_free (str, FALSE));
+    }
+
+  while (ar->len < n_paths)
+    {
+      const gchar *dir = g_ptr_array_index (dirs, g_rand_int_range (rand, 0, dirs->len));
+      GString *str = g_string_new (dir);
+      guint n_words = g_rand_int_range (rand, 1, 4);
+
+      g_string_append_c (str, '/');
+      append_lower (str, PICK (rand, namespaces));
+      for (i = 0; i < n_words; i++)
+        {
+          g_string_append_c (str, '-');
+          append_lower (str, PICK (rand, words));
+        }
+      g_string_append (str, PICK (rand, extensions));
+
+      if (g_hash_table_contains (seen, str->str))
+        {
+          g_string_free (str, TRUE);
+          continue;
+        }
+
+      g_ptr_array_add (ar, g_string_free (str, FALSE));
+      g_hash_table_add (seen, g_ptr_array_index (ar, ar->len - 1));
+    }
+
+  return ar;
+}
+
+static gint
+compare_lines (gconstpointer a,
+               gconstpointer b)
+{
+  return strcmp (*(const gchar * const *)a, *(const gchar * const *)b);
+}
+
+/**
+ * bench_corpus_tags:
+ * @rand: a #GRand
+ * @identifiers: the names to generate tags for
+ * @paths: the paths the tags refer to
+ *
+ * Generates a sorted tags file in the extended format produced by
+ * Exuberant Ctags with an entry for each of @identifiers.
+ *
+ * Returns: (transfer full): a #GString containing the tags file.
+ */
+GString *
+bench_corpus_tags (GRand     *rand,
+                   GPtrArray *identifiers,
+                   GPtrArray *paths)
+{
+  g_autoptr(GPtrArray) lines = NULL;
+  GString *str;
+  guint i;
+
+  lines = g_ptr_array_new_with_free_func (g_free);
+
+  for (i = 0; i < identifiers->len; i++)
+    {
+      const gchar *name = g_ptr_array_index (identifiers, i);
+      const gchar *path = g_ptr_array_index (paths, g_rand_int_range (rand, 0, paths->len));
+      gchar kind = ctags_kinds [g_rand_int_range (rand, 0, strlen (ctags_kinds))];
+
+      g_ptr_array_add (lines,
+                       g_strdup_printf ("%s\t%s\t/^%s (%s *self)$/;\"\t%c%s",
+                                        name, path, name,
+                                        PICK (rand, words), kind,
+                                        kind == 'm' ? "\tstruct:_Ide" : ""));
+    }
+
+  g_ptr_array_sort (lines, compare_lines);
+
+  str = g_string_new ("!_TAG_FILE_FORMAT\t2\t/extended format; --format=1 will not append ;\" to lines/\n"
+                      "!_TAG_FILE_SORTED\t1\t/0=unsorted, 1=sorted, 2=foldcase/\n"
+                      "!_TAG_PROGRAM_NAME\tExuberant Ctags\t//\n");
+
+  for (i = 0; i < lines->len; i++)
+    {
+      g_string_append (str, g_ptr_array_index (lines, i));
+      g_string_append_c (str, '\n');
+    }
+
+  return str;
+}
+
+/**
+ * bench_corpus_make_dump:
+ * @rand: a #GRand
+ * @paths: the source files of the project
+ *
+ * Generates something resembling the output of `make -p` for an automake
+ * project containing the C files within @paths, with a libtool target for
+ * each file along with the variables and comments that make emits.
+ *
+ * Returns: (transfer full): a #GString containing the dump.
+ */
+GString *
+bench_corpus_make_dump (GRand     *rand,
+                        GPtrArray *paths)
+{
+  g_autoptr(GHashTable) by_dir = NULL;
+  g_autoptr(GList) dirs = NULL;
+  GString *str;
+  guint line = 1;
+  GList *iter;
+  guint i;
+
+  by_dir = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+                                  (GDestroyNotify)g_ptr_array_unref);
+
+  for (i = 0; i < paths->len; i++)
+    {
+      const gchar *path = g_ptr_array_index (paths, i);
+      g_autofree gchar *dir = NULL;
+      GPtrArray *files;
+
+      if (!g_str_has_suffix (path, ".c"))
+        continue;
+
+      dir = g_path_get_dirname (path);
+
+      if (NULL == (files = g_hash_table_lookup (by_dir, dir)))
+        {
+          files = g_ptr_array_new_with_free_func (g_free);
+          g_hash_table_insert (by_dir, g_strdup (dir), files);
+        }
+
+      g_ptr_array_add (files, g_path_get_basename (path));
+    }
+
+  /* Hash table order is not stable across GLib versions */
+  dirs = g_hash_table_get_keys (by_dir);
+  dirs = g_list_sort (dirs, (GCompareFunc)strcmp);
+
+  str = g_string_new ("# GNU Make 4.1\n"
+                      "# Built for x86_64-pc-linux-gnu\n\n"
+                      "# Make data base, printed on Thu Jan  1 00:00:00 2016\n\n"
+                      "# Variables\n\n");
+
+  for (iter = dirs; iter; iter = iter->next)
+    {
+      const gchar *dir = iter->data;
+      GPtrArray *files = g_hash_table_lookup (by_dir, dir);
+      g_autofree gchar *lib = g_strdelimit (g_strdup (dir), "/-", '_');
+
+      g_string_append_printf (str, "# makefile (from 'Makefile', line %u)\n", line++);
+      g_string_append_printf (str, "subdir = %s\n", dir);
+      g_string_append_printf (str, "# makefile (from 'Makefile', line %u)\n", line++);
+      g_string_append_printf (str, "lib%s_la_CFLAGS = $(DEBUG_CFLAGS) $(LIBIDE_CFLAGS) -I$(top_srcdir)/%s\n", lib, dir);
+      g_string_append_printf (str, "# makefile (from 'Makefile', line %u)\n", line++);
+      g_string_append_printf (str, "lib%s_la_SOURCES =", lib);
+      for (i = 0; i < files->len; i++)
+        g_string_append_printf (str, " %s", (gchar *)g_ptr_array_index (files, i));
+      g_string_append (str, "\n\n");
+
+      for (i = 0; i < files->len; i++)
+        {
+          g_autofree gchar *base = g_strdup (g_ptr_array_index (files, i));
+          guint n_deps = g_rand_int_range (rand, 2, 12);
+          guint j;
+
+          *strrchr (base, '.') = '\0';
+
+          g_string_append_printf (str, "lib%s_la-%s.lo: %s.c", lib, base, base);
+          for (j = 0; j < n_deps; j++)
+            {
+              g_string_append (str, " $(top_srcdir)/libide/ide-");
+              append_lower (str, PICK (rand, words));
+              g_string_append (str, ".h");
+            }
+          g_string_append (str,
+                           "\n"
+                           "#  Implicit rule search has not been done.\n"
+                           "#  Modification time never checked.\n"
+                           "#  File has not been updated.\n");
+          g_string_append_printf (str, "#  recipe to execute (from 'Makefile', line %u):\n", line++);
+          g_string_append_printf (str,
+                                  "\t$(AM_V_CC)$(LIBTOOL) $(AM_V_lt) --tag=CC $(AM_LIBTOOLFLAGS) "
+                                  "--mode=compile $(CC) $(lib%s_la_CFLAGS) $(CFLAGS) "
+                                  "-MT lib%s_la-%s.lo -MD -MP -c -o lib%s_la-%s.lo "
+                                  "`test -f '%s.c' || echo '$(srcdir)/'`%s.c\n\n",
+                                  lib, lib, base, lib, base, base, base);
+        }
+    }
+
+  g_string_append (str, "# Finished Make data base on Thu Jan  1 00:00:00 2016\n");
+
+  return str;
+}
+
+static void
+append_indent (GString *str,
+               guint    depth)
+{
+  guint i;
+
+  for (i = 0; i < depth; i++)
+    g_string_append (str, "  ");
+}
+
+static void
+append_block (GRand     *rand,
+              GString   *str,
+              GPtrArray *identifiers,
+              guint      depth)
+{
+  guint n_statements = g_rand_int_range (rand, 1, 6);
+  guint i;
+
+  append_indent (str, depth);
+  g_string_append (str, "{\n");
+
+  for (i = 0; i < n_statements; i++)
+    {
+      const gchar *func = g_ptr_array_index (identifiers, g_rand_int_range (rand, 0, identifiers->len));
+
+      append_indent (str, depth + 1);
+
+      switch (g_rand_int_range (rand, 0, 7))
+        {
+        case 0:
+          g_string_append_printf (str, "/* call %s() if needed ( { */\n", func);
+          break;
+
+        case 1:
+          g_string_append_printf (str, "g_print (\"%s: ) } ]\\n\", %s (self, '{'));\n", func, func);
+          break;
+
+        case 2:
+          g_string_append_printf (str, "ret = %s (self,\n", func);
+          append_indent (str, depth + 1);
+          g_string_append (str, "       (flags & FLAG_MASK) != 0,\n");
+          append_indent (str, depth + 1);
+          g_string_append (str, "       items [i + 1]); // trailing )\n");
+          break;
+
+        case 3:
+        case 4:
+          if (depth < 4)
+            {
+              g_string_append_printf (str, "if (%s (self) && (count > 0 || str [0] == '('))\n", func);
+              append_block (rand, str, identifiers, depth + 2);
+              break;
+            }
+          /* fall through */
+
+        case 5:
+          if (depth < 4)
+            {
+              g_string_append (str, "for (i = 0; i < count; i++)\n");
+              append_block (rand, str, identifiers, depth + 2);
+              break;
+            }
+          /* fall through */
+
+        default:
+          g_string_append_printf (str, "%s (self, i, NULL);\n", func);
+          break;
+        }
+    }
+
+  append_indent (str, depth);
+  g_string_append (str, "}\n");
+}
+
+/**
+ * bench_corpus_c_source:
+ * @rand: a #GRand
+ * @identifiers: the names to use for functions and calls
+ * @n_functions: the number of functions to generate
+ *
+ * Generates a C file in the GNU style with nested blocks, comments, string
+ * and character constants containing brackets, and multi-line parameter
+ * lists, which are the constructs the C indenter has to look past.
+ *
+ * Returns: (transfer full): a #GString containing the source.
+ */
+GString *
+bench_corpus_c_source (GRand     *rand,
+                       GPtrArray *identifiers,
+                       guint      n_functions)
+{
+  GString *str;
+  guint i;
+
+  str = g_string_new ("/* generated.c\n"
+                      " *\n"
+                      " * Generated source used for benchmarking.\n"
+                      " */\n\n"
+                      "#include <glib.h>\n\n"
+                      "#define FLAG_MASK (1 << 3)\n"
+                      "#define CHECK(x) \\\n"
+                      "  G_STMT_START { \\\n"
+                      "    if (!(x)) \\\n"
+                      "      return; \\\n"
+                      "  } G_STMT_END\n\n");
+
+  for (i = 0; i < n_functions; i++)
+    {
+      const gchar *name = g_ptr_array_index (identifiers, i % identifiers->len);
+      g_autofree gchar *prefix = g_strdup_printf ("%s_%u (", name, i);
+      gint width = strlen (prefix);
+
+      g_string_append_printf (str,
+                              "static gboolean\n"
+                              "%sGObject      *self,\n"
+                              "%*sconst gchar  *str,\n"
+                              "%*sgint          count)\n",
+                              prefix, width, "", width, "");
+      append_block (rand, str, identifiers, 0);
+      g_string_append_c (str, '\n');
+    }
+
+  return str;
+}
@@ -0,0 +1,439 @@
+/* bench-harness.c
+ *
+ * Copyright (C) 2016 Christian Hergert <chergert@redhat.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <glib/gstdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "bench-harness.h"
+
+/*
+ * Each benchmark is calibrated so that a sample performs enough operations
+ * to take at least --min-time, and then a fixed number of samples are taken.
+ * The time per operation of each sample is used to compute the median and
+ * 95th percentile, which are less sensitive to scheduling noise than the
+ * mean.
+ *
+ * Allocations are counted by interposing the malloc() family, which catches
+ * g_malloc() and, with G_SLICE=always-malloc as set by the bench target,
+ * g_slice_alloc() as well. The count includes every thread, so work handed
+ * off to a GTask thread is attributed to the operation that started it.
+ *
+ * Results can be saved with --save and compared against on a later run with
+ * --compare, in which case the exit status is non-zero if the median of any
+ * benchmark regressed by more than --threshold percent.
+ */
+
+#define MAX_BATCH G_MAXUINT32
+
+typedef struct
+{
+  const BenchCase *bench;
+  guint64          batch;
+  gdouble          median_ns;
+  gdouble          p95_ns;
+  gdouble          allocs;
+} BenchResult;
+
+static gint     n_samples = 25;
+static gint     min_time_msec = 20;
+static gint64   seed = 20160101;
+static gchar   *save_path;
+static gchar   *compare_path;
+static gdouble  threshold = 10.0;
+static gboolean list_only;
+static gchar   *tmpdir;
+
+#ifdef __GLIBC__
+/*
+ * glibc allows the allocator to be replaced by defining these in the
+ * executable. We forward to the real implementation after counting.
+ */
+extern void *__libc_malloc  (gsize size);
+extern void *__libc_calloc  (gsize n_members, gsize size);
+extern void *__libc_realloc (void *mem, gsize size);
+
+# define HAVE_ALLOC_COUNTER 1
+
+static volatile guint64 n_allocs;
+
+void *
+malloc (gsize size)
+{
+  __sync_fetch_and_add (&n_allocs, 1);
+  return __libc_malloc (size);
+}
+
+void *
+calloc (gsize n_members,
+        gsize size)
+{
+  __sync_fetch_and_add (&n_allocs, 1);
+  return __libc_calloc (n_members, size);
+}
+
+void *
+realloc (void  *mem,
+         gsize  size)
+{
+  __sync_fetch_and_add (&n_allocs, 1);
+  return __libc_realloc (mem, size);
+}
+
+static inline guint64
+bench_get_allocs (void)
+{
+  return n_allocs;
+}
+#else
+static inline guint64
+bench_get_allocs (void)
+{
+  return 0;
+}
+#endif
+
+static inline gint64
+bench_get_time_ns (void)
+{
+  struct timespec ts;
+
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+
+  return (ts.tv_sec * G_GINT64_CONSTANT (1000000000)) + ts.tv_nsec;
+}
+
+static gchar *
+bench_format_time (gdouble ns)
+{
+  if (ns < 1000.0)
+    return g_strdup_printf ("%.1f ns", ns);
+  else if (ns < 1000000.0)
+    return g_strdup_printf ("%.2f us", ns / 1000.0);
+  else if (ns < 1000000000.0)
+    return g_strdup_printf ("%.2f ms", ns / 1000000.0);
+  else
+    return g_strdup_printf ("%.2f s", ns / 1000000000.0);
+}
+
+static gint
+compare_double (gconstpointer a,
+                gconstpointer b)
+{
+  gdouble da = *(const gdouble *)a;
+  gdouble db = *(const gdouble *)b;
+
+  return (da > db) - (da < db);
+}
+
+/**
+ * bench_write_file:
+ * @name: the basename of the file
+ * @contents: the contents to write
+ * @length: the length of @contents
+ *
+ * Writes @contents to a file within a temporary directory that is removed
+ * when the benchmarks complete.
+ *
+ * Returns: (transfer full): the path to the file.
+ */
+gchar *
+bench_write_file (const gchar *name,
+                  const gchar *contents,
+                  gsize        length)
+{
+  g_autoptr(GError) error = NULL;
+  gchar *path;
+
+  path = g_build_filename (tmpdir, name, NULL);
+
+  if (!g_file_set_contents (path, contents, length, &error))
+    g_error ("Failed to write %s: %s", path, error->message);
+
+  return path;
+}
+
+static void
+bench_remove_tmpdir (void)
+{
+  const gchar *name;
+  GDir *dir;
+
+  if (tmpdir == NULL || NULL == (dir = g_dir_open (tmpdir, 0, NULL)))
+    return;
+
+  while ((name = g_dir_read_name (dir)))
+    {
+      g_autofree gchar *path = g_build_filename (tmpdir, name, NULL);
+      g_unlink (path);
+    }
+
+  g_dir_close (dir);
+  g_rmdir (tmpdir);
+  g_clear_pointer (&tmpdir, g_free);
+}
+
+static gboolean
+bench_matches (const BenchCase  *bench,
+               gchar           **filters)
+{
+  guint i;
+
+  if (filters == NULL || filters [0] == NULL)
+    return TRUE;
+
+  for (i = 0; filters [i]; i++)
+    {
+      if (strstr (bench->name, filters [i]) != NULL)
+        return TRUE;
+    }
+
+  return FALSE;
+}
+
+static void
+bench_run (const BenchCase *bench,
+           BenchResult     *result)
+{
+  g_autofree gdouble *samples = NULL;
+  GRand *rand;
+  gpointer state;
+  guint64 batch = 1;
+  guint64 allocs = 0;
+  guint iteration = 0;
+  guint i;
+
+  rand = g_rand_new_with_seed ((guint32)seed);
+  state = bench->setup ? bench->setup (rand) : NULL;
+
+  /* Double the batch until a sample takes long enough to time reliably */
+  for (;;)
+    {
+      gint64 begin = bench_get_time_ns ();
+      guint64 j;
+
+      for (j = 0; j < batch; j++)
+        bench->func (state, iteration++);
+
+      if (bench_get_time_ns () - begin >= min_time_msec * G_GINT64_CONSTANT (1000000) ||
+          batch >= MAX_BATCH / 2)
+        break;
+
+      batch *= 2;
+    }
+
+  samples = g_new0 (gdouble, n_samples);
+
+  for (i = 0; i < (guint)n_samples; i++)
+    {
+      guint64 allocs_begin = bench_get_allocs ();
+      gint64 begin = bench_get_time_ns ();
+      guint64 j;
+
+      for (j = 0; j < batch; j++)
+        bench->func (state, iteration++);
+
+      samples [i] = (gdouble)(bench_get_time_ns () - begin) / batch;
+      allocs += bench_get_allocs () - allocs_begin;
+    }
+
+  qsort (samples, n_samples, sizeof (gdouble), compare_double);
+
+  result->bench = bench;
+  result->batch = batch;
+  result->median_ns = samples [n_samples / 2];
+  result->p95_ns = samples [MAX (0, (n_samples * 95 + 99) / 100 - 1)];
+  result->allocs = (gdouble)allocs / (batch * n_samples);
+
+  if (bench->teardown)
+    bench->teardown (state);
+
+  g_rand_free (rand);
+}
+
+static void
+bench_print_result (const BenchResult *result,
+                    GKeyFile          *baseline,
+                    gboolean          *regressed)
+{
+  g_autofree gchar *median = bench_format_time (result->median_ns);
+  g_autofree gchar *p95 = bench_format_time (result->p95_ns);
+  g_autofree gchar *allocs = NULL;
+  g_autofree gchar *delta = NULL;
+
+#ifdef HAVE_ALLOC_COUNTER
+  allocs = g_strdup_printf ("%.1f", result->allocs);
+#else
+  allocs = g_strdup ("-");
+#endif
+
+  if (baseline != NULL)
+    {
+      gdouble previous;
+
+      previous = g_key_file_get_double (baseline, result->bench->name, "median-ns", NULL);
+
+      if (previous > 0.0)
+        {
+          gdouble change = (result->median_ns - previous) * 100.0 / previous;
+
+          delta = g_strdup_printf ("%+.1f%%%s", change, change > threshold ? " REGRESSED" : "");
+
+          if (change > threshold)
+            *regressed = TRUE;
+        }
+      else
+        delta = g_strdup ("new");
+    }
+
+  g_print ("%-32s %12s %12s %10s %8"G_GUINT64_FORMAT"  %s\n",
+           result->bench->name, median, p95, allocs, result->batch,
+           delta ? delta : "");
+}
+
+static void
+bench_save_result (const BenchResult *result,
+                   GKeyFile          *key_file)
+{
+  g_key_file_set_double (key_file, result->bench->name, "median-ns", result->median_ns);
+  g_key_file_set_double (key_file, result->bench->name, "p95-ns", result->p95_ns);
+  g_key_file_set_double (key_file, result->bench->name, "allocs", result->allocs);
+}
+
+/**
+ * bench_main:
+ * @argc: the number of arguments
+ * @argv: the arguments
+ * @cases: the available benchmarks
+ * @n_cases: the number of elements in @cases
+ *
+ * Parses the command line and runs the benchmarks in @cases whose name
+ * contains one of the remaining arguments, or all of them if there are
+ * none.
+ *
+ * Returns: the exit status for the program.
+ */
+gint
+bench_main (gint             argc,
+            gchar          **argv,
+            const BenchCase *cases,
+            guint            n_cases)
+{
+  GOptionEntry entries[] = {
+    { "samples", 'n', 0, G_OPTION_ARG_INT, &n_samples,
+      "The number of samples to take of each benchmark", "N" },
+    { "min-time", 't', 0, G_OPTION_ARG_INT, &min_time_msec,
+      "The minimum duration of a sample in milliseconds", "MSEC" },
+    { "seed", 's', 0, G_OPTION_ARG_INT64, &seed,
+      "The seed used to generate the corpora", "SEED" },
+    { "save", 0, 0, G_OPTION_ARG_FILENAME, &save_path,
+      "Save the results as a baseline", "FILE" },
+    { "compare", 'c', 0, G_OPTION_ARG_FILENAME, &compare_path,
+      "Compare the results to a saved baseline", "FILE" },
+    { "threshold", 0, 0, G_OPTION_ARG_DOUBLE, &threshold,
+      "The median slowdown in percent considered a regression", "PERCENT" },
+    { "list", 'l', 0, G_OPTION_ARG_NONE, &list_only,
+      "List the available benchmarks", NULL },
+    { NULL }
+  };
+  g_autoptr(GOptionContext) context = NULL;
+  g_autoptr(GKeyFile) baseline = NULL;
+  g_autoptr(GKeyFile) results = NULL;
+  g_autoptr(GError) error = NULL;
+  gboolean regressed = FALSE;
+  guint i;
+
+  context = g_option_context_new ("[FILTER...] - Run libide benchmarks");
+  g_option_context_add_main_entries (context, entries, NULL);
+
+  if (!g_option_context_parse (context, &argc, &argv, &error))
+    {
+      g_printerr ("%s\n", error->message);
+      return EXIT_FAILURE;
+    }
+
+  if (n_samples < 1 || min_time_msec < 0)
+    {
+      g_printerr ("--samples must be positive and --min-time must not be negative\n");
+      return EXIT_FAILURE;
+    }
+
+  if (list_only)
+    {
+      for (i = 0; i < n_cases; i++)
+        g_print ("%-32s %s\n", cases [i].name, cases [i].description);
+      return EXIT_SUCCESS;
+    }
+
+  if (compare_path != NULL)
+    {
+      baseline = g_key_file_new ();
+
+      if (!g_key_file_load_from_file (baseline, compare_path, G_KEY_FILE_NONE, &error))
+        {
+          g_printerr ("Failed to load baseline: %s\n", error->message);
+          return EXIT_FAILURE;
+        }
+
+      /* Different corpora make the comparison meaningless */
+      if (g_key_file_get_int64 (baseline, "Benchmarks", "seed", NULL) != seed)
+        g_printerr ("Warning: the baseline was recorded with a different --seed\n");
+    }
+
+  if (NULL == (tmpdir = g_dir_make_tmp ("bench-libide-XXXXXX", &error)))
+    {
+      g_printerr ("%s\n", error->message);
+      return EXIT_FAILURE;
+    }
+
+  results = g_key_file_new ();
+
+  g_print ("# seed %"G_GINT64_FORMAT", %d samples of at least %d msec\n",
+           seed, n_samples, min_time_msec);
+  g_print ("%-32s %12s %12s %10s %8s  %s\n",
+           "Benchmark", "Median", "p95", "Allocs/op", "Batch",
+           baseline ? "Change" : "");
+
+  for (i = 0; i < n_cases; i++)
+    {
+      BenchResult result = { 0 };
+
+      if (!bench_matches (&cases [i], &argv [1]))
+        continue;
+
+      bench_run (&cases [i], &result);
+      bench_print_result (&result, baseline, &regressed);
+      bench_save_result (&result, results);
+    }
+
+  bench_remove_tmpdir ();
+
+  if (save_path != NULL)
+    {
+      g_key_file_set_int64 (results, "Benchmarks", "seed", seed);
+
+      if (!g_key_file_save_to_file (results, save_path, &error))
+        {
+          g_printerr ("Failed to save baseline: %s\n", error->message);
+          return EXIT_FAILURE;
+        }
+    }
+
+  return regressed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,88 @@
+/* bench-harness.h
+ *
+ * Copyright (C) 2016 Christian Hergert <chergert@redhat.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef BENCH_HARNESS_H
+#define BENCH_HARNESS_H
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/**
+ * BenchSetupFunc:
+ * @rand: a #GRand seeded identically for every run
+ *
+ * Prepares the state for a benchmark, usually by generating a corpus.
+ * Setup is not measured.
+ *
+ * Returns: the state passed to the #BenchFunc.
+ */
+typedef gpointer (*BenchSetupFunc)    (GRand    *rand);
+
+/**
+ * BenchFunc:
+ * @state: the state returned from the #BenchSetupFunc
+ * @iteration: the number of operations performed so far
+ *
+ * Performs a single operation. @iteration can be used to pick a different
+ * input for each operation while remaining reproducible.
+ */
+typedef void     (*BenchFunc)         (gpointer  state,
+                                       guint     iteration);
+typedef void     (*BenchTeardownFunc) (gpointer  state);
+
+typedef struct
+{
+  const gchar       *name;
+  const gchar       *description;
+  BenchSetupFunc     setup;
+  BenchFunc          func;
+  BenchTeardownFunc  teardown;
+} BenchCase;
+
+gint       bench_main                (gint             argc,
+                                      gchar          **argv,
+                                      const BenchCase *cases,
+                                      guint            n_cases);
+gchar     *bench_write_file          (const gchar     *name,
+                                      const gchar     *contents,
+                                      gsize            length);
+
+/* Synthetic corpora, see bench-corpus.c */
+GPtrArray *bench_corpus_identifiers  (GRand           *rand,
+                                      guint            n_identifiers);
+GPtrArray *bench_corpus_paths        (GRand           *rand,
+                                      guint            n_paths);
+GString   *bench_corpus_tags         (GRand           *rand,
+                                      GPtrArray       *identifiers,
+                                      GPtrArray       *paths);
+GString   *bench_corpus_make_dump    (GRand           *rand,
+                                      GPtrArray       *paths);
+GString   *bench_corpus_c_source     (GRand           *rand,
+                                      GPtrArray       *identifiers,
+                                      guint            n_functions);
+
+/* Benchmarks of plugin internals, see bench-makecache.c */
+gpointer   bench_makecache_setup     (GRand           *rand);
+void       bench_makecache_targets   (gpointer         state,
+                                      guint            iteration);
+void       bench_makecache_teardown  (gpointer         state);
+
+G_END_DECLS
+
+#endif /* BENCH_HARNESS_H */
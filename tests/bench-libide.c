@@ -0,0 +1,456 @@
+/* bench-libide.c
+ *
+ * Copyright (C) 2016 Christian Hergert <chergert@redhat.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Micro-benchmarks for hot paths in libide and the plugins. Run them with
+ * "make -C tests bench", and see bench-harness.c for the available options.
+ *
+ *   make -C tests bench BENCH_ARGS="--save=baseline.ini"
+ *   make -C tests bench BENCH_ARGS="--compare=baseline.ini fuzzy"
+ */
+
+#include <fuzzy.h>
+#include <gtk/gtk.h>
+#include <ide.h>
+#include <string.h>
+
+#include "bench-harness.h"
+#include "ide-c-line-cache.h"
+#include "ide-ctags-index.h"
+
+#define N_QUERIES 64
+
+void _ide_ctags_index_register_type (GTypeModule *module);
+
+/* The ctags index is a dynamic type, so it needs a module to register with */
+typedef GTypeModule      BenchTypeModule;
+typedef GTypeModuleClass BenchTypeModuleClass;
+
+G_DEFINE_TYPE (BenchTypeModule, bench_type_module, G_TYPE_TYPE_MODULE)
+
+static gboolean
+bench_type_module_load (GTypeModule *module)
+{
+  return TRUE;
+}
+
+static void
+bench_type_module_unload (GTypeModule *module)
+{
+}
+
+static void
+bench_type_module_class_init (BenchTypeModuleClass *klass)
+{
+  klass->load = bench_type_module_load;
+  klass->unload = bench_type_module_unload;
+}
+
+static void
+bench_type_module_init (BenchTypeModule *self)
+{
+}
+
+/*
+ * Picks a query the way people type them, a few characters in order from
+ * the name of something they are looking for.
+ */
+static gchar *
+make_query (GRand       *rand,
+            const gchar *target)
+{
+  const gchar *base = strrchr (target, '/');
+  GString *str = g_string_new (NULL);
+  guint len;
+  guint n_chars;
+
+  base = base ? base + 1 : target;
+  len = strlen (base);
+  n_chars = MIN (len, (guint)g_rand_int_range (rand, 2, 7));
+
+  while (str->len < n_chars && *base)
+    {
+      if (g_rand_int_range (rand, 0, len) < n_chars * 2)
+        g_string_append_c (str, g_ascii_tolower (*base));
+      base++;
+    }
+
+  return g_string_free (str, FALSE);
+}
+
+typedef struct
+{
+  GPtrArray *paths;
+  GPtrArray *queries;
+  Fuzzy     *fuzzy;
+} FuzzyState;
+
+static Fuzzy *
+fuzzy_build_index (GPtrArray *paths)
+{
+  Fuzzy *fuzzy;
+  guint i;
+
+  fuzzy = fuzzy_new (FALSE);
+
+  fuzzy_begin_bulk_insert (fuzzy);
+  for (i = 0; i < paths->len; i++)
+    fuzzy_insert (fuzzy, g_ptr_array_index (paths, i), NULL);
+  fuzzy_end_bulk_insert (fuzzy);
+
+  return fuzzy;
+}
+
+static gpointer
+fuzzy_setup (GRand *rand)
+{
+  FuzzyState *state;
+  guint i;
+
+  state = g_new0 (FuzzyState, 1);
+  state->paths = bench_corpus_paths (rand, 50000);
+  state->queries = g_ptr_array_new_with_free_func (g_free);
+
+  for (i = 0; i < N_QUERIES; i++)
+    {
+      const gchar *path = g_ptr_array_index (state->paths, g_rand_int_range (rand, 0, state->paths->len));
+      g_ptr_array_add (state->queries, make_query (rand, path));
+    }
+
+  state->fuzzy = fuzzy_build_index (state->paths);
+
+  return state;
+}
+
+static void
+fuzzy_build (gpointer data,
+             guint    iteration)
+{
+  FuzzyState *state = data;
+
+  fuzzy_unref (fuzzy_build_index (state->paths));
+}
+
+static void
+fuzzy_match_query (gpointer data,
+                   guint    iteration)
+{
+  FuzzyState *state = data;
+  const gchar *query;
+
+  query = g_ptr_array_index (state->queries, iteration % state->queries->len);
+  g_array_unref (fuzzy_match (state->fuzzy, query, 100));
+}
+
+static void
+fuzzy_teardown (gpointer data)
+{
+  FuzzyState *state = data;
+
+  g_ptr_array_unref (state->paths);
+  g_ptr_array_unref (state->queries);
+  fuzzy_unref (state->fuzzy);
+  g_free (state);
+}
+
+typedef struct
+{
+  GFile         *file;
+  GPtrArray     *prefixes;
+  IdeCtagsIndex *index;
+} CtagsState;
+
+static void
+ctags_init_cb (GObject      *object,
+               GAsyncResult *result,
+               gpointer      user_data)
+{
+  g_autoptr(GError) error = NULL;
+  gboolean *done = user_data;
+
+  if (!g_async_initable_init_finish (G_ASYNC_INITABLE (object), result, &error))
+    g_error ("%s", error->message);
+
+  *done = TRUE;
+}
+
+static IdeCtagsIndex *
+ctags_load (GFile *file)
+{
+  IdeCtagsIndex *index;
+  gboolean done = FALSE;
+
+  index = ide_ctags_index_new (file, NULL, 0);
+  g_async_initable_init_async (G_ASYNC_INITABLE (index),
+                               G_PRIORITY_DEFAULT,
+                               NULL,
+                               ctags_init_cb,
+                               &done);
+
+  while (!done)
+    g_main_context_iteration (NULL, TRUE);
+
+  return index;
+}
+
+static gpointer
+ctags_setup (GRand *rand)
+{
+  g_autoptr(GPtrArray) identifiers = NULL;
+  g_autoptr(GPtrArray) paths = NULL;
+  g_autoptr(GString) tags = NULL;
+  g_autofree gchar *filename = NULL;
+  CtagsState *state;
+  guint i;
+
+  identifiers = bench_corpus_identifiers (rand, 50000);
+  paths = bench_corpus_paths (rand, 5000);
+  tags = bench_corpus_tags (rand, identifiers, paths);
+  filename = bench_write_file ("tags", tags->str, tags->len);
+
+  state = g_new0 (CtagsState, 1);
+  state->file = g_file_new_for_path (filename);
+  state->prefixes = g_ptr_array_new_with_free_func (g_free);
+
+  /* Completion looks up the word being typed, usually a few characters in */
+  for (i = 0; i < N_QUERIES; i++)
+    {
+      const gchar *name = g_ptr_array_index (identifiers, g_rand_int_range (rand, 0, identifiers->len));
+      g_ptr_array_add (state->prefixes,
+                       g_strndup (name, g_rand_int_range (rand, 3, 9)));
+    }
+
+  state->index = ctags_load (state->file);
+
+  return state;
+}
+
+static void
+ctags_load_file (gpointer data,
+                 guint    iteration)
+{
+  CtagsState *state = data;
+
+  g_object_unref (ctags_load (state->file));
+}
+
+static void
+ctags_lookup_prefix (gpointer data,
+                     guint    iteration)
+{
+  CtagsState *state = data;
+  const gchar *prefix;
+  gsize n_entries;
+
+  prefix = g_ptr_array_index (state->prefixes, iteration % state->prefixes->len);
+  ide_ctags_index_lookup_prefix (state->index, prefix, &n_entries);
+}
+
+static void
+ctags_teardown (gpointer data)
+{
+  CtagsState *state = data;
+
+  g_object_unref (state->file);
+  g_object_unref (state->index);
+  g_ptr_array_unref (state->prefixes);
+  g_free (state);
+}
+
+typedef struct
+{
+  GPtrArray         *words;
+  IdeHighlightIndex *index;
+} HighlightState;
+
+static IdeHighlightIndex *
+highlight_build_index (GPtrArray *words)
+{
+  IdeHighlightIndex *index;
+  guint i;
+
+  index = ide_highlight_index_new ();
+
+  /* Only insert every other word so that half of the lookups miss */
+  for (i = 0; i < words->len; i += 2)
+    ide_highlight_index_insert (index, g_ptr_array_index (words, i), (gpointer)"def:type");
+
+  return index;
+}
+
+static gpointer
+highlight_setup (GRand *rand)
+{
+  HighlightState *state;
+
+  state = g_new0 (HighlightState, 1);
+  state->words = bench_corpus_identifiers (rand, 40000);
+  state->index = highlight_build_index (state->words);
+
+  return state;
+}
+
+static void
+highlight_build (gpointer data,
+                 guint    iteration)
+{
+  HighlightState *state = data;
+
+  ide_highlight_index_unref (highlight_build_index (state->words));
+}
+
+static void
+highlight_lookup (gpointer data,
+                  guint    iteration)
+{
+  HighlightState *state = data;
+  const gchar *word;
+
+  word = g_ptr_array_index (state->words, (iteration * 7919) % state->words->len);
+  ide_highlight_index_lookup (state->index, word);
+}
+
+static void
+highlight_teardown (gpointer data)
+{
+  HighlightState *state = data;
+
+  g_ptr_array_unref (state->words);
+  ide_highlight_index_unref (state->index);
+  g_free (state);
+}
+
+typedef struct
+{
+  GtkTextBuffer *buffer;
+  IdeCLineCache *cache;
+  guint          n_lines;
+} IndenterState;
+
+static gpointer
+indenter_setup (GRand *rand)
+{
+  g_autoptr(GPtrArray) identifiers = NULL;
+  g_autoptr(GString) source = NULL;
+  IndenterState *state;
+
+  identifiers = bench_corpus_identifiers (rand, 2000);
+  source = bench_corpus_c_source (rand, identifiers, 2000);
+
+  state = g_new0 (IndenterState, 1);
+  state->buffer = gtk_text_buffer_new (NULL);
+  gtk_text_buffer_set_text (state->buffer, source->str, source->len);
+  state->n_lines = gtk_text_buffer_get_line_count (state->buffer);
+  state->cache = ide_c_line_cache_get_for_buffer (state->buffer);
+
+  return state;
+}
+
+static void
+indenter_find_unmatched_at_line (IndenterState *state,
+                                 guint          line,
+                                 gunichar       ch)
+{
+  GtkTextIter iter;
+
+  gtk_text_buffer_get_iter_at_line (state->buffer, &iter, line);
+  if (!gtk_text_iter_ends_line (&iter))
+    gtk_text_iter_forward_to_line_end (&iter);
+
+  ide_c_line_cache_backward_find_unmatched (state->cache, &iter, ch);
+}
+
+static void
+indenter_find_unmatched (gpointer data,
+                         guint    iteration)
+{
+  IndenterState *state = data;
+
+  indenter_find_unmatched_at_line (state,
+                                   (iteration * 7919) % state->n_lines,
+                                   (iteration & 1) ? ')' : '}');
+}
+
+/*
+ * Simulates typing: an edit invalidates the cached state after the edited
+ * line, and the next indent request below it has to scan forward again.
+ */
+static void
+indenter_edit (gpointer data,
+               guint    iteration)
+{
+  IndenterState *state = data;
+  GtkTextIter begin;
+  GtkTextIter end;
+  guint line;
+
+  line = (iteration * 7919) % state->n_lines;
+
+  gtk_text_buffer_get_iter_at_line (state->buffer, &begin, line);
+  gtk_text_buffer_insert (state->buffer, &begin, " ", 1);
+
+  indenter_find_unmatched_at_line (state, MIN (line + 20, state->n_lines - 1), '}');
+
+  gtk_text_buffer_get_iter_at_line (state->buffer, &begin, line);
+  end = begin;
+  gtk_text_iter_forward_char (&end);
+  gtk_text_buffer_delete (state->buffer, &begin, &end);
+}
+
+static void
+indenter_teardown (gpointer data)
+{
+  IndenterState *state = data;
+
+  g_object_unref (state->buffer);
+  g_free (state);
+}
+
+static const BenchCase cases[] = {
+  { "fuzzy/build", "Index 50000 paths with bulk insertion",
+    fuzzy_setup, fuzzy_build, fuzzy_teardown },
+  { "fuzzy/match", "Match a short query against 50000 paths",
+    fuzzy_setup, fuzzy_match_query, fuzzy_teardown },
+  { "ctags/load", "Load and sort a tags file with 50000 entries",
+    ctags_setup, ctags_load_file, ctags_teardown },
+  { "ctags/lookup-prefix", "Find the tags starting with a short prefix",
+    ctags_setup, ctags_lookup_prefix, ctags_teardown },
+  { "highlight/build", "Insert 20000 identifiers into a highlight index",
+    highlight_setup, highlight_build, highlight_teardown },
+  { "highlight/lookup", "Look up an identifier, half of them missing",
+    highlight_setup, highlight_lookup, highlight_teardown },
+  { "makecache/targets", "Find the targets of a file in a make -p dump",
+    bench_makecache_setup, bench_makecache_targets, bench_makecache_teardown },
+  { "c-indenter/find-unmatched", "Find the unmatched bracket before a line",
+    indenter_setup, indenter_find_unmatched, indenter_teardown },
+  { "c-indenter/edit", "Insert a character and find an unmatched bracket below it",
+    indenter_setup, indenter_edit, indenter_teardown },
+};
+
+gint
+main (gint   argc,
+      gchar *argv[])
+{
+  GTypeModule *module;
+
+  module = g_object_new (bench_type_module_get_type (), NULL);
+  g_type_module_use (module);
+  _ide_ctags_index_register_type (module);
+
+  return bench_main (argc, argv, cases, G_N_ELEMENTS (cases));
+}
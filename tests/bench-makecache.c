@@ -0,0 +1,88 @@
+/* bench-makecache.c
+ *
+ * Copyright (C) 2016 Christian Hergert <chergert@redhat.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * The target lookup is private to the autotools plugin and creating an
+ * IdeMakecache requires running make, so we compile the plugin source into
+ * this file and call the lookup on a synthetic `make -p` dump directly.
+ */
+#include "ide-makecache.c"
+
+#include "bench-harness.h"
+
+typedef struct
+{
+  GPtrArray   *sources;
+  GMappedFile *mapped;
+} MakecacheState;
+
+gpointer
+bench_makecache_setup (GRand *rand)
+{
+  g_autoptr(GPtrArray) paths = NULL;
+  g_autoptr(GString) dump = NULL;
+  g_autoptr(GError) error = NULL;
+  g_autofree gchar *filename = NULL;
+  MakecacheState *state;
+  guint i;
+
+  paths = bench_corpus_paths (rand, 20000);
+  dump = bench_corpus_make_dump (rand, paths);
+  filename = bench_write_file ("makecache", dump->str, dump->len);
+
+  state = g_new0 (MakecacheState, 1);
+  state->sources = g_ptr_array_new_with_free_func (g_free);
+
+  if (NULL == (state->mapped = g_mapped_file_new (filename, FALSE, &error)))
+    g_error ("%s", error->message);
+
+  for (i = 0; i < paths->len; i++)
+    {
+      const gchar *path = g_ptr_array_index (paths, i);
+
+      if (g_str_has_suffix (path, ".c"))
+        g_ptr_array_add (state->sources, g_strdup (path));
+    }
+
+  return state;
+}
+
+void
+bench_makecache_targets (gpointer data,
+                         guint    iteration)
+{
+  MakecacheState *state = data;
+  const gchar *path;
+  GPtrArray *targets;
+
+  /* Spread lookups evenly over the dump */
+  path = g_ptr_array_index (state->sources, (iteration * 7919) % state->sources->len);
+
+  if ((targets = ide_makecache_get_file_targets_searched (state->mapped, path)))
+    g_ptr_array_unref (targets);
+}
+
+void
+bench_makecache_teardown (gpointer data)
+{
+  MakecacheState *state = data;
+
+  g_ptr_array_unref (state->sources);
+  g_mapped_file_unref (state->mapped);
+  g_free (state);
+}
@@ -91,19 +91,33 @@ test_filesettings (void)
   g_clear_object (&dummy);
 }
 
+typedef struct
+{
+  const gchar    *filename;
+  guint           tab_width;
+  gint            indent_width;
+  IdeIndentStyle  indent_style;
+} EditorconfigExpected;
+
+typedef struct
+{
+  GMainLoop                  *main_loop;
+  const EditorconfigExpected *expected;
+} EditorconfigState;
+
 static void
 test_editorconfig_new_cb (GObject      *object,
                           GAsyncResult *result,
                           gpointer      user_data)
 {
   GAsyncInitable *initable = (GAsyncInitable *)object;
-  GMainLoop *main_loop = user_data;
+  EditorconfigState *state = user_data;
   IdeFileSettings *settings;
   GObject *res;
   GError *error = NULL;
 
   g_assert (G_IS_ASYNC_INITABLE (initable));
-  g_assert (main_loop != NULL);
+  g_assert (state != NULL);
 
   res = g_async_initable_new_finish (initable, result, &error);
   g_assert_no_error (error);
@@ -113,46 +127,67 @@ test_editorconfig_new_cb (GObject      *object,
   settings = IDE_FILE_SETTINGS (res);
   g_assert (settings != NULL);
 
-  g_assert_cmpint (ide_file_settings_get_tab_width (settings), ==, 4);
-  g_assert_cmpint (ide_file_settings_get_indent_width (settings), ==, 2);
+  g_assert_cmpint (ide_file_settings_get_tab_width (settings), ==, state->expected->tab_width);
+  g_assert_cmpint (ide_file_settings_get_indent_width (settings), ==, state->expected->indent_width);
   g_assert_cmpstr (ide_file_settings_get_encoding (settings), ==, "utf-8");
-  g_assert_cmpint (ide_file_settings_get_indent_style (settings), ==, IDE_INDENT_STYLE_SPACES);
+  g_assert_cmpint (ide_file_settings_get_indent_style (settings), ==, state->expected->indent_style);
 
-  g_main_loop_quit (main_loop);
+  g_object_unref (res);
+
+  g_main_loop_quit (state->main_loop);
 }
 
 static void
 test_editorconfig (void)
 {
-  GMainLoop *main_loop;
+  static const EditorconfigExpected expected[] = {
+    { "test.c", 4, 2, IDE_INDENT_STYLE_SPACES },
+    /* indent_style = tab implies indent_size = tab, using the tab width */
+    { "indent-style-tab.txt", 8, -1, IDE_INDENT_STYLE_TABS },
+    /* indent_size = tab takes the value of tab_width */
+    { "indent-size-tab.txt", 4, 4, IDE_INDENT_STYLE_TABS },
+    /* tab_width defaults to a numeric indent_size */
+    { "indent-size.txt", 3, 3, IDE_INDENT_STYLE_SPACES },
+  };
+  EditorconfigState state;
   IdeContext *dummy;
-  IdeFile *file;
-  GFile *gfile;
+  guint i;
 
   dummy = g_object_new (IDE_TYPE_CONTEXT, NULL);
-  gfile = g_file_new_for_path (TEST_DATA_DIR"/project1/test.c");
-  file = g_object_new (IDE_TYPE_FILE,
-                       "context", dummy,
-                       "file", gfile,
-                       "path", TEST_DATA_DIR"/project1/test.c",
-                       NULL);
+  state.main_loop = g_main_loop_new (NULL, FALSE);
 
-  main_loop = g_main_loop_new (NULL, FALSE);
+  for (i = 0; i < G_N_ELEMENTS (expected); i++)
+    {
+      g_autofree gchar *path = NULL;
+      IdeFile *file;
+      GFile *gfile;
 
-  g_async_initable_new_async (IDE_TYPE_EDITORCONFIG_FILE_SETTINGS,
-                              G_PRIORITY_DEFAULT,
-                              NULL,
-                              test_editorconfig_new_cb,
-                              main_loop,
-                              "file", file,
-                              "context", dummy,
-                              NULL);
+      path = g_build_filename (TEST_DATA_DIR, "project1", expected [i].filename, NULL);
+      gfile = g_file_new_for_path (path);
+      file = g_object_new (IDE_TYPE_FILE,
+                           "context", dummy,
+                           "file", gfile,
+                           "path", path,
+                           NULL);
 
-  g_main_loop_run (main_loop);
+      state.expected = &expected [i];
 
-  g_main_loop_unref (main_loop);
-  g_clear_object (&file);
-  g_clear_object (&gfile);
+      g_async_initable_new_async (IDE_TYPE_EDITORCONFIG_FILE_SETTINGS,
+                                  G_PRIORITY_DEFAULT,
+                                  NULL,
+                                  test_editorconfig_new_cb,
+                                  &state,
+                                  "file", file,
+                                  "context", dummy,
+                                  NULL);
+
+      g_main_loop_run (state.main_loop);
+
+      g_clear_object (&file);
+      g_clear_object (&gfile);
+    }
+
+  g_main_loop_unref (state.main_loop);
   g_clear_object (&dummy);
 }
 
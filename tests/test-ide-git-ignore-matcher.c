@@ -0,0 +1,191 @@
+/* test-ide-git-ignore-matcher.c
+ *
+ * Copyright (C) 2016 Christian Hergert <chergert@redhat.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * glob_to_regex() is private to the git plugin, so we compile the matcher
+ * into this file. It only depends on GLib, not on libgit2.
+ */
+#include "ide-git-ignore-matcher.c"
+
+#include <glib/gstdio.h>
+
+static const struct {
+  const gchar *glob;
+  const gchar *path;
+  gboolean     matches;
+} glob_cases[] = {
+  { "*.c",          "main.c",         TRUE  },
+  { "*.c",          "main.cc",        FALSE },
+  { "*.c",          "src/main.c",     FALSE },
+  { "?.o",          "a.o",            TRUE  },
+  { "?.o",          "ab.o",           FALSE },
+  { "?",            "/",              FALSE },
+  { "foo.bar",      "fooxbar",        FALSE },
+
+  /* Leading "**" matches in all directories */
+  { "**/foo",       "foo",            TRUE  },
+  { "**/foo",       "a/foo",          TRUE  },
+  { "**/foo",       "a/b/foo",        TRUE  },
+  { "**/foo",       "xfoo",           FALSE },
+
+  /* "/**\/" matches zero or more directories */
+  { "a/**/b",       "a/b",            TRUE  },
+  { "a/**/b",       "a/x/b",          TRUE  },
+  { "a/**/b",       "a/x/y/b",        TRUE  },
+  { "a/**/b",       "ab",             FALSE },
+
+  /* Trailing "/**" matches everything inside */
+  { "foo/**",       "foo/x",          TRUE  },
+  { "foo/**",       "foo/x/y",        TRUE  },
+  { "foo/**",       "foo",            FALSE },
+
+  /* Character classes */
+  { "[abc].txt",    "a.txt",          TRUE  },
+  { "[abc].txt",    "d.txt",          FALSE },
+  { "[!abc].txt",   "d.txt",          TRUE  },
+  { "[!abc].txt",   "a.txt",          FALSE },
+  { "[^abc].txt",   "a.txt",          FALSE },
+  { "[a-z]*.h",     "foo.h",          TRUE  },
+  { "[a-z]*.h",     "Foo.h",          FALSE },
+  { "[]]x",         "]x",             TRUE  },
+  { "[abc",         "[abc",           TRUE  },
+  { "[abc",         "a",              FALSE },
+
+  /* Escapes */
+  { "\\*.c",        "*.c",            TRUE  },
+  { "\\*.c",        "a.c",            FALSE },
+};
+
+static const struct {
+  const gchar *contents;
+  const gchar *relpath;
+  gboolean     is_dir;
+  gboolean     ignored;
+} rule_cases[] = {
+  /* Leading slash anchors to the directory of the .gitignore */
+  { "/build\n",                  "build",             TRUE,  TRUE  },
+  { "/build\n",                  "src/build",         TRUE,  FALSE },
+  { "build\n",                   "src/build",         TRUE,  TRUE  },
+
+  /* Trailing slash only matches directories */
+  { "build/\n",                  "build",             TRUE,  TRUE  },
+  { "build/\n",                  "build",             FALSE, FALSE },
+  { "build/\n",                  "src/build",         TRUE,  TRUE  },
+  { "build/\n",                  "build/main.o",      FALSE, TRUE  },
+
+  /* Negation, last match wins */
+  { "*.log\n!keep.log\n",        "a.log",             FALSE, TRUE  },
+  { "*.log\n!keep.log\n",        "keep.log",          FALSE, FALSE },
+  { "*.log\n!keep.log\n",        "src/keep.log",      FALSE, FALSE },
+  { "!keep.log\n*.log\n",        "keep.log",          FALSE, TRUE  },
+  { "\\!important\n",            "!important",        FALSE, TRUE  },
+
+  /* Files within an ignored directory cannot be re-included */
+  { "logs/\n!logs/keep.log\n",   "logs/keep.log",     FALSE, TRUE  },
+
+  /* "**" */
+  { "**/cache\n",                "cache",             TRUE,  TRUE  },
+  { "**/cache\n",                "a/b/cache",         TRUE,  TRUE  },
+  { "doc/**/*.html\n",           "doc/a.html",        FALSE, TRUE  },
+  { "doc/**/*.html\n",           "doc/x/y/a.html",    FALSE, TRUE  },
+  { "doc/**/*.html\n",           "src/a.html",        FALSE, FALSE },
+
+  /* Character classes */
+  { "*.[oa]\n",                  "x.o",               FALSE, TRUE  },
+  { "*.[oa]\n",                  "lib/x.a",           FALSE, TRUE  },
+  { "*.[oa]\n",                  "x.c",               FALSE, FALSE },
+
+  /* Comments, blank lines and trailing whitespace */
+  { "#comment\n\n",              "#comment",          FALSE, FALSE },
+  { "\\#comment\n",              "#comment",          FALSE, TRUE  },
+  { "foo.o   \n",                "foo.o",             FALSE, TRUE  },
+};
+
+static void
+test_glob_to_regex (void)
+{
+  guint i;
+
+  for (i = 0; i < G_N_ELEMENTS (glob_cases); i++)
+    {
+      g_autofree gchar *pattern = glob_to_regex (glob_cases [i].glob);
+      gboolean matches;
+
+      matches = g_regex_match_simple (pattern, glob_cases [i].path, 0, 0);
+
+      if (matches != glob_cases [i].matches)
+        g_error ("\"%s\" (%s) %s match \"%s\"",
+                 glob_cases [i].glob, pattern,
+                 glob_cases [i].matches ? "should" : "should not",
+                 glob_cases [i].path);
+    }
+}
+
+static void
+test_is_ignored (void)
+{
+  g_autoptr(GError) error = NULL;
+  g_autofree gchar *workdir = NULL;
+  g_autofree gchar *gitdir = NULL;
+  g_autofree gchar *gitignore = NULL;
+  g_autofree gchar *excludes_file = NULL;
+  guint i;
+
+  workdir = g_dir_make_tmp ("test-ide-git-ignore-matcher-XXXXXX", &error);
+  g_assert_no_error (error);
+
+  gitdir = g_build_filename (workdir, ".git", NULL);
+  gitignore = g_build_filename (workdir, ".gitignore", NULL);
+
+  /* Keep the user's core.excludesfile out of the results */
+  excludes_file = g_build_filename (workdir, "excludes", NULL);
+
+  for (i = 0; i < G_N_ELEMENTS (rule_cases); i++)
+    {
+      g_autoptr(IdeGitIgnoreMatcher) matcher = NULL;
+      gboolean ignored;
+
+      g_file_set_contents (gitignore, rule_cases [i].contents, -1, &error);
+      g_assert_no_error (error);
+
+      matcher = ide_git_ignore_matcher_new (workdir, gitdir, excludes_file);
+      ignored = ide_git_ignore_matcher_is_ignored (matcher,
+                                                   rule_cases [i].relpath,
+                                                   rule_cases [i].is_dir);
+
+      if (ignored != rule_cases [i].ignored)
+        g_error ("\"%s\"%s %s be ignored by:\n%s",
+                 rule_cases [i].relpath,
+                 rule_cases [i].is_dir ? " (directory)" : "",
+                 rule_cases [i].ignored ? "should" : "should not",
+                 rule_cases [i].contents);
+    }
+
+  g_unlink (gitignore);
+  g_rmdir (workdir);
+}
+
+gint
+main (gint   argc,
+      gchar *argv[])
+{
+  g_test_init (&argc, &argv, NULL);
+  g_test_add_func ("/Ide/Git/IgnoreMatcher/glob_to_regex", test_glob_to_regex);
+  g_test_add_func ("/Ide/Git/IgnoreMatcher/is_ignored", test_is_ignored);
+  return g_test_run ();
+}
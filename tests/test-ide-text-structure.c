@@ -0,0 +1,317 @@
+/* test-ide-text-structure.c
+ *
+ * Copyright (C) 2016 Christian Hergert <chergert@redhat.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <ide.h>
+#include <string.h>
+
+#include "ide-text-structure.h"
+
+/*
+ * Edits a buffer and compares every query of the index with a naive walk
+ * over the buffer contents. Several edits are made between queries so
+ * that splices happen while other lines are still waiting to be rescanned.
+ */
+
+#define N_ROUNDS      200
+#define N_LINES       300
+#define MAX_EDIT_LEN  80
+
+static const gchar alphabet[] = "(((){}}}[[]]]##/**/ ab\n\n";
+
+static const struct {
+  gunichar open_char;
+  gunichar close_char;
+} pairs[] = {
+  { '(', ')' },
+  { '[', ']' },
+  { '{', '}' },
+};
+
+typedef enum {
+  EDIT_INSERT,
+  EDIT_DELETE,
+  EDIT_REPLACE,
+  EDIT_ANY,
+} EditKind;
+
+static gchar *
+random_text (GRand *rand,
+             guint  len)
+{
+  gchar *text = g_malloc (len + 1);
+  guint i;
+
+  for (i = 0; i < len; i++)
+    text [i] = alphabet [g_rand_int_range (rand, 0, sizeof alphabet - 1)];
+  text [len] = '\0';
+
+  return text;
+}
+
+static void
+random_iter (GRand         *rand,
+             GtkTextBuffer *buffer,
+             GtkTextIter   *iter)
+{
+  gint n_chars = gtk_text_buffer_get_char_count (buffer);
+
+  gtk_text_buffer_get_iter_at_offset (buffer, iter, g_rand_int_range (rand, 0, n_chars + 1));
+}
+
+static void
+edit_insert (GRand         *rand,
+             GtkTextBuffer *buffer)
+{
+  g_autofree gchar *text = NULL;
+  GtkTextIter iter;
+
+  random_iter (rand, buffer, &iter);
+  text = random_text (rand, g_rand_int_range (rand, 1, MAX_EDIT_LEN));
+  gtk_text_buffer_insert (buffer, &iter, text, -1);
+}
+
+static void
+edit_delete (GRand         *rand,
+             GtkTextBuffer *buffer)
+{
+  GtkTextIter begin;
+  GtkTextIter end;
+
+  random_iter (rand, buffer, &begin);
+  end = begin;
+  gtk_text_iter_forward_chars (&end, g_rand_int_range (rand, 1, MAX_EDIT_LEN * 2));
+  gtk_text_buffer_delete (buffer, &begin, &end);
+}
+
+static void
+edit_replace (GRand         *rand,
+              GtkTextBuffer *buffer)
+{
+  g_autofree gchar *text = NULL;
+  GtkTextIter begin;
+  GtkTextIter end;
+
+  random_iter (rand, buffer, &begin);
+  end = begin;
+  gtk_text_iter_forward_chars (&end, g_rand_int_range (rand, 1, MAX_EDIT_LEN));
+  text = random_text (rand, g_rand_int_range (rand, 1, MAX_EDIT_LEN));
+
+  gtk_text_buffer_begin_user_action (buffer);
+  gtk_text_buffer_delete (buffer, &begin, &end);
+  gtk_text_buffer_insert (buffer, &begin, text, -1);
+  gtk_text_buffer_end_user_action (buffer);
+}
+
+static gboolean
+naive_match (GtkTextIter *iter,
+             gunichar     open_char,
+             gunichar     close_char,
+             gint         direction,
+             gint         depth)
+{
+  GtkTextIter cur = *iter;
+
+  while (direction > 0 ? gtk_text_iter_forward_char (&cur) : gtk_text_iter_backward_char (&cur))
+    {
+      gunichar ch = gtk_text_iter_get_char (&cur);
+
+      if (ch == open_char)
+        depth += direction;
+      else if (ch == close_char)
+        depth -= direction;
+
+      if (depth == 0)
+        {
+          *iter = cur;
+          return TRUE;
+        }
+    }
+
+  return FALSE;
+}
+
+static gboolean
+line_has_marker (GtkTextBuffer          *buffer,
+                 gint                    line,
+                 IdeTextStructureMarker  marker)
+{
+  g_autofree gchar *text = NULL;
+  GtkTextIter begin;
+  GtkTextIter end;
+
+  gtk_text_buffer_get_iter_at_line (buffer, &begin, line);
+  end = begin;
+  if (!gtk_text_iter_ends_line (&end))
+    gtk_text_iter_forward_to_line_end (&end);
+  text = gtk_text_iter_get_slice (&begin, &end);
+
+  switch (marker)
+    {
+    case IDE_TEXT_STRUCTURE_HASH:          return strchr (text, '#') != NULL;
+    case IDE_TEXT_STRUCTURE_COMMENT_START: return strstr (text, "/*") != NULL;
+    case IDE_TEXT_STRUCTURE_COMMENT_END:   return strstr (text, "*/") != NULL;
+    default:                               g_assert_not_reached ();
+    }
+}
+
+static void
+check_structure (GRand         *rand,
+                 GtkTextBuffer *buffer)
+{
+  static const IdeTextStructureMarker markers[] = {
+    IDE_TEXT_STRUCTURE_HASH,
+    IDE_TEXT_STRUCTURE_COMMENT_START,
+    IDE_TEXT_STRUCTURE_COMMENT_END,
+  };
+  IdeTextStructure *structure = _ide_text_structure_get_for_buffer (buffer);
+  gint n_lines = gtk_text_buffer_get_line_count (buffer);
+  guint i;
+  guint j;
+
+  for (i = 0; i < 20; i++)
+    {
+      GtkTextIter iter;
+      gint line;
+
+      random_iter (rand, buffer, &iter);
+      line = gtk_text_iter_get_line (&iter);
+
+      for (j = 0; j < G_N_ELEMENTS (pairs); j++)
+        {
+          gint depth = g_rand_int_range (rand, 1, 4);
+          GtkTextIter expected = iter;
+          GtkTextIter found = iter;
+          gboolean expected_ret;
+          gboolean ret;
+
+          expected_ret = naive_match (&expected, pairs [j].open_char, pairs [j].close_char, 1, depth);
+          ret = _ide_text_structure_match_forward (structure, &found, pairs [j].open_char, pairs [j].close_char, depth);
+          g_assert_cmpint (ret, ==, expected_ret);
+          g_assert_cmpint (gtk_text_iter_get_offset (&found), ==, gtk_text_iter_get_offset (&expected));
+
+          expected = iter;
+          found = iter;
+          expected_ret = naive_match (&expected, pairs [j].open_char, pairs [j].close_char, -1, depth);
+          ret = _ide_text_structure_match_backward (structure, &found, pairs [j].open_char, pairs [j].close_char, depth);
+          g_assert_cmpint (ret, ==, expected_ret);
+          g_assert_cmpint (gtk_text_iter_get_offset (&found), ==, gtk_text_iter_get_offset (&expected));
+        }
+
+      for (j = 0; j < G_N_ELEMENTS (markers); j++)
+        {
+          gint expected;
+
+          for (expected = line + 1; expected < n_lines; expected++)
+            if (line_has_marker (buffer, expected, markers [j]))
+              break;
+          if (expected == n_lines)
+            expected = -1;
+          g_assert_cmpint (_ide_text_structure_next_line (structure, line, markers [j]), ==, expected);
+
+          for (expected = line - 1; expected >= 0; expected--)
+            if (line_has_marker (buffer, expected, markers [j]))
+              break;
+          g_assert_cmpint (_ide_text_structure_previous_line (structure, line, markers [j]), ==, expected);
+        }
+    }
+}
+
+static void
+run_edits (EditKind kind)
+{
+  g_autoptr(GtkTextBuffer) buffer = NULL;
+  g_autofree gchar *initial = NULL;
+  GRand *rand;
+  guint round;
+
+  rand = g_rand_new_with_seed (g_test_rand_int ());
+  buffer = gtk_text_buffer_new (NULL);
+
+  initial = random_text (rand, N_LINES * 8);
+  gtk_text_buffer_set_text (buffer, initial, -1);
+
+  /* Populate the index before editing so that edits are spliced */
+  check_structure (rand, buffer);
+
+  for (round = 0; round < N_ROUNDS; round++)
+    {
+      guint n_edits = g_rand_int_range (rand, 1, 5);
+      guint i;
+
+      for (i = 0; i < n_edits; i++)
+        {
+          EditKind edit = kind;
+
+          if (edit == EDIT_ANY)
+            edit = g_rand_int_range (rand, EDIT_INSERT, EDIT_ANY);
+
+          /* Keep the buffer from shrinking away under repeated deletes */
+          if (edit == EDIT_DELETE && gtk_text_buffer_get_char_count (buffer) < N_LINES)
+            edit = EDIT_INSERT;
+
+          switch (edit)
+            {
+            case EDIT_INSERT:  edit_insert (rand, buffer); break;
+            case EDIT_DELETE:  edit_delete (rand, buffer); break;
+            case EDIT_REPLACE: edit_replace (rand, buffer); break;
+            case EDIT_ANY:
+            default:           g_assert_not_reached ();
+            }
+        }
+
+      check_structure (rand, buffer);
+    }
+
+  g_rand_free (rand);
+}
+
+static void
+test_text_structure_insert (void)
+{
+  run_edits (EDIT_INSERT);
+}
+
+static void
+test_text_structure_delete (void)
+{
+  run_edits (EDIT_DELETE);
+}
+
+static void
+test_text_structure_replace (void)
+{
+  run_edits (EDIT_REPLACE);
+}
+
+static void
+test_text_structure_mixed (void)
+{
+  run_edits (EDIT_ANY);
+}
+
+gint
+main (gint   argc,
+      gchar *argv[])
+{
+  g_test_init (&argc, &argv, NULL);
+  g_test_add_func ("/Ide/TextStructure/insert", test_text_structure_insert);
+  g_test_add_func ("/Ide/TextStructure/delete", test_text_structure_delete);
+  g_test_add_func ("/Ide/TextStructure/replace", test_text_structure_replace);
+  g_test_add_func ("/Ide/TextStructure/mixed", test_text_structure_mixed);
+  return g_test_run ();
+}
@@ -0,0 +1,171 @@
+/* test-ide-thread-pool.c
+ *
+ * Copyright (C) 2016 Christian Hergert <chergert@redhat.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <ide.h>
+
+#include "ide-internal.h"
+
+/* _ide_thread_pool_init (TRUE) creates exactly two workers */
+#define N_WORKERS 2
+
+static GMutex   block_mutex;
+static GCond    block_cond;
+static guint    n_blocked;
+static gboolean released;
+
+static void
+block_worker (gpointer data)
+{
+  g_mutex_lock (&block_mutex);
+  n_blocked++;
+  g_cond_broadcast (&block_cond);
+  while (!released)
+    g_cond_wait (&block_cond, &block_mutex);
+  n_blocked--;
+  g_cond_broadcast (&block_cond);
+  g_mutex_unlock (&block_mutex);
+}
+
+/* Occupies every worker so that newly pushed tasks stay queued */
+static void
+block_workers (void)
+{
+  guint i;
+
+  g_mutex_lock (&block_mutex);
+  released = FALSE;
+  g_mutex_unlock (&block_mutex);
+
+  for (i = 0; i < N_WORKERS; i++)
+    ide_thread_pool_push_with_priority (IDE_THREAD_POOL_COMPILER,
+                                        IDE_THREAD_POOL_PRIORITY_INTERACTIVE,
+                                        block_worker,
+                                        NULL);
+
+  g_mutex_lock (&block_mutex);
+  while (n_blocked < N_WORKERS)
+    g_cond_wait (&block_cond, &block_mutex);
+  g_mutex_unlock (&block_mutex);
+}
+
+static void
+release_workers (void)
+{
+  g_mutex_lock (&block_mutex);
+  released = TRUE;
+  g_cond_broadcast (&block_cond);
+  while (n_blocked > 0)
+    g_cond_wait (&block_cond, &block_mutex);
+  g_mutex_unlock (&block_mutex);
+}
+
+static void
+never_run_worker (GTask        *task,
+                  gpointer      source_object,
+                  gpointer      task_data,
+                  GCancellable *cancellable)
+{
+  g_assert_not_reached ();
+}
+
+static void
+cancelled_cb (GObject      *object,
+              GAsyncResult *result,
+              gpointer      user_data)
+{
+  gboolean *completed = user_data;
+  GError *error = NULL;
+
+  g_assert (!g_task_propagate_boolean (G_TASK (result), &error));
+  g_assert_error (error, G_IO_ERROR, G_IO_ERROR_CANCELLED);
+  g_clear_error (&error);
+
+  *completed = TRUE;
+}
+
+/*
+ * Pushes a task and cancels it before any worker can start it. The task
+ * must complete and release the source object, which is only possible if
+ * the cancelled handler was disconnected.
+ */
+static void
+push_and_cancel (gboolean cancel_before_push)
+{
+  GCancellable *cancellable;
+  GObject *source;
+  GTask *task;
+  gboolean completed = FALSE;
+
+  source = g_object_new (G_TYPE_OBJECT, NULL);
+  g_object_add_weak_pointer (source, (gpointer *)&source);
+
+  cancellable = g_cancellable_new ();
+  task = g_task_new (source, cancellable, cancelled_cb, &completed);
+  g_object_unref (source);
+
+  if (cancel_before_push)
+    g_cancellable_cancel (cancellable);
+
+  ide_thread_pool_push_task_with_priority (IDE_THREAD_POOL_COMPILER,
+                                           IDE_THREAD_POOL_PRIORITY_INTERACTIVE,
+                                           task,
+                                           never_run_worker);
+  g_object_unref (task);
+
+  if (!cancel_before_push)
+    g_cancellable_cancel (cancellable);
+
+  while (!completed)
+    g_main_context_iteration (NULL, TRUE);
+  while (g_main_context_pending (NULL))
+    g_main_context_iteration (NULL, FALSE);
+
+  g_object_unref (cancellable);
+
+  g_assert (source == NULL);
+}
+
+static void
+test_cancel_queued (void)
+{
+  block_workers ();
+  push_and_cancel (FALSE);
+  release_workers ();
+}
+
+static void
+test_cancel_before_push (void)
+{
+  block_workers ();
+  push_and_cancel (TRUE);
+  release_workers ();
+}
+
+gint
+main (gint   argc,
+      gchar *argv[])
+{
+  g_test_init (&argc, &argv, NULL);
+
+  _ide_thread_pool_init (TRUE);
+
+  g_test_add_func ("/Ide/ThreadPool/cancel_queued", test_cancel_queued);
+  g_test_add_func ("/Ide/ThreadPool/cancel_before_push", test_cancel_before_push);
+
+  return g_test_run ();
+}
@@ -0,0 +1,343 @@
+/* test-trie.c
+ *
+ * Copyright (C) 2016 Christian Hergert <chergert@redhat.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <trie.h>
+
+static const gchar *sorted_keys[] = {
+  "",
+  "a",
+  "ab",
+  "abc",
+  "abd",
+  "b",
+  "ba",
+  "bar",
+  "barn",
+  "foo",
+  "foobar",
+  "foobaz",
+  "z",
+};
+
+static gint
+compare_strings (gconstpointer a,
+                 gconstpointer b)
+{
+  return strcmp (*(const gchar * const *)a, *(const gchar * const *)b);
+}
+
+static gboolean
+collect_cb (Trie        *trie,
+            const gchar *key,
+            gpointer     value,
+            gpointer     user_data)
+{
+  GPtrArray *ar = user_data;
+
+  g_ptr_array_add (ar, g_strdup_printf ("%s=%u", key, GPOINTER_TO_UINT (value)));
+
+  return FALSE;
+}
+
+static gchar *
+traverse_to_string (Trie          *trie,
+                    const gchar   *key,
+                    GTraverseType  order,
+                    gint           max_depth)
+{
+  g_autoptr(GPtrArray) ar = g_ptr_array_new_with_free_func (g_free);
+
+  trie_traverse (trie, key, order, G_TRAVERSE_LEAVES, max_depth, collect_cb, ar);
+  g_ptr_array_add (ar, NULL);
+
+  return g_strjoinv (" ", (gchar **)ar->pdata);
+}
+
+/* Sibling order differs between layouts, so compare the results sorted */
+static void
+assert_same_results (const gchar *a,
+                     const gchar *b)
+{
+  g_auto(GStrv) split_a = g_strsplit (a, " ", -1);
+  g_auto(GStrv) split_b = g_strsplit (b, " ", -1);
+  guint i;
+
+  g_assert_cmpuint (g_strv_length (split_a), ==, g_strv_length (split_b));
+
+  qsort (split_a, g_strv_length (split_a), sizeof (gchar *), compare_strings);
+  qsort (split_b, g_strv_length (split_b), sizeof (gchar *), compare_strings);
+
+  for (i = 0; split_a[i]; i++)
+    g_assert_cmpstr (split_a[i], ==, split_b[i]);
+}
+
+/* Checks that two tries built from the same keys agree on all queries */
+static void
+assert_equivalent (Trie         *a,
+                   Trie         *b,
+                   const gchar **keys,
+                   guint         n_keys)
+{
+  static const gchar *prefixes[] = { "", "a", "ab", "b", "ba", "f", "foo", "foob", "x", "zz" };
+  guint i;
+
+  for (i = 0; i < n_keys; i++)
+    g_assert (trie_lookup (a, keys[i]) == trie_lookup (b, keys[i]));
+
+  g_assert (trie_lookup (b, "nonexistent") == NULL);
+  g_assert (trie_lookup (b, "fo") == NULL);
+
+  for (i = 0; i < G_N_ELEMENTS (prefixes); i++)
+    {
+      g_autofree gchar *pre_a = traverse_to_string (a, prefixes[i], G_PRE_ORDER, -1);
+      g_autofree gchar *pre_b = traverse_to_string (b, prefixes[i], G_PRE_ORDER, -1);
+      g_autofree gchar *post_a = traverse_to_string (a, prefixes[i], G_POST_ORDER, 2);
+      g_autofree gchar *post_b = traverse_to_string (b, prefixes[i], G_POST_ORDER, 2);
+
+      assert_same_results (pre_a, pre_b);
+      assert_same_results (post_a, post_b);
+    }
+}
+
+static void
+test_trie_insert_sorted (void)
+{
+  gpointer values[G_N_ELEMENTS (sorted_keys)];
+  Trie *incremental;
+  Trie *bulk;
+  guint i;
+
+  incremental = trie_new (NULL);
+  bulk = trie_new (NULL);
+
+  /* Skip the empty key, which is only used to check lookups of the root */
+  for (i = 1; i < G_N_ELEMENTS (sorted_keys); i++)
+    {
+      values[i] = GUINT_TO_POINTER (i);
+      trie_insert (incremental, sorted_keys[i], values[i]);
+    }
+
+  trie_insert_sorted (bulk, &sorted_keys[1], &values[1], G_N_ELEMENTS (sorted_keys) - 1);
+
+  assert_equivalent (incremental, bulk, sorted_keys, G_N_ELEMENTS (sorted_keys));
+
+  /* A prefix traversal in pre-order visits a node before its children */
+  {
+    g_autofree gchar *str = traverse_to_string (bulk, "ab", G_PRE_ORDER, -1);
+    g_assert (g_str_has_prefix (str, "ab=2 "));
+  }
+
+  g_assert (trie_remove (bulk, "foobar"));
+  g_assert (trie_lookup (bulk, "foobar") == NULL);
+  g_assert (trie_lookup (bulk, "foobaz") == GUINT_TO_POINTER (11));
+
+  trie_destroy (incremental);
+  trie_destroy (bulk);
+}
+
+static void
+test_trie_insert_unsorted (void)
+{
+  const gchar *keys[] = { "b", "a", "c" };
+  gpointer values[] = { GUINT_TO_POINTER (1), GUINT_TO_POINTER (2), GUINT_TO_POINTER (3) };
+  Trie *trie;
+
+  trie = trie_new (NULL);
+  trie_insert_sorted (trie, keys, values, G_N_ELEMENTS (keys));
+
+  g_assert (trie_lookup (trie, "a") == GUINT_TO_POINTER (2));
+  g_assert (trie_lookup (trie, "b") == GUINT_TO_POINTER (1));
+  g_assert (trie_lookup (trie, "c") == GUINT_TO_POINTER (3));
+
+  trie_destroy (trie);
+}
+
+static void
+test_trie_duplicates (void)
+{
+  const gchar *keys[] = { "a", "a", "b" };
+  gpointer values[3];
+  Trie *trie;
+
+  values[0] = g_strdup ("first");
+  values[1] = g_strdup ("second");
+  values[2] = g_strdup ("third");
+
+  trie = trie_new (g_free);
+  trie_insert_sorted (trie, keys, values, G_N_ELEMENTS (keys));
+
+  g_assert_cmpstr (trie_lookup (trie, "a"), ==, "second");
+  g_assert_cmpstr (trie_lookup (trie, "b"), ==, "third");
+
+  trie_destroy (trie);
+}
+
+static guint32
+serialize_cb (gpointer value,
+              gpointer user_data)
+{
+  guint *n_calls = user_data;
+
+  (*n_calls)++;
+
+  return (guint32)strlen (value);
+}
+
+static void
+test_trie_serialize (void)
+{
+  g_autoptr(GPtrArray) keys = g_ptr_array_new_with_free_func (g_free);
+  g_autoptr(GBytes) bytes = NULL;
+  g_autoptr(GError) error = NULL;
+  Trie *trie;
+  Trie *image;
+  guint n_calls = 0;
+  guint i;
+
+  trie = trie_new (NULL);
+
+  /* Enough keys to overflow the inline chunks and several arena blocks */
+  for (i = 0; i < 5000; i++)
+    {
+      gchar *key = g_strdup_printf ("key-%u-%x", i % 97, i);
+
+      g_ptr_array_add (keys, key);
+      trie_insert (trie, key, key);
+    }
+
+  bytes = trie_serialize (trie, serialize_cb, &n_calls);
+  g_assert (bytes != NULL);
+  g_assert_cmpuint (n_calls, ==, keys->len);
+
+  image = trie_new_from_bytes (bytes, &error);
+  g_assert_no_error (error);
+  g_assert (image != NULL);
+
+  for (i = 0; i < keys->len; i++)
+    {
+      const gchar *key = g_ptr_array_index (keys, i);
+
+      g_assert_cmpuint (GPOINTER_TO_UINT (trie_lookup (image, key)), ==, strlen (key));
+    }
+
+  g_assert (trie_lookup (image, "key-") == NULL);
+  g_assert (trie_lookup (image, "missing") == NULL);
+
+  trie_destroy (image);
+  trie_destroy (trie);
+}
+
+static void
+test_trie_serialize_roundtrip (void)
+{
+  gpointer values[G_N_ELEMENTS (sorted_keys)];
+  g_autoptr(GBytes) bytes = NULL;
+  g_autoptr(GError) error = NULL;
+  Trie *trie;
+  Trie *image;
+  guint i;
+
+  trie = trie_new (NULL);
+
+  for (i = 1; i < G_N_ELEMENTS (sorted_keys); i++)
+    values[i] = GUINT_TO_POINTER (i);
+  trie_insert_sorted (trie, &sorted_keys[1], &values[1], G_N_ELEMENTS (sorted_keys) - 1);
+
+  bytes = trie_serialize (trie, NULL, NULL);
+  image = trie_new_from_bytes (bytes, &error);
+  g_assert_no_error (error);
+
+  assert_equivalent (trie, image, sorted_keys, G_N_ELEMENTS (sorted_keys));
+
+  /* Children are stored sorted, so image traversals are in key order */
+  {
+    g_autofree gchar *str = traverse_to_string (image, "ba", G_PRE_ORDER, -1);
+    g_assert_cmpstr (str, ==, "ba=6 bar=7 barn=8");
+  }
+
+  trie_destroy (image);
+  trie_destroy (trie);
+}
+
+static void
+test_trie_invalid_image (void)
+{
+  gpointer values[] = { GUINT_TO_POINTER (1), GUINT_TO_POINTER (2) };
+  const gchar *keys[] = { "a", "b" };
+  g_autoptr(GBytes) bytes = NULL;
+  g_autoptr(GBytes) truncated = NULL;
+  g_autoptr(GBytes) corrupt = NULL;
+  g_autoptr(GBytes) overflow = NULL;
+  g_autofree guint8 *data = NULL;
+  guint8 single[29] = { 0 };
+  guint32 word;
+  GError *error = NULL;
+  Trie *trie;
+  gsize len;
+
+  trie = trie_new (NULL);
+  trie_insert_sorted (trie, keys, values, G_N_ELEMENTS (keys));
+  bytes = trie_serialize (trie, NULL, NULL);
+  trie_destroy (trie);
+
+  data = g_bytes_unref_to_data (g_bytes_ref (bytes), &len);
+
+  truncated = g_bytes_new (data, len - 1);
+  g_assert (trie_new_from_bytes (truncated, &error) == NULL);
+  g_assert_error (error, TRIE_ERROR, TRIE_ERROR_INVALID);
+  g_clear_error (&error);
+
+  /* Point the root at itself, which must not be accepted */
+  memset (data + 20, 0, 4);
+  corrupt = g_bytes_new (data, len);
+  g_assert (trie_new_from_bytes (corrupt, &error) == NULL);
+  g_assert_error (error, TRIE_ERROR, TRIE_ERROR_INVALID);
+  g_clear_error (&error);
+
+  /*
+   * A single node whose children run past the end of the image. The bounds
+   * check must not wrap around when n_children exceeds n_nodes.
+   */
+  memcpy (single, data, 8);
+  word = 1;
+  memcpy (single + 8, &word, 4);
+  word = 1;
+  memcpy (single + 20, &word, 4);
+  word = 5;
+  memcpy (single + 24, &word, 4);
+  overflow = g_bytes_new (single, sizeof single);
+  g_assert (trie_new_from_bytes (overflow, &error) == NULL);
+  g_assert_error (error, TRIE_ERROR, TRIE_ERROR_INVALID);
+  g_clear_error (&error);
+}
+
+gint
+main (gint   argc,
+      gchar *argv[])
+{
+  g_test_init (&argc, &argv, NULL);
+  g_test_add_func ("/Search/Trie/insert_sorted", test_trie_insert_sorted);
+  g_test_add_func ("/Search/Trie/insert_unsorted", test_trie_insert_unsorted);
+  g_test_add_func ("/Search/Trie/duplicates", test_trie_duplicates);
+  g_test_add_func ("/Search/Trie/serialize", test_trie_serialize);
+  g_test_add_func ("/Search/Trie/serialize_roundtrip", test_trie_serialize_roundtrip);
+  g_test_add_func ("/Search/Trie/invalid_image", test_trie_invalid_image);
+  return g_test_run ();
+}
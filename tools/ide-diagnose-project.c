@@ -0,0 +1,488 @@
+/* ide-diagnose-project.c
+ *
+ * Copyright (C) 2016 Christian Hergert <chergert@redhat.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Runs the diagnostic providers over every file in a project, which is
+ * useful from continuous integration or a pre-commit hook.
+ *
+ * Results are streamed to stdout as soon as each file completes, one JSON
+ * object per line (or in the familiar compiler format with --format=text).
+ * Up to --jobs files are diagnosed concurrently. The last record contains
+ * the totals and the wall clock time of the run.
+ *
+ * The exit status is non-zero if any error was found.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <glib.h>
+#include <glib/gi18n.h>
+#include <ide.h>
+#include <libpeas/peas.h>
+#include <stdlib.h>
+
+#include "ide-internal.h"
+
+typedef struct
+{
+  IdeFile *file;
+  gint64   begin_time;
+} Request;
+
+static GMainLoop *main_loop;
+static gint exit_code = EXIT_SUCCESS;
+static IdeContext *ide_context;
+static GHashTable *diagnosticians;
+static GQueue pending = G_QUEUE_INIT;
+static gboolean text_format;
+static gint n_jobs;
+static gchar *format;
+static guint n_active;
+static guint n_files;
+static guint n_diagnostics;
+static guint n_errors;
+static guint n_failed;
+static gint64 begin_time;
+
+static void
+quit (gint code)
+{
+  exit_code = code;
+  g_clear_object (&ide_context);
+  g_main_loop_quit (main_loop);
+}
+
+static void
+append_json_string (GString     *str,
+                    const gchar *value)
+{
+  const gchar *iter;
+
+  g_string_append_c (str, '"');
+
+  for (iter = value ?: ""; *iter; iter++)
+    {
+      switch (*iter)
+        {
+        case '"':  g_string_append (str, "\\\""); break;
+        case '\\': g_string_append (str, "\\\\"); break;
+        case '\n': g_string_append (str, "\\n"); break;
+        case '\r': g_string_append (str, "\\r"); break;
+        case '\t': g_string_append (str, "\\t"); break;
+        default:
+          if ((guchar)*iter < 0x20)
+            g_string_append_printf (str, "\\u%04x", (guchar)*iter);
+          else
+            g_string_append_c (str, *iter);
+          break;
+        }
+    }
+
+  g_string_append_c (str, '"');
+}
+
+static const gchar *
+severity_to_string (IdeDiagnosticSeverity severity)
+{
+  switch (severity)
+    {
+    case IDE_DIAGNOSTIC_IGNORED:    return "ignored";
+    case IDE_DIAGNOSTIC_NOTE:       return "note";
+    case IDE_DIAGNOSTIC_DEPRECATED: return "deprecated";
+    case IDE_DIAGNOSTIC_WARNING:    return "warning";
+    case IDE_DIAGNOSTIC_ERROR:      return "error";
+    case IDE_DIAGNOSTIC_FATAL:      return "fatal";
+    default:                        return "unknown";
+    }
+}
+
+static void
+print_diagnostic (IdeDiagnostic *diag)
+{
+  g_autoptr(GString) str = NULL;
+  IdeDiagnosticSeverity severity;
+  IdeSourceLocation *location;
+  const gchar *path = NULL;
+  guint line = 0;
+  guint column = 0;
+
+  severity = ide_diagnostic_get_severity (diag);
+
+  if (NULL != (location = ide_diagnostic_get_location (diag)))
+    {
+      path = ide_file_get_path (ide_source_location_get_file (location));
+      line = ide_source_location_get_line (location);
+      column = ide_source_location_get_line_offset (location);
+    }
+
+  str = g_string_new (NULL);
+
+  if (text_format)
+    {
+      g_string_append_printf (str, "%s:%u:%u: %s: %s\n",
+                              path ?: "", line + 1, column + 1,
+                              severity_to_string (severity),
+                              ide_diagnostic_get_text (diag));
+    }
+  else
+    {
+      g_string_append (str, "{\"type\":\"diagnostic\",\"file\":");
+      append_json_string (str, path);
+      g_string_append_printf (str, ",\"line\":%u,\"column\":%u,\"severity\":\"%s\",\"text\":",
+                              line + 1, column + 1, severity_to_string (severity));
+      append_json_string (str, ide_diagnostic_get_text (diag));
+      g_string_append (str, "}\n");
+    }
+
+  fputs (str->str, stdout);
+}
+
+static void
+print_file (IdeFile      *file,
+            gint64        elapsed,
+            guint         count,
+            const GError *error)
+{
+  g_autoptr(GString) str = g_string_new (NULL);
+  const gchar *path = ide_file_get_path (file);
+
+  if (text_format)
+    {
+      if (error != NULL)
+        g_string_append_printf (str, "%s: %s\n", path, error->message);
+      g_string_append_printf (str, "%s: %u diagnostics in %.3lf seconds\n",
+                              path, count, elapsed / (gdouble)G_USEC_PER_SEC);
+      fputs (str->str, stderr);
+      return;
+    }
+
+  g_string_append (str, "{\"type\":\"file\",\"file\":");
+  append_json_string (str, path);
+  g_string_append_printf (str, ",\"diagnostics\":%u,\"elapsed_usec\":%"G_GINT64_FORMAT,
+                          count, elapsed);
+  if (error != NULL)
+    {
+      g_string_append (str, ",\"error\":");
+      append_json_string (str, error->message);
+    }
+  g_string_append (str, "}\n");
+
+  fputs (str->str, stdout);
+  fflush (stdout);
+}
+
+static void
+print_summary (void)
+{
+  gint64 elapsed = g_get_monotonic_time () - begin_time;
+
+  if (text_format)
+    g_printerr ("%u files, %u diagnostics, %u errors, %u failed in %.3lf seconds using %d jobs\n",
+                n_files, n_diagnostics, n_errors, n_failed,
+                elapsed / (gdouble)G_USEC_PER_SEC, n_jobs);
+  else
+    g_print ("{\"type\":\"summary\",\"files\":%u,\"diagnostics\":%u,\"errors\":%u,"
+             "\"failed\":%u,\"jobs\":%d,\"elapsed_usec\":%"G_GINT64_FORMAT"}\n",
+             n_files, n_diagnostics, n_errors, n_failed, n_jobs, elapsed);
+}
+
+static void run_next (void);
+
+static void
+diagnose_cb (GObject      *object,
+             GAsyncResult *result,
+             gpointer      user_data)
+{
+  IdeDiagnostician *diagnostician = (IdeDiagnostician *)object;
+  g_autoptr(IdeDiagnostics) ret = NULL;
+  g_autoptr(GError) error = NULL;
+  Request *request = user_data;
+  gsize count = 0;
+  gsize i;
+
+  n_active--;
+
+  ret = ide_diagnostician_diagnose_finish (diagnostician, result, &error);
+
+  if (ret != NULL)
+    {
+      count = ide_diagnostics_get_size (ret);
+
+      for (i = 0; i < count; i++)
+        {
+          IdeDiagnostic *diag = ide_diagnostics_index (ret, i);
+          IdeDiagnosticSeverity severity = ide_diagnostic_get_severity (diag);
+
+          if (severity == IDE_DIAGNOSTIC_ERROR || severity == IDE_DIAGNOSTIC_FATAL)
+            n_errors++;
+
+          print_diagnostic (diag);
+        }
+    }
+  else
+    n_failed++;
+
+  n_files++;
+  n_diagnostics += count;
+
+  print_file (request->file, g_get_monotonic_time () - request->begin_time, count, error);
+
+  g_object_unref (request->file);
+  g_slice_free (Request, request);
+
+  run_next ();
+}
+
+static IdeDiagnostician *
+get_diagnostician (GtkSourceLanguage *language)
+{
+  IdeDiagnostician *diagnostician;
+  const gchar *lang_id = gtk_source_language_get_id (language);
+
+  /* One diagnostician per language, so providers are only loaded once */
+  if (NULL == (diagnostician = g_hash_table_lookup (diagnosticians, lang_id)))
+    {
+      diagnostician = g_object_new (IDE_TYPE_DIAGNOSTICIAN,
+                                    "context", ide_context,
+                                    "language", language,
+                                    NULL);
+      g_hash_table_insert (diagnosticians, g_strdup (lang_id), diagnostician);
+    }
+
+  return diagnostician;
+}
+
+static void
+run_next (void)
+{
+  while (n_active < (guint)n_jobs)
+    {
+      GtkSourceLanguage *language;
+      Request *request;
+      IdeFile *file;
+
+      if (NULL == (file = g_queue_pop_head (&pending)))
+        break;
+
+      request = g_slice_new0 (Request);
+      request->file = file;
+      request->begin_time = g_get_monotonic_time ();
+
+      language = ide_file_get_language (file);
+
+      n_active++;
+
+      ide_diagnostician_diagnose_async (get_diagnostician (language),
+                                        file,
+                                        NULL,
+                                        diagnose_cb,
+                                        request);
+    }
+
+  if (n_active == 0)
+    {
+      print_summary ();
+      quit (n_errors > 0 || n_failed > 0 ? EXIT_FAILURE : EXIT_SUCCESS);
+    }
+}
+
+static void
+collect_files (IdeProject     *project,
+               IdeProjectItem *item)
+{
+  GSequence *children;
+  GSequenceIter *iter;
+
+  if (IDE_IS_PROJECT_FILE (item) &&
+      !ide_project_file_get_is_directory (IDE_PROJECT_FILE (item)))
+    {
+      const gchar *path = ide_project_file_get_path (IDE_PROJECT_FILE (item));
+      IdeFile *file;
+
+      if (NULL != (file = ide_project_get_file_for_path (project, path)))
+        {
+          /* Files without a language have no diagnostic providers */
+          if (ide_file_get_language (file) != NULL)
+            g_queue_push_tail (&pending, file);
+          else
+            g_object_unref (file);
+        }
+    }
+
+  if (NULL != (children = ide_project_item_get_children (item)))
+    {
+      for (iter = g_sequence_get_begin_iter (children);
+           !g_sequence_iter_is_end (iter);
+           iter = g_sequence_iter_next (iter))
+        collect_files (project, g_sequence_get (iter));
+    }
+}
+
+static void
+context_cb (GObject      *object,
+            GAsyncResult *result,
+            gpointer      user_data)
+{
+  g_autoptr(IdeContext) context = NULL;
+  g_autoptr(GError) error = NULL;
+  IdeProject *project;
+
+  context = ide_context_new_finish (result, &error);
+
+  if (!context)
+    {
+      g_printerr ("%s\n", error->message);
+      quit (EXIT_FAILURE);
+      return;
+    }
+
+  ide_context = g_object_ref (context);
+
+  project = ide_context_get_project (context);
+
+  ide_project_reader_lock (project);
+  collect_files (project, ide_project_get_root (project));
+  ide_project_reader_unlock (project);
+
+  run_next ();
+}
+
+/*
+ * Discovers the plugins from the same locations as IdeApplication and loads
+ * those that are enabled in the user's settings, so the diagnostic providers
+ * match the ones used by Builder itself.
+ */
+static void
+load_plugins (void)
+{
+  PeasEngine *engine = peas_engine_get_default ();
+  g_autofree gchar *user_path = NULL;
+  const GList *list;
+
+  if (g_getenv ("GB_IN_TREE_PLUGINS") != NULL)
+    {
+      GDir *dir;
+
+      if ((dir = g_dir_open (BUILDDIR"/plugins", 0, NULL)))
+        {
+          const gchar *name;
+
+          while ((name = g_dir_read_name (dir)))
+            {
+              g_autofree gchar *path = g_build_filename (BUILDDIR, "plugins", name, NULL);
+
+              peas_engine_prepend_search_path (engine, path, path);
+            }
+
+          g_dir_close (dir);
+        }
+    }
+  else
+    {
+      peas_engine_prepend_search_path (engine,
+                                       PACKAGE_LIBDIR"/gnome-builder/plugins",
+                                       PACKAGE_DATADIR"/gnome-builder/plugins");
+    }
+
+  user_path = g_build_filename (g_get_user_data_dir (), "gnome-builder", "plugins", NULL);
+  peas_engine_prepend_search_path (engine, user_path, user_path);
+
+  peas_engine_rescan_plugins (engine);
+
+  for (list = peas_engine_get_plugin_list (engine); list; list = list->next)
+    {
+      PeasPluginInfo *plugin_info = list->data;
+      g_autoptr(GSettings) settings = NULL;
+      g_autofree gchar *path = NULL;
+
+      path = g_strdup_printf ("/org/gnome/builder/plugins/%s/",
+                              peas_plugin_info_get_module_name (plugin_info));
+      settings = g_settings_new_with_path ("org.gnome.builder.plugin", path);
+
+      if (g_settings_get_boolean (settings, "enabled"))
+        peas_engine_load_plugin (engine, plugin_info);
+    }
+}
+
+gint
+main (gint   argc,
+      gchar *argv[])
+{
+  GOptionEntry entries[] = {
+    { "jobs", 'j', 0, G_OPTION_ARG_INT, &n_jobs,
+      N_("Number of files to diagnose concurrently"), N_("JOBS") },
+    { "format", 0, 0, G_OPTION_ARG_STRING, &format,
+      N_("Output format, either json or text"), N_("FORMAT") },
+    { NULL }
+  };
+  g_autoptr(GOptionContext) context = NULL;
+  g_autoptr(GError) error = NULL;
+  g_autoptr(GFile) project_file = NULL;
+  const gchar *project_path = ".";
+
+  ide_set_program_name ("gnome-builder");
+  g_set_prgname ("ide-diagnose-project");
+
+  /* No widgets are created, so this must keep working without a display */
+  gtk_init_check (&argc, &argv);
+
+  context = g_option_context_new (_("- Diagnose all files in a project."));
+  g_option_context_add_main_entries (context, entries, GETTEXT_PACKAGE);
+
+  if (!g_option_context_parse (context, &argc, &argv, &error))
+    {
+      g_printerr ("%s\n", error->message);
+      return EXIT_FAILURE;
+    }
+
+  if (n_jobs <= 0)
+    n_jobs = g_get_num_processors ();
+
+  if (format != NULL && !g_str_equal (format, "json"))
+    {
+      if (!g_str_equal (format, "text"))
+        {
+          g_printerr (_("Unknown output format: %s\n"), format);
+          return EXIT_FAILURE;
+        }
+      text_format = TRUE;
+    }
+
+  if (argc > 1)
+    project_path = argv [1];
+  project_file = g_file_new_for_path (project_path);
+
+  main_loop = g_main_loop_new (NULL, FALSE);
+  diagnosticians = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_object_unref);
+  begin_time = g_get_monotonic_time ();
+
+  _ide_thread_pool_init (FALSE);
+  load_plugins ();
+
+  ide_context_new_async (project_file, NULL, context_cb, NULL);
+
+  g_main_loop_run (main_loop);
+
+  g_clear_pointer (&diagnosticians, g_hash_table_unref);
+  g_clear_pointer (&main_loop, g_main_loop_unref);
+  g_clear_pointer (&format, g_free);
+
+  return exit_code;
+}
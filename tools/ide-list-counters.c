@@ -21,6 +21,9 @@
 #include <errno.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+
+static gint watch;
 
 static void
 foreach_cb (EggCounter *counter,
@@ -37,6 +40,178 @@ foreach_cb (EggCounter *counter,
            counter->description);
 }
 
+static gint64
+percentile_of (const gint64 *buckets,
+               gint64        count,
+               gdouble       percentile)
+{
+  gint64 target;
+  gint64 seen = 0;
+  guint i;
+
+  if (count == 0)
+    return 0;
+
+  target = MAX (1, (gint64)(count * percentile / 100.0));
+
+  for (i = 0; i < EGG_HISTOGRAM_N_BUCKETS; i++)
+    {
+      seen += buckets [i];
+      if (seen >= target)
+        return egg_histogram_bucket_upper_bound (i);
+    }
+
+  return egg_histogram_bucket_upper_bound (EGG_HISTOGRAM_N_BUCKETS - 1);
+}
+
+static void
+print_histogram (EggHistogram *histogram,
+                 const gint64 *buckets)
+{
+  gint64 count = 0;
+  gint64 max = 0;
+  guint i;
+
+  for (i = 0; i < EGG_HISTOGRAM_N_BUCKETS; i++)
+    {
+      count += buckets [i];
+      if (buckets [i] > 0)
+        max = egg_histogram_bucket_upper_bound (i);
+    }
+
+  g_print ("%-20s : %-32s : %10"G_GINT64_FORMAT" : %8"G_GINT64_FORMAT" : %8"G_GINT64_FORMAT
+           " : %8"G_GINT64_FORMAT" : %8"G_GINT64_FORMAT"\n",
+           histogram->category,
+           histogram->name,
+           count,
+           percentile_of (buckets, count, 50.0),
+           percentile_of (buckets, count, 90.0),
+           percentile_of (buckets, count, 99.0),
+           max);
+}
+
+static void
+foreach_histogram_cb (EggHistogram *histogram,
+                      gpointer      user_data)
+{
+  gint64 buckets [EGG_HISTOGRAM_N_BUCKETS];
+  guint *n_histograms = user_data;
+
+  (*n_histograms)++;
+
+  egg_histogram_get_buckets (histogram, buckets);
+  print_histogram (histogram, buckets);
+}
+
+static void
+print_histogram_header (void)
+{
+  g_print ("%-20s : %-32s : %10s : %8s : %8s : %8s : %8s\n",
+           "      Category",
+           "             Name", "Count", "p50", "p90", "p99", "Max");
+  g_print ("-------------------- : "
+           "-------------------------------- : "
+           "---------- : -------- : -------- : -------- : --------\n");
+}
+
+typedef struct
+{
+  GHashTable *previous;
+  gdouble     seconds;
+} Watch;
+
+static void
+watch_counter_cb (EggCounter *counter,
+                  gpointer    user_data)
+{
+  Watch *state = user_data;
+  gint64 *previous;
+  gint64 value;
+
+  value = egg_counter_get (counter);
+
+  if (!(previous = g_hash_table_lookup (state->previous, counter)))
+    {
+      previous = g_new0 (gint64, 1);
+      *previous = value;
+      g_hash_table_insert (state->previous, counter, previous);
+      return;
+    }
+
+  if (value != *previous)
+    g_print ("%-20s : %-32s : %14.1f/s : %20"G_GINT64_FORMAT"\n",
+             counter->category,
+             counter->name,
+             (value - *previous) / state->seconds,
+             value);
+
+  *previous = value;
+}
+
+static void
+watch_histogram_cb (EggHistogram *histogram,
+                    gpointer      user_data)
+{
+  Watch *state = user_data;
+  gint64 buckets [EGG_HISTOGRAM_N_BUCKETS];
+  gint64 delta [EGG_HISTOGRAM_N_BUCKETS];
+  gint64 *previous;
+  gboolean changed = FALSE;
+  guint i;
+
+  egg_histogram_get_buckets (histogram, buckets);
+
+  if (!(previous = g_hash_table_lookup (state->previous, histogram)))
+    {
+      previous = g_new0 (gint64, EGG_HISTOGRAM_N_BUCKETS);
+      memcpy (previous, buckets, sizeof buckets);
+      g_hash_table_insert (state->previous, histogram, previous);
+      return;
+    }
+
+  /* Only report what was recorded during this interval */
+  for (i = 0; i < EGG_HISTOGRAM_N_BUCKETS; i++)
+    {
+      delta [i] = buckets [i] - previous [i];
+      changed |= (delta [i] != 0);
+    }
+
+  if (changed)
+    print_histogram (histogram, delta);
+
+  memcpy (previous, buckets, sizeof buckets);
+}
+
+static void
+run_watch (EggCounterArena *arena)
+{
+  Watch state;
+
+  state.previous = g_hash_table_new_full (NULL, NULL, NULL, g_free);
+  state.seconds = watch;
+
+  /* Take the initial sample */
+  egg_counter_arena_foreach (arena, watch_counter_cb, &state);
+  egg_counter_arena_foreach_histogram (arena, watch_histogram_cb, &state);
+
+  for (;;)
+    {
+      g_usleep (watch * G_USEC_PER_SEC);
+
+      g_print ("\n%-20s : %-32s : %16s : %20s\n",
+               "      Category", "             Name", "Rate", "Value");
+      g_print ("-------------------- : "
+               "-------------------------------- : "
+               "---------------- : "
+               "--------------------\n");
+      egg_counter_arena_foreach (arena, watch_counter_cb, &state);
+
+      g_print ("\n");
+      print_histogram_header ();
+      egg_counter_arena_foreach_histogram (arena, watch_histogram_cb, &state);
+    }
+}
+
 static gboolean
 int_parse_with_range (gint        *value,
                       gint         lower,
@@ -65,19 +240,36 @@ gint
 main (gint   argc,
       gchar *argv[])
 {
+  GOptionEntry entries[] = {
+    { "watch", 'w', 0, G_OPTION_ARG_INT, &watch,
+      "Print the rate of change every SECONDS seconds", "SECONDS" },
+    { NULL }
+  };
+  g_autoptr(GOptionContext) context = NULL;
+  g_autoptr(GError) error = NULL;
   EggCounterArena *arena;
   guint n_counters = 0;
+  guint n_histograms = 0;
   gint pid;
 
-  if (argc != 2)
+  context = g_option_context_new ("PID - List the counters of a running process");
+  g_option_context_add_main_entries (context, entries, NULL);
+
+  if (!g_option_context_parse (context, &argc, &argv, &error))
+    {
+      fprintf (stderr, "%s\n", error->message);
+      return EXIT_FAILURE;
+    }
+
+  if (argc != 2 || watch < 0)
     {
-      fprintf (stderr, "usage: %s <pid>\n", argv [0]);
+      fprintf (stderr, "usage: %s [--watch=SECONDS] <pid>\n", argv [0]);
       return EXIT_FAILURE;
     }
 
-  if (!int_parse_with_range (&pid, 1, G_MAXUSHORT, argv [1]))
+  if (!int_parse_with_range (&pid, 1, G_MAXINT, argv [1]))
     {
-      fprintf (stderr, "usage: %s <pid>\n", argv [0]);
+      fprintf (stderr, "usage: %s [--watch=SECONDS] <pid>\n", argv [0]);
       return EXIT_FAILURE;
     }
 
@@ -89,6 +281,12 @@ main (gint   argc,
       return EXIT_FAILURE;
     }
 
+  if (watch > 0)
+    {
+      run_watch (arena);
+      return EXIT_SUCCESS;
+    }
+
   g_print ("%-20s : %-32s : %20s : %-72s\n",
            "      Category",
            "             Name", "Value", "Description");
@@ -103,5 +301,10 @@ main (gint   argc,
            "------------------------------------------------------------------------\n");
   g_print ("Discovered %u counters\n", n_counters);
 
+  g_print ("\n");
+  print_histogram_header ();
+  egg_counter_arena_foreach_histogram (arena, foreach_histogram_cb, &n_histograms);
+  g_print ("Discovered %u histograms (values in usec)\n", n_histograms);
+
   return EXIT_SUCCESS;
 }
@@ -0,0 +1,235 @@
+/* ide-trace-export.c
+ *
+ * Copyright (C) 2016 Christian Hergert <chergert@redhat.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Exports the trace spans recorded by a running Builder (started with
+ * IDE_TRACE_SPANS=1) in one of two formats:
+ *
+ *   --format=chrome  The Trace Event format, which can be loaded into
+ *                    chrome://tracing or other timeline viewers.
+ *   --format=folded  Folded stacks weighted by microseconds, suitable
+ *                    for flamegraph.pl and compatible viewers.
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "ide-trace.h"
+
+typedef struct
+{
+  GPid        pid;
+  gboolean    first;
+
+  /* Used to rebuild the call stacks for folded output */
+  gint        thread;
+  gint64      last_time;
+  GPtrArray  *stack;
+  GHashTable *folded;
+} Export;
+
+static gchar *format;
+
+static void
+print_json_string (const gchar *str)
+{
+  putchar ('"');
+  for (; *str; str++)
+    {
+      if (*str == '"' || *str == '\\')
+        putchar ('\\');
+      if ((guchar)*str >= 0x20)
+        putchar (*str);
+    }
+  putchar ('"');
+}
+
+static void
+chrome_cb (const gchar  *func,
+           gint          thread,
+           IdeTraceKind  kind,
+           gint64        time,
+           gpointer      user_data)
+{
+  Export *export = user_data;
+  const gchar *phase;
+
+  switch (kind)
+    {
+    case IDE_TRACE_ENTRY: phase = "B"; break;
+    case IDE_TRACE_EXIT:  phase = "E"; break;
+    case IDE_TRACE_PROBE: phase = "i"; break;
+    default:
+      return;
+    }
+
+  g_print ("%s\n{\"name\":", export->first ? "" : ",");
+  print_json_string (func);
+  g_print (",\"ph\":\"%s\",\"ts\":%"G_GINT64_FORMAT",\"pid\":%d,\"tid\":%d}",
+           phase, time, (gint)export->pid, thread);
+
+  export->first = FALSE;
+}
+
+static void
+folded_flush (Export *export,
+              gint64  time)
+{
+  GString *key;
+  gpointer value;
+  guint i;
+
+  if (export->stack->len == 0 || time <= export->last_time)
+    return;
+
+  key = g_string_new (NULL);
+
+  for (i = 0; i < export->stack->len; i++)
+    {
+      if (i > 0)
+        g_string_append_c (key, ';');
+      g_string_append (key, g_ptr_array_index (export->stack, i));
+    }
+
+  value = g_hash_table_lookup (export->folded, key->str);
+  g_hash_table_replace (export->folded,
+                        g_string_free (key, FALSE),
+                        GSIZE_TO_POINTER (GPOINTER_TO_SIZE (value) + (time - export->last_time)));
+}
+
+static void
+folded_cb (const gchar  *func,
+           gint          thread,
+           IdeTraceKind  kind,
+           gint64        time,
+           gpointer      user_data)
+{
+  Export *export = user_data;
+
+  /* Records are delivered one thread at a time */
+  if (thread != export->thread)
+    {
+      g_ptr_array_set_size (export->stack, 0);
+      export->thread = thread;
+      export->last_time = time;
+    }
+
+  /* Attribute the time since the previous record to the current stack */
+  folded_flush (export, time);
+  export->last_time = time;
+
+  if (kind == IDE_TRACE_ENTRY)
+    {
+      g_ptr_array_add (export->stack, g_strdup (func));
+    }
+  else if (kind == IDE_TRACE_EXIT)
+    {
+      guint i;
+
+      /*
+       * The beginning of the ring may have been overwritten, so we can see
+       * exits without a matching entry. Unwind to the matching frame if any.
+       */
+      for (i = export->stack->len; i > 0; i--)
+        {
+          if (g_str_equal (g_ptr_array_index (export->stack, i - 1), func))
+            {
+              g_ptr_array_set_size (export->stack, i - 1);
+              break;
+            }
+        }
+    }
+}
+
+gint
+main (gint   argc,
+      gchar *argv[])
+{
+  GOptionEntry entries[] = {
+    { "format", 'f', 0, G_OPTION_ARG_STRING, &format,
+      "The output format, either chrome or folded", "FORMAT" },
+    { NULL }
+  };
+  g_autoptr(GOptionContext) context = NULL;
+  g_autoptr(GError) error = NULL;
+  Export export = { 0 };
+  gint64 pid;
+
+  context = g_option_context_new ("PID - Export trace spans from a running process");
+  g_option_context_add_main_entries (context, entries, NULL);
+
+  if (!g_option_context_parse (context, &argc, &argv, &error))
+    {
+      g_printerr ("%s\n", error->message);
+      return EXIT_FAILURE;
+    }
+
+  if (argc != 2 ||
+      (pid = g_ascii_strtoll (argv [1], NULL, 10)) <= 0 ||
+      pid > G_MAXINT)
+    {
+      fprintf (stderr, "usage: %s [--format=chrome|folded] <pid>\n", argv [0]);
+      return EXIT_FAILURE;
+    }
+
+  export.pid = (GPid)pid;
+  export.first = TRUE;
+
+  if (format == NULL || g_str_equal (format, "chrome"))
+    {
+      g_print ("{\"traceEvents\":[");
+      if (!ide_trace_read (export.pid, chrome_cb, &export, &error))
+        goto failure;
+      g_print ("\n]}\n");
+    }
+  else if (g_str_equal (format, "folded"))
+    {
+      GHashTableIter iter;
+      gpointer key;
+      gpointer value;
+
+      export.stack = g_ptr_array_new_with_free_func (g_free);
+      export.folded = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+      export.thread = -1;
+
+      if (!ide_trace_read (export.pid, folded_cb, &export, &error))
+        goto failure;
+
+      g_hash_table_iter_init (&iter, export.folded);
+      while (g_hash_table_iter_next (&iter, &key, &value))
+        g_print ("%s %"G_GSIZE_FORMAT"\n", (gchar *)key, GPOINTER_TO_SIZE (value));
+
+      g_ptr_array_unref (export.stack);
+      g_hash_table_unref (export.folded);
+    }
+  else
+    {
+      fprintf (stderr, "Unknown format: %s\n", format);
+      return EXIT_FAILURE;
+    }
+
+  g_free (format);
+
+  return EXIT_SUCCESS;
+
+failure:
+  g_printerr ("%s\n", error->message);
+
+  return EXIT_FAILURE;
+}